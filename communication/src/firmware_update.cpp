@@ -108,6 +108,7 @@ ProtocolError FirmwareUpdate::responseAck(Message* msg) {
         LOG(INFO, "Processing time: %u", (unsigned)stats_.processingTime);
         LOG(INFO, "Chunks received: %u", stats_.receivedChunks);
         LOG(INFO, "Chunk ACKs sent: %u", stats_.sentChunkAcks);
+        LOG(INFO, "Repeated chunk ACKs: %u", stats_.repeatedChunkAcks);
         LOG(INFO, "Duplicate chunks: %u", stats_.duplicateChunks);
         LOG(INFO, "Out-of-order chunks: %u", stats_.outOfOrderChunks);
         LOG(INFO, "Applying firmware update");
@@ -134,31 +135,22 @@ ProtocolError FirmwareUpdate::process() {
     }
     if (unackChunks_ > 0 && millis() - lastChunkTime_ >= OTA_CHUNK_ACK_DELAY) {
         // Send an UpdateAck
-        Message msg;
-        int r = channel_->create(msg);
+        const int r = sendChunkAck();
         if (r != ProtocolError::NO_ERROR) {
-            LOG(ERROR, "Failed to create message");
             return (ProtocolError)r;
         }
-        CoapMessageEncoder e((char*)msg.buf(), msg.capacity());
-        initChunkAck(&e);
-        r = e.encode();
-        if (r < 0) {
-            LOG(ERROR, "Failed to encode message: %d", r);
-            return ProtocolError::INTERNAL;
-        }
-        if (r > (int)msg.capacity()) {
-            LOG(ERROR, "Too large message");
-            return ProtocolError::INSUFFICIENT_STORAGE;
-        }
-        msg.set_length(r);
-        r = channel_->send(msg);
+    } else if (chunkIndex_ < chunkCount_ && millis() - lastChunkTime_ >= ackRepeatDelay_ &&
+            millis() - lastAckTime_ >= ackRepeatDelay_) {
+        // The transfer has stalled, most likely because the last chunks or acknowledgements sent
+        // in either direction were lost. Repeat the acknowledgement so that the server can
+        // retransmit the missing chunks
+        LOG(TRACE, "Repeating UpdateAck; chunk index: %u", chunkIndex_);
+        const int r = sendChunkAck();
         if (r != ProtocolError::NO_ERROR) {
-            LOG(ERROR, "Failed to send message: %d", (int)r);
             return (ProtocolError)r;
         }
-        unackChunks_ = 0;
-        ++stats_.sentChunkAcks;
+        ++stats_.repeatedChunkAcks;
+        ackRepeatDelay_ *= 2;
     }
     if (stateLogChunks_ < chunkIndex_ && millis() - stateLogTime_ >= TRANSFER_STATE_LOG_INTERVAL) {
         const size_t bytesLeft = fileSize_ - fileOffset_;
@@ -451,10 +443,16 @@ int FirmwareUpdate::handleChunkRequest(const CoapMessageDecoder& d, CoapMessageE
                 // Shift the receiver window
                 unsigned bits = 0;
                 while ((bits = trailingOneBits(chunks_[0]))) {
-                    for (size_t i = 0; i < OTA_CHUNK_BITMAP_ELEMENTS; ++i) {
-                        chunks_[i] >>= bits;
-                        if (i < OTA_CHUNK_BITMAP_ELEMENTS - 1) {
-                            chunks_[i] |= chunks_[i + 1] << (32 - bits);
+                    if (bits == 32) {
+                        // Shifting a 32-bit value by 32 bits is undefined behavior
+                        memmove(chunks_, chunks_ + 1, sizeof(chunks_) - sizeof(chunks_[0]));
+                        chunks_[OTA_CHUNK_BITMAP_ELEMENTS - 1] = 0;
+                    } else {
+                        for (size_t i = 0; i < OTA_CHUNK_BITMAP_ELEMENTS; ++i) {
+                            chunks_[i] >>= bits;
+                            if (i < OTA_CHUNK_BITMAP_ELEMENTS - 1) {
+                                chunks_[i] |= chunks_[i + 1] << (32 - bits);
+                            }
                         }
                     }
                     fileOffset_ += bits * chunkSize_;
@@ -490,10 +488,12 @@ int FirmwareUpdate::handleChunkRequest(const CoapMessageDecoder& d, CoapMessageE
         // Send an UpdateAck
         initChunkAck(e);
         unackChunks_ = 0;
+        lastAckTime_ = chunkTime;
         ++stats_.sentChunkAcks;
     }
     hasGaps_ = hasGaps;
     lastChunkTime_ = chunkTime;
+    ackRepeatDelay_ = OTA_CHUNK_ACK_REPEAT_DELAY;
     if (!stats_.transferStartTime) {
         stats_.transferStartTime = chunkTime;
     }
@@ -668,6 +668,36 @@ void FirmwareUpdate::initChunkAck(CoapMessageEncoder* e) {
     e->payload((const char*)chunks_, payloadSize);
 }
 
+int FirmwareUpdate::sendChunkAck() {
+    Message msg;
+    int r = channel_->create(msg);
+    if (r != ProtocolError::NO_ERROR) {
+        LOG(ERROR, "Failed to create message");
+        return r;
+    }
+    CoapMessageEncoder e((char*)msg.buf(), msg.capacity());
+    initChunkAck(&e);
+    r = e.encode();
+    if (r < 0) {
+        LOG(ERROR, "Failed to encode message: %d", r);
+        return ProtocolError::INTERNAL;
+    }
+    if (r > (int)msg.capacity()) {
+        LOG(ERROR, "Too large message");
+        return ProtocolError::INSUFFICIENT_STORAGE;
+    }
+    msg.set_length(r);
+    r = channel_->send(msg);
+    if (r != ProtocolError::NO_ERROR) {
+        LOG(ERROR, "Failed to send message: %d", (int)r);
+        return r;
+    }
+    unackChunks_ = 0;
+    lastAckTime_ = millis();
+    ++stats_.sentChunkAcks;
+    return ProtocolError::NO_ERROR;
+}
+
 int FirmwareUpdate::sendErrorResponse(Message* msg, int error, CoapType type, int id, const char* token,
         size_t tokenSize) {
     msg->clear();
@@ -741,6 +771,8 @@ void FirmwareUpdate::reset() {
     memset(chunks_, 0, sizeof(chunks_));
     stats_ = FirmwareUpdateStats();
     lastChunkTime_ = 0;
+    lastAckTime_ = 0;
+    ackRepeatDelay_ = OTA_CHUNK_ACK_REPEAT_DELAY;
     stateLogTime_ = 0;
     fileSize_ = 0;
     fileOffset_ = 0;
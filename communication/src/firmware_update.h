@@ -95,6 +95,16 @@ const system_tick_t OTA_CHUNK_ACK_DELAY = 200;
  */
 const unsigned OTA_CHUNK_ACK_COUNT = 2;
 
+/**
+ * Delay in milliseconds before the last acknowledgement is repeated if the transfer has stalled.
+ *
+ * If no chunks are received for this amount of time while some chunks are still missing, the
+ * device repeats the acknowledgement so that the server can retransmit the missing chunks without
+ * waiting for its own retransmission timeout. The delay doubles with every repeated acknowledgement
+ * until a new chunk is received.
+ */
+const system_tick_t OTA_CHUNK_ACK_REPEAT_DELAY = 1000;
+
 /**
  * Maximum time to wait for the next chunk before timing out the transfer.
  */
@@ -116,6 +126,7 @@ struct FirmwareUpdateStats {
     system_tick_t processingTime; // System processing time
     unsigned receivedChunks; // Total number of received chunks
     unsigned sentChunkAcks; // Number of sent acknowledgements
+    unsigned repeatedChunkAcks; // Number of acknowledgements repeated due to a stalled transfer
     unsigned outOfOrderChunks; // Number of chunks received out of order
     unsigned duplicateChunks; // Number of duplicate chunks received
 };
@@ -152,6 +163,8 @@ private:
     const SparkCallbacks* callbacks_; // System callbacks
     MessageChannel* channel_; // Message channel
     system_tick_t lastChunkTime_; // Time when the last chunk was received
+    system_tick_t lastAckTime_; // Time when the last acknowledgement was sent
+    system_tick_t ackRepeatDelay_; // Delay before the last acknowledgement is repeated
     system_tick_t stateLogTime_; // Time when the transfer state was last logged
     size_t fileSize_; // File size
     size_t fileOffset_; // Current offset in the file
@@ -180,6 +193,7 @@ private:
             unsigned* chunkIndex);
 
     void initChunkAck(CoapMessageEncoder* e);
+    int sendChunkAck();
 
     int sendErrorResponse(Message* msg, int error, CoapType type, int id, const char* token, size_t tokenSize);
     int sendEmptyAck(Message* msg, CoapType type, CoapMessageId id);
@@ -44,7 +44,8 @@ typedef enum module_info_flags_t {
                                                 // and potentially module_info_suffix_t + CRC in the end of the binary (depending on platform/module)
                                                 // need to be skipped when copying/writing this module into its target location.
     MODULE_INFO_FLAG_COMPRESSED         = 0x02, // Indicates that the module data is compressed.
-    MODULE_INFO_FLAG_COMBINED           = 0x04  // Indicates that this module is combined with another module.
+    MODULE_INFO_FLAG_COMBINED           = 0x04, // Indicates that this module is combined with another module.
+    MODULE_INFO_FLAG_DELTA              = 0x08  // Indicates that the module data is a patch against an installed module.
 } module_info_flags_t;
 
 /**
@@ -200,6 +201,39 @@ typedef struct compressed_module_header {
     uint32_t original_size;
 } __attribute__((__packed__)) compressed_module_header;
 
+/**
+ * Delta module header.
+ *
+ * In a delta module, this header immediately follows the module info header (`module_info_t`) and
+ * precedes the patch data (see `DeltaPatcher` for the description of the patch format). The module
+ * info header describes the module produced by applying the patch.
+ */
+typedef struct delta_module_header {
+    /**
+     * Header size.
+     */
+    uint16_t size;
+    /**
+     * Patch method.
+     *
+     * As of now, the only supported method is 0.
+     */
+    uint8_t method;
+    uint8_t reserved;
+    /**
+     * Size of the patched module, including the CRC.
+     */
+    uint32_t original_size;
+    /**
+     * Size of the base module, including the CRC.
+     */
+    uint32_t base_size;
+    /**
+     * SHA-256 hash of the base module, as stored in its suffix (`module_info_suffix_t`).
+     */
+    uint8_t base_hash[32];
+} __attribute__((__packed__)) delta_module_header;
+
 /*
  * The structure is a suffix to the module, placed before the end symbol
  */
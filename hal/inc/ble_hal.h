@@ -254,6 +254,17 @@ typedef struct hal_ble_desc_init_t {
     hal_ble_attr_handle_t char_handle;
 } hal_ble_desc_init_t;
 
+/* BLE characteristic value streaming statistics */
+typedef struct hal_ble_stream_stats_t {
+    uint16_t version;
+    uint16_t size;
+    size_t bytes;           /**< Number of bytes delivered to the SoftDevice TX queue. */
+    size_t packets;         /**< Number of notifications sent. */
+    size_t queue_full;      /**< Number of times the TX queue was full and the transfer had to wait. */
+    uint32_t duration_ms;   /**< Time taken until all the queued notifications were transmitted. */
+    uint32_t throughput;    /**< Achieved throughput, in bytes per second. */
+} hal_ble_stream_stats_t;
+
 typedef struct hal_ble_conn_info_t {
     uint16_t version;
     uint16_t size;
@@ -1001,6 +1012,24 @@ ssize_t hal_ble_gatt_server_notify_characteristic_value(hal_ble_attr_handle_t va
  */
 ssize_t hal_ble_gatt_server_indicate_characteristic_value(hal_ble_attr_handle_t value_handle, const uint8_t* buf, size_t len, void* reserved);
 
+/**
+ * Stream data of arbitrary length to the subscribers of a Characteristic using notifications.
+ *
+ * The data is split into chunks of the maximum size allowed by the negotiated ATT_MTU of each link,
+ * and the SoftDevice TX queue is kept full until all chunks are queued. Data length extension and
+ * 2M PHY are requested on the link before the first transfer. The BLE lock is released while
+ * waiting for the queued notifications to be transmitted. Only one stream can be in progress at a time.
+ *
+ * @param[in]   value_handle    Characteristic value handle.
+ * @param[in]   buf             Pointer to the buffer that contains the data to be streamed.
+ * @param[in]   len             Length of the data to be streamed.
+ * @param[out]  stats           Pointer to the hal_ble_stream_stats_t structure. Can be NULL.
+ *
+ * @returns     Length of the data has been streamed, system_error_t on error. SYSTEM_ERROR_ABORTED is
+ *              returned if the peer disconnected before all data was transmitted.
+ */
+ssize_t hal_ble_gatt_server_stream_characteristic_value(hal_ble_attr_handle_t value_handle, const uint8_t* buf, size_t len, hal_ble_stream_stats_t* stats, void* reserved);
+
 /**
  * Get Characteristic value.
  *
@@ -29,6 +29,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 /* Includes ------------------------------------------------------------------*/
 
@@ -54,6 +55,16 @@ void HAL_EEPROM_Clear();
 bool HAL_EEPROM_Has_Pending_Erase();
 void HAL_EEPROM_Perform_Pending_Erase();
 
+/**
+ * Write pending changes to the underlying storage.
+ *
+ * @param force If `true`, all pending changes are written. Otherwise, the changes are only written
+ *        if they have been pending for longer than a platform-specific delay.
+ * @param reserved Reserved argument. Must be set to `NULL`.
+ * @return 0 on success or a negative result code in case of an error.
+ */
+int hal_eeprom_flush(bool force, void* reserved);
+
 #ifdef __cplusplus
 }
 #endif
@@ -60,6 +60,15 @@ int hal_exflash_erase_special(hal_exflash_special_sector_t sp, uintptr_t addr, s
 int hal_exflash_special_command(hal_exflash_special_sector_t sp, hal_exflash_command_t cmd, const uint8_t* data, uint8_t* result, size_t size);
 int hal_exflash_sleep(bool sleep, void* reserved);
 
+/**
+ * Waits until the external flash completes a pending erase operation.
+ *
+ * Erase functions return as soon as the flash accepts the last erase command, and any subsequent
+ * access to the flash waits for its completion. This function needs to be called before the
+ * device is reset.
+ */
+int hal_exflash_sync(void* reserved);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif /* __cplusplus */
@@ -109,6 +109,8 @@ DYNALIB_FN(BASE_IDX + 28, hal, hal_exrtc_get_watchdog_limits, void(system_tick_t
 #define BASE_IDX2 (BASE_IDX + 25)
 #endif
 
+DYNALIB_FN(BASE_IDX2 + 0, hal, hal_eeprom_flush, int(bool, void*))
+
 DYNALIB_END(hal)
 
 #undef BASE_IDX
@@ -105,6 +105,7 @@ DYNALIB_FN(70, hal_ble, hal_ble_gap_is_pairing, bool(hal_ble_conn_handle_t, void
 DYNALIB_FN(71, hal_ble, hal_ble_gap_is_paired, bool(hal_ble_conn_handle_t, void*))
 DYNALIB_FN(72, hal_ble, hal_ble_gap_set_pairing_auth_data, int(hal_ble_conn_handle_t, const hal_ble_pairing_auth_data_t*, void*))
 DYNALIB_FN(73, hal_ble, hal_ble_gap_get_pairing_config, int(hal_ble_pairing_config_t*, void*))
+DYNALIB_FN(74, hal_ble, hal_ble_gatt_server_stream_characteristic_value, ssize_t(hal_ble_attr_handle_t, const uint8_t*, size_t, hal_ble_stream_stats_t*, void*))
 
 DYNALIB_END(hal_ble)
 
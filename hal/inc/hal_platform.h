@@ -41,6 +41,11 @@
 #define HAL_PLATFORM_WIFI_NCP_SDIO (0)
 #endif // HAL_PLATFORM_WIFI_NCP_SDIO
 
+// Run the serial link to the Wi-Fi NCP at a higher baud rate with larger buffers
+#ifndef HAL_PLATFORM_WIFI_NCP_HIGH_THROUGHPUT
+#define HAL_PLATFORM_WIFI_NCP_HIGH_THROUGHPUT (0)
+#endif // HAL_PLATFORM_WIFI_NCP_HIGH_THROUGHPUT
+
 #if HAL_PLATFORM_WIFI && HAL_PLATFORM_NCP_AT && !HAL_PLATFORM_WIFI_NCP_SDIO
 # ifndef HAL_PLATFORM_WIFI_SERIAL
 #  error "HAL_PLATFORM_WIFI_SERIAL is not defined"
@@ -327,6 +332,18 @@
 #define HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD (0)
 #endif // HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD
 
+// Maximum number of packet buffers that can be added to the flow control threshold at runtime
+// if the pool still runs out of buffers (0 disables the adaptation)
+#ifndef HAL_PLATFORM_PACKET_BUFFER_ADAPTIVE_RESERVE
+#define HAL_PLATFORM_PACKET_BUFFER_ADAPTIVE_RESERVE (0)
+#endif // HAL_PLATFORM_PACKET_BUFFER_ADAPTIVE_RESERVE
+
+// Size of the buffer used to read ahead sequential reads from the external flash (0 disables
+// the read-ahead)
+#ifndef HAL_PLATFORM_EXFLASH_READ_AHEAD_SIZE
+#define HAL_PLATFORM_EXFLASH_READ_AHEAD_SIZE (0)
+#endif // HAL_PLATFORM_EXFLASH_READ_AHEAD_SIZE
+
 #ifndef HAL_PLATFORM_MUXER_MAY_NEED_DELAY_IN_TX
 #define HAL_PLATFORM_MUXER_MAY_NEED_DELAY_IN_TX (0)
 #endif //HAL_PLATFORM_MUXER_MAY_NEED_DELAY_IN_TX
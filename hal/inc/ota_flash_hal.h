@@ -149,6 +149,29 @@ int HAL_FLASH_Update(const uint8_t *pBuffer, uint32_t address, uint32_t length,
  */
 int HAL_OTA_Flash_Read(uintptr_t address, uint8_t* buffer, size_t size);
 
+/**
+ * Registers a decoded copy of the compressed or delta module stored in the OTA section.
+ *
+ * If the copy passes validation, `HAL_FLASH_OTA_Validate()` and `HAL_FLASH_End()` use it in place of
+ * the module that was received, so that the module doesn't need to be decoded when it's applied.
+ *
+ * @param address Address of the decoded module in the OTA section, or 0 to clear the registration.
+ * @param size Size of the decoded module, including the CRC.
+ * @returns 0 on success or a negative result code in case of an error.
+ */
+int HAL_OTA_Set_Decoded_Module(uintptr_t address, size_t size, void* reserved);
+
+/**
+ * Reads part of an installed module.
+ *
+ * @param module Module info as returned by `HAL_System_Info()`.
+ * @param offset Offset from the start address of the module.
+ * @param buffer Destination buffer.
+ * @param size Number of bytes to read.
+ * @returns 0 on success or a negative result code in case of an error.
+ */
+int HAL_OTA_Read_Module(const hal_module_t* module, uintptr_t offset, uint8_t* buffer, size_t size, void* reserved);
+
 typedef enum {
     HAL_UPDATE_APPLIED = 0,
     HAL_UPDATE_APPLIED_PENDING_RESTART = 1
@@ -217,9 +217,39 @@ typedef void (*if_event_handler_t)(void* arg, if_t iface, const struct if_event*
 
 typedef struct if_event_power_state if_req_power;
 
+/* Header compression statistics of a PPP interface (outgoing direction) */
+typedef struct if_req_ppp_stats {
+    uint32_t tx_frames;
+    uint32_t tx_bytes;
+    uint32_t tx_vj_frames;
+    uint32_t tx_hdr_saved; /* Bytes saved by address/control and protocol field compression */
+    uint32_t tx_vj_saved; /* Bytes saved by VJ TCP/IP header compression (lower bound) */
+} if_req_ppp_stats;
+
+typedef enum if_memp_pool_t {
+    IF_MEMP_POOL_PBUF    = 0,
+    IF_MEMP_POOL_TCP_SEG = 1
+} if_memp_pool_t;
+
+/* Memory pool statistics. The pools are shared by all interfaces */
+typedef struct if_req_memp_stats {
+    uint8_t pool; /* if_memp_pool_t, set by the caller */
+    uint8_t reserved[1];
+    uint16_t size;
+    uint16_t used;
+    uint16_t max; /* High-water mark */
+    uint16_t extra_reserve; /* Buffers added to the flow control threshold at runtime */
+    uint32_t err; /* Allocation failures */
+    uint32_t stalls; /* Number of times the input had to wait for the pool */
+    uint32_t stall_time; /* Total time spent waiting, in milliseconds */
+    uint32_t max_stall_time;
+} if_req_memp_stats;
+
 typedef enum if_req_t {
     IF_REQ_NONE        = 0,
-    IF_REQ_POWER_STATE = 1
+    IF_REQ_POWER_STATE = 1,
+    IF_REQ_PPP_STATS   = 2,
+    IF_REQ_MEMP_STATS  = 3
 } if_req_t;
 
 int if_init(void);
@@ -36,6 +36,10 @@ int BaseNetif::getClientDataId() {
     return clientDataId_;
 }
 
+int BaseNetif::getPppStats(if_req_ppp_stats* stats) const {
+    return -1;
+}
+
 void BaseNetif::registerHandlers() {
     LwipTcpIpCoreLock lk;
     std::call_once(once_, []() {
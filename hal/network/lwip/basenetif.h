@@ -38,6 +38,7 @@ public:
 
     virtual int getPowerState(if_power_state_t* state) const = 0;
     virtual int getNcpState(unsigned int* state) const = 0;
+    virtual int getPppStats(if_req_ppp_stats* stats) const;
 
 protected:
     void registerHandlers();
@@ -251,6 +251,16 @@ int PppNcpNetif::getNcpState(unsigned int* state) const {
     return SYSTEM_ERROR_NONE;
 }
 
+int PppNcpNetif::getPppStats(if_req_ppp_stats* stats) const {
+    const auto& c = client_.frameStats();
+    stats->tx_frames = c.frames;
+    stats->tx_bytes = c.bytes;
+    stats->tx_vj_frames = c.vjFrames;
+    stats->tx_hdr_saved = c.hdrSaved;
+    stats->tx_vj_saved = c.vjSaved;
+    return SYSTEM_ERROR_NONE;
+}
+
 int PppNcpNetif::upImpl() {
     client_.setOutputCallback([](const uint8_t* data, size_t size, void* ctx) -> int {
         auto c = (CellularNcpClient*)ctx;
@@ -331,6 +341,9 @@ void PppNcpNetif::pppEventHandler(uint64_t ev) {
         if (connectStart_ == 0) {
             connectStart_ = HAL_Timer_Get_Milli_Seconds();
         }
+        // Don't let the peer send us frames larger than the modem can pass through
+        const auto ncpMtu = celMan_->ncpClient()->getMtu();
+        client_.setMru(ncpMtu > 0 ? ncpMtu : 0);
     }
 }
 
@@ -411,6 +424,7 @@ int PppNcpNetif::ncpDataHandlerCb(int id, const uint8_t* data, size_t size, void
     PppNcpNetif* self = static_cast<PppNcpNetif*>(ctx);
     int r = self->client_.input(data, size);
     if (r == SYSTEM_ERROR_NO_MEMORY) {
+        lwip_memp_stall_begin(MEMP_PBUF_POOL);
         self->celMan_->ncpClient()->dataChannelFlowControl(true);
     }
     return r;
@@ -418,7 +432,8 @@ int PppNcpNetif::ncpDataHandlerCb(int id, const uint8_t* data, size_t size, void
 
 void PppNcpNetif::mempEventHandler(memp_t type, unsigned available, unsigned size, void* ctx) {
     PppNcpNetif* self = static_cast<PppNcpNetif*>(ctx);
-    if (available > HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD) {
+    if (available > self->client_.inputFlowControlThreshold()) {
+        lwip_memp_stall_end(MEMP_PBUF_POOL);
         self->celMan_->ncpClient()->dataChannelFlowControl(false);
     }
 }
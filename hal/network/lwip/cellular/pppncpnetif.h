@@ -49,6 +49,7 @@ public:
 
     virtual int getPowerState(if_power_state_t* state) const override;
     virtual int getNcpState(unsigned int* state) const override;
+    virtual int getPppStats(if_req_ppp_stats* stats) const override;
 
     static int ncpDataHandlerCb(int id, const uint8_t* data, size_t size, void* ctx);
     static void ncpEventHandlerCb(const NcpEvent& ev, void* ctx);
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dns_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <strings.h>
+
+using namespace particle::net;
+
+namespace {
+
+const uint32_t STORAGE_MAGIC = 0x444e5343; // "DNSC"
+const uint16_t STORAGE_VERSION = 1;
+
+const uint16_t DNS_FLAG_QR = 0x8000;
+const uint16_t DNS_FLAG_OPCODE_MASK = 0x7800;
+const uint16_t DNS_FLAG_TC = 0x0200;
+const uint16_t DNS_RCODE_MASK = 0x000f;
+const uint16_t DNS_RCODE_NOERROR = 0;
+
+const uint16_t DNS_TYPE_A = 1;
+const uint16_t DNS_TYPE_AAAA = 28;
+const uint16_t DNS_CLASS_IN = 1;
+
+const uint8_t DNS_LABEL_POINTER = 0xc0;
+const size_t DNS_MAX_LABEL_SIZE = 63;
+const unsigned DNS_MAX_POINTER_JUMPS = 16;
+
+inline uint16_t read16(const uint8_t* p) {
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+inline uint32_t read32(const uint8_t* p) {
+    return ((uint32_t)read16(p) << 16) | read16(p + 2);
+}
+
+inline uint16_t queryType(const DnsCache::Query& query) {
+    return (query.type == DnsCache::ENTRY_NO_IPV6) ? DNS_TYPE_AAAA : DNS_TYPE_A;
+}
+
+// Parses an encoded domain name at the specified offset. Returns the offset of the data
+// following the name, or 0 in case of an error. If `name` is not null, the name is also
+// decoded into the buffer
+size_t readName(const uint8_t* data, size_t size, size_t offs, char* name, size_t nameSize, bool* nameTooLong) {
+    size_t end = 0;
+    size_t nameLen = 0;
+    unsigned jumps = 0;
+    for (;;) {
+        if (offs >= size) {
+            return 0;
+        }
+        const uint8_t n = data[offs];
+        if ((n & DNS_LABEL_POINTER) == DNS_LABEL_POINTER) {
+            if (offs + 2 > size || ++jumps > DNS_MAX_POINTER_JUMPS) {
+                return 0;
+            }
+            if (!end) {
+                end = offs + 2;
+            }
+            offs = read16(data + offs) & 0x3fff;
+            continue;
+        }
+        if (n > DNS_MAX_LABEL_SIZE || offs + 1 + n > size) {
+            return 0;
+        }
+        if (n == 0) {
+            if (!end) {
+                end = offs + 1;
+            }
+            break;
+        }
+        if (name) {
+            const size_t len = nameLen + (nameLen ? 1 : 0) + n;
+            if (len < nameSize) {
+                if (nameLen) {
+                    name[nameLen] = '.';
+                }
+                memcpy(name + len - n, data + offs + 1, n);
+                name[len] = '\0';
+            } else {
+                *nameTooLong = true;
+            }
+            nameLen = len;
+        }
+        offs += 1 + n;
+    }
+    if (name && !nameLen && nameSize) {
+        name[0] = '\0';
+    }
+    return end;
+}
+
+} // unnamed
+
+const uint32_t DnsCache::MAX_TTL;
+const uint32_t DnsCache::MIN_REFRESH_MARGIN;
+
+DnsCache::DnsCache(Storage* storage) :
+        storage_(storage),
+        stats_() {
+}
+
+void DnsCache::init() {
+    if (storage_->magic != STORAGE_MAGIC || storage_->version != STORAGE_VERSION || storage_->entrySize != sizeof(Entry)) {
+        memset(storage_, 0, sizeof(Storage));
+        storage_->magic = STORAGE_MAGIC;
+        storage_->version = STORAGE_VERSION;
+        storage_->entrySize = sizeof(Entry);
+        return;
+    }
+    for (auto& e: storage_->entries) {
+        if ((e.type != ENTRY_IPV4 && e.type != ENTRY_NO_IPV6) || !memchr(e.name, '\0', sizeof(e.name))) {
+            memset(&e, 0, sizeof(e));
+        }
+        // Any pending refresh didn't survive
+        e.refreshRequested = 0;
+    }
+}
+
+DnsCache::LookupResult DnsCache::lookup(const char* name, EntryType type, uint32_t now, uint32_t* addr) {
+    const auto e = find(name, type);
+    if (!e) {
+        ++stats_.misses;
+        return LOOKUP_MISS;
+    }
+    if (now >= e->expires || e->expires - now > e->ttl) {
+        // Expired, or the clock went backwards
+        memset(e, 0, sizeof(Entry));
+        ++stats_.misses;
+        return LOOKUP_MISS;
+    }
+    ++stats_.hits;
+    if (addr) {
+        *addr = e->addr;
+    }
+    if (type == ENTRY_IPV4) {
+        const uint32_t margin = std::max(e->ttl >> REFRESH_MARGIN_SHIFT, MIN_REFRESH_MARGIN);
+        if (e->expires - now <= margin && (!e->refreshRequested || now - e->refreshRequested >= REFRESH_RETRY_INTERVAL)) {
+            e->refreshRequested = now;
+            ++stats_.refreshes;
+            return LOOKUP_HIT_REFRESH;
+        }
+    }
+    return LOOKUP_HIT;
+}
+
+void DnsCache::update(const char* name, EntryType type, uint32_t addr, uint32_t ttl, uint32_t now) {
+    if (!name || strlen(name) >= MAX_NAME_SIZE || ttl == 0) {
+        return;
+    }
+    auto e = find(name, type);
+    if (!e) {
+        e = alloc(now);
+    }
+    memset(e, 0, sizeof(Entry));
+    strcpy(e->name, name);
+    e->type = type;
+    e->addr = addr;
+    e->ttl = std::min(ttl, MAX_TTL);
+    e->expires = now + e->ttl;
+    ++stats_.updates;
+}
+
+void DnsCache::remove(const char* name, EntryType type) {
+    const auto e = find(name, type);
+    if (e) {
+        memset(e, 0, sizeof(Entry));
+    }
+}
+
+void DnsCache::clear() {
+    memset(storage_->entries, 0, sizeof(storage_->entries));
+}
+
+bool DnsCache::processResponse(const uint8_t* data, size_t size, const Query& query, uint32_t now) {
+    if (size < DNS_HEADER_SIZE || read16(data) != query.id) {
+        return false;
+    }
+    const uint16_t flags = read16(data + 2);
+    const uint16_t qdCount = read16(data + 4);
+    const uint16_t anCount = read16(data + 6);
+    // Only standard responses for a single question that weren't truncated
+    if (!(flags & DNS_FLAG_QR) || (flags & (DNS_FLAG_OPCODE_MASK | DNS_FLAG_TC)) ||
+            (flags & DNS_RCODE_MASK) != DNS_RCODE_NOERROR || qdCount != 1) {
+        return false;
+    }
+    char name[MAX_NAME_SIZE] = {};
+    bool nameTooLong = false;
+    size_t offs = readName(data, size, DNS_HEADER_SIZE, name, sizeof(name), &nameTooLong);
+    if (!offs || nameTooLong || !name[0] || offs + 4 > size) {
+        return false;
+    }
+    const uint16_t qType = read16(data + offs);
+    const uint16_t qClass = read16(data + offs + 2);
+    offs += 4;
+    if (qClass != DNS_CLASS_IN || qType != queryType(query) || strcasecmp(name, query.name) != 0) {
+        return false;
+    }
+    uint32_t addr = 0;
+    bool hasAddr = false;
+    uint32_t ttl = MAX_TTL;
+    for (unsigned i = 0; i < anCount; ++i) {
+        offs = readName(data, size, offs, nullptr, 0, nullptr);
+        if (!offs || offs + 10 > size) {
+            return false;
+        }
+        const uint16_t type = read16(data + offs);
+        const uint16_t cls = read16(data + offs + 2);
+        const uint32_t rrTtl = read32(data + offs + 4);
+        const uint16_t rdLen = read16(data + offs + 8);
+        offs += 10;
+        if (offs + rdLen > size) {
+            return false;
+        }
+        if (cls == DNS_CLASS_IN) {
+            // The TTL of a CNAME chain is limited by each of its records
+            ttl = std::min(ttl, rrTtl);
+            if (type == qType) {
+                if (type == DNS_TYPE_A && rdLen == 4 && !hasAddr) {
+                    memcpy(&addr, data + offs, 4);
+                }
+                hasAddr = true;
+            }
+        }
+        offs += rdLen;
+    }
+    if (qType == DNS_TYPE_A) {
+        if (!hasAddr) {
+            return false;
+        }
+        update(name, ENTRY_IPV4, addr, ttl, now);
+    } else if (hasAddr) {
+        // IPv6 addresses are not cached, but the host has them
+        remove(name, ENTRY_NO_IPV6);
+        return false;
+    } else {
+        update(name, ENTRY_NO_IPV6, 0, NEGATIVE_TTL, now);
+    }
+    return true;
+}
+
+size_t DnsCache::formatQuery(const Query& query, uint8_t* buf, size_t size) {
+    const char* const name = query.name;
+    const size_t nameLen = strnlen(name, sizeof(query.name));
+    // Header, encoded name, type and class
+    const size_t msgSize = DNS_HEADER_SIZE + nameLen + 2 + 4;
+    if (!nameLen || nameLen == sizeof(query.name) || msgSize > size) {
+        return 0;
+    }
+    memset(buf, 0, DNS_HEADER_SIZE);
+    buf[0] = query.id >> 8;
+    buf[1] = query.id & 0xff;
+    buf[2] = 0x01; // RD
+    buf[5] = 1; // QDCOUNT
+    uint8_t* p = buf + DNS_HEADER_SIZE;
+    const char* label = name;
+    for (;;) {
+        const char* dot = strchr(label, '.');
+        const size_t n = dot ? dot - label : strlen(label);
+        if (n == 0 || n > DNS_MAX_LABEL_SIZE) {
+            if (!dot && n == 0 && label != name) {
+                break; // Trailing dot
+            }
+            return 0;
+        }
+        *p++ = n;
+        memcpy(p, label, n);
+        p += n;
+        if (!dot) {
+            break;
+        }
+        label = dot + 1;
+    }
+    *p++ = 0;
+    const uint16_t type = queryType(query);
+    *p++ = type >> 8;
+    *p++ = type & 0xff;
+    *p++ = DNS_CLASS_IN >> 8;
+    *p++ = DNS_CLASS_IN & 0xff;
+    return p - buf;
+}
+
+DnsCache::Entry* DnsCache::find(const char* name, EntryType type) {
+    if (!name) {
+        return nullptr;
+    }
+    for (auto& e: storage_->entries) {
+        if (e.type == type && strcasecmp(e.name, name) == 0) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+DnsCache::Entry* DnsCache::alloc(uint32_t now) {
+    Entry* entry = nullptr;
+    for (auto& e: storage_->entries) {
+        if (e.type == ENTRY_NONE || now >= e.expires) {
+            return &e;
+        }
+        // Evict the entry that expires first
+        if (!entry || e.expires < entry->expires) {
+            entry = &e;
+        }
+    }
+    return entry;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAL_NETWORK_LWIP_DNS_CACHE_H
+#define HAL_NETWORK_LWIP_DNS_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __cplusplus
+
+namespace particle { namespace net {
+
+/**
+ * Host name cache that is kept in memory surviving sleep and reset (retained RAM).
+ *
+ * The cache is populated from the responses to its own DNS queries, so that the entries expire
+ * according to the TTLs returned by the server. Besides IPv4 addresses, the cache remembers names that have
+ * no IPv6 addresses, so that AF_UNSPEC lookups don't need a round trip for the AAAA query.
+ *
+ * All times are in seconds since the Unix epoch, as the cache needs to outlive the system tick
+ * counter. The class is not thread-safe.
+ */
+class DnsCache {
+public:
+    static const size_t MAX_NAME_SIZE = 48; // Including the terminating null
+    static const size_t MAX_ENTRY_COUNT = 4;
+    // How long a name is known to have no IPv6 addresses (RFC 2308 suggests 1-3 hours at most)
+    static const uint32_t NEGATIVE_TTL = 5 * 60;
+    static const uint32_t MAX_TTL = 7 * 24 * 60 * 60;
+    // An entry is refreshed once this part of its TTL is left (1/8), but not earlier than
+    // MIN_REFRESH_MARGIN seconds before its expiration
+    static const unsigned REFRESH_MARGIN_SHIFT = 3;
+    static const uint32_t MIN_REFRESH_MARGIN = 30;
+    static const uint32_t REFRESH_RETRY_INTERVAL = 10;
+
+    static const uint16_t DNS_PORT = 53;
+    static const size_t DNS_HEADER_SIZE = 12;
+
+    enum EntryType {
+        ENTRY_NONE = 0,
+        ENTRY_IPV4 = 1, ///< IPv4 address.
+        ENTRY_NO_IPV6 = 2 ///< The name has no IPv6 addresses.
+    };
+
+    enum LookupResult {
+        LOOKUP_MISS = 0,
+        LOOKUP_HIT = 1,
+        LOOKUP_HIT_REFRESH = 2 ///< The entry is about to expire and needs to be refreshed.
+    };
+
+    struct Entry {
+        char name[MAX_NAME_SIZE];
+        uint32_t addr; // Network byte order
+        uint32_t expires;
+        uint32_t ttl;
+        uint32_t refreshRequested;
+        uint8_t type;
+        uint8_t reserved[3];
+    };
+
+    struct Storage {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t entrySize;
+        Entry entries[MAX_ENTRY_COUNT];
+    };
+
+    /**
+     * Query sent on behalf of the cache.
+     */
+    struct Query {
+        char name[MAX_NAME_SIZE];
+        uint16_t id;
+        uint8_t type; // ENTRY_IPV4 for an A query, ENTRY_NO_IPV6 for an AAAA query
+    };
+
+    struct Stats {
+        unsigned hits;
+        unsigned misses;
+        unsigned updates;
+        unsigned refreshes;
+    };
+
+    explicit DnsCache(Storage* storage);
+
+    /**
+     * Validates the storage contents and drops them if they weren't written by this class.
+     */
+    void init();
+    /**
+     * Looks up an entry of the given type.
+     *
+     * @param name Host name.
+     * @param type Entry type.
+     * @param now Current time.
+     * @param addr IPv4 address of the host (network byte order).
+     */
+    LookupResult lookup(const char* name, EntryType type, uint32_t now, uint32_t* addr = nullptr);
+    /**
+     * Adds or updates an entry.
+     */
+    void update(const char* name, EntryType type, uint32_t addr, uint32_t ttl, uint32_t now);
+    /**
+     * Removes an entry.
+     */
+    void remove(const char* name, EntryType type);
+    /**
+     * Removes all entries.
+     */
+    void clear();
+    /**
+     * Updates the cache with the contents of a DNS response message.
+     *
+     * The response is ignored unless its ID and question match the query.
+     *
+     * @return `true` if the cache was updated.
+     */
+    bool processResponse(const uint8_t* data, size_t size, const Query& query, uint32_t now);
+
+    const Stats& stats() const;
+
+    /**
+     * Formats a query message.
+     *
+     * @return Size of the message, or 0 if the buffer is too small or the name is invalid.
+     */
+    static size_t formatQuery(const Query& query, uint8_t* buf, size_t size);
+
+private:
+    Storage* storage_;
+    Stats stats_;
+
+    Entry* find(const char* name, EntryType type);
+    Entry* alloc(uint32_t now);
+};
+
+inline const DnsCache::Stats& DnsCache::stats() const {
+    return stats_;
+}
+
+} } /* namespace particle::net */
+
+#endif /* __cplusplus */
+
+#endif /* HAL_NETWORK_LWIP_DNS_CACHE_H */
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logging.h"
+LOG_SOURCE_CATEGORY("net.dns")
+
+#include "dns_cache.h"
+#include "lwiplock.h"
+#include "lwiphooks.h"
+#include "rtc_hal.h"
+#include "platform_headers.h"
+#include <lwip/dns.h>
+#include <lwip/udp.h>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <cstring>
+#include <strings.h>
+
+using namespace particle::net;
+
+namespace {
+
+const size_t MAX_RESPONSE_SIZE = 512;
+const size_t MAX_PENDING_QUERY_COUNT = 4;
+const uint32_t QUERY_TIMEOUT = 5; // Seconds
+const uint16_t MIN_LOCAL_PORT = 1024;
+const unsigned MAX_BIND_ATTEMPTS = 5;
+
+struct PendingQuery {
+    DnsCache::Query query; // The type is set to ENTRY_NONE if the entry is not used
+    uint32_t time;
+};
+
+// Survives resets and sleep. The contents are validated by DnsCache::init()
+retained_system DnsCache::Storage sCacheStorage;
+
+DnsCache sCache(&sCacheStorage);
+bool sCacheInitialized = false;
+udp_pcb* sQueryPcb = nullptr;
+PendingQuery sQueries[MAX_PENDING_QUERY_COUNT] = {};
+unsigned sNextQuery = 0;
+
+// Returns 0 if the RTC is not set, in which case the cache is not used
+uint32_t currentTime() {
+    if (!hal_rtc_time_is_valid(nullptr)) {
+        return 0;
+    }
+    struct timeval tv = {};
+    if (hal_rtc_get_time(&tv, nullptr) != 0) {
+        return 0;
+    }
+    return tv.tv_sec;
+}
+
+DnsCache* cache() {
+    if (!sCacheInitialized) {
+        sCache.init();
+        sCacheInitialized = true;
+    }
+    return &sCache;
+}
+
+bool isDnsServer(const ip_addr_t* addr) {
+    for (unsigned i = 0; i < DNS_MAX_SERVERS; ++i) {
+        const ip_addr_t* server = dns_getserver(i);
+        if (server && IP_IS_V4(server) && ip_addr_cmp(server, addr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Only the responses that arrive at the port of the query socket, come from a configured DNS
+// server and match the ID and question of a pending query are used to update the cache.
+// lwIP's resolver performs the same checks on its own responses
+void queryPcbRecv(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, u16_t port) {
+    const uint32_t now = currentTime();
+    if (!now || port != DnsCache::DNS_PORT || !isDnsServer(addr) || p->tot_len < DnsCache::DNS_HEADER_SIZE) {
+        pbuf_free(p);
+        return;
+    }
+    const size_t size = std::min<size_t>(p->tot_len, MAX_RESPONSE_SIZE);
+    std::unique_ptr<uint8_t[]> buf(new(std::nothrow) uint8_t[size]);
+    if (!buf || pbuf_copy_partial(p, buf.get(), size, 0) != size) {
+        pbuf_free(p);
+        return;
+    }
+    pbuf_free(p);
+    const uint16_t id = ((uint16_t)buf[0] << 8) | buf[1];
+    for (auto& q: sQueries) {
+        if (q.query.type != DnsCache::ENTRY_NONE && q.query.id == id) {
+            if (cache()->processResponse(buf.get(), size, q.query, now)) {
+                LOG_DEBUG(TRACE, "Updated DNS cache");
+            }
+            q.query.type = DnsCache::ENTRY_NONE;
+            break;
+        }
+    }
+}
+
+// Sends a query for the name on the side. The cache can't learn from lwIP's own queries, as
+// their IDs and ports are private to the resolver, and lwIP would answer a refresh from its
+// own table while the name hasn't expired there
+void sendQuery(const char* name, DnsCache::EntryType type, uint32_t now) {
+    const ip_addr_t* server = dns_getserver(0);
+    if (!server || ip_addr_isany(server) || !IP_IS_V4(server) || strlen(name) >= DnsCache::MAX_NAME_SIZE) {
+        return;
+    }
+    for (const auto& q: sQueries) {
+        if (q.query.type == type && now - q.time < QUERY_TIMEOUT && strcasecmp(q.query.name, name) == 0) {
+            return; // Already pending
+        }
+    }
+    if (!sQueryPcb) {
+        sQueryPcb = udp_new_ip_type(IPADDR_TYPE_V4);
+        if (!sQueryPcb) {
+            return;
+        }
+        // Use a random local port, as lwIP's resolver does with LWIP_DNS_SECURE_RAND_SRC_PORT
+        err_t r = ERR_USE;
+        for (unsigned i = 0; i < MAX_BIND_ATTEMPTS && r != ERR_OK; ++i) {
+            r = udp_bind(sQueryPcb, IP4_ADDR_ANY, MIN_LOCAL_PORT + LWIP_RAND() % (0x10000 - MIN_LOCAL_PORT));
+        }
+        if (r != ERR_OK) {
+            udp_remove(sQueryPcb);
+            sQueryPcb = nullptr;
+            return;
+        }
+        udp_recv(sQueryPcb, queryPcbRecv, nullptr);
+    }
+    // Replace the oldest query if there are too many pending queries
+    auto& pending = sQueries[sNextQuery];
+    sNextQuery = (sNextQuery + 1) % MAX_PENDING_QUERY_COUNT;
+    pending.time = now;
+    auto& q = pending.query;
+    strcpy(q.name, name);
+    q.id = LWIP_RAND();
+    q.type = type;
+    const size_t size = DnsCache::DNS_HEADER_SIZE + DnsCache::MAX_NAME_SIZE + 6;
+    pbuf* p = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_RAM);
+    if (!p) {
+        q.type = DnsCache::ENTRY_NONE;
+        return;
+    }
+    const size_t n = DnsCache::formatQuery(q, (uint8_t*)p->payload, p->len);
+    if (n > 0) {
+        pbuf_realloc(p, n);
+        LOG_DEBUG(TRACE, "Querying %s", name);
+        udp_sendto(sQueryPcb, p, server, DnsCache::DNS_PORT);
+    } else {
+        q.type = DnsCache::ENTRY_NONE;
+    }
+    pbuf_free(p);
+}
+
+} // anonymous
+
+int lwip_hook_netconn_external_resolve(const char* name, ip_addr_t* addr, u8_t addrtype, err_t* err) {
+    const uint32_t now = currentTime();
+    if (!now) {
+        return 0;
+    }
+    LwipTcpIpCoreLock lk;
+    auto c = cache();
+    if (addrtype == LWIP_DNS_ADDRTYPE_IPV6) {
+        // Short-circuit the AAAA query if the name is known to have no IPv6 addresses
+        if (c->lookup(name, DnsCache::ENTRY_NO_IPV6, now) != DnsCache::LOOKUP_MISS) {
+            *err = ERR_VAL;
+            return 1;
+        }
+        sendQuery(name, DnsCache::ENTRY_NO_IPV6, now);
+        return 0;
+    }
+    if (addrtype == LWIP_DNS_ADDRTYPE_IPV6_IPV4 && c->lookup(name, DnsCache::ENTRY_NO_IPV6, now) == DnsCache::LOOKUP_MISS) {
+        // The IPv6 address would be preferred
+        sendQuery(name, DnsCache::ENTRY_NO_IPV6, now);
+        return 0;
+    }
+    uint32_t ip = 0;
+    const auto r = c->lookup(name, DnsCache::ENTRY_IPV4, now, &ip);
+    if (r != DnsCache::LOOKUP_HIT) {
+        // Populate or refresh the entry while lwIP resolves the name or the cached address is used
+        sendQuery(name, DnsCache::ENTRY_IPV4, now);
+        if (r == DnsCache::LOOKUP_MISS) {
+            return 0;
+        }
+    }
+    ip_addr_set_ip4_u32(addr, ip);
+    *err = ERR_OK;
+    return 1;
+}
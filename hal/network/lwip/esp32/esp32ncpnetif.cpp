@@ -377,7 +377,8 @@ int Esp32NcpNetif::ncpDataHandlerCb(int id, const uint8_t* data, size_t size, vo
         /* drop the padding word */
         pbuf_remove_header(p, ETH_PAD_SIZE);
 #endif /* ETH_PAD_SIZE */
-        memcpy(p->payload, data, size);
+        // The frame may span several pool buffers if it doesn't fit into one
+        pbuf_take(p, data, size);
 #if ETH_PAD_SIZE
         /* reclaim the padding word */
         pbuf_add_header(p, ETH_PAD_SIZE);
@@ -393,7 +394,8 @@ int Esp32NcpNetif::ncpDataHandlerCb(int id, const uint8_t* data, size_t size, vo
 
     int poolAvail = MEMP_STATS_GET(avail, MEMP_PBUF_POOL) - MEMP_STATS_GET(used, MEMP_PBUF_POOL);
 
-    if (!p || err == ERR_MEM || poolAvail <= HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD) {
+    if (!p || err == ERR_MEM || poolAvail <= (int)lwip_memp_reserve(MEMP_PBUF_POOL, HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD)) {
+        lwip_memp_stall_begin(MEMP_PBUF_POOL);
         self->wifiMan_->ncpClient()->dataChannelFlowControl(true);
 #ifdef DEBUG_BUILD
         if (!p || err == ERR_MEM) {
@@ -467,7 +469,8 @@ void Esp32NcpNetif::netifEventHandler(netif_nsc_reason_t reason, const netif_ext
 
 void Esp32NcpNetif::mempEventHandler(memp_t type, unsigned available, unsigned size, void* ctx) {
     Esp32NcpNetif* self = static_cast<Esp32NcpNetif*>(ctx);
-    if (available > HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD) {
+    if (available > lwip_memp_reserve(MEMP_PBUF_POOL, HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD)) {
+        lwip_memp_stall_end(MEMP_PBUF_POOL);
         self->wifiMan_->ncpClient()->dataChannelFlowControl(false);
     }
 }
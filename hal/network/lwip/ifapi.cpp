@@ -33,6 +33,7 @@ extern "C" {
 
 #include "resolvapi.h"
 #include "basenetif.h"
+#include "memp_hook.h"
 #include "check.h"
 
 using namespace particle::net;
@@ -57,6 +58,40 @@ BaseNetif* getBaseNetif(if_t iface) {
     return (BaseNetif*)netif_get_client_data(iface, idx);
 }
 
+int getMempStats(void* req, size_t reqsize) {
+    if (reqsize != sizeof(if_req_memp_stats)) {
+        return -1;
+    }
+
+    auto sreq = (if_req_memp_stats*)req;
+    memp_t type;
+    switch (sreq->pool) {
+        case IF_MEMP_POOL_PBUF: {
+            type = MEMP_PBUF_POOL;
+            break;
+        }
+        case IF_MEMP_POOL_TCP_SEG: {
+            type = MEMP_TCP_SEG;
+            break;
+        }
+        default: {
+            return -1;
+        }
+    }
+
+    lwip_memp_stats stats = {};
+    CHECK_TRUE(lwip_memp_get_stats(type, &stats) == 0, -1);
+    sreq->size = stats.size;
+    sreq->used = stats.used;
+    sreq->max = stats.max;
+    sreq->extra_reserve = stats.extra_reserve;
+    sreq->err = stats.err;
+    sreq->stalls = stats.stalls;
+    sreq->stall_time = stats.stall_time;
+    sreq->max_stall_time = stats.max_stall_time;
+    return 0;
+}
+
 struct EventHandlerList {
     EventHandlerList* next;
     if_t iface;
@@ -1151,6 +1186,11 @@ int if_event_handler_del(if_event_handler_cookie_t cookie) {
 }
 
 int if_request(if_t iface, int type, void* req, size_t reqsize, void* reserved) {
+    if (type == IF_REQ_MEMP_STATS) {
+        /* Not specific to the interface */
+        return getMempStats(req, reqsize);
+    }
+
     LwipTcpIpCoreLock lk;
 
     if (!netif_validate(iface)) {
@@ -1174,6 +1214,16 @@ int if_request(if_t iface, int type, void* req, size_t reqsize, void* reserved)
             break;
         }
 
+        case IF_REQ_PPP_STATS: {
+            if (reqsize != sizeof(if_req_ppp_stats)) {
+                return -1;
+            }
+
+            auto bnetif = getBaseNetif(iface);
+            CHECK_TRUE(bnetif, -1);
+            return bnetif->getPppStats((if_req_ppp_stats*)req);
+        }
+
         default: {
             return -1;
         }
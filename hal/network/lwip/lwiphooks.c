@@ -68,4 +68,10 @@ __attribute__((weak)) int lwip_hook_ip6_forward_post_routing(struct pbuf* p, str
 
 __attribute__((weak)) struct netif* lwip_hook_ip6_route(const ip6_addr_t* src, const ip6_addr_t* dst) {
     return NULL;
-}
\ No newline at end of file
+}
+/* Netconn hooks */
+#if LWIP_DNS
+__attribute__((weak)) int lwip_hook_netconn_external_resolve(const char* name, ip_addr_t* addr, u8_t addrtype, err_t* err) {
+    return 0;
+}
+#endif /* LWIP_DNS */
@@ -21,6 +21,13 @@
 #include "lwiplock.h"
 #include "lwip_util.h"
 #include "lwiphooks.h"
+#include "memp_monitor.h"
+#include "timer_hal.h"
+#include "hal_platform.h"
+#include <lwip/stats.h>
+#include <lwip/sys.h>
+
+using particle::net::PoolMonitor;
 
 namespace {
 
@@ -33,13 +40,41 @@ struct EventHandlerList {
 
 EventHandlerList* sEventHandlerList = nullptr;
 
+struct MonitoredPool {
+    memp_t type;
+    PoolMonitor monitor;
+};
+
+// Only the pools that are subject to flow control are monitored for stalls
+MonitoredPool sMonitoredPools[] = {
+    { MEMP_PBUF_POOL, PoolMonitor(HAL_PLATFORM_PACKET_BUFFER_ADAPTIVE_RESERVE) },
+    { MEMP_TCP_SEG, PoolMonitor() }
+};
+
+PoolMonitor* poolMonitor(memp_t type) {
+    for (auto& p: sMonitoredPools) {
+        if (p.type == type) {
+            return &p.monitor;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t poolErrCount(memp_t type) {
+#if MEMP_STATS
+    return MEMP_STATS_GET(err, type);
+#else
+    return 0;
+#endif // MEMP_STATS
+}
+
 } // anonymous
 
 typedef void (*lwip_memp_event_handler_t)(memp_t type, unsigned available, unsigned size, void* ctx);
 
 void lwip_hook_memp_free(memp_t type, unsigned available, unsigned size) {
     for (EventHandlerList* h = sEventHandlerList; h != nullptr; h = h->next) {
-        if (h->type == type && h->handler) {
+        if ((h->type == type || h->type == LWIP_MEMP_ANY) && h->handler) {
             h->handler(type, available, size, h->ctx);
         }
     }
@@ -59,3 +94,61 @@ int lwip_memp_event_handler_add(lwip_memp_event_handler_t handler, memp_t type,
 
     return 0;
 }
+
+int lwip_memp_get_stats(memp_t type, lwip_memp_stats* stats) {
+    CHECK_TRUE(type < MEMP_MAX && stats, SYSTEM_ERROR_INVALID_ARGUMENT);
+    *stats = {};
+#if MEMP_STATS
+    stats->size = MEMP_STATS_GET(avail, type);
+    stats->used = MEMP_STATS_GET(used, type);
+    stats->max = MEMP_STATS_GET(max, type);
+    stats->err = MEMP_STATS_GET(err, type);
+#endif // MEMP_STATS
+    auto m = poolMonitor(type);
+    if (m) {
+        SYS_ARCH_DECL_PROTECT(lev);
+        SYS_ARCH_PROTECT(lev);
+        const auto s = m->stats();
+        SYS_ARCH_UNPROTECT(lev);
+        stats->stalls = s.stalls;
+        stats->stall_time = s.stallTime;
+        stats->max_stall_time = s.maxStallTime;
+        stats->extra_reserve = s.extraReserve;
+    }
+    return 0;
+}
+
+void lwip_memp_stall_begin(memp_t type) {
+    auto m = poolMonitor(type);
+    if (m) {
+        SYS_ARCH_DECL_PROTECT(lev);
+        SYS_ARCH_PROTECT(lev);
+        m->stallBegin(HAL_Timer_Get_Milli_Seconds());
+        SYS_ARCH_UNPROTECT(lev);
+    }
+}
+
+void lwip_memp_stall_end(memp_t type) {
+    auto m = poolMonitor(type);
+    if (m) {
+        SYS_ARCH_DECL_PROTECT(lev);
+        SYS_ARCH_PROTECT(lev);
+        m->stallEnd(HAL_Timer_Get_Milli_Seconds(), poolErrCount(type));
+        SYS_ARCH_UNPROTECT(lev);
+    }
+}
+
+unsigned lwip_memp_reserve(memp_t type, unsigned base) {
+    auto m = poolMonitor(type);
+    return m ? m->reserve(base) : base;
+}
+
+int lwip_memp_set_max_extra_reserve(memp_t type, unsigned count) {
+    auto m = poolMonitor(type);
+    CHECK_TRUE(m, SYSTEM_ERROR_NOT_SUPPORTED);
+    SYS_ARCH_DECL_PROTECT(lev);
+    SYS_ARCH_PROTECT(lev);
+    m->setMaxExtraReserve(count);
+    SYS_ARCH_UNPROTECT(lev);
+    return 0;
+}
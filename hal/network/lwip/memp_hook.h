@@ -18,15 +18,40 @@
 #pragma once
 
 #include <lwip/memp.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
 
+// Pass as the pool type to receive events for all pools
+#define LWIP_MEMP_ANY MEMP_MAX
+
 typedef void (*lwip_memp_event_handler_t)(memp_t type, unsigned available, unsigned size, void* ctx);
 
+typedef struct lwip_memp_stats {
+    uint16_t size;
+    uint16_t used;
+    uint16_t max; // High-water mark
+    uint16_t extra_reserve; // Elements added to the flow control threshold at runtime
+    uint32_t err; // Allocation failures
+    uint32_t stalls; // Number of times the consumers had to wait for the pool
+    uint32_t stall_time; // Total time spent waiting, in milliseconds
+    uint32_t max_stall_time;
+} lwip_memp_stats;
+
 int lwip_memp_event_handler_add(lwip_memp_event_handler_t handler, memp_t type, void* ctx);
 
+int lwip_memp_get_stats(memp_t type, lwip_memp_stats* stats);
+
+// Consumers of a pool report when they start and stop waiting for the pool to have free elements
+void lwip_memp_stall_begin(memp_t type);
+void lwip_memp_stall_end(memp_t type);
+
+// Returns the number of elements to keep free given the consumer's own threshold
+unsigned lwip_memp_reserve(memp_t type, unsigned base);
+int lwip_memp_set_max_extra_reserve(memp_t type, unsigned count);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
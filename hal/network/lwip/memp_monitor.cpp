@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "memp_monitor.h"
+
+using namespace particle::net;
+
+PoolMonitor::PoolMonitor(unsigned maxExtraReserve) :
+        stats_(),
+        stallStart_(0),
+        lastErrCount_(0),
+        maxExtraReserve_(maxExtraReserve),
+        cleanStalls_(0),
+        stalled_(false) {
+}
+
+void PoolMonitor::stallBegin(uint32_t now) {
+    if (stalled_) {
+        return;
+    }
+    stalled_ = true;
+    stallStart_ = now;
+    ++stats_.stalls;
+}
+
+void PoolMonitor::stallEnd(uint32_t now, uint32_t errCount) {
+    if (!stalled_) {
+        return;
+    }
+    stalled_ = false;
+    const uint32_t t = now - stallStart_;
+    stats_.stallTime += t;
+    if (t > stats_.maxStallTime) {
+        stats_.maxStallTime = t;
+    }
+    if (errCount != lastErrCount_) {
+        // Allocations failed despite the flow control
+        if (stats_.extraReserve < maxExtraReserve_) {
+            ++stats_.extraReserve;
+        }
+        cleanStalls_ = 0;
+    } else if (stats_.extraReserve > 0 && ++cleanStalls_ >= SHRINK_AFTER_CLEAN_STALLS) {
+        --stats_.extraReserve;
+        cleanStalls_ = 0;
+    }
+    lastErrCount_ = errCount;
+}
+
+void PoolMonitor::setMaxExtraReserve(unsigned count) {
+    maxExtraReserve_ = count;
+    if (stats_.extraReserve > count) {
+        stats_.extraReserve = count;
+    }
+}
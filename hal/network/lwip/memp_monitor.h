@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace particle { namespace net {
+
+/**
+ * Tracks how long the consumers of a memory pool had to wait for it (stalls) and adapts
+ * the number of elements kept in reserve by flow control.
+ *
+ * The reserve grows by one element every time the pool reported allocation failures during
+ * a stall episode, i.e. the flow control kicked in too late, and shrinks back after a number
+ * of episodes without failures.
+ */
+class PoolMonitor {
+public:
+    // Number of stall episodes without allocation failures after which the reserve shrinks
+    static const unsigned SHRINK_AFTER_CLEAN_STALLS = 8;
+
+    struct Stats {
+        uint32_t stalls;
+        uint32_t stallTime; // Total, in milliseconds
+        uint32_t maxStallTime;
+        unsigned extraReserve;
+    };
+
+    explicit PoolMonitor(unsigned maxExtraReserve = 0);
+
+    /**
+     * Called when a consumer starts waiting for the pool.
+     *
+     * @param now Current time in milliseconds.
+     */
+    void stallBegin(uint32_t now);
+    /**
+     * Called when the consumer resumes.
+     *
+     * @param now Current time in milliseconds.
+     * @param errCount Number of allocation failures of the pool so far.
+     */
+    void stallEnd(uint32_t now, uint32_t errCount);
+    bool isStalled() const;
+
+    /**
+     * Returns the number of elements that need to be kept free, given the consumer's own estimate.
+     */
+    unsigned reserve(unsigned base) const;
+
+    void setMaxExtraReserve(unsigned count);
+    const Stats& stats() const;
+
+private:
+    Stats stats_;
+    uint32_t stallStart_;
+    uint32_t lastErrCount_;
+    unsigned maxExtraReserve_;
+    unsigned cleanStalls_;
+    bool stalled_;
+};
+
+inline bool PoolMonitor::isStalled() const {
+    return stalled_;
+}
+
+inline unsigned PoolMonitor::reserve(unsigned base) const {
+    return base + stats_.extraReserve;
+}
+
+inline const PoolMonitor::Stats& PoolMonitor::stats() const {
+    return stats_;
+}
+
+} } // particle::net
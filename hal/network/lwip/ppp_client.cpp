@@ -33,6 +33,7 @@ extern "C" {
 #include "inet_hal.h"
 #include "system_error.h"
 #include "lwiplock.h"
+#include "memp_hook.h"
 #include <lwip/stats.h>
 #include <algorithm>
 #include "delay_hal.h"
@@ -65,6 +66,8 @@ Client::Client() {
 
   exit_ = false;
   running_ = false;
+  maxInputSize_ = 0;
+  mru_ = 0;
 }
 
 Client::~Client() {
@@ -229,8 +232,14 @@ int Client::input(const uint8_t* data, size_t size) {
 #endif // DEBUG_BUILD
         // FIXME
         err_t err = ERR_OK;
+        if (size > maxInputSize_) {
+          maxInputSize_ = size;
+        }
+        // pppos_input() decodes straight into PBUF_POOL pbufs and drops the whole frame
+        // if it runs out of them, so ask for the data channel to be suspended while there
+        // is still room for the largest chunk we've seen so far
         int poolAvail = MEMP_STATS_GET(avail, MEMP_PBUF_POOL) - MEMP_STATS_GET(used, MEMP_PBUF_POOL);
-        if (poolAvail <= HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD) {
+        if (poolAvail <= (int)inputFlowControlThreshold()) {
           LOG_DEBUG(WARN, "Almost out of pbufs");
           return SYSTEM_ERROR_NO_MEMORY;
         }
@@ -245,6 +254,17 @@ int Client::input(const uint8_t* data, size_t size) {
   return SYSTEM_ERROR_INVALID_STATE;
 }
 
+unsigned Client::inputFlowControlThreshold() const {
+#if PPP_INPROC_IRQ_SAFE
+  // Decoded data never exceeds the HDLC-encoded input, plus one pbuf for a frame spanning chunks
+  const unsigned pbufs = (maxInputSize_ + PBUF_POOL_BUFSIZE - 1) / PBUF_POOL_BUFSIZE + 1;
+  return std::min<unsigned>(lwip_memp_reserve(MEMP_PBUF_POOL, HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD + pbufs),
+      PBUF_POOL_SIZE / 2);
+#else
+  return lwip_memp_reserve(MEMP_PBUF_POOL, HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD);
+#endif // PPP_INPROC_IRQ_SAFE
+}
+
 void Client::setNotifyCallback(NotifyCallback cb, void* ctx) {
   std::lock_guard<std::mutex> lk(mutex_);
   cb_ = cb;
@@ -290,6 +310,14 @@ void Client::setAuth(const char* user, const char* password) {
   }
 }
 
+void Client::setMru(unsigned mru) {
+  mru_ = mru;
+}
+
+const FrameStats::Counters& Client::frameStats() const {
+  return frameStats_.counters();
+}
+
 netif* Client::getIf() {
   return &if_;
 }
@@ -446,6 +474,7 @@ uint32_t Client::output(const uint8_t* data, size_t len) {
   if (oCb_) {
     auto r = oCb_(data, len, oCbCtx_);
     if (r >= 0) {
+      frameStats_.process(data, r);
       return r;
     }
   }
@@ -462,6 +491,36 @@ void Client::notifyPhaseCb(ppp_pcb* pcb, uint8_t phase, void* ctx) {
 
 void Client::notifyPhase(uint8_t phase) {
   LOG(TRACE, "PPP phase -> %d", phase);
+  if (phase == PPP_PHASE_ESTABLISH) {
+    // LCP options are reinitialized when connecting, this is the last chance to
+    // change them before the first Configure-Request is sent
+    configureLcp();
+  }
+}
+
+void Client::configureLcp() {
+  lcp_options* wo = &pcb_->lcp_wantoptions;
+  lcp_options* ao = &pcb_->lcp_allowoptions;
+
+  // Address/control and protocol field compression (RFC 1661) in both directions
+  wo->neg_accompression = 1;
+  wo->neg_pcompression = 1;
+  ao->neg_accompression = 1;
+  ao->neg_pcompression = 1;
+
+  // The MTU ends up being the smaller of our and the peer's MRU, so advertise
+  // as much as both lwIP and the modem can handle
+  unsigned mru = mru_;
+  if (mru == 0 || mru > PPP_MAXMRU) {
+    mru = PPP_MAXMRU;
+  } else if (mru < PPP_MINMRU) {
+    mru = PPP_MINMRU;
+  }
+  wo->neg_mru = 1;
+  wo->mru = mru;
+  ao->neg_mru = 1;
+  ao->mru = mru;
+  LOG(TRACE, "Requesting MRU %u, ACFC, PFC", mru);
 }
 
 void Client::notifyStatusCb(ppp_pcb* pcb, int err, void* ctx) {
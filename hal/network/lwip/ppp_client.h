@@ -28,6 +28,7 @@ extern "C" {
 #if defined(PPP_SUPPORT) && PPP_SUPPORT
 
 #include "ppp_ipcp.h"
+#include "ppp_frame_stats.h"
 #include "concurrent_hal.h"
 #include <mutex>
 #include <atomic>
@@ -79,6 +80,8 @@ public:
 
   bool notifyEvent(uint64_t ev);
   int input(const uint8_t* data, size_t size);
+  /* Number of free pool pbufs below which the input should be flow controlled */
+  unsigned inputFlowControlThreshold() const;
 
   typedef int (*OutputCallback)(const uint8_t* data, size_t size, void* ctx);
   typedef int (*EnterDataModeCallback)(void* ctx);
@@ -91,6 +94,11 @@ public:
 
   void setAuth(const char* user, const char* password);
 
+  /* Largest MRU to negotiate, 0 to use PPP_MAXMRU. Takes effect on the next connection */
+  void setMru(unsigned mru);
+  /* Header compression statistics of the outgoing frames. Should be called with the TCP/IP core locked */
+  const FrameStats::Counters& frameStats() const;
+
   netif* getIf();
 
 private:
@@ -130,6 +138,7 @@ private:
 
   static void notifyPhaseCb(ppp_pcb* pcb, uint8_t phase, void* ctx);
   void notifyPhase(uint8_t phase);
+  void configureLcp();
 
   static void notifyStatusCb(ppp_pcb* pcb, int err, void* ctx);
   void notifyStatus(int err);
@@ -172,6 +181,9 @@ private:
 
   bool inited_ = false;
   std::atomic_bool running_;
+  std::atomic<size_t> maxInputSize_;
+  std::atomic<unsigned> mru_;
+  FrameStats frameStats_;
   std::atomic_bool exit_;
 
   static std::once_flag once_;
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ppp_frame_stats.h"
+
+#include <cstring>
+
+using namespace particle::net::ppp;
+
+namespace {
+
+const uint8_t HDLC_FLAG = 0x7e;
+const uint8_t HDLC_ESCAPE = 0x7d;
+const uint8_t HDLC_TRANS = 0x20;
+const uint8_t HDLC_ALLSTATIONS = 0xff;
+const uint8_t HDLC_UI = 0x03;
+
+const size_t HDLC_FCS_SIZE = 2;
+
+const uint16_t PROTOCOL_VJC_COMP = 0x002d;
+
+/* RFC 1144 change mask bits */
+const uint8_t VJ_NEW_C = 0x40;
+const uint8_t VJ_NEW_I = 0x20;
+const uint8_t VJ_NEW_S = 0x08;
+const uint8_t VJ_NEW_A = 0x04;
+const uint8_t VJ_NEW_W = 0x02;
+const uint8_t VJ_NEW_U = 0x01;
+const uint8_t VJ_SPECIALS_MASK = VJ_NEW_S | VJ_NEW_A | VJ_NEW_W | VJ_NEW_U;
+const uint8_t VJ_SPECIAL_I = VJ_NEW_S | VJ_NEW_W | VJ_NEW_U;
+const uint8_t VJ_SPECIAL_D = VJ_NEW_S | VJ_NEW_A | VJ_NEW_W | VJ_NEW_U;
+
+/* IPv4 and TCP headers without options */
+const size_t VJ_TCPIP_HEADER_SIZE = 40;
+
+/* A delta is encoded in 1 byte, or as 0 followed by 2 bytes */
+size_t vjDeltaSize(const uint8_t* data, size_t len, size_t offs) {
+  if (offs >= len) {
+    return 0;
+  }
+  return data[offs] ? 1 : 3;
+}
+
+} /* namespace */
+
+FrameStats::FrameStats() {
+  reset();
+}
+
+void FrameStats::reset() {
+  memset(&counters_, 0, sizeof(counters_));
+  frameSize_ = 0;
+  inFrame_ = false;
+  escape_ = false;
+}
+
+void FrameStats::process(const uint8_t* data, size_t len) {
+  counters_.bytes += len;
+  for (size_t i = 0; i < len; ++i) {
+    uint8_t c = data[i];
+    if (c == HDLC_FLAG) {
+      /* The closing flag of a frame may also open the next one */
+      if (inFrame_ && frameSize_ > 0) {
+        frameEnd();
+      }
+      inFrame_ = true;
+      frameSize_ = 0;
+      escape_ = false;
+      continue;
+    }
+    if (!inFrame_) {
+      continue;
+    }
+    if (c == HDLC_ESCAPE) {
+      escape_ = true;
+      continue;
+    }
+    if (escape_) {
+      c ^= HDLC_TRANS;
+      escape_ = false;
+    }
+    if (frameSize_ < MAX_HEADER_SIZE) {
+      header_[frameSize_] = c;
+    }
+    ++frameSize_;
+  }
+}
+
+void FrameStats::frameEnd() {
+  /* Protocol field and FCS at the very least */
+  if (frameSize_ < 1 + HDLC_FCS_SIZE) {
+    return;
+  }
+  const size_t size = frameSize_ < MAX_HEADER_SIZE ? frameSize_ - HDLC_FCS_SIZE : MAX_HEADER_SIZE;
+  size_t offs = 0;
+  uint32_t saved = 0;
+  if (size >= 2 && header_[0] == HDLC_ALLSTATIONS && header_[1] == HDLC_UI) {
+    offs += 2;
+  } else {
+    saved += 2;
+  }
+  if (offs >= size) {
+    return;
+  }
+  uint16_t protocol = header_[offs];
+  if (protocol & 0x01) {
+    saved += 1;
+    offs += 1;
+  } else {
+    if (offs + 2 > size) {
+      return;
+    }
+    protocol = (protocol << 8) | header_[offs + 1];
+    offs += 2;
+  }
+  ++counters_.frames;
+  counters_.hdrSaved += saved;
+  if (protocol == PROTOCOL_VJC_COMP) {
+    const size_t vjSize = vjHeaderSize(header_ + offs, size - offs);
+    if (vjSize > 0 && vjSize < VJ_TCPIP_HEADER_SIZE) {
+      ++counters_.vjFrames;
+      counters_.vjSaved += VJ_TCPIP_HEADER_SIZE - vjSize;
+    }
+  }
+}
+
+size_t FrameStats::vjHeaderSize(const uint8_t* data, size_t len) {
+  if (len < 1) {
+    return 0;
+  }
+  const uint8_t changes = data[0];
+  /* Change mask, connection number and TCP checksum */
+  size_t size = 1 + ((changes & VJ_NEW_C) ? 1 : 0) + 2;
+  const uint8_t specials = changes & VJ_SPECIALS_MASK;
+  if (specials != VJ_SPECIAL_I && specials != VJ_SPECIAL_D) {
+    const uint8_t fields[] = { VJ_NEW_U, VJ_NEW_W, VJ_NEW_A, VJ_NEW_S };
+    for (const auto f: fields) {
+      if (changes & f) {
+        const size_t n = vjDeltaSize(data, len, size);
+        if (n == 0) {
+          return 0;
+        }
+        size += n;
+      }
+    }
+  }
+  if (changes & VJ_NEW_I) {
+    const size_t n = vjDeltaSize(data, len, size);
+    if (n == 0) {
+      return 0;
+    }
+    size += n;
+  }
+  if (size > len) {
+    return 0;
+  }
+  return size;
+}
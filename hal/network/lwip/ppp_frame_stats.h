@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAL_NETWORK_LWIP_PPP_FRAME_STATS_H
+#define HAL_NETWORK_LWIP_PPP_FRAME_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __cplusplus
+
+namespace particle { namespace net { namespace ppp {
+
+/* Estimates the number of bytes saved by the header compression options negotiated
+ * for the link by inspecting outgoing HDLC-like frames (RFC 1662).
+ *
+ * Frames without the address and control fields are accounted as saving 2 bytes (ACFC),
+ * frames with a single-byte protocol field as saving 1 byte (PFC). For VJ-compressed
+ * TCP/IP packets (RFC 1144) the savings are calculated against the minimal 40-byte
+ * TCP/IP header, so the result is a lower bound if the original headers had options.
+ */
+class FrameStats {
+public:
+  struct Counters {
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t vjFrames;
+    uint32_t hdrSaved;
+    uint32_t vjSaved;
+  };
+
+  FrameStats();
+
+  /* Processes encoded output. Frames may span multiple calls */
+  void process(const uint8_t* data, size_t len);
+  void reset();
+
+  const Counters& counters() const;
+
+  /* Returns the size of a VJ-compressed header, or 0 if it's truncated */
+  static size_t vjHeaderSize(const uint8_t* data, size_t len);
+
+private:
+  static const size_t MAX_HEADER_SIZE = 24;
+
+  Counters counters_;
+  uint8_t header_[MAX_HEADER_SIZE];
+  size_t frameSize_;
+  bool inFrame_;
+  bool escape_;
+
+  void frameEnd();
+};
+
+inline const FrameStats::Counters& FrameStats::counters() const {
+  return counters_;
+}
+
+} } } /* namespace particle::net::ppp */
+
+#endif /* __cplusplus */
+
+#endif /* HAL_NETWORK_LWIP_PPP_FRAME_STATS_H */
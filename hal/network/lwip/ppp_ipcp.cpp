@@ -35,6 +35,25 @@ const char detail::ipProtocolName[] = "IP";
 
 const struct protent ipcp_protent = Ipcp::generateProtent();
 
+#if VJ_SUPPORT
+namespace {
+
+// Output function of the PPP netif, replaced while VJ is only negotiated for received packets
+netif_output_fn sNetifOutput = nullptr;
+
+err_t outputWithoutVjCompression(struct netif* netif, struct pbuf* p, const ip4_addr_t* addr) {
+  // lwIP uses the same flag to enable VJ compression and decompression. The peer didn't ask
+  // for compressed packets, so compression is disabled while sending
+  auto pcb = static_cast<ppp_pcb*>(netif->state);
+  sifvjcomp(pcb, 0, 0, 0);
+  const err_t err = sNetifOutput(netif, p, addr);
+  sifvjcomp(pcb, 1, 0, ipcp::IpCompressionProtocolConfigurationOption::DEFAULT_MAX_SLOT_ID);
+  return err;
+}
+
+} // unnamed
+#endif // VJ_SUPPORT
+
 Ipcp::Ipcp(ppp_pcb* pcb)
     : IpcpBase(pcb) {
 
@@ -43,6 +62,9 @@ Ipcp::Ipcp(ppp_pcb* pcb)
   registerOption(new ipcp::IpNetmaskConfigurationOption());
   registerOption(new ipcp::PrimaryDnsServerConfigurationOption());
   registerOption(new ipcp::SecondaryDnsServerConfigurationOption());
+#if VJ_SUPPORT
+  registerOption(new ipcp::IpCompressionProtocolConfigurationOption());
+#endif // VJ_SUPPORT
 }
 
 Ipcp::~Ipcp() {
@@ -132,7 +154,7 @@ void Ipcp::resetConfigurationInformation() {
 
     switch (opt->id) {
       case ipcp::CONFIGURATION_OPTION_IP_COMPRESSION_PROTOCOL: {
-        // TODO:
+        // Slot parameters are restored to their defaults by reset()
         break;
       }
       case ipcp::CONFIGURATION_OPTION_IP_ADDRESS: {
@@ -361,6 +383,10 @@ void Ipcp::up() {
   auto mask = getNegotiatedNetmask();
   netif_set_addr(pcb_->netif, &ip, &mask, &peer);
 
+#if VJ_SUPPORT
+  setNegotiatedVjCompression();
+#endif // VJ_SUPPORT
+
   if (!ip4_addr_isany_val(pdns)) {
     ip_addr_t tmp;
     ip_addr_copy_from_ip4(tmp, pdns);
@@ -385,6 +411,11 @@ void Ipcp::down() {
 
   sifdown(pcb_);
 
+#if VJ_SUPPORT
+  restoreNetifOutput();
+  sifvjcomp(pcb_, 0, 0, 0);
+#endif // VJ_SUPPORT
+
   netif_set_addr(pcb_->netif, IP4_ADDR_ANY4, IP4_ADDR_BROADCAST, IP4_ADDR_ANY4);
 
   if (state_) {
@@ -503,4 +534,32 @@ ip4_addr_t Ipcp::getNegotiatedSecondaryDns() {
   return ret;
 }
 
+#if VJ_SUPPORT
+void Ipcp::setNegotiatedVjCompression() {
+  using namespace ipcp;
+  auto opt = static_cast<IpCompressionProtocolConfigurationOption*>(findOption(CONFIGURATION_OPTION_IP_COMPRESSION_PROTOCOL));
+  restoreNetifOutput();
+  if (opt->isSendNegotiated()) {
+    LOG(TRACE, "VJ compression enabled: max slot %u, comp slot %u", opt->peerMaxSlotId, opt->peerCompSlotId);
+    sifvjcomp(pcb_, 1, opt->peerCompSlotId, opt->peerMaxSlotId);
+  } else if (opt->isReceiveNegotiated()) {
+    // The peer may send compressed packets even though it didn't ask for them. lwIP only
+    // decompresses them if VJ is enabled, so compression is disabled per packet instead
+    LOG(TRACE, "VJ decompression enabled");
+    sifvjcomp(pcb_, 1, 0, IpCompressionProtocolConfigurationOption::DEFAULT_MAX_SLOT_ID);
+    sNetifOutput = pcb_->netif->output;
+    pcb_->netif->output = outputWithoutVjCompression;
+  } else {
+    sifvjcomp(pcb_, 0, 0, 0);
+  }
+}
+
+void Ipcp::restoreNetifOutput() {
+  if (sNetifOutput) {
+    pcb_->netif->output = sNetifOutput;
+    sNetifOutput = nullptr;
+  }
+}
+#endif // VJ_SUPPORT
+
 #endif // defined(PPP_SUPPORT) && PPP_SUPPORT
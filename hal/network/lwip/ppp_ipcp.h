@@ -107,6 +107,10 @@ private:
   ip4_addr_t getNegotiatedNetmask();
   ip4_addr_t getNegotiatedPrimaryDns();
   ip4_addr_t getNegotiatedSecondaryDns();
+#if VJ_SUPPORT
+  void setNegotiatedVjCompression();
+  void restoreNetifOutput();
+#endif // VJ_SUPPORT
 
 private:
   bool lowerState_ = false;
@@ -206,6 +210,11 @@ inline int IpcpBase::printPacket(const uint8_t *p, int plen, PacketPrinter print
         processed = opt.print(buf, len, printer, arg);
         break;
       }
+      case ipcp::CONFIGURATION_OPTION_IP_COMPRESSION_PROTOCOL: {
+        ipcp::IpCompressionProtocolConfigurationOption opt;
+        processed = opt.print(buf, len, printer, arg);
+        break;
+      }
     }
 
     if (processed <= 0) {
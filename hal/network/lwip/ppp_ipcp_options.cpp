@@ -193,6 +193,151 @@ int CommonConfigurationOptionIpAddress::print(const uint8_t* buf, size_t len, Pa
   return 0;
 }
 
+void IpCompressionProtocolConfigurationOption::reset() {
+  ConfigurationOption::reset();
+  localMaxSlotId = DEFAULT_MAX_SLOT_ID;
+  localCompSlotId = 1;
+  peerMaxSlotId = 0;
+  peerCompSlotId = 0;
+  data = nullptr;
+}
+
+bool IpCompressionProtocolConfigurationOption::validate(uint8_t* buf, size_t len) {
+  if (len >= OPTION_HEADER_SIZE + 2) {
+    uint8_t rid = buf[0];
+    uint8_t rlength = buf[1];
+    if (rid == id && rlength >= OPTION_HEADER_SIZE + 2 && rlength <= len) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool isVjCompressionProtocol(const uint8_t* buf, size_t length) {
+  uint16_t protocol = ((uint16_t)buf[2] << 8) | buf[3];
+  return protocol == IpCompressionProtocolConfigurationOption::PROTOCOL_VJ && buf[1] == length;
+}
+
+/* Local -> Remote */
+int IpCompressionProtocolConfigurationOption::sendConfigureReq(uint8_t* buf, size_t len) {
+  if (len >= length) {
+    buf[0] = id;
+    buf[1] = length;
+    buf[2] = (PROTOCOL_VJ >> 8) & 0xff;
+    buf[3] = PROTOCOL_VJ & 0xff;
+    buf[4] = localMaxSlotId;
+    buf[5] = localCompSlotId;
+    return length;
+  }
+
+  return 0;
+}
+
+int IpCompressionProtocolConfigurationOption::recvConfigureRej(uint8_t* buf, size_t len) {
+  if (validate(buf, len)) {
+    stateLocal = CONFIGURATION_OPTION_STATE_REJ;
+    return buf[1];
+  }
+  /* error */
+  return 0;
+}
+
+int IpCompressionProtocolConfigurationOption::recvConfigureAck(uint8_t* buf, size_t len) {
+  if (validate(buf, len) && isVjCompressionProtocol(buf, length) &&
+      buf[4] == localMaxSlotId && buf[5] == localCompSlotId) {
+    stateLocal = CONFIGURATION_OPTION_STATE_ACK;
+    return length;
+  }
+  /* error */
+  return 0;
+}
+
+int IpCompressionProtocolConfigurationOption::recvConfigureNak(uint8_t* buf, size_t len) {
+  if (validate(buf, len)) {
+    if (isVjCompressionProtocol(buf, length)) {
+      stateLocal = CONFIGURATION_OPTION_STATE_NAK;
+      if (buf[4] < localMaxSlotId) {
+        localMaxSlotId = buf[4];
+      }
+      if (!buf[5]) {
+        localCompSlotId = 0;
+      }
+    } else {
+      /* We don't support any other compression protocol, stop requesting it */
+      stateLocal = CONFIGURATION_OPTION_STATE_REJ;
+    }
+    return buf[1];
+  }
+  /* error */
+  return 0;
+}
+
+/* Remote -> Local */
+int IpCompressionProtocolConfigurationOption::recvConfigureReq(uint8_t* buf, size_t len) {
+  if (validate(buf, len)) {
+    data = buf;
+    if (isVjCompressionProtocol(buf, length)) {
+      peerMaxSlotId = buf[4];
+      peerCompSlotId = buf[5] ? 1 : 0;
+      if (peerMaxSlotId > DEFAULT_MAX_SLOT_ID) {
+        peerMaxSlotId = DEFAULT_MAX_SLOT_ID;
+        statePeer = CONFIGURATION_OPTION_STATE_NAK;
+      } else {
+        statePeer = CONFIGURATION_OPTION_STATE_ACK;
+      }
+    } else {
+      statePeer = CONFIGURATION_OPTION_STATE_REJ;
+    }
+    return buf[1];
+  }
+
+  statePeer = CONFIGURATION_OPTION_STATE_ERR;
+
+  return 0;
+}
+
+int IpCompressionProtocolConfigurationOption::sendConfigureRej(uint8_t* buf, size_t len) {
+  if (data != nullptr && len >= data[1]) {
+    size_t l = data[1];
+    memmove(buf, data, l);
+    return l;
+  }
+
+  return 0;
+}
+
+int IpCompressionProtocolConfigurationOption::sendConfigureAck(uint8_t* buf, size_t len) {
+  if (len >= length) {
+    buf[0] = id;
+    buf[1] = length;
+    buf[2] = (PROTOCOL_VJ >> 8) & 0xff;
+    buf[3] = PROTOCOL_VJ & 0xff;
+    buf[4] = peerMaxSlotId;
+    buf[5] = peerCompSlotId;
+    return length;
+  }
+
+  return 0;
+}
+
+int IpCompressionProtocolConfigurationOption::sendConfigureNak(uint8_t* buf, size_t len) {
+  return sendConfigureAck(buf, len);
+}
+
+int IpCompressionProtocolConfigurationOption::print(const uint8_t* buf, size_t len, PacketPrinter printer, void* arg) {
+  if (len >= OPTION_HEADER_SIZE + 2 && buf[1] >= OPTION_HEADER_SIZE + 2 && buf[1] <= len) {
+    if (isVjCompressionProtocol(buf, length)) {
+      printer(arg, " <compress VJ %u %u>", buf[4], buf[5]);
+    } else {
+      printer(arg, " <compress %.2x%.2x>", buf[2], buf[3]);
+    }
+    return buf[1];
+  }
+
+  return 0;
+}
+
 bool UnknownConfigurationOption::validate(uint8_t* buf, size_t len) {
   if (len >= 2) {
     if (buf[1] <= len) {
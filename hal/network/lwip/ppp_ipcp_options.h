@@ -117,6 +117,54 @@ struct SecondaryDnsServerConfigurationOption : public CommonConfigurationOptionI
   }
 };
 
+/* Van Jacobson TCP/IP header compression (RFC 1332, RFC 1144) */
+struct IpCompressionProtocolConfigurationOption : public ConfigurationOption {
+  static const uint16_t PROTOCOL_VJ = 0x002d;
+  /* Number of slots supported by lwIP's VJ implementation (MAX_SLOTS) */
+  static const uint8_t DEFAULT_MAX_SLOT_ID = 15;
+
+  IpCompressionProtocolConfigurationOption()
+      : ConfigurationOption(CONFIGURATION_OPTION_IP_COMPRESSION_PROTOCOL, OPTION_HEADER_SIZE + 4) {
+  }
+
+  virtual void reset() override;
+
+  virtual bool validate(uint8_t* buf, size_t len) override;
+
+  /* Local -> Remote */
+  virtual int sendConfigureReq(uint8_t* buf, size_t len) override;
+  virtual int recvConfigureRej(uint8_t* buf, size_t len) override;
+  virtual int recvConfigureAck(uint8_t* buf, size_t len) override;
+  virtual int recvConfigureNak(uint8_t* buf, size_t len) override;
+
+  /* Remote -> Local */
+  virtual int recvConfigureReq(uint8_t* buf, size_t len) override;
+  virtual int sendConfigureRej(uint8_t* buf, size_t len) override;
+  virtual int sendConfigureAck(uint8_t* buf, size_t len) override;
+  virtual int sendConfigureNak(uint8_t* buf, size_t len) override;
+
+  virtual int print(const uint8_t* buf, size_t len, PacketPrinter printer, void* arg) override;
+
+  /* The peer accepted our request, it may send compressed packets */
+  bool isReceiveNegotiated() const {
+    return stateLocal == CONFIGURATION_OPTION_STATE_ACK;
+  }
+
+  /* We accepted the peer's request, it expects compressed packets */
+  bool isSendNegotiated() const {
+    return statePeer == CONFIGURATION_OPTION_STATE_ACK;
+  }
+
+  /* Slot parameters we are willing to receive with */
+  uint8_t localMaxSlotId = DEFAULT_MAX_SLOT_ID;
+  uint8_t localCompSlotId = 1;
+  /* Slot parameters the peer is willing to receive with */
+  uint8_t peerMaxSlotId = 0;
+  uint8_t peerCompSlotId = 0;
+
+  uint8_t* data = nullptr;
+};
+
 struct UnknownConfigurationOption : public ConfigurationOption {
   UnknownConfigurationOption()
       : ConfigurationOption(0, 0) {
@@ -41,8 +41,10 @@ AtParser::~AtParser() {
 int AtParser::init(AtParserConfig conf) {
     CHECK_FALSE(p_, SYSTEM_ERROR_INVALID_STATE);
     CHECK_TRUE(AtParserImpl::isConfigValid(conf), SYSTEM_ERROR_INVALID_ARGUMENT);
-    p_.reset(new(std::nothrow) AtParserImpl(std::move(conf)));
-    CHECK_TRUE(p_, SYSTEM_ERROR_NO_MEMORY);
+    std::unique_ptr<AtParserImpl> p(new(std::nothrow) AtParserImpl(std::move(conf)));
+    CHECK_TRUE(p, SYSTEM_ERROR_NO_MEMORY);
+    CHECK(p->init());
+    p_ = std::move(p);
     return 0;
 }
 
@@ -84,6 +84,12 @@ public:
      * @see `logCategory()`
      */
     static constexpr auto DEFAULT_LOG_CATEGORY = "ncp.at";
+    /**
+     * Default size of the input buffer.
+     *
+     * @see `inputBufferSize()`
+     */
+    static const size_t DEFAULT_INPUT_BUFFER_SIZE = 64;
 
     /**
      * Constructs a settings object with all parameters set to their default values.
@@ -199,6 +205,26 @@ public:
      * @see `DEFAULT_LOG_CATEGORY`
      */
     const char* logCategory() const;
+    /**
+     * Sets the size of the input buffer.
+     *
+     * The parser reads as much data from the stream as fits into this buffer at once. The size
+     * also limits the length of the URC prefixes that can be registered.
+     *
+     * @param size Buffer size.
+     * @return This settings object.
+     *
+     * @see `DEFAULT_INPUT_BUFFER_SIZE`
+     */
+    AtParserConfig& inputBufferSize(size_t size);
+    /**
+     * Returns the size of the input buffer.
+     *
+     * @return Buffer size.
+     *
+     * @see `DEFAULT_INPUT_BUFFER_SIZE`
+     */
+    size_t inputBufferSize() const;
 
 private:
     Stream* strm_;
@@ -208,6 +234,7 @@ private:
     bool echoEnabled_;
     bool logEnabled_;
     CString logCategory_;
+    size_t inputBufSize_;
 };
 
 /**
@@ -413,7 +440,8 @@ inline AtParserConfig::AtParserConfig() :
         cmdTimeout_(DEFAULT_COMMAND_TIMEOUT),
         strmTimeout_(DEFAULT_STREAM_TIMEOUT),
         echoEnabled_(DEFAULT_ECHO_ENABLED),
-        logEnabled_(DEFAULT_LOG_ENABLED) {
+        logEnabled_(DEFAULT_LOG_ENABLED),
+        inputBufSize_(DEFAULT_INPUT_BUFFER_SIZE) {
 }
 
 inline AtParserConfig& AtParserConfig::stream(Stream* strm) {
@@ -479,4 +507,13 @@ inline const char* AtParserConfig::logCategory() const {
     return logCategory_ ? static_cast<const char*>(logCategory_) : DEFAULT_LOG_CATEGORY;
 }
 
+inline AtParserConfig& AtParserConfig::inputBufferSize(size_t size) {
+    inputBufSize_ = size;
+    return *this;
+}
+
+inline size_t AtParserConfig::inputBufferSize() const {
+    return inputBufSize_;
+}
+
 } // particle
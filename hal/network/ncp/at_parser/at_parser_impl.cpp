@@ -26,6 +26,7 @@
 #include "debug.h"
 
 #include <algorithm>
+#include <new>
 #include <cstdlib>
 #include <cctype>
 #include <cassert>
@@ -98,11 +99,22 @@ inline system_tick_t millis() {
 AtParserImpl::AtParserImpl(AtParserConfig conf) :
         cmdTerm_(cmdTermStr(conf.commandTerminator())),
         cmdTermSize_(strlen(cmdTerm_)),
+        buf_(nullptr),
+        bufSize_(conf.inputBufferSize()),
         conf_(std::move(conf)) {
     reset();
 }
 
 AtParserImpl::~AtParserImpl() {
+    delete[] buf_;
+}
+
+int AtParserImpl::init() {
+    buf_ = new(std::nothrow) char[bufSize_];
+    if (!buf_) {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    return 0;
 }
 
 int AtParserImpl::newCommand() {
@@ -118,7 +130,7 @@ int AtParserImpl::newCommand() {
     if (!checkStatus(StatusFlag::FLUSH_CMD)) {
         cmdSize_ = 0;
     }
-    clearStatus(StatusFlag::READY);
+    clearStatus(StatusFlag::READY | StatusFlag::PARTIAL_READ);
     setStatus(StatusFlag::WRITE_CMD);
     return 0;
 }
@@ -208,6 +220,18 @@ int AtParserImpl::readLine(char* data, size_t size) {
     return ret;
 }
 
+int AtParserImpl::read(char* data, size_t size) {
+    // Unlike readLine(), never move past the end of the line that is being read
+    if (checkStatus(StatusFlag::PARTIAL_READ) && checkStatus(StatusFlag::LINE_END)) {
+        return 0;
+    }
+    const int ret = readLine(data, size);
+    if (ret > 0) {
+        setStatus(StatusFlag::PARTIAL_READ);
+    }
+    return ret;
+}
+
 int AtParserImpl::nextLine() {
     if (checkStatus(StatusFlag::READY)) {
         return error(SYSTEM_ERROR_INVALID_STATE);
@@ -266,7 +290,7 @@ int AtParserImpl::hasNextLine(bool* hasLine) {
 
 int AtParserImpl::addUrcHandler(const char* prefix, AtParser::UrcHandler handler, void* data) {
     const size_t prefixSize = strlen(prefix);
-    if (prefixSize == 0 || prefixSize > INPUT_BUF_SIZE) {
+    if (prefixSize == 0 || prefixSize > bufSize_) {
         return SYSTEM_ERROR_INVALID_ARGUMENT;
     }
     removeUrcHandler(prefix);
@@ -278,6 +302,12 @@ int AtParserImpl::addUrcHandler(const char* prefix, AtParser::UrcHandler handler
     if (!urcHandlers_.append(std::move(h))) {
         return SYSTEM_ERROR_NO_MEMORY;
     }
+    const int ret = addToUrcTrie(urcHandlers_.size() - 1);
+    if (ret < 0) {
+        urcHandlers_.takeLast();
+        rebuildUrcTrie();
+        return ret;
+    }
     return 0;
 }
 
@@ -285,6 +315,8 @@ void AtParserImpl::removeUrcHandler(const char* prefix) {
     for (int i = 0; i < urcHandlers_.size(); ++i) {
         if (strcmp(urcHandlers_.at(i).prefix, prefix) == 0) {
             urcHandlers_.removeAt(i);
+            // Handler indices have changed
+            rebuildUrcTrie();
             break;
         }
     }
@@ -321,7 +353,8 @@ void AtParserImpl::reset() {
 }
 
 bool AtParserImpl::isConfigValid(const AtParserConfig& conf) {
-    return (conf.stream() != nullptr && conf.commandTimeout() > 0 && conf.streamTimeout() > 0);
+    return (conf.stream() != nullptr && conf.commandTimeout() > 0 && conf.streamTimeout() > 0 &&
+            conf.inputBufferSize() >= MIN_INPUT_BUF_SIZE);
 }
 
 int AtParserImpl::readRespLine(char* data, size_t size) {
@@ -389,7 +422,7 @@ int AtParserImpl::parseLine(unsigned flags, unsigned* timeout) {
                 AtResponseReader reader(this);
                 setStatus(StatusFlag::URC_HANDLER);
                 const int r = h->callback(&reader, h->prefix, h->data);
-                clearStatus(StatusFlag::URC_HANDLER);
+                clearStatus(StatusFlag::URC_HANDLER | StatusFlag::PARTIAL_READ);
                 if (r < 0) {
                     LOG_C(ERROR, conf_.logCategory(), "URC handler error: %d", r);
                 }
@@ -479,24 +512,33 @@ int AtParserImpl::parseUrc(const UrcHandler** handler) {
     if (bufPos_ == 0) {
         return ParseResult::READ_MORE;
     }
-    // Look for an URC prefix that matches the buffer contents
-    const UrcHandler* h = nullptr;
-    size_t maxSize = 0;
-    for (size_t i = 0; i < (size_t)urcHandlers_.size(); ++i) {
-        const UrcHandler& h2 = urcHandlers_.at(i);
-        const size_t n = std::min(bufPos_, h2.prefixSize);
-        if (memcmp(buf_, h2.prefix, n) == 0 && n > maxSize) {
-            h = &h2;
-            maxSize = n;
+    if (urcTrie_.isEmpty()) {
+        return ParseResult::NO_MATCH;
+    }
+    // Walk the prefix trie looking for the longest URC prefix that matches the buffer contents
+    int node = 0;
+    int h = -1;
+    size_t i = 0;
+    for (; i < bufPos_; ++i) {
+        int child = urcTrie_.at(node).child;
+        while (child >= 0 && urcTrie_.at(child).c != buf_[i]) {
+            child = urcTrie_.at(child).next;
+        }
+        if (child < 0) {
+            break;
+        }
+        node = child;
+        if (urcTrie_.at(node).handler >= 0) {
+            h = urcTrie_.at(node).handler;
         }
     }
-    if (!h) {
-        return ParseResult::NO_MATCH;
+    if (i == bufPos_ && urcTrie_.at(node).child >= 0) {
+        return ParseResult::READ_MORE; // A longer prefix may still match
     }
-    if (bufPos_ < h->prefixSize) {
-        return ParseResult::READ_MORE;
+    if (h < 0) {
+        return ParseResult::NO_MATCH;
     }
-    *handler = h;
+    *handler = &urcHandlers_.at(h);
     return ParseResult::PARSED_URC;
 }
 
@@ -509,13 +551,49 @@ int AtParserImpl::parseEcho() {
     if (memcmp(buf_, cmdData_, n) != 0) {
         return ParseResult::NO_MATCH;
     }
-    n = std::min(cmdSize_, INPUT_BUF_SIZE);
+    n = std::min(cmdSize_, bufSize_);
     if (bufPos_ < n) {
         return ParseResult::READ_MORE;
     }
     return ParseResult::PARSED_ECHO;
 }
 
+int AtParserImpl::addToUrcTrie(int handlerIndex) {
+    if (urcTrie_.isEmpty()) {
+        const UrcTrieNode root = { '\0', -1, -1, -1 };
+        if (!urcTrie_.append(root)) {
+            return SYSTEM_ERROR_NO_MEMORY;
+        }
+    }
+    const UrcHandler& h = urcHandlers_.at(handlerIndex);
+    int node = 0;
+    for (size_t i = 0; i < h.prefixSize; ++i) {
+        int child = urcTrie_.at(node).child;
+        while (child >= 0 && urcTrie_.at(child).c != h.prefix[i]) {
+            child = urcTrie_.at(child).next;
+        }
+        if (child < 0) {
+            const UrcTrieNode n = { h.prefix[i], -1, urcTrie_.at(node).child, -1 };
+            if (!urcTrie_.append(n)) {
+                return SYSTEM_ERROR_NO_MEMORY;
+            }
+            child = urcTrie_.size() - 1;
+            urcTrie_[node].child = child;
+        }
+        node = child;
+    }
+    urcTrie_[node].handler = handlerIndex;
+    return 0;
+}
+
+int AtParserImpl::rebuildUrcTrie() {
+    urcTrie_.clear();
+    for (int i = 0; i < urcHandlers_.size(); ++i) {
+        CHECK(addToUrcTrie(i));
+    }
+    return 0;
+}
+
 int AtParserImpl::readLine(char* data, size_t size, unsigned* timeout) {
     size_t bytesRead = 0;
     for (;;) {
@@ -576,7 +654,7 @@ int AtParserImpl::nextLine(unsigned* timeout) {
             CHECK(readMore(timeout));
         }
         if (checkStatus(StatusFlag::LINE_END) && !isNewline(buf_[0])) {
-            clearStatus(StatusFlag::LINE_END);
+            clearStatus(StatusFlag::LINE_END | StatusFlag::PARTIAL_READ);
             setStatus(StatusFlag::LINE_BEGIN);
             break;
         }
@@ -585,11 +663,11 @@ int AtParserImpl::nextLine(unsigned* timeout) {
 }
 
 int AtParserImpl::readMore(unsigned* timeout) {
-    assert(bufPos_ < INPUT_BUF_SIZE);
+    assert(bufPos_ < bufSize_);
     const auto strm = conf_.stream();
     size_t bytesRead = 0;
     for (;;) {
-        bytesRead = CHECK(strm->read(buf_ + bufPos_, INPUT_BUF_SIZE - bufPos_));
+        bytesRead = CHECK(strm->read(buf_ + bufPos_, bufSize_ - bufPos_));
         if (bytesRead > 0) {
             break;
         }
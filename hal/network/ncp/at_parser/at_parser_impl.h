@@ -39,8 +39,8 @@ namespace detail {
 
 using spark::Vector;
 
-// Size of the intermediate buffer for received data
-const size_t INPUT_BUF_SIZE = 64;
+// Minimum size of the intermediate buffer for received data
+const size_t MIN_INPUT_BUF_SIZE = 32;
 
 // Maximum number of AT command characters stored by the parser
 const size_t CMD_BUF_SIZE = 128;
@@ -53,6 +53,8 @@ public:
     explicit AtParserImpl(AtParserConfig conf);
     ~AtParserImpl();
 
+    int init();
+
     int newCommand();
     int sendCommand();
     void resetCommand();
@@ -61,6 +63,7 @@ public:
 
     int readResult(int* errorCode);
     int readLine(char* data, size_t size);
+    int read(char* data, size_t size);
     int nextLine();
     int hasNextLine(bool* hasLine);
     bool atLineEnd() const;
@@ -87,7 +90,8 @@ private:
         HAS_RESULT = 0x0020, // A final result code has been parsed
         HAS_ECHO = 0x0040, // The command echo has been parsed
         ECHO_ENABLED = 0x0080, // The echo is enabled
-        URC_HANDLER = 0x0100 // An URC handler is running
+        URC_HANDLER = 0x0100, // An URC handler is running
+        PARTIAL_READ = 0x0200 // The current line is being read in chunks
     };
 
     enum ParseFlag {
@@ -111,10 +115,18 @@ private:
         void* data; // User data
     };
 
+    struct UrcTrieNode {
+        char c; // Prefix character
+        int16_t child; // Index of the first child node, or -1
+        int16_t next; // Index of the next sibling node, or -1
+        int16_t handler; // Index of the handler whose prefix ends at this node, or -1
+    };
+
     const char* const cmdTerm_; // Command terminator string
     const size_t cmdTermSize_; // Size of the command terminator string
 
-    char buf_[INPUT_BUF_SIZE]; // Input buffer
+    char* buf_; // Input buffer
+    size_t bufSize_; // Size of the input buffer
     size_t bufPos_; // Number of bytes in the input buffer
 
     char cmdData_[CMD_BUF_SIZE]; // Command data
@@ -130,6 +142,7 @@ private:
     unsigned status_; // Status flags
 
     Vector<UrcHandler> urcHandlers_; // URC handlers
+    Vector<UrcTrieNode> urcTrie_; // Prefix trie of the URC handlers, the root node is at index 0
     AtParserConfig conf_; // Parser settings
 
     int readRespLine(char* data, size_t size);
@@ -140,6 +153,9 @@ private:
     int parseUrc(const UrcHandler** handler);
     int parseEcho();
 
+    int addToUrcTrie(int handlerIndex);
+    int rebuildUrcTrie();
+
     int readLine(char* data, size_t size, unsigned* timeout);
     int nextLine(unsigned* timeout);
     int readMore(unsigned* timeout);
@@ -76,6 +76,17 @@ int AtResponseReader::readLine(char* data, size_t size) {
     return n;
 }
 
+int AtResponseReader::read(char* data, size_t size) {
+    if (!parser_) {
+        return error(SYSTEM_ERROR_INVALID_STATE);
+    }
+    const int n = parser_->read(data, size);
+    if (n < 0) {
+        return error(n);
+    }
+    return n;
+}
+
 CString AtResponseReader::readLine() {
     const size_t size = READ_LINE_INIT_BUF_SIZE;
     auto buf = (char*)malloc(size);
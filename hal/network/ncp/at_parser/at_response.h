@@ -92,6 +92,18 @@ public:
      * @see `scanf()`
      */
     CString readLine();
+    /**
+     * Reads a portion of the current line.
+     *
+     * Unlike `readLine()`, this method doesn't discard the rest of the line, which makes it
+     * possible to process lines of arbitrary length in chunks. The output is not null-terminated.
+     *
+     * @param data Destination buffer.
+     * @param size Buffer size.
+     * @return Number of characters read, `0` if the end of the line is reached, or a negative
+     *         result code in case of an error.
+     */
+    int read(char* data, size_t size);
     /**
      * Reads and parses the current line.
      *
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logging.h"
+LOG_SOURCE_CATEGORY("ncp.client");
+
+#include "at_command_sequence.h"
+
+#include "at_parser.h"
+#include "at_response.h"
+
+#include "timer_hal.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace particle {
+
+namespace {
+
+inline system_tick_t millis() {
+    return HAL_Timer_Get_Milli_Seconds();
+}
+
+} // unnamed
+
+AtCommandSequence::AtCommandSequence(AtParser* parser, const AtSequenceStep* steps, size_t count) :
+        parser_(parser),
+        steps_(steps),
+        count_(count),
+        stats_(),
+        applied_(0),
+        sent_(0),
+        skipped_(0),
+        totalTime_(0) {
+}
+
+int AtCommandSequence::run() {
+    CHECK_TRUE(count_ <= MAX_STEP_COUNT, SYSTEM_ERROR_TOO_LARGE);
+    memset(stats_, 0, sizeof(stats_));
+    sent_ = 0;
+    skipped_ = 0;
+    const auto t = millis();
+    int r = AtResponse::OK;
+    size_t i = 0;
+    while (i < count_) {
+        const auto& s = steps_[i];
+        if ((s.flags & AtSequenceStep::PERSISTENT) && !s.query && (applied_ & (1u << i))) {
+            stats_[i].skipped = true;
+            ++skipped_;
+            ++i;
+            continue;
+        }
+        size_t n = 1;
+        if (isBatchable(i)) {
+            size_t size = strlen(s.cmd);
+            while (i + n < count_ && isBatchable(i + n)) {
+                // Commands following the first one are appended without the "AT" prefix
+                const size_t cmdSize = strlen(steps_[i + n].cmd) - 1;
+                if (size + cmdSize > MAX_BATCH_SIZE) {
+                    break;
+                }
+                size += cmdSize;
+                ++n;
+            }
+        }
+        r = (n > 1) ? runBatch(i, n) : runStep(i);
+        if (r != AtResponse::OK) {
+            break;
+        }
+        i += n;
+    }
+    totalTime_ = millis() - t;
+    return r;
+}
+
+void AtCommandSequence::log() const {
+#ifdef DEBUG_BUILD
+    for (size_t i = 0; i < count_ && i < MAX_STEP_COUNT; ++i) {
+        const auto& s = stats_[i];
+        LOG_DEBUG(TRACE, "%s: %s%u ms", steps_[i].cmd, s.skipped ? "skipped, " : (s.batched ? "batched, " : ""),
+                (unsigned)s.time);
+    }
+#endif // DEBUG_BUILD
+    LOG(TRACE, "Command sequence took %u ms, %u commands sent, %u steps skipped", (unsigned)totalTime_,
+            sent_, skipped_);
+}
+
+int AtCommandSequence::runBatch(size_t first, size_t count) {
+    char line[MAX_BATCH_SIZE + 1] = {};
+    size_t size = 0;
+    unsigned timeout = 0;
+    for (size_t i = first; i < first + count; ++i) {
+        const char* cmd = steps_[i].cmd;
+        if (i != first) {
+            line[size++] = ';';
+            cmd += 2; // Skip "AT"
+        }
+        const size_t n = strlen(cmd);
+        memcpy(line + size, cmd, n);
+        size += n;
+        timeout = std::max(timeout, steps_[i].timeout);
+    }
+    const auto t = millis();
+    const int r = CHECK(exec(line, timeout));
+    if (r == AtResponse::OK) {
+        const auto d = millis() - t;
+        for (size_t i = first; i < first + count; ++i) {
+            stats_[i].time = d;
+            stats_[i].batched = true;
+            if (steps_[i].flags & AtSequenceStep::PERSISTENT) {
+                applied_ |= (1u << i);
+            }
+        }
+        return AtResponse::OK;
+    }
+    // Batched commands are expected to be idempotent, so it's safe to run them again
+    LOG_DEBUG(TRACE, "Batch failed: %s", line);
+    for (size_t i = first; i < first + count; ++i) {
+        const int r = runStep(i);
+        if (r != AtResponse::OK) {
+            return r;
+        }
+    }
+    return AtResponse::OK;
+}
+
+int AtCommandSequence::runStep(size_t step) {
+    const auto& s = steps_[step];
+    const auto t = millis();
+    if (s.query) {
+        auto resp = (s.timeout > 0) ? parser_->sendCommand(s.timeout, "%s", s.query) : parser_->sendCommand("%s", s.query);
+        ++sent_;
+        bool applied = false;
+        const size_t expectSize = s.expect ? strlen(s.expect) : 0;
+        while (resp.hasNextLine()) {
+            char buf[64] = {};
+            CHECK(resp.readLine(buf, sizeof(buf)));
+            if (expectSize > 0 && strncmp(buf, s.expect, expectSize) == 0) {
+                applied = true;
+            }
+        }
+        // The setting is changed anyway if the query fails
+        const int r = CHECK(resp.readResult());
+        if (r == AtResponse::OK && applied) {
+            if (s.flags & AtSequenceStep::PERSISTENT) {
+                applied_ |= (1u << step);
+            }
+            stats_[step].time = millis() - t;
+            stats_[step].skipped = true;
+            ++skipped_;
+            return AtResponse::OK;
+        }
+    }
+    const int r = CHECK(exec(s.cmd, s.timeout));
+    stats_[step].time = millis() - t;
+    if (r == AtResponse::OK) {
+        if (s.flags & AtSequenceStep::PERSISTENT) {
+            applied_ |= (1u << step);
+        }
+    } else if (!(s.flags & AtSequenceStep::OPTIONAL)) {
+        LOG(ERROR, "%s failed: %d", s.cmd, r);
+        return r;
+    }
+    return AtResponse::OK;
+}
+
+int AtCommandSequence::exec(const char* cmd, unsigned timeout) {
+    ++sent_;
+    return (timeout > 0) ? parser_->execCommand(timeout, "%s", cmd) : parser_->execCommand("%s", cmd);
+}
+
+bool AtCommandSequence::isBatchable(size_t step) const {
+    const auto& s = steps_[step];
+    return (s.flags & AtSequenceStep::BATCH) && !s.query && strncmp(s.cmd, "AT", 2) == 0 && strlen(s.cmd) > 2 &&
+            !((s.flags & AtSequenceStep::PERSISTENT) && (applied_ & (1u << step)));
+}
+
+} // particle
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_tick_hal.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particle {
+
+class AtParser;
+
+/**
+ * A step of an AT command sequence.
+ */
+struct AtSequenceStep {
+    /**
+     * Step flags.
+     */
+    enum Flag {
+        OPTIONAL = 0x01, ///< A final result code other than OK is not an error.
+        BATCH = 0x02, ///< The command can be concatenated with adjacent commands that have this flag set.
+        PERSISTENT = 0x04 ///< The setting survives a modem reset and is recorded once it has been applied.
+    };
+
+    const char* cmd; ///< Command.
+    const char* query; ///< Command that reads the current setting, or `nullptr`.
+    const char* expect; ///< Prefix of the `query` response that means the setting is already applied.
+    unsigned flags; ///< Step flags (a combination of the `Flag` values).
+    unsigned timeout; ///< Command timeout in milliseconds, or 0 to use the parser's default timeout.
+};
+
+/**
+ * Runs a declarative sequence of modem configuration commands.
+ *
+ * Adjacent commands marked with `AtSequenceStep::BATCH` are sent as a single command line
+ * (e.g. "AT+COPS=3,2;+CGEREP=1,0"). If the batch fails, its commands are retried one by one.
+ * Steps marked with `AtSequenceStep::PERSISTENT` are recorded in a bit mask once they're known
+ * to be applied. The caller can pass the mask back to `appliedMask()` to skip the persistent steps
+ * that don't have a query. Steps that have a query always run it, since the setting may have been
+ * changed by other means, and only the command that changes the setting is skipped.
+ */
+class AtCommandSequence {
+public:
+    /**
+     * Maximum number of steps in a sequence.
+     */
+    static const size_t MAX_STEP_COUNT = 32;
+    /**
+     * Maximum length of a batched command line.
+     */
+    static const size_t MAX_BATCH_SIZE = 64;
+
+    /**
+     * Timing statistics of a step.
+     */
+    struct StepStats {
+        system_tick_t time; ///< Time spent on the step in the last run (milliseconds).
+        bool skipped; ///< Set to `true` if the step was skipped in the last run.
+        bool batched; ///< Set to `true` if the command was sent as part of a batch.
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param parser AT parser.
+     * @param steps Sequence steps.
+     * @param count Number of steps.
+     */
+    AtCommandSequence(AtParser* parser, const AtSequenceStep* steps, size_t count);
+
+    /**
+     * Sets the mask of persistent steps that are known to be applied.
+     */
+    AtCommandSequence& appliedMask(uint32_t mask);
+    /**
+     * Returns the mask of persistent steps that are known to be applied.
+     */
+    uint32_t appliedMask() const;
+
+    /**
+     * Runs the sequence.
+     *
+     * @return `AtResponse::OK` if all mandatory commands succeeded, a final result code of the
+     *         first mandatory command that failed, or a negative result code in case of an error.
+     */
+    int run();
+
+    /**
+     * Returns the timing statistics of a step.
+     */
+    const StepStats& stats(size_t step) const;
+    /**
+     * Returns the number of command lines sent to the modem in the last run.
+     */
+    unsigned commandsSent() const;
+    /**
+     * Returns the number of steps skipped in the last run.
+     */
+    unsigned stepsSkipped() const;
+    /**
+     * Returns the duration of the last run in milliseconds.
+     */
+    system_tick_t totalTime() const;
+    /**
+     * Logs the timing statistics of the last run.
+     */
+    void log() const;
+
+private:
+    AtParser* parser_;
+    const AtSequenceStep* steps_;
+    size_t count_;
+    StepStats stats_[MAX_STEP_COUNT];
+    uint32_t applied_;
+    unsigned sent_;
+    unsigned skipped_;
+    system_tick_t totalTime_;
+
+    int runBatch(size_t first, size_t count);
+    int runStep(size_t step);
+    int exec(const char* cmd, unsigned timeout);
+    bool isBatchable(size_t step) const;
+};
+
+inline AtCommandSequence& AtCommandSequence::appliedMask(uint32_t mask) {
+    applied_ = mask;
+    return *this;
+}
+
+inline uint32_t AtCommandSequence::appliedMask() const {
+    return applied_;
+}
+
+inline const AtCommandSequence::StepStats& AtCommandSequence::stats(size_t step) const {
+    return stats_[step];
+}
+
+inline unsigned AtCommandSequence::commandsSent() const {
+    return sent_;
+}
+
+inline unsigned AtCommandSequence::stepsSkipped() const {
+    return skipped_;
+}
+
+inline system_tick_t AtCommandSequence::totalTime() const {
+    return totalTime_;
+}
+
+} // particle
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logging.h"
+LOG_SOURCE_CATEGORY("ncp.client");
+
+#include "cellular_ncp_common.h"
+
+#include "at_parser.h"
+#include "at_response.h"
+
+#include "check.h"
+#include "enumclass.h"
+
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#define CHECK_PARSER(_expr) \
+        ({ \
+            const auto _r = _expr; \
+            if (_r < 0) { \
+                this->parserError(_r); \
+                return _r; \
+            } \
+            _r; \
+        })
+
+namespace particle {
+
+namespace {
+
+using LacType = decltype(CellularGlobalIdentity::location_area_code);
+using CidType = decltype(CellularGlobalIdentity::cell_id);
+
+struct RegLineFormat {
+    const char* response; // <n>,<stat>[,<lac>,<ci>[,<AcT>]]
+    const char* urc; // <stat>[,<lac>,<ci>[,<AcT>]]
+};
+
+const RegLineFormat REG_LINE_FORMATS[] = {
+    { "+CREG: %*u,%u,\"%x\",\"%x\",%u", "+CREG: %u,\"%x\",\"%x\",%u" },
+    { "+CGREG: %*u,%u,\"%x\",\"%x\",%u", "+CGREG: %u,\"%x\",\"%x\",%u" },
+    { "+CEREG: %*u,%u,\"%x\",\"%x\",%u", "+CEREG: %u,\"%x\",\"%x\",%u" }
+};
+
+bool isValidAct(CellularAccessTechnology act) {
+    switch (act) {
+        case CellularAccessTechnology::NONE:
+        case CellularAccessTechnology::GSM:
+        case CellularAccessTechnology::GSM_COMPACT:
+        case CellularAccessTechnology::UTRAN:
+        case CellularAccessTechnology::GSM_EDGE:
+        case CellularAccessTechnology::UTRAN_HSDPA:
+        case CellularAccessTechnology::UTRAN_HSUPA:
+        case CellularAccessTechnology::UTRAN_HSDPA_HSUPA:
+        case CellularAccessTechnology::LTE:
+        case CellularAccessTechnology::LTE_CAT_M1:
+        case CellularAccessTechnology::LTE_NB_IOT: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+bool isCsPsAct(CellularAccessTechnology act) {
+    switch (act) {
+        case CellularAccessTechnology::GSM:
+        case CellularAccessTechnology::GSM_COMPACT:
+        case CellularAccessTechnology::UTRAN:
+        case CellularAccessTechnology::GSM_EDGE:
+        case CellularAccessTechnology::UTRAN_HSDPA:
+        case CellularAccessTechnology::UTRAN_HSUPA:
+        case CellularAccessTechnology::UTRAN_HSDPA_HSUPA: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+bool isEpsAct(CellularAccessTechnology act) {
+    switch (act) {
+        case CellularAccessTechnology::LTE:
+        case CellularAccessTechnology::LTE_CAT_M1:
+        case CellularAccessTechnology::LTE_NB_IOT: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+} // unnamed
+
+CellularNcpCommon::CellularNcpCommon(AtParser* parser, CellularGlobalIdentity* cgi, int* parserError) :
+        parser_(parser),
+        cgi_(cgi),
+        parserError_(parserError),
+        traits_(nullptr) {
+}
+
+int CellularNcpCommon::processRegLine(CellularRegType type, const char* line, CellularAccessTechnology act,
+        CellularRegistrationStatus* status, CellularRegUpdate* update) {
+    const auto& fmt = REG_LINE_FORMATS[to_underlying(type)];
+    unsigned int val[4] = {};
+    // Parse response ignoring mode (replicate URC response)
+    int r = ::sscanf(line, fmt.response, &val[0], &val[1], &val[2], &val[3]);
+    // A line that includes the mode is a response to the query command
+    const bool urc = (0 >= r);
+    // Reparse URC as direct response
+    if (urc) {
+        r = ::sscanf(line, fmt.urc, &val[0], &val[1], &val[2], &val[3]);
+    }
+    CHECK_TRUE(r >= 1, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
+
+    const bool prevRegistered = status->registered();
+    const auto prevStatus = status->status();
+    status->status(CellularRegistrationStatus::decodeAtStatus(val[0]));
+    if (update) {
+        update->urc = urc;
+        update->changed = (status->status() != prevStatus);
+        update->registered = !prevRegistered && status->registered();
+    }
+    // Cellular Global Identity (partial)
+    if (r >= 3) {
+        bool set = false;
+        if (type == CellularRegType::CREG) {
+            // Only update if unset
+            set = cgi_->location_area_code == std::numeric_limits<LacType>::max() &&
+                    cgi_->cell_id == std::numeric_limits<CidType>::max();
+        } else {
+            const auto rat = (r >= 4) ? static_cast<CellularAccessTechnology>(val[3]) : act;
+            set = (type == CellularRegType::CGREG) ? isCsPsAct(rat) : isEpsAct(rat);
+        }
+        if (set) {
+            cgi_->location_area_code = static_cast<LacType>(val[1]);
+            cgi_->cell_id = static_cast<CidType>(val[2]);
+        }
+    }
+    return SYSTEM_ERROR_NONE;
+}
+
+int CellularNcpCommon::queryOperator(CellularSignalQuality* qual) {
+    int act;
+    char mobileCountryCode[4] = {0};
+    char mobileNetworkCode[4] = {0};
+
+    // Reformat the operator string to be numeric
+    // (allows the capture of `mcc` and `mnc`)
+    int r = CHECK_PARSER(parser_->execCommand("AT+COPS=3,2"));
+    CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
+
+    auto resp = parser_->sendCommand("AT+COPS?");
+    r = CHECK_PARSER(resp.scanf("+COPS: %*d,%*d,\"%3[0-9]%3[0-9]\",%d", mobileCountryCode,
+                                    mobileNetworkCode, &act));
+    CHECK_TRUE(r == 3, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
+    r = CHECK_PARSER(resp.readResult());
+    CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
+
+    // Preserve digit format data
+    const int mnc_digits = ::strnlen(mobileNetworkCode, sizeof(mobileNetworkCode));
+    CHECK_TRUE((2 == mnc_digits || 3 == mnc_digits), SYSTEM_ERROR_BAD_DATA);
+    if (2 == mnc_digits) {
+        cgi_->cgi_flags |= CGI_FLAG_TWO_DIGIT_MNC;
+    } else {
+        cgi_->cgi_flags &= ~CGI_FLAG_TWO_DIGIT_MNC;
+    }
+
+    // `atoi` returns zero on error, which is an invalid `mcc` and `mnc`
+    cgi_->mobile_country_code = static_cast<uint16_t>(::atoi(mobileCountryCode));
+    cgi_->mobile_network_code = static_cast<uint16_t>(::atoi(mobileNetworkCode));
+
+    if (traits_ && traits_->lteIsCatM1) {
+        if (act == particle::to_underlying(CellularAccessTechnology::LTE)) {
+            act = particle::to_underlying(CellularAccessTechnology::LTE_CAT_M1);
+        }
+    }
+    CHECK_TRUE(isValidAct(static_cast<CellularAccessTechnology>(act)), SYSTEM_ERROR_BAD_DATA);
+    if (qual) {
+        qual->accessTechnology(static_cast<CellularAccessTechnology>(act));
+    }
+
+    return SYSTEM_ERROR_NONE;
+}
+
+int CellularNcpCommon::configurePdpContext(const char* apn, bool auth) {
+    CHECK_TRUE(traits_, SYSTEM_ERROR_INVALID_STATE);
+    auto resp = parser_->sendCommand("AT+CGDCONT=%d,\"%s\",\"%s%s\"",
+            traits_->cid, traits_->pdpType,
+            (auth && traits_->chapApn) ? "CHAP:" : "",
+            apn ? apn : "");
+    return CHECK_PARSER(resp.readResult());
+}
+
+int CellularNcpCommon::dial(AtParser* parser) {
+    CHECK_TRUE(traits_, SYSTEM_ERROR_INVALID_STATE);
+    char dialCmd[32] = {};
+    snprintf(dialCmd, sizeof(dialCmd), "ATD*99***%d#", traits_->cid);
+    auto resp = parser->sendCommand(traits_->dialTimeout, "%s", dialCmd);
+    if (resp.hasNextLine()) {
+        char buf[64] = {};
+        CHECK(resp.readLine(buf, sizeof(buf)));
+        const char connectResponse[] = "CONNECT";
+        if (strncmp(buf, connectResponse, sizeof(connectResponse) - 1)) {
+            return SYSTEM_ERROR_UNKNOWN;
+        }
+        return SYSTEM_ERROR_NONE;
+    }
+    // We've got a final response code
+    CHECK(resp.readResult());
+    return SYSTEM_ERROR_NOT_ALLOWED;
+}
+
+} // particle
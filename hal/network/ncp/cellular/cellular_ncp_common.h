@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "cellular_ncp_client.h"
+#include "cellular_reg_status.h"
+
+namespace particle {
+
+class AtParser;
+
+/**
+ * Modem-specific parameters of the common cellular NCP routines.
+ */
+struct CellularNcpTraits {
+    int cid; ///< PDP context identifier.
+    const char* pdpType; ///< PDP type.
+    bool chapApn; ///< Prefix the APN with "CHAP:" if the network requires authentication.
+    bool lteIsCatM1; ///< The modem reports LTE Cat-M1 as LTE in +COPS.
+    unsigned dialTimeout; ///< Timeout of the dial command in milliseconds.
+};
+
+/**
+ * Registration status URC/response types.
+ */
+enum class CellularRegType {
+    CREG, ///< Circuit switched domain (+CREG).
+    CGREG, ///< Packet switched domain (+CGREG).
+    CEREG ///< EPS (+CEREG).
+};
+
+/**
+ * Result of processing a registration status line.
+ */
+struct CellularRegUpdate {
+    bool urc; ///< The line is an unsolicited result code rather than a response to a query.
+    bool changed; ///< The registration status has changed.
+    bool registered; ///< The status has changed from not registered to registered.
+};
+
+/**
+ * Implementation of the AT command handling that is common to the cellular NCP clients.
+ *
+ * The modem-specific behavior is described by `CellularNcpTraits`. Parser errors are reported
+ * to the client via a pointer to its parser error variable, same as with the client's own
+ * `CHECK_PARSER()` checks.
+ */
+class CellularNcpCommon {
+public:
+    /**
+     * Constructor.
+     *
+     * @param parser AT parser of the command channel.
+     * @param cgi Cellular global identity maintained by the client.
+     * @param parserError Variable receiving the last parser error.
+     */
+    CellularNcpCommon(AtParser* parser, CellularGlobalIdentity* cgi, int* parserError);
+
+    /**
+     * Sets the modem traits.
+     */
+    void traits(const CellularNcpTraits* traits);
+    /**
+     * Returns the modem traits.
+     */
+    const CellularNcpTraits* traits() const;
+
+    /**
+     * Processes a +CREG/+CGREG/+CEREG line.
+     *
+     * Both the URCs and the responses to the query commands are supported. The location area
+     * code and cell ID are stored in the cellular global identity if they're reported for the
+     * current access technology.
+     *
+     * @param type Line type.
+     * @param line Line data.
+     * @param act Current access technology.
+     * @param status Registration status to update.
+     * @param update Result of the update (optional).
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int processRegLine(CellularRegType type, const char* line, CellularAccessTechnology act,
+            CellularRegistrationStatus* status, CellularRegUpdate* update = nullptr);
+    /**
+     * Queries the current operator and updates the MCC and MNC of the cellular global identity.
+     *
+     * @param qual Signal quality receiving the access technology (optional).
+     * @return 0 on success, otherwise an error code defined by `system_error_t`.
+     */
+    int queryOperator(CellularSignalQuality* qual = nullptr);
+    /**
+     * Configures the PDP context.
+     *
+     * @param apn APN, or `nullptr` to use the network's default APN.
+     * @param auth Set to `true` if the network requires authentication.
+     * @return Final result code of the command, or a negative result code in case of an error.
+     */
+    int configurePdpContext(const char* apn, bool auth);
+    /**
+     * Requests the packet domain service on the data channel.
+     *
+     * @param parser AT parser of the data channel.
+     * @return 0 if the modem has switched to the data mode, `SYSTEM_ERROR_NOT_ALLOWED` if the
+     *         modem replied with a final result code, or another error code defined by `system_error_t`.
+     */
+    int dial(AtParser* parser);
+
+private:
+    AtParser* parser_;
+    CellularGlobalIdentity* cgi_;
+    int* parserError_;
+    const CellularNcpTraits* traits_;
+
+    void parserError(int error);
+};
+
+inline void CellularNcpCommon::traits(const CellularNcpTraits* traits) {
+    traits_ = traits;
+}
+
+inline const CellularNcpTraits* CellularNcpCommon::traits() const {
+    return traits_;
+}
+
+inline void CellularNcpCommon::parserError(int error) {
+    if (parserError_) {
+        *parserError_ = error;
+    }
+}
+
+} // particle
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logging.h"
+LOG_SOURCE_CATEGORY("ncp.client");
+
+#include "ncp_phase_timer.h"
+
+#include "timer_hal.h"
+
+#include <cstring>
+
+namespace particle {
+
+namespace {
+
+const char* const PHASE_NAMES[NCP_PHASE_COUNT] = {
+    "initReady",
+    "selectNetworkProf",
+    "registerNet",
+    "enterDataMode"
+};
+
+} // unnamed
+
+NcpPhaseTimer::NcpPhaseTimer() {
+    reset();
+}
+
+void NcpPhaseTimer::begin(NcpPhase phase) {
+    startTime_[(size_t)phase] = HAL_Timer_Get_Milli_Seconds();
+}
+
+system_tick_t NcpPhaseTimer::end(NcpPhase phase) {
+    const system_tick_t d = HAL_Timer_Get_Milli_Seconds() - startTime_[(size_t)phase];
+    auto& s = stats_[(size_t)phase];
+    s.last = d;
+    s.total += d;
+    if (d > s.max) {
+        s.max = d;
+    }
+    ++s.count;
+    LOG(TRACE, "%s took %u ms", phaseName(phase), (unsigned)d);
+    return d;
+}
+
+void NcpPhaseTimer::reset() {
+    memset(stats_, 0, sizeof(stats_));
+    memset(startTime_, 0, sizeof(startTime_));
+}
+
+void NcpPhaseTimer::log() const {
+    for (size_t i = 0; i < NCP_PHASE_COUNT; ++i) {
+        const auto& s = stats_[i];
+        if (s.count > 0) {
+            LOG(TRACE, "%s: last %u ms, max %u ms, avg %u ms (%u runs)", PHASE_NAMES[i], (unsigned)s.last,
+                    (unsigned)s.max, (unsigned)(s.total / s.count), s.count);
+        }
+    }
+}
+
+const char* NcpPhaseTimer::phaseName(NcpPhase phase) {
+    return PHASE_NAMES[(size_t)phase];
+}
+
+} // particle
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_tick_hal.h"
+
+#include <cstddef>
+
+namespace particle {
+
+/**
+ * Phases of the cellular NCP connection sequence.
+ */
+enum class NcpPhase {
+    INIT_READY = 0, ///< Early modem initialization.
+    SELECT_NETWORK_PROF = 1, ///< MNO and band profile selection, or network settings selection on modems without MNO profiles.
+    REGISTER_NET = 2, ///< Network registration request.
+    ENTER_DATA_MODE = 3 ///< Switching the data channel to PPP.
+};
+
+/**
+ * Number of phases.
+ */
+const size_t NCP_PHASE_COUNT = 4;
+
+/**
+ * Timing statistics of a phase.
+ */
+struct NcpPhaseStats {
+    system_tick_t last; ///< Duration of the last completed run (milliseconds).
+    system_tick_t max; ///< Maximum duration (milliseconds).
+    system_tick_t total; ///< Total duration of all runs (milliseconds).
+    unsigned count; ///< Number of completed runs.
+};
+
+/**
+ * Collects per-phase timing of the NCP connection sequence.
+ */
+class NcpPhaseTimer {
+public:
+    /**
+     * Times a phase for the lifetime of the object.
+     */
+    class Scope {
+    public:
+        Scope(NcpPhaseTimer* timer, NcpPhase phase);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        NcpPhaseTimer* timer_;
+        NcpPhase phase_;
+    };
+
+    NcpPhaseTimer();
+
+    /**
+     * Marks the beginning of a phase.
+     */
+    void begin(NcpPhase phase);
+    /**
+     * Marks the end of a phase.
+     *
+     * @return Duration of the phase in milliseconds.
+     */
+    system_tick_t end(NcpPhase phase);
+
+    /**
+     * Returns the timing statistics of a phase.
+     */
+    const NcpPhaseStats& stats(NcpPhase phase) const;
+    /**
+     * Resets the timing statistics.
+     */
+    void reset();
+    /**
+     * Logs the timing statistics of all phases that have completed at least once.
+     */
+    void log() const;
+
+    /**
+     * Returns the name of a phase.
+     */
+    static const char* phaseName(NcpPhase phase);
+
+private:
+    NcpPhaseStats stats_[NCP_PHASE_COUNT];
+    system_tick_t startTime_[NCP_PHASE_COUNT];
+};
+
+inline NcpPhaseTimer::Scope::Scope(NcpPhaseTimer* timer, NcpPhase phase) :
+        timer_(timer),
+        phase_(phase) {
+    timer_->begin(phase_);
+}
+
+inline NcpPhaseTimer::Scope::~Scope() {
+    timer_->end(phase_);
+}
+
+inline const NcpPhaseStats& NcpPhaseTimer::stats(NcpPhase phase) const {
+    return stats_[(size_t)phase];
+}
+
+} // particle
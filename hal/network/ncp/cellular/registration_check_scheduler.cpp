@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logging.h"
+LOG_SOURCE_CATEGORY("ncp.client");
+
+#include "registration_check_scheduler.h"
+
+#include <algorithm>
+
+namespace particle {
+
+RegistrationCheckScheduler::RegistrationCheckScheduler(system_tick_t minInterval, system_tick_t maxInterval) :
+        minInterval_(minInterval),
+        maxInterval_(std::max(minInterval, maxInterval)),
+        interval_(minInterval),
+        lastUpdate_(0),
+        lastSlot_(0),
+        sent_(0),
+        avoided_(0),
+        urcs_(0) {
+}
+
+void RegistrationCheckScheduler::reset(system_tick_t now) {
+    interval_ = minInterval_;
+    lastUpdate_ = now;
+    lastSlot_ = now;
+}
+
+void RegistrationCheckScheduler::urcReceived(bool changed, system_tick_t now) {
+    ++urcs_;
+    lastUpdate_ = now;
+    if (changed) {
+        interval_ = minInterval_;
+    }
+}
+
+bool RegistrationCheckScheduler::checkDue(system_tick_t now) {
+    const bool due = now - lastUpdate_ >= interval_;
+    if (!due && now - lastSlot_ >= minInterval_) {
+        lastSlot_ = now;
+        ++avoided_;
+    }
+    return due;
+}
+
+void RegistrationCheckScheduler::checked(bool changed, system_tick_t now) {
+    ++sent_;
+    lastUpdate_ = now;
+    lastSlot_ = now;
+    interval_ = changed ? minInterval_ : std::min(interval_ * 2, maxInterval_);
+}
+
+void RegistrationCheckScheduler::log() const {
+    LOG(TRACE, "Registration polls: %u sent, %u avoided, %u URCs received, interval: %u ms", sent_, avoided_,
+            urcs_, (unsigned)interval_);
+}
+
+} // particle
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_tick_hal.h"
+
+namespace particle {
+
+/**
+ * Schedules the registration status polls of a cellular NCP client.
+ *
+ * The registration state is tracked via the +CREG/+CGREG/+CEREG URCs. A poll is only due when
+ * no URC has been received for the current poll interval. The interval starts at `minInterval`
+ * and doubles up to `maxInterval` every time a poll doesn't change the registration state.
+ * Any change of the state resets the interval back to `minInterval`.
+ */
+class RegistrationCheckScheduler {
+public:
+    /**
+     * Constructor.
+     *
+     * @param minInterval Minimum poll interval in milliseconds.
+     * @param maxInterval Maximum poll interval in milliseconds.
+     */
+    RegistrationCheckScheduler(system_tick_t minInterval, system_tick_t maxInterval);
+
+    /**
+     * Restarts the scheduling at the minimum poll interval.
+     *
+     * The poll counters are not reset.
+     */
+    void reset(system_tick_t now);
+    /**
+     * Notifies the scheduler that a registration URC has been received.
+     *
+     * @param changed `true` if the registration state has changed.
+     */
+    void urcReceived(bool changed, system_tick_t now);
+    /**
+     * Returns `true` if a poll is due.
+     *
+     * A poll that would have been sent at the minimum poll interval but is not due is counted
+     * as avoided.
+     */
+    bool checkDue(system_tick_t now);
+    /**
+     * Notifies the scheduler that a poll has been sent.
+     *
+     * @param changed `true` if the registration state has changed.
+     */
+    void checked(bool changed, system_tick_t now);
+
+    /**
+     * Returns the current poll interval in milliseconds.
+     */
+    system_tick_t interval() const;
+    /**
+     * Returns the number of polls sent.
+     */
+    unsigned checksSent() const;
+    /**
+     * Returns the number of polls avoided.
+     */
+    unsigned checksAvoided() const;
+    /**
+     * Returns the number of registration URCs received.
+     */
+    unsigned urcCount() const;
+    /**
+     * Logs the poll statistics.
+     */
+    void log() const;
+
+private:
+    system_tick_t minInterval_;
+    system_tick_t maxInterval_;
+    system_tick_t interval_;
+    system_tick_t lastUpdate_; // Time of the last URC or poll
+    system_tick_t lastSlot_; // Time of the last poll at the minimum interval
+    unsigned sent_;
+    unsigned avoided_;
+    unsigned urcs_;
+};
+
+inline system_tick_t RegistrationCheckScheduler::interval() const {
+    return interval_;
+}
+
+inline unsigned RegistrationCheckScheduler::checksSent() const {
+    return sent_;
+}
+
+inline unsigned RegistrationCheckScheduler::checksAvoided() const {
+    return avoided_;
+}
+
+inline unsigned RegistrationCheckScheduler::urcCount() const {
+    return urcs_;
+}
+
+} // particle
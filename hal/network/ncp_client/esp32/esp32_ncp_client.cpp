@@ -84,6 +84,17 @@ const auto ESP32_NCP_KEEPALIVE_MAX_MISSED = 5;
 const auto ESP32_NCP_AT_CHANNEL_RX_BUFFER_SIZE = 4096;
 
 const auto ESP32_NCP_DEFAULT_SERIAL_BAUDRATE = 921600;
+#if HAL_PLATFORM_WIFI_NCP_HIGH_THROUGHPUT
+// Highest baud rate supported by the nRF52840 UARTE; the ESP32 UART clock divides it exactly
+const auto ESP32_NCP_RUNTIME_SERIAL_BAUDRATE = 1000000;
+// Larger buffers let the UARTE receive and transmit in longer DMA transfers
+const auto ESP32_NCP_SERIAL_RX_BUFFER_SIZE = 4096;
+const auto ESP32_NCP_SERIAL_TX_BUFFER_SIZE = 4096;
+#else
+const auto ESP32_NCP_RUNTIME_SERIAL_BAUDRATE = ESP32_NCP_DEFAULT_SERIAL_BAUDRATE;
+const auto ESP32_NCP_SERIAL_RX_BUFFER_SIZE = 0; // Default size
+const auto ESP32_NCP_SERIAL_TX_BUFFER_SIZE = 0;
+#endif // HAL_PLATFORM_WIFI_NCP_HIGH_THROUGHPUT
 const auto ESP32_NCP_DEFAULT_SDIO_SPEED = 8000000;  // 8MHz
 
 const auto ESP32_NCP_AT_CHANNEL = 1;
@@ -105,7 +116,8 @@ Esp32NcpClient::Esp32NcpClient() :
         connState_(NcpConnectionState::DISCONNECTED),
         parserError_(0),
         ready_(false),
-        muxerNotStarted_(false) {
+        muxerNotStarted_(false),
+        runtimeBaudRateFailed_(false) {
 }
 
 Esp32NcpClient::~Esp32NcpClient() {
@@ -125,7 +137,7 @@ int Esp32NcpClient::init(const NcpClientConfig& conf) {
 #if !HAL_PLATFORM_WIFI_NCP_SDIO
     // Initialize serial stream
     std::unique_ptr<SerialStream> serial(new(std::nothrow) SerialStream(HAL_USART_SERIAL2, ESP32_NCP_DEFAULT_SERIAL_BAUDRATE,
-            SERIAL_8N1 | SERIAL_FLOW_CONTROL_RTS_CTS));
+            SERIAL_8N1 | SERIAL_FLOW_CONTROL_RTS_CTS, ESP32_NCP_SERIAL_RX_BUFFER_SIZE, ESP32_NCP_SERIAL_TX_BUFFER_SIZE));
 #else
     std::unique_ptr<Esp32SdioStream> serial(new(std::nothrow) Esp32SdioStream(HAL_SPI_INTERFACE2, ESP32_NCP_DEFAULT_SDIO_SPEED, WIFI_CS, WIFI_INT));
 #endif // !HAL_PLATFORM_WIFI_NCP_SDIO
@@ -566,6 +578,22 @@ int Esp32NcpClient::initReady() {
     CHECK(getMacAddressImpl(&mac));
     CHECK(wifiNcpUpdateInfoCache(mver, mac));
 
+#if !HAL_PLATFORM_WIFI_NCP_SDIO
+    if (ESP32_NCP_RUNTIME_SERIAL_BAUDRATE != ESP32_NCP_DEFAULT_SERIAL_BAUDRATE && !runtimeBaudRateFailed_) {
+        // The baud rate needs to be changed before the muxer is started
+        const int r = changeBaudRate(ESP32_NCP_RUNTIME_SERIAL_BAUDRATE);
+        if (r == SYSTEM_ERROR_NOT_SUPPORTED) {
+            LOG(TRACE, "NCP doesn't support changing the baud rate");
+            runtimeBaudRateFailed_ = true;
+        } else if (r < 0) {
+            // The NCP will be reset back to the default baud rate
+            LOG(ERROR, "NCP is not responsive @ %u baud", (unsigned)ESP32_NCP_RUNTIME_SERIAL_BAUDRATE);
+            runtimeBaudRateFailed_ = true;
+            return r;
+        }
+    }
+#endif // !HAL_PLATFORM_WIFI_NCP_SDIO
+
     if (mver >= ESP32_NCP_MIN_MVER_WITH_CMUX) {
 #if HAL_PLATFORM_WIFI_NCP_SDIO
         serial_->txInterruptSupported(true);
@@ -586,6 +614,27 @@ int Esp32NcpClient::initReady() {
     return 0;
 }
 
+#if !HAL_PLATFORM_WIFI_NCP_SDIO
+int Esp32NcpClient::changeBaudRate(unsigned int baud) {
+    // The setting is not persistent, the NCP starts at the default baud rate after a reset.
+    // RTS/CTS flow control stays enabled
+    auto resp = parser_.sendCommand("AT+UART_CUR=%u,8,1,0,3", baud);
+    const int r = CHECK_PARSER(resp.readResult());
+    CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_NOT_SUPPORTED);
+    CHECK(serial_->setBaudRate(baud));
+    skipAll(serial_.get(), 100);
+    parser_.reset();
+    for (unsigned i = 0; i < 3; ++i) {
+        if (parser_.execCommand(1000, "AT") == AtResponse::OK) {
+            LOG(TRACE, "Switched to %u baud", baud);
+            return 0;
+        }
+    }
+    CHECK(serial_->setBaudRate(ESP32_NCP_DEFAULT_SERIAL_BAUDRATE));
+    return SYSTEM_ERROR_TIMEOUT;
+}
+#endif // !HAL_PLATFORM_WIFI_NCP_SDIO
+
 int Esp32NcpClient::initMuxer() {
     // Initialize muxer
     muxer_.setStream(serial_.get());
@@ -89,11 +89,13 @@ private:
     std::unique_ptr<particle::MuxerChannelStream<decltype(muxer_)> > muxerAtStream_;
     bool muxerNotStarted_;
     volatile bool inFlowControl_ = false;
+    bool runtimeBaudRateFailed_;
 
     int initParser(Stream* stream);
     int waitReady();
     int initReady();
     int initMuxer();
+    int changeBaudRate(unsigned int baud);
     static int muxChannelStateCb(uint8_t channel, decltype(muxer_)::ChannelState oldState,
             decltype(muxer_)::ChannelState newState, void* ctx);
     void ncpState(NcpState state);
@@ -24,6 +24,8 @@ LOG_SOURCE_CATEGORY("ncp.client");
 #include "at_command.h"
 #include "at_response.h"
 #include "network/ncp/cellular/network_config_db.h"
+#include "network/ncp/cellular/cellular_ncp_common.h"
+#include "network/ncp/cellular/at_command_sequence.h"
 
 #include "serial_stream.h"
 #include "check.h"
@@ -98,6 +100,7 @@ const auto QUECTEL_NCP_KEEPALIVE_MAX_MISSED = 5;
 // FIXME: for now using a very large buffer
 const auto QUECTEL_NCP_AT_CHANNEL_RX_BUFFER_SIZE = 4096;
 const auto QUECTEL_NCP_PPP_CHANNEL_RX_BUFFER_SIZE = 256;
+const auto QUECTEL_NCP_AT_PARSER_INPUT_BUFFER_SIZE = 256;
 
 const auto QUECTEL_NCP_AT_CHANNEL = 1;
 const auto QUECTEL_NCP_PPP_CHANNEL = 2;
@@ -105,6 +108,7 @@ const auto QUECTEL_NCP_PPP_CHANNEL = 2;
 const auto QUECTEL_NCP_SIM_SELECT_PIN = 23;
 
 const unsigned REGISTRATION_CHECK_INTERVAL = 15 * 1000;
+const unsigned REGISTRATION_CHECK_MAX_INTERVAL = 60 * 1000;
 const unsigned REGISTRATION_TIMEOUT = 10 * 60 * 1000;
 const unsigned REGISTRATION_INTERVENTION_TIMEOUT = 15 * 1000;
 const unsigned REGISTRATION_TWILIO_HOLDOFF_TIMEOUT = 5 * 60 * 1000;
@@ -128,6 +132,14 @@ using CidType = decltype(CellularGlobalIdentity::cell_id);
 const int QUECTEL_DEFAULT_CID = 1;
 const char QUECTEL_DEFAULT_PDP_TYPE[] = "IP";
 
+const CellularNcpTraits QUECTEL_NCP_TRAITS = {
+    .cid = QUECTEL_DEFAULT_CID,
+    .pdpType = QUECTEL_DEFAULT_PDP_TYPE,
+    .chapApn = false,
+    .lteIsCatM1 = false,
+    .dialTimeout = 3 * 60 * 1000
+};
+
 const int IMSI_MAX_RETRY_CNT = 10;
 const int CCID_MAX_RETRY_CNT = 2;
 
@@ -135,9 +147,28 @@ const int DATA_MODE_BREAK_ATTEMPTS = 5;
 const int PPP_ECHO_REQUEST_ATTEMPTS = 3;
 const int CGDCONT_ATTEMPTS = 5;
 
+// Low power modes are disabled on BG96 before starting the muxer
+const AtSequenceStep QUECTEL_NCP_BG96_LOW_POWER_STEPS[] = {
+    // Force eDRX mode to be disabled.
+    { "AT+CEDRXS=0", nullptr, nullptr, AtSequenceStep::OPTIONAL | AtSequenceStep::BATCH, 0 },
+    // Disable Power Saving Mode
+    { "AT+CPSMS=0", nullptr, nullptr, AtSequenceStep::OPTIONAL | AtSequenceStep::BATCH, 0 }
+};
+
+// Configuration commands sent over the muxed AT channel
+const AtSequenceStep QUECTEL_NCP_MUXER_INIT_STEPS[] = {
+    // Make sure that we receive URCs only on AT channel, ignore response code just in case
+    { "AT+QCFG=\"cmux/urcport\",1", nullptr, nullptr, AtSequenceStep::OPTIONAL | AtSequenceStep::BATCH, 0 },
+    // Enable packet domain error reporting
+    // Ignore error responses, this command is known to fail sometimes
+    { "AT+CGEREP=1,0", nullptr, nullptr, AtSequenceStep::OPTIONAL | AtSequenceStep::BATCH, 0 }
+};
+
 } // anonymous
 
-QuectelNcpClient::QuectelNcpClient() {
+QuectelNcpClient::QuectelNcpClient() :
+        common_(&parser_, &cgi_, &parserError_),
+        regCheck_(REGISTRATION_CHECK_INTERVAL, REGISTRATION_CHECK_MAX_INTERVAL) {
 }
 
 QuectelNcpClient::~QuectelNcpClient() {
@@ -147,6 +178,7 @@ QuectelNcpClient::~QuectelNcpClient() {
 int QuectelNcpClient::init(const NcpClientConfig& conf) {
     modemInit();
     conf_ = static_cast<const CellularNcpClientConfig&>(conf);
+    common_.traits(&QUECTEL_NCP_TRAITS);
 
 
     // Initialize serial stream
@@ -168,7 +200,6 @@ int QuectelNcpClient::init(const NcpClientConfig& conf) {
     prevNcpState_ = NcpState::OFF;
     connState_ = NcpConnectionState::DISCONNECTED;
     regStartTime_ = 0;
-    regCheckTime_ = 0;
     parserError_ = 0;
     ready_ = false;
     registrationTimeout_ = REGISTRATION_TIMEOUT;
@@ -189,7 +220,10 @@ void QuectelNcpClient::destroy() {
 
 int QuectelNcpClient::initParser(Stream* stream) {
     // Initialize AT parser
-    auto parserConf = AtParserConfig().stream(stream).commandTerminator(AtCommandTerminator::CRLF);
+    auto parserConf = AtParserConfig()
+            .stream(stream)
+            .commandTerminator(AtCommandTerminator::CRLF)
+            .inputBufferSize(QUECTEL_NCP_AT_PARSER_INPUT_BUFFER_SIZE);
     parser_.destroy();
     CHECK(parser_.init(std::move(parserConf)));
 
@@ -200,123 +234,33 @@ int QuectelNcpClient::initParser(Stream* stream) {
     //+CREG: <stat>[,<lac>,<ci>[,<Act>]]
     CHECK(parser_.addUrcHandler("+CREG", [](AtResponseReader* reader, const char* prefix, void* data) -> int {
         const auto self = (QuectelNcpClient*)data;
-        unsigned int val[4] = {};
         char atResponse[64] = {};
-        // Take a copy of AT response for multi-pass scanning
         CHECK_PARSER_URC(reader->readLine(atResponse, sizeof(atResponse)));
-        // Parse response ignoring mode (replicate URC response)
-        int r = ::sscanf(atResponse, "+CREG: %*u,%u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]);
-        // Reparse URC as direct response
-        if (0 >= r) {
-            r = CHECK_PARSER_URC(
-                ::sscanf(atResponse, "+CREG: %u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]));
-        }
-        CHECK_TRUE(r >= 1, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
-
-        bool prevRegStatus = self->csd_.registered();
-        self->csd_.status(self->csd_.decodeAtStatus(val[0]));
-        // Check IMSI only if registered from a non-registered state, to avoid checking IMSI
-        // every time there is a cell tower change in which case also we could see a CEREG: {1 or 5} URC
-        // TODO: Do this only for Twilio
-        if (!prevRegStatus && self->csd_.registered()) {   // just registered. Check which IMSI worked.
-            self->checkImsi_ = true;
-        }
-        // self->checkRegistrationState();
-        // Cellular Global Identity (partial)
-        // Only update if unset
-        if (r >= 3) {
-            if (self->cgi_.location_area_code == std::numeric_limits<LacType>::max() &&
-                    self->cgi_.cell_id == std::numeric_limits<CidType>::max()) {
-                self->cgi_.location_area_code = static_cast<LacType>(val[1]);
-                self->cgi_.cell_id = static_cast<CidType>(val[2]);
-            }
-        }
+        CellularRegUpdate update = {};
+        CHECK(self->common_.processRegLine(CellularRegType::CREG, atResponse, self->act_, &self->csd_, &update));
+        self->registrationUpdated(update);
         return SYSTEM_ERROR_NONE;
     }, this));
     //+CGREG: <n>,<stat>[,<lac>,<ci>[,<Act>]]
     //+CGREG: <stat>[,<lac>,<ci>[,<Act>]]
     CHECK(parser_.addUrcHandler("+CGREG", [](AtResponseReader* reader, const char* prefix, void* data) -> int {
         const auto self = (QuectelNcpClient*)data;
-        unsigned int val[4] = {};
         char atResponse[64] = {};
-        // Take a copy of AT response for multi-pass scanning
         CHECK_PARSER_URC(reader->readLine(atResponse, sizeof(atResponse)));
-        // Parse response ignoring mode (replicate URC response)
-        int r = ::sscanf(atResponse, "+CGREG: %*u,%u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]);
-        // Reparse URC as direct response
-        if (0 >= r) {
-            r = CHECK_PARSER_URC(
-                ::sscanf(atResponse, "+CGREG: %u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]));
-        }
-        CHECK_TRUE(r >= 1, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
-
-        bool prevRegStatus = self->psd_.registered();
-        self->psd_.status(self->psd_.decodeAtStatus(val[0]));
-        // Check IMSI only if registered from a non-registered state, to avoid checking IMSI
-        // every time there is a cell tower change in which case also we could see a CGREG: {1 or 5} URC
-        // TODO: Do this only for Twilio
-        if (!prevRegStatus && self->psd_.registered()) {   // just registered. Check which IMSI worked.
-            self->checkImsi_ = true;
-        }
-        // self->checkRegistrationState();
-        // Cellular Global Identity (partial)
-        if (r >= 3) {
-            auto rat = r >= 4 ? static_cast<CellularAccessTechnology>(val[3]) : self->act_;
-            switch (rat) {
-                case CellularAccessTechnology::GSM:
-                case CellularAccessTechnology::GSM_COMPACT:
-                case CellularAccessTechnology::UTRAN:
-                case CellularAccessTechnology::GSM_EDGE:
-                case CellularAccessTechnology::UTRAN_HSDPA:
-                case CellularAccessTechnology::UTRAN_HSUPA:
-                case CellularAccessTechnology::UTRAN_HSDPA_HSUPA: {
-                    self->cgi_.location_area_code = static_cast<LacType>(val[1]);
-                    self->cgi_.cell_id = static_cast<CidType>(val[2]);
-                    break;
-                }
-            }
-        }
+        CellularRegUpdate update = {};
+        CHECK(self->common_.processRegLine(CellularRegType::CGREG, atResponse, self->act_, &self->psd_, &update));
+        self->registrationUpdated(update);
         return SYSTEM_ERROR_NONE;
     }, this));
     //+CEREG: <n>,<stat>[,<tac>,<ci>[,<Act>]]
     //+CEREG: <stat>[,<tac>,<ci>[,<Act>]]
     CHECK(parser_.addUrcHandler("+CEREG", [](AtResponseReader* reader, const char* prefix, void* data) -> int {
         const auto self = (QuectelNcpClient*)data;
-        unsigned int val[4] = {};
         char atResponse[64] = {};
-        // Take a copy of AT response for multi-pass scanning
         CHECK_PARSER_URC(reader->readLine(atResponse, sizeof(atResponse)));
-        // Parse response ignoring mode (replicate URC response)
-        int r = ::sscanf(atResponse, "+CEREG: %*u,%u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]);
-        // Reparse URC as direct response
-        if (0 >= r) {
-            r = CHECK_PARSER_URC(
-                ::sscanf(atResponse, "+CEREG: %u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]));
-        }
-        CHECK_TRUE(r >= 1, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
-
-        bool prevRegStatus = self->eps_.registered();
-        self->eps_.status(self->eps_.decodeAtStatus(val[0]));
-        // Check IMSI only if registered from a non-registered state, to avoid checking IMSI
-        // every time there is a cell tower change in which case also we could see a CEREG: {1 or 5} URC
-        // TODO: Do this only for Twilio
-        if (!prevRegStatus && self->eps_.registered()) {   // just registered. Check which IMSI worked.
-            self->checkImsi_ = true;
-        }
-        // self->checkRegistrationState();
-        // Cellular Global Identity (partial)
-        if (r >= 3) {
-            auto rat = r >= 4 ? static_cast<CellularAccessTechnology>(val[3]) : self->act_;
-            switch (rat) {
-                case CellularAccessTechnology::LTE:
-                case CellularAccessTechnology::LTE_CAT_M1:
-                case CellularAccessTechnology::LTE_NB_IOT: {
-                    self->cgi_.location_area_code = static_cast<LacType>(val[1]);
-                    self->cgi_.cell_id = static_cast<CidType>(val[2]);
-                    break;
-                }
-            }
-        }
+        CellularRegUpdate update = {};
+        CHECK(self->common_.processRegLine(CellularRegType::CEREG, atResponse, self->act_, &self->eps_, &update));
+        self->registrationUpdated(update);
         return SYSTEM_ERROR_NONE;
     }, this));
 	// "+QUSIM: 1" URC is seen with USIM update / availability
@@ -572,58 +516,7 @@ int QuectelNcpClient::getImei(char* buf, size_t size) {
 }
 
 int QuectelNcpClient::queryAndParseAtCops(CellularSignalQuality* qual) {
-    int act;
-    char mobileCountryCode[4] = {0};
-    char mobileNetworkCode[4] = {0};
-
-    // Reformat the operator string to be numeric
-    // (allows the capture of `mcc` and `mnc`)
-    int r = CHECK_PARSER(parser_.execCommand("AT+COPS=3,2"));
-    CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
-
-    auto resp = parser_.sendCommand("AT+COPS?");
-    r = CHECK_PARSER(resp.scanf("+COPS: %*d,%*d,\"%3[0-9]%3[0-9]\",%d", mobileCountryCode,
-                                    mobileNetworkCode, &act));
-    CHECK_TRUE(r == 3, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
-    r = CHECK_PARSER(resp.readResult());
-    CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
-
-    // Preserve digit format data
-    const int mnc_digits = ::strnlen(mobileNetworkCode, sizeof(mobileNetworkCode));
-    CHECK_TRUE((2 == mnc_digits || 3 == mnc_digits), SYSTEM_ERROR_BAD_DATA);
-    if (2 == mnc_digits) {
-        cgi_.cgi_flags |= CGI_FLAG_TWO_DIGIT_MNC;
-    } else {
-        cgi_.cgi_flags &= ~CGI_FLAG_TWO_DIGIT_MNC;
-    }
-
-    // `atoi` returns zero on error, which is an invalid `mcc` and `mnc`
-    cgi_.mobile_country_code = static_cast<uint16_t>(::atoi(mobileCountryCode));
-    cgi_.mobile_network_code = static_cast<uint16_t>(::atoi(mobileNetworkCode));
-
-    switch (static_cast<CellularAccessTechnology>(act)) {
-        case CellularAccessTechnology::NONE:
-        case CellularAccessTechnology::GSM:
-        case CellularAccessTechnology::GSM_COMPACT:
-        case CellularAccessTechnology::UTRAN:
-        case CellularAccessTechnology::GSM_EDGE:
-        case CellularAccessTechnology::UTRAN_HSDPA:
-        case CellularAccessTechnology::UTRAN_HSUPA:
-        case CellularAccessTechnology::UTRAN_HSDPA_HSUPA:
-        case CellularAccessTechnology::LTE:
-        case CellularAccessTechnology::LTE_CAT_M1:
-        case CellularAccessTechnology::LTE_NB_IOT: {
-            break;
-        }
-        default: {
-            return SYSTEM_ERROR_BAD_DATA;
-        }
-    }
-    if (qual) {
-        qual->accessTechnology(static_cast<CellularAccessTechnology>(act));
-    }
-
-    return SYSTEM_ERROR_NONE;
+    return common_.queryOperator(qual);
 }
 
 int QuectelNcpClient::getCellularGlobalIdentity(CellularGlobalIdentity* cgi) {
@@ -1011,6 +904,7 @@ int QuectelNcpClient::changeBaudRate(unsigned int baud) {
 }
 
 int QuectelNcpClient::initReady(ModemState state) {
+    const NcpPhaseTimer::Scope phase(&phaseTimer_, NcpPhase::INIT_READY);
     // Set modem full functionality
     int r = CHECK_PARSER(parser_.execCommand("AT+CFUN=1,0"));
     CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_UNKNOWN);
@@ -1042,11 +936,10 @@ int QuectelNcpClient::initReady(ModemState state) {
         // CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_UNKNOWN);
 
         if (ncpId() == PLATFORM_NCP_QUECTEL_BG96) {
-            // Force eDRX mode to be disabled.
-            CHECK_PARSER(parser_.execCommand("AT+CEDRXS=0"));
-
-            // Disable Power Saving Mode
-            CHECK_PARSER(parser_.execCommand("AT+CPSMS=0"));
+            AtCommandSequence seq(&parser_, QUECTEL_NCP_BG96_LOW_POWER_STEPS,
+                    sizeof(QUECTEL_NCP_BG96_LOW_POWER_STEPS) / sizeof(QUECTEL_NCP_BG96_LOW_POWER_STEPS[0]));
+            CHECK_PARSER(seq.run());
+            seq.log();
         }
 
         // Select (U)SIM card in slot 1, EG91 has two SIM card slots
@@ -1097,13 +990,10 @@ int QuectelNcpClient::initReady(ModemState state) {
 
     muxerSg.dismiss();
 
-    // Make sure that we receive URCs only on AT channel, ignore response code
-    // just in case
-    CHECK_PARSER(parser_.execCommand("AT+QCFG=\"cmux/urcport\",1"));
-
-    // Enable packet domain error reporting
-    // Ignore error responses, this command is known to fail sometimes
-    CHECK_PARSER(parser_.execCommand("AT+CGEREP=1,0"));
+    AtCommandSequence seq(&parser_, QUECTEL_NCP_MUXER_INIT_STEPS,
+            sizeof(QUECTEL_NCP_MUXER_INIT_STEPS) / sizeof(QUECTEL_NCP_MUXER_INIT_STEPS[0]));
+    CHECK_PARSER(seq.run());
+    seq.log();
 
     return SYSTEM_ERROR_NONE;
 }
@@ -1230,6 +1120,8 @@ int QuectelNcpClient::checkSimCard() {
 }
 
 int QuectelNcpClient::configureApn(const CellularNetworkConfig& conf) {
+    // Quectel modems have no MNO profiles, the network settings are selected based on the SIM card instead
+    const NcpPhaseTimer::Scope phase(&phaseTimer_, NcpPhase::SELECT_NETWORK_PROF);
     // IMPORTANT: Set modem full functionality!
     // Otherwise we won't be able to query ICCID/IMSI
     CHECK_PARSER_OK(parser_.execCommand("AT+CFUN=1,0"));
@@ -1256,10 +1148,7 @@ int QuectelNcpClient::configureApn(const CellularNetworkConfig& conf) {
     // XXX: we've seen CGDCONT fail on cold boot, retrying here a few times
     for (int i = 0; i < CGDCONT_ATTEMPTS; i++) {
         // FIXME: for now IPv4 context only
-        auto resp = parser_.sendCommand("AT+CGDCONT=%d,\"%s\",\"%s\"",
-                QUECTEL_DEFAULT_CID, QUECTEL_DEFAULT_PDP_TYPE,
-                netConf_.hasApn() ? netConf_.apn() : "");
-        const int r = CHECK_PARSER(resp.readResult());
+        const int r = CHECK(common_.configurePdpContext(netConf_.hasApn() ? netConf_.apn() : nullptr, false));
         if (r == AtResponse::OK) {
             return SYSTEM_ERROR_NONE;
         }
@@ -1269,6 +1158,7 @@ int QuectelNcpClient::configureApn(const CellularNetworkConfig& conf) {
 }
 
 int QuectelNcpClient::registerNet() {
+    const NcpPhaseTimer::Scope phase(&phaseTimer_, NcpPhase::REGISTER_NET);
     int r = 0;
     // Set modem full functionality
     r = CHECK_PARSER(parser_.execCommand("AT+CFUN=1,0"));
@@ -1332,7 +1222,7 @@ int QuectelNcpClient::registerNet() {
     CHECK_PARSER_OK(parser_.execCommand("AT+CEREG?"));
 
     regStartTime_ = millis();
-    regCheckTime_ = regStartTime_;
+    regCheck_.reset(regStartTime_);
 
     return SYSTEM_ERROR_NONE;
 }
@@ -1379,9 +1269,13 @@ int QuectelNcpClient::enterDataMode() {
     CHECK_TRUE(connectionState() == NcpConnectionState::CONNECTED, SYSTEM_ERROR_INVALID_STATE);
     const NcpClientLock lock(this);
     bool ok = false;
+    phaseTimer_.begin(NcpPhase::ENTER_DATA_MODE);
     SCOPE_GUARD({
         muxerDataStream_->enabled(false);
-        if (!ok) {
+        phaseTimer_.end(NcpPhase::ENTER_DATA_MODE);
+        if (ok) {
+            phaseTimer_.log();
+        } else {
             LOG(ERROR, "Failed to enter data mode");
             muxer_.setChannelDataHandler(QUECTEL_NCP_PPP_CHANNEL, nullptr, nullptr);
             // Go into an error state
@@ -1481,20 +1375,12 @@ int QuectelNcpClient::enterDataMode() {
     }
 
     if (!ok) {
-        auto resp = dataParser_.sendCommand(3 * 60 * 1000, "ATD*99***1#");
-        if (resp.hasNextLine()) {
-            memset(buf, 0, sizeof(buf));
-            CHECK(resp.readLine(buf, sizeof(buf)));
-            if (strncmp(buf, connectResponse, sizeof(connectResponse) - 1)) {
-                return SYSTEM_ERROR_UNKNOWN;
-            }
-        } else {
-            // We've got a final response code
-            CHECK(resp.readResult());
-            // This is not a critical failure
+        const int r = common_.dial(&dataParser_);
+        if (r == SYSTEM_ERROR_NOT_ALLOWED) {
+            // We've got a final response code. This is not a critical failure
             ok = true;
-            return SYSTEM_ERROR_NOT_ALLOWED;
         }
+        CHECK(r);
     }
 
     int r = muxer_.setChannelDataHandler(QUECTEL_NCP_PPP_CHANNEL, [](const uint8_t* data, size_t size, void* ctx) -> int {
@@ -1611,13 +1497,28 @@ void QuectelNcpClient::resetRegistrationState() {
     psd_.reset();
     eps_.reset();
     regStartTime_ = millis();
-    regCheckTime_ = regStartTime_;
+    regCheck_.reset(regStartTime_);
     registrationInterventions_ = 0;
 }
 
+void QuectelNcpClient::registrationUpdated(const CellularRegUpdate& update) {
+    if (update.urc) {
+        regCheck_.urcReceived(update.changed, millis());
+    }
+    // Check IMSI only if registered from a non-registered state, to avoid checking IMSI
+    // every time there is a cell tower change in which case also we could see a +CxREG: {1 or 5} URC
+    // TODO: Do this only for Twilio
+    if (update.registered) {   // just registered. Check which IMSI worked.
+        checkImsi_ = true;
+    }
+}
+
 void QuectelNcpClient::checkRegistrationState() {
     if (connState_ != NcpConnectionState::DISCONNECTED) {
         if ((csd_.registered() && psd_.registered()) || eps_.registered()) {
+            if (connState_ != NcpConnectionState::CONNECTED) {
+                regCheck_.log();
+            }
             connectionState(NcpConnectionState::CONNECTED);
         } else if (connState_ == NcpConnectionState::CONNECTED) {
             // FIXME: potentially go back into connecting state only when getting into
@@ -1725,22 +1626,12 @@ int QuectelNcpClient::processEventsImpl() {
     checkRegistrationState();
     interveneRegistration();
     checkRunningImsi();
-    if (connState_ != NcpConnectionState::CONNECTING || millis() - regCheckTime_ < REGISTRATION_CHECK_INTERVAL) {
+    if (connState_ != NcpConnectionState::CONNECTING) {
         return SYSTEM_ERROR_NONE;
     }
-    SCOPE_GUARD({ regCheckTime_ = millis(); });
-
-    // Check GPRS, LET, NB-IOT network registration status
-    CHECK_PARSER(parser_.execCommand("AT+CEER"));
-    CHECK_PARSER_OK(parser_.execCommand("AT+CREG?"));
-    CHECK_PARSER_OK(parser_.execCommand("AT+CGREG?"));
-    CHECK_PARSER_OK(parser_.execCommand("AT+CEREG?"));
-    // Check the signal seen by the module while trying to register
-    // Do not need to check for an OK, as this is just for debugging purpose
-    CHECK_PARSER(parser_.execCommand("AT+QCSQ"));
-
-    if (connState_ == NcpConnectionState::CONNECTING && millis() - regStartTime_ >= registrationTimeout_) {
+    if (millis() - regStartTime_ >= registrationTimeout_) {
         LOG(WARN, "Resetting the modem due to the network registration timeout");
+        regCheck_.log();
         // We are going into an OFF state immediately before stopping the muxer
         // otherwise the muxer channel state callback will disable us unnecessarily.
         ncpState(NcpState::OFF);
@@ -1751,7 +1642,25 @@ int QuectelNcpClient::processEventsImpl() {
         }
         return SYSTEM_ERROR_TIMEOUT;
     }
+    // The registration state is tracked via URCs. Poll the modem only if it's been quiet for a while
+    if (!regCheck_.checkDue(millis())) {
+        return SYSTEM_ERROR_NONE;
+    }
+    const auto prevCsd = csd_.status();
+    const auto prevPsd = psd_.status();
+    const auto prevEps = eps_.status();
+    SCOPE_GUARD({
+        regCheck_.checked(csd_.status() != prevCsd || psd_.status() != prevPsd || eps_.status() != prevEps, millis());
+    });
 
+    // Check GPRS, LET, NB-IOT network registration status
+    CHECK_PARSER(parser_.execCommand("AT+CEER"));
+    CHECK_PARSER_OK(parser_.execCommand("AT+CREG?"));
+    CHECK_PARSER_OK(parser_.execCommand("AT+CGREG?"));
+    CHECK_PARSER_OK(parser_.execCommand("AT+CEREG?"));
+    // Check the signal seen by the module while trying to register
+    // Do not need to check for an OK, as this is just for debugging purpose
+    CHECK_PARSER(parser_.execCommand("AT+QCSQ"));
     return SYSTEM_ERROR_NONE;
 }
 
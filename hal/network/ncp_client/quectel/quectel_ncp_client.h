@@ -20,6 +20,9 @@
 #include <cstdlib>
 
 #include "network/ncp/cellular/cellular_ncp_client.h"
+#include "network/ncp/cellular/cellular_ncp_common.h"
+#include "network/ncp/cellular/ncp_phase_timer.h"
+#include "network/ncp/cellular/registration_check_scheduler.h"
 #include "platform_ncp.h"
 
 #include "at_parser.h"
@@ -95,6 +98,8 @@ private:
     std::unique_ptr<particle::MuxerChannelStream<decltype(muxer_)> > muxerDataStream_;
     CellularNetworkConfig netConf_;
     CellularGlobalIdentity cgi_ = {};
+    NcpPhaseTimer phaseTimer_;
+    CellularNcpCommon common_;
     CellularAccessTechnology act_ = CellularAccessTechnology::NONE;
 
     enum class ModemState {
@@ -109,7 +114,7 @@ private:
     CellularRegistrationStatus eps_;
 
     system_tick_t regStartTime_;
-    system_tick_t regCheckTime_;
+    RegistrationCheckScheduler regCheck_;
     unsigned registrationTimeout_;
     unsigned registrationInterventions_;
     volatile bool inFlowControl_ = false;
@@ -137,6 +142,7 @@ private:
     void parserError(int error);
     void resetRegistrationState();
     void checkRegistrationState();
+    void registrationUpdated(const CellularRegUpdate& update);
     int interveneRegistration();
     int checkRunningImsi();
     int processEventsImpl();
@@ -25,6 +25,8 @@ LOG_SOURCE_CATEGORY("ncp.client");
 #include "at_command.h"
 #include "at_response.h"
 #include "network/ncp/cellular/network_config_db.h"
+#include "network/ncp/cellular/cellular_ncp_common.h"
+#include "network/ncp/cellular/at_command_sequence.h"
 
 #include "serial_stream.h"
 #include "check.h"
@@ -105,6 +107,7 @@ const auto UBLOX_NCP_KEEPALIVE_MAX_MISSED = 5;
 // FIXME: for now using a very large buffer
 const auto UBLOX_NCP_AT_CHANNEL_RX_BUFFER_SIZE = 4096;
 const auto UBLOX_NCP_PPP_CHANNEL_RX_BUFFER_SIZE = 256;
+const auto UBLOX_NCP_AT_PARSER_INPUT_BUFFER_SIZE = 256;
 
 const auto UBLOX_NCP_AT_CHANNEL = 1;
 const auto UBLOX_NCP_PPP_CHANNEL = 2;
@@ -112,6 +115,7 @@ const auto UBLOX_NCP_PPP_CHANNEL = 2;
 const auto UBLOX_NCP_SIM_SELECT_PIN = 23;
 
 const unsigned REGISTRATION_CHECK_INTERVAL = 15 * 1000;
+const unsigned REGISTRATION_CHECK_MAX_INTERVAL = 60 * 1000;
 const unsigned REGISTRATION_INTERVENTION_TIMEOUT = 15 * 1000;
 const unsigned REGISTRATION_TIMEOUT = 10 * 60 * 1000;
 const unsigned REGISTRATION_TWILIO_HOLDOFF_TIMEOUT = 5 * 60 * 1000;
@@ -135,13 +139,50 @@ const int UBLOX_NCP_R4_NO_HW_FLOW_CONTROL_MTU = 990;
 
 const int UBLOX_DEFAULT_CID = 1;
 const char UBLOX_DEFAULT_PDP_TYPE[] = "IP";
+const unsigned UBLOX_DIAL_TIMEOUT = 3 * 60 * 1000;
+
+const CellularNcpTraits UBLOX_NCP_R4_TRAITS = {
+    .cid = UBLOX_DEFAULT_CID,
+    .pdpType = UBLOX_DEFAULT_PDP_TYPE,
+    .chapApn = true,
+    .lteIsCatM1 = true,
+    .dialTimeout = UBLOX_DIAL_TIMEOUT
+};
+
+const CellularNcpTraits UBLOX_NCP_U2_TRAITS = {
+    .cid = UBLOX_DEFAULT_CID,
+    .pdpType = UBLOX_DEFAULT_PDP_TYPE,
+    .chapApn = true,
+    .lteIsCatM1 = false,
+    .dialTimeout = UBLOX_DIAL_TIMEOUT
+};
 
 const int IMSI_MAX_RETRY_CNT = 5;
 const int CCID_MAX_RETRY_CNT = 2;
 
+// Configuration commands sent during early initialization
+const AtSequenceStep UBLOX_NCP_R4_INIT_STEPS[] = {
+    // Reformat the operator string to be numeric (allows the capture of `mcc` and `mnc`)
+    { "AT+COPS=3,2", nullptr, nullptr, AtSequenceStep::OPTIONAL | AtSequenceStep::BATCH, 0 },
+    // Enable packet domain error reporting
+    { "AT+CGEREP=1,0", nullptr, nullptr, AtSequenceStep::BATCH, 0 }
+};
+
+const AtSequenceStep UBLOX_NCP_U2_INIT_STEPS[] = {
+    { "AT+COPS=3,2", nullptr, nullptr, AtSequenceStep::OPTIONAL | AtSequenceStep::BATCH, 0 },
+    { "AT+CGEREP=1,0", nullptr, nullptr, AtSequenceStep::BATCH, 0 },
+    // Force Power Saving mode to be disabled
+    //
+    // TODO: if we enable this feature in the future add logic to CHECK_PARSER macro(s)
+    // to wait longer for device to become active (see MDMParser::_atOk)
+    { "AT+UPSV=0", nullptr, nullptr, AtSequenceStep::BATCH, 0 }
+};
+
 } // anonymous
 
-SaraNcpClient::SaraNcpClient() {
+SaraNcpClient::SaraNcpClient() :
+        common_(&parser_, &cgi_, &parserError_),
+        regCheck_(REGISTRATION_CHECK_INTERVAL, REGISTRATION_CHECK_MAX_INTERVAL) {
 }
 
 SaraNcpClient::~SaraNcpClient() {
@@ -151,6 +192,7 @@ SaraNcpClient::~SaraNcpClient() {
 int SaraNcpClient::init(const NcpClientConfig& conf) {
     modemInit();
     conf_ = static_cast<const CellularNcpClientConfig&>(conf);
+    common_.traits((ncpId() == PLATFORM_NCP_SARA_R410) ? &UBLOX_NCP_R4_TRAITS : &UBLOX_NCP_U2_TRAITS);
     // Initialize serial stream
     std::unique_ptr<SerialStream> serial(new (std::nothrow) SerialStream(HAL_USART_SERIAL2,
             UBLOX_NCP_DEFAULT_SERIAL_BAUDRATE, SERIAL_8N1 | SERIAL_FLOW_CONTROL_RTS_CTS));
@@ -170,7 +212,6 @@ int SaraNcpClient::init(const NcpClientConfig& conf) {
     prevNcpState_ = NcpState::OFF;
     connState_ = NcpConnectionState::DISCONNECTED;
     regStartTime_ = 0;
-    regCheckTime_ = 0;
     imsiCheckTime_ = 0;
     powerOnTime_ = 0;
     registeredTime_ = 0;
@@ -198,7 +239,8 @@ int SaraNcpClient::initParser(Stream* stream) {
     // Initialize AT parser
     auto parserConf = AtParserConfig()
             .stream(stream)
-            .commandTerminator(AtCommandTerminator::CRLF);
+            .commandTerminator(AtCommandTerminator::CRLF)
+            .inputBufferSize(UBLOX_NCP_AT_PARSER_INPUT_BUFFER_SIZE);
     parser_.destroy();
     CHECK(parser_.init(std::move(parserConf)));
 
@@ -208,122 +250,32 @@ int SaraNcpClient::initParser(Stream* stream) {
     // +CREG: <stat>[,<lac>,<ci>[,<AcTStatus>]]
     CHECK(parser_.addUrcHandler("+CREG", [](AtResponseReader* reader, const char* prefix, void* data) -> int {
         const auto self = (SaraNcpClient*)data;
-        unsigned int val[4] = {};
         char atResponse[64] = {};
-        // Take a copy of AT response for multi-pass scanning
         CHECK_PARSER_URC(reader->readLine(atResponse, sizeof(atResponse)));
-        // Parse response ignoring mode (replicate URC response)
-        int r = ::sscanf(atResponse, "+CREG: %*u,%u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]);
-        // Reparse URC as direct response
-        if (0 >= r) {
-            r = CHECK_PARSER_URC(
-                ::sscanf(atResponse, "+CREG: %u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]));
-        }
-        CHECK_TRUE(r >= 1, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
-
-        bool prevRegStatus = self->csd_.registered();
-        self->csd_.status(self->csd_.decodeAtStatus(val[0]));
-        // Check IMSI only if registered from a non-registered state, to avoid checking IMSI
-        // every time there is a cell tower change in which case also we could see a CREG: {1 or 5} URC
-        // TODO: Do this only for Twilio
-        if (!prevRegStatus && self->csd_.registered()) {   // just registered. Check which IMSI worked.
-            self->imsiCheckTime_ = 0;
-        }
-        // self->checkRegistrationState();
-        // Cellular Global Identity (partial)
-        // Only update if unset
-        if (r >= 3) {
-            if (self->cgi_.location_area_code == std::numeric_limits<LacType>::max() &&
-                    self->cgi_.cell_id == std::numeric_limits<CidType>::max()) {
-                self->cgi_.location_area_code = static_cast<LacType>(val[1]);
-                self->cgi_.cell_id = static_cast<CidType>(val[2]);
-            }
-        }
+        CellularRegUpdate update = {};
+        CHECK(self->common_.processRegLine(CellularRegType::CREG, atResponse, self->act_, &self->csd_, &update));
+        self->registrationUpdated(update);
         return SYSTEM_ERROR_NONE;
     }, this));
     // n={0,1} +CGREG: <stat>
     // n=2     +CGREG: <stat>[,<lac>,<ci>[,<AcT>,<rac>]]
     CHECK(parser_.addUrcHandler("+CGREG", [](AtResponseReader* reader, const char* prefix, void* data) -> int {
         const auto self = (SaraNcpClient*)data;
-        unsigned int val[4] = {};
         char atResponse[64] = {};
-        // Take a copy of AT response for multi-pass scanning
         CHECK_PARSER_URC(reader->readLine(atResponse, sizeof(atResponse)));
-        // Parse response ignoring mode (replicate URC response)
-        int r = ::sscanf(atResponse, "+CGREG: %*u,%u,\"%x\",\"%x\",%u,\"%*x\"", &val[0], &val[1], &val[2], &val[3]);
-        // Reparse URC as direct response
-        if (0 >= r) {
-            r = CHECK_PARSER_URC(
-                ::sscanf(atResponse, "+CGREG: %u,\"%x\",\"%x\",%u,\"%*x\"", &val[0], &val[1], &val[2], &val[3]));
-        }
-        CHECK_TRUE(r >= 1, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
-
-        bool prevRegStatus = self->psd_.registered();
-        self->psd_.status(self->psd_.decodeAtStatus(val[0]));
-        // Check IMSI only if registered from a non-registered state, to avoid checking IMSI
-        // every time there is a cell tower change in which case also we could see a CGREG: {1 or 5} URC
-        // TODO: Do this only for Twilio
-        if (!prevRegStatus && self->psd_.registered()) {   // just registered. Check which IMSI worked.
-            self->imsiCheckTime_ = 0;
-        }
-        // self->checkRegistrationState();
-        // Cellular Global Identity (partial)
-        if (r >= 3) {
-            auto rat = r >= 4 ? static_cast<CellularAccessTechnology>(val[3]) : self->act_;
-            switch (rat) {
-                case CellularAccessTechnology::GSM:
-                case CellularAccessTechnology::GSM_COMPACT:
-                case CellularAccessTechnology::UTRAN:
-                case CellularAccessTechnology::GSM_EDGE:
-                case CellularAccessTechnology::UTRAN_HSDPA:
-                case CellularAccessTechnology::UTRAN_HSUPA:
-                case CellularAccessTechnology::UTRAN_HSDPA_HSUPA: {
-                    self->cgi_.location_area_code = static_cast<LacType>(val[1]);
-                    self->cgi_.cell_id = static_cast<CidType>(val[2]);
-                    break;
-                }
-            }
-        }
+        CellularRegUpdate update = {};
+        CHECK(self->common_.processRegLine(CellularRegType::CGREG, atResponse, self->act_, &self->psd_, &update));
+        self->registrationUpdated(update);
         return SYSTEM_ERROR_NONE;
     }, this));
     // +CEREG: <stat>[,[<tac>],[<ci>],[<AcT>][,<cause_type>,<reject_cause>[,[<Active_Time>],[<Periodic_TAU>]]]]
     CHECK(parser_.addUrcHandler("+CEREG", [](AtResponseReader* reader, const char* prefix, void* data) -> int {
         const auto self = (SaraNcpClient*)data;
-        unsigned int val[4] = {};
         char atResponse[64] = {};
-        // Take a copy of AT response for multi-pass scanning
         CHECK_PARSER_URC(reader->readLine(atResponse, sizeof(atResponse)));
-        // Parse response ignoring mode (replicate URC response)
-        int r = ::sscanf(atResponse, "+CEREG: %*u,%u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]);
-        // Reparse URC as direct response
-        if (0 >= r) {
-            r = CHECK_PARSER_URC(
-                ::sscanf(atResponse, "+CEREG: %u,\"%x\",\"%x\",%u", &val[0], &val[1], &val[2], &val[3]));
-        }
-        CHECK_TRUE(r >= 1, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
-
-        bool prevRegStatus = self->eps_.registered();
-        self->eps_.status(self->eps_.decodeAtStatus(val[0]));
-        // Check IMSI only if registered from a non-registered state, to avoid checking IMSI
-        // every time there is a cell tower change in which case also we could see a CEREG: {1 or 5} URC
-        // TODO: Do this only for Twilio
-        if (!prevRegStatus && self->eps_.registered()) {   // just registered. Check which IMSI worked.
-            self->imsiCheckTime_ = 0;
-        }
-        // self->checkRegistrationState();
-        // Cellular Global Identity (partial)
-        if (r >= 3) {
-            auto rat = r >= 4 ? static_cast<CellularAccessTechnology>(val[3]) : self->act_;
-            switch (rat) {
-                case CellularAccessTechnology::LTE:
-                case CellularAccessTechnology::LTE_CAT_M1:
-                case CellularAccessTechnology::LTE_NB_IOT: {
-                    self->cgi_.location_area_code = static_cast<LacType>(val[1]);
-                    self->cgi_.cell_id = static_cast<CidType>(val[2]);
-                    break;
-                }
-            }
-        }
+        CellularRegUpdate update = {};
+        CHECK(self->common_.processRegLine(CellularRegType::CEREG, atResponse, self->act_, &self->eps_, &update));
+        self->registrationUpdated(update);
         return SYSTEM_ERROR_NONE;
     }, this));
     return SYSTEM_ERROR_NONE;
@@ -603,64 +555,7 @@ int SaraNcpClient::getTxDelayInDataChannel() {
 }
 
 int SaraNcpClient::queryAndParseAtCops(CellularSignalQuality* qual) {
-    int act;
-    char mobileCountryCode[4] = {0};
-    char mobileNetworkCode[4] = {0};
-
-    // Reformat the operator string to be numeric
-    // (allows the capture of `mcc` and `mnc`)
-    int r = CHECK_PARSER(parser_.execCommand("AT+COPS=3,2"));
-    CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
-
-    auto resp = parser_.sendCommand("AT+COPS?");
-    r = CHECK_PARSER(resp.scanf("+COPS: %*d,%*d,\"%3[0-9]%3[0-9]\",%d", mobileCountryCode,
-                                    mobileNetworkCode, &act));
-    CHECK_TRUE(r == 3, SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
-    r = CHECK_PARSER(resp.readResult());
-    CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
-
-    // Preserve digit format data
-    const int mnc_digits = ::strnlen(mobileNetworkCode, sizeof(mobileNetworkCode));
-    CHECK_TRUE((2 == mnc_digits || 3 == mnc_digits), SYSTEM_ERROR_BAD_DATA);
-    if (2 == mnc_digits) {
-        cgi_.cgi_flags |= CGI_FLAG_TWO_DIGIT_MNC;
-    } else {
-        cgi_.cgi_flags &= ~CGI_FLAG_TWO_DIGIT_MNC;
-    }
-
-    // `atoi` returns zero on error, which is an invalid `mcc` and `mnc`
-    cgi_.mobile_country_code = static_cast<uint16_t>(::atoi(mobileCountryCode));
-    cgi_.mobile_network_code = static_cast<uint16_t>(::atoi(mobileNetworkCode));
-
-    if (ncpId() == PLATFORM_NCP_SARA_R410) {
-        if (act == particle::to_underlying(CellularAccessTechnology::LTE)) {
-            act = particle::to_underlying(CellularAccessTechnology::LTE_CAT_M1);
-        }
-    }
-
-    switch (static_cast<CellularAccessTechnology>(act)) {
-        case CellularAccessTechnology::NONE:
-        case CellularAccessTechnology::GSM:
-        case CellularAccessTechnology::GSM_COMPACT:
-        case CellularAccessTechnology::UTRAN:
-        case CellularAccessTechnology::GSM_EDGE:
-        case CellularAccessTechnology::UTRAN_HSDPA:
-        case CellularAccessTechnology::UTRAN_HSUPA:
-        case CellularAccessTechnology::UTRAN_HSDPA_HSUPA:
-        case CellularAccessTechnology::LTE:
-        case CellularAccessTechnology::LTE_CAT_M1:
-        case CellularAccessTechnology::LTE_NB_IOT: {
-            break;
-        }
-        default: {
-            return SYSTEM_ERROR_BAD_DATA;
-        }
-    }
-    if (qual) {
-        qual->accessTechnology(static_cast<CellularAccessTechnology>(act));
-    }
-
-    return SYSTEM_ERROR_NONE;
+    return common_.queryOperator(qual);
 }
 
 int SaraNcpClient::getCellularGlobalIdentity(CellularGlobalIdentity* cgi) {
@@ -986,6 +881,7 @@ int SaraNcpClient::checkNetConfForImsi() {
 }
 
 int SaraNcpClient::selectNetworkProf(ModemState& state) {
+    const NcpPhaseTimer::Scope phase(&phaseTimer_, NcpPhase::SELECT_NETWORK_PROF);
     int resetCount = 0;
     bool disableLowPowerModes = false;
     // Note: Not failing on AT error on ICCID/IMSI lookup since SIMs have shown strange edge cases
@@ -1315,6 +1211,7 @@ int SaraNcpClient::getAppFirmwareVersion() {
 }
 
 int SaraNcpClient::initReady(ModemState state) {
+    const NcpPhaseTimer::Scope phase(&phaseTimer_, NcpPhase::INIT_READY);
     fwVersion_ = getAppFirmwareVersion();
     // L0.0.00.00.05.06,A.02.00 has a memory issue
     memoryIssuePresent_ = (fwVersion_ == UBLOX_NCP_R4_APP_FW_VERSION_MEMORY_LEAK_ISSUE);
@@ -1355,46 +1252,39 @@ int SaraNcpClient::initReady(ModemState state) {
         CHECK(selectNetworkProf(state));
     }
 
-    // Reformat the operator string to be numeric
-    // (allows the capture of `mcc` and `mnc`)
-    int r = CHECK_PARSER(parser_.execCommand("AT+COPS=3,2"));
-
-    // Enable packet domain error reporting
-    CHECK_PARSER_OK(parser_.execCommand("AT+CGEREP=1,0"));
+    const bool isR4 = (ncpId() == PLATFORM_NCP_SARA_R410);
+    AtCommandSequence seq(&parser_, isR4 ? UBLOX_NCP_R4_INIT_STEPS : UBLOX_NCP_U2_INIT_STEPS,
+            isR4 ? sizeof(UBLOX_NCP_R4_INIT_STEPS) / sizeof(UBLOX_NCP_R4_INIT_STEPS[0]) :
+            sizeof(UBLOX_NCP_U2_INIT_STEPS) / sizeof(UBLOX_NCP_U2_INIT_STEPS[0]));
+    CHECK_PARSER_OK(seq.run());
+    seq.log();
 
-    if (ncpId() == PLATFORM_NCP_SARA_R410) {
+    if (isR4) {
         // Force Cat M1-only mode
         // We may encounter a CME ERROR response with u-blox firmware 05.08,A.02.04 and in that case Cat-M1 mode is
         // already enforced properly based on the UMNOPROF setting.
+        // NOTE: The current settings are always read back since they may have been changed by the
+        // application via Cellular.command(); only the writes are skipped when nothing needs to change
         auto resp = parser_.sendCommand("AT+URAT?");
         unsigned selectAct = 0, preferAct1 = 0, preferAct2 = 0;
         auto r = resp.scanf("+URAT: %u,%u,%u", &selectAct, &preferAct1, &preferAct2);
         resp.readResult();
-        if (r > 0) {
-            if (selectAct != 7 || (r >= 2 && preferAct1 != 7) || (r >= 3 && preferAct2 != 7)) { // 7: LTE Cat M1
-                // Disconnect before making changes to URAT
-                r = CHECK_PARSER(parser_.execCommand("AT+COPS=2,2"));
-                if (r == AtResponse::OK) {
-                    // This is a persistent setting
-                    CHECK_PARSER_OK(parser_.execCommand("AT+URAT=7"));
-                }
+        if (r > 0 && (selectAct != 7 || (r >= 2 && preferAct1 != 7) || (r >= 3 && preferAct2 != 7))) { // 7: LTE Cat M1
+            // Disconnect before making changes to URAT
+            r = CHECK_PARSER(parser_.execCommand("AT+COPS=2,2"));
+            if (r == AtResponse::OK) {
+                // This is a persistent setting
+                CHECK_PARSER_OK(parser_.execCommand("AT+URAT=7"));
             }
         }
 
         // Disable Cat-M1 low power modes
         CHECK(disablePsmEdrx());
-
-    } else {
-        // Force Power Saving mode to be disabled
-        //
-        // TODO: if we enable this feature in the future add logic to CHECK_PARSER macro(s)
-        // to wait longer for device to become active (see MDMParser::_atOk)
-        CHECK_PARSER_OK(parser_.execCommand("AT+UPSV=0"));
     }
 
     if (state != ModemState::MuxerAtChannel) {
         // Send AT+CMUX and initialize multiplexer
-        r = CHECK_PARSER(parser_.execCommand("AT+CMUX=0,0,,%u,,,,,", UBLOX_NCP_MAX_MUXER_FRAME_SIZE));
+        const int r = CHECK_PARSER(parser_.execCommand("AT+CMUX=0,0,,%u,,,,,", UBLOX_NCP_MAX_MUXER_FRAME_SIZE));
         CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
 
         // Initialize muxer
@@ -1633,11 +1523,8 @@ int SaraNcpClient::configureApn(const CellularNetworkConfig& conf) {
         }
     }
 
-    auto resp = parser_.sendCommand("AT+CGDCONT=%d,\"%s\",\"%s%s\"",
-            UBLOX_DEFAULT_CID, UBLOX_DEFAULT_PDP_TYPE,
-            (netConf_.hasUser() && netConf_.hasPassword()) ? "CHAP:" : "",
-            netConf_.hasApn() ? netConf_.apn() : "");
-    const int r = CHECK_PARSER(resp.readResult());
+    const int r = CHECK(common_.configurePdpContext(netConf_.hasApn() ? netConf_.apn() : nullptr,
+            netConf_.hasUser() && netConf_.hasPassword()));
     CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
     return SYSTEM_ERROR_NONE;
 }
@@ -1648,6 +1535,7 @@ int SaraNcpClient::setRegistrationTimeout(unsigned timeout) {
 }
 
 int SaraNcpClient::registerNet() {
+    const NcpPhaseTimer::Scope phase(&phaseTimer_, NcpPhase::REGISTER_NET);
     int r = 0;
 
     // Set modem full functionality
@@ -1696,7 +1584,7 @@ int SaraNcpClient::registerNet() {
     }
 
     regStartTime_ = millis();
-    regCheckTime_ = regStartTime_;
+    regCheck_.reset(regStartTime_);
     imsiCheckTime_ = (imsiCheckTime_ == 0) ? 0 : regStartTime_;     // if it is 0, it means the radio registered in the last query
 
     return SYSTEM_ERROR_NONE;
@@ -1744,9 +1632,13 @@ int SaraNcpClient::enterDataMode() {
     CHECK_TRUE(connectionState() == NcpConnectionState::CONNECTED, SYSTEM_ERROR_INVALID_STATE);
     const NcpClientLock lock(this);
     bool ok = false;
+    phaseTimer_.begin(NcpPhase::ENTER_DATA_MODE);
     SCOPE_GUARD({
         muxerDataStream_->enabled(false);
-        if (!ok) {
+        phaseTimer_.end(NcpPhase::ENTER_DATA_MODE);
+        if (ok) {
+            phaseTimer_.log();
+        } else {
             LOG(ERROR, "Failed to enter data mode");
             muxer_.setChannelDataHandler(UBLOX_NCP_PPP_CHANNEL, nullptr, nullptr);
             // Go into an error state
@@ -1794,24 +1686,14 @@ int SaraNcpClient::enterDataMode() {
         CHECK(dataParser_.execCommand(20000, "ATH"));
     }
 
-    auto resp = dataParser_.sendCommand(3 * 60 * 1000, "ATD*99***1#");
-    if (resp.hasNextLine()) {
-        char buf[64] = {};
-        CHECK(resp.readLine(buf, sizeof(buf)));
-        const char connectResponse[] = "CONNECT";
-        if (strncmp(buf, connectResponse, sizeof(connectResponse) - 1)) {
-            return SYSTEM_ERROR_UNKNOWN;
-        }
-    } else {
-        // We've got a final response code
-        CHECK(resp.readResult());
-        // This is not a critical failure
+    int r = common_.dial(&dataParser_);
+    if (r == SYSTEM_ERROR_NOT_ALLOWED) {
+        // We've got a final response code. This is not a critical failure
         ok = true;
-        return SYSTEM_ERROR_NOT_ALLOWED;
     }
+    CHECK(r);
 
-
-    int r = muxer_.setChannelDataHandler(UBLOX_NCP_PPP_CHANNEL, [](const uint8_t* data, size_t size, void* ctx) -> int {
+    r = muxer_.setChannelDataHandler(UBLOX_NCP_PPP_CHANNEL, [](const uint8_t* data, size_t size, void* ctx) -> int {
         auto self = (SaraNcpClient*)ctx;
         const auto handler = self->conf_.dataHandler();
         if (handler) {
@@ -1933,16 +1815,31 @@ void SaraNcpClient::resetRegistrationState() {
     psd_.reset();
     eps_.reset();
     regStartTime_ = millis();
-    regCheckTime_ = regStartTime_;
+    regCheck_.reset(regStartTime_);
     imsiCheckTime_ = regStartTime_;
     registrationInterventions_ = 0;
 }
 
+void SaraNcpClient::registrationUpdated(const CellularRegUpdate& update) {
+    if (update.urc) {
+        regCheck_.urcReceived(update.changed, millis());
+    }
+    // Check IMSI only if registered from a non-registered state, to avoid checking IMSI
+    // every time there is a cell tower change in which case also we could see a +CxREG: {1 or 5} URC
+    // TODO: Do this only for Twilio
+    if (update.registered) {   // just registered. Check which IMSI worked.
+        imsiCheckTime_ = 0;
+    }
+}
+
 void SaraNcpClient::checkRegistrationState() {
     if (connState_ != NcpConnectionState::DISCONNECTED) {
         if ((csd_.registered() && psd_.registered()) || eps_.registered()) {
-            if (memoryIssuePresent_ && connState_ != NcpConnectionState::CONNECTED) {
-                registeredTime_ = millis(); // start registered timer for memory issue power off delays
+            if (connState_ != NcpConnectionState::CONNECTED) {
+                if (memoryIssuePresent_) {
+                    registeredTime_ = millis(); // start registered timer for memory issue power off delays
+                }
+                regCheck_.log();
             }
             connectionState(NcpConnectionState::CONNECTED);
         } else if (connState_ == NcpConnectionState::CONNECTED) {
@@ -2037,12 +1934,31 @@ int SaraNcpClient::processEventsImpl() {
     checkRegistrationState();
     interveneRegistration();
     checkRunningImsi();
-    if (connState_ != NcpConnectionState::CONNECTING ||
-            millis() - regCheckTime_ < REGISTRATION_CHECK_INTERVAL) {
+    if (connState_ != NcpConnectionState::CONNECTING) {
+        return SYSTEM_ERROR_NONE;
+    }
+    if (millis() - regStartTime_ >= registrationTimeout_) {
+        LOG(WARN, "Resetting the modem due to the network registration timeout");
+        regCheck_.log();
+        // We are going into an OFF state immediately before stopping the muxer
+        // otherwise the muxer channel state callback will disable us unnecessarily.
+        ncpState(NcpState::OFF);
+        muxer_.stop();
+        int rv = modemPowerOff();
+        if (rv != 0) {
+            modemHardReset(true);
+        }
+        return SYSTEM_ERROR_TIMEOUT;
+    }
+    // The registration state is tracked via URCs. Poll the modem only if it's been quiet for a while
+    if (!regCheck_.checkDue(millis())) {
         return SYSTEM_ERROR_NONE;
     }
+    const auto prevCsd = csd_.status();
+    const auto prevPsd = psd_.status();
+    const auto prevEps = eps_.status();
     SCOPE_GUARD({
-        regCheckTime_ = millis();
+        regCheck_.checked(csd_.status() != prevCsd || psd_.status() != prevPsd || eps_.status() != prevEps, millis());
     });
 
     if (conf_.ncpIdentifier() != PLATFORM_NCP_SARA_R410) {
@@ -2060,20 +1976,6 @@ int SaraNcpClient::processEventsImpl() {
         CHECK_PARSER(parser_.execCommand("AT+UCGED=5"));
         CHECK_PARSER(parser_.execCommand("AT+UCGED?"));
     }
-
-    if (connState_ == NcpConnectionState::CONNECTING &&
-            millis() - regStartTime_ >= registrationTimeout_) {
-        LOG(WARN, "Resetting the modem due to the network registration timeout");
-        // We are going into an OFF state immediately before stopping the muxer
-        // otherwise the muxer channel state callback will disable us unnecessarily.
-        ncpState(NcpState::OFF);
-        muxer_.stop();
-        int rv = modemPowerOff();
-        if (rv != 0) {
-            modemHardReset(true);
-        }
-        return SYSTEM_ERROR_TIMEOUT;
-    }
     return SYSTEM_ERROR_NONE;
 }
 
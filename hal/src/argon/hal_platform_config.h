@@ -8,6 +8,7 @@
 #define HAL_PLATFORM_NCP_UPDATABLE (1)
 #define HAL_PLATFORM_WIFI (1)
 #define HAL_PLATFORM_WIFI_SERIAL (HAL_USART_SERIAL2)
+#define HAL_PLATFORM_WIFI_NCP_HIGH_THROUGHPUT (1)
 #define HAL_PLATFORM_SPI_NUM (2)
 #define HAL_PLATFORM_I2C_NUM (2)
 #define HAL_PLATFORM_USART_NUM (2)
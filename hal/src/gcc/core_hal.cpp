@@ -36,10 +36,10 @@
 #include "device_config.h"
 #include "hal_platform.h"
 #include "interrupts_hal.h"
-#include <boost/crc.hpp>  // for boost::crc_32_type
 #include <sstream>
 #include <iomanip>
 #include "system_error.h"
+#include "crc32_util.h"
 
 #include "eeprom_file.h"
 #include "eeprom_hal.h"
@@ -324,10 +324,7 @@ crc32(uint32_t crc, const uint8_t* buf, size_t size)
  */
 uint32_t HAL_Core_Compute_CRC32(const uint8_t *pBuffer, uint32_t bufferSize)
 {
-	boost::crc_32_type  result;
-	result.process_bytes(pBuffer, bufferSize);
-	return result.checksum();
-    //return crc32(0, pBuffer, bufferSize);
+	return crc32_calc(pBuffer, bufferSize, 0);
 }
 
 // todo find a technique that allows accessor functions to be inlined while still keeping
@@ -98,6 +98,11 @@ void HAL_EEPROM_Perform_Pending_Erase()
 {
 }
 
+int hal_eeprom_flush(bool force, void* reserved)
+{
+	return 0;
+}
+
 void GCC_EEPROM_Load(const char* filename)
 {
 	read_file(filename, eeprom, sizeof(eeprom));
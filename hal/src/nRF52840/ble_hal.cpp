@@ -43,6 +43,7 @@ LOG_SOURCE_CATEGORY("hal.ble");
 #include <mutex>
 
 #include "gpio_hal.h"
+#include "timer_hal.h"
 #include "device_code.h"
 #include "radio_common.h"
 #include "nrf_system_error.h"
@@ -451,6 +452,7 @@ public:
     bool valid(hal_ble_conn_handle_t connHandle);
     ssize_t getAttMtu(hal_ble_conn_handle_t connHandle);
     int setDesiredAttMtu(size_t attMtu);
+    int requestHighThroughput(hal_ble_conn_handle_t connHandle);
     int processConnectedEventFromThread(const ble_evt_t* event);
     int processDisconnectedEventFromThread(const ble_evt_t* event);
     int processConnParamsUpdatedEventFromThread(const ble_evt_t* event);
@@ -479,6 +481,7 @@ private:
         hal_ble_conn_info_t info;
         BleLinkEventHandler handler; // It is used for central link only.
         bool isMtuExchanged;
+        bool isHighThroughputRequested;
         BlePairingState pairState;
         std::unique_ptr<ble_gap_lesc_p256_pk_t> peerPublicKey;
     };
@@ -535,7 +538,11 @@ public:
             : gattsInitialized_(false),
               isHvxing_(false),
               currHvxConnHandle_(BLE_INVALID_CONN_HANDLE),
-              hvxSemaphore_(nullptr) {
+              hvxSemaphore_(nullptr),
+              isStreaming_(false),
+              streamConnHandle_(BLE_INVALID_CONN_HANDLE),
+              streamPending_(0),
+              streamSemaphore_(nullptr) {
     }
     ~GattServer() = default;
     int init();
@@ -548,6 +555,7 @@ public:
     void removeSubscriberFromAllCharacteristics(hal_ble_conn_handle_t connHandle);
     ssize_t setValue(hal_ble_attr_handle_t attrHandle, const uint8_t* buf, size_t len);
     ssize_t notifyValue(hal_ble_attr_handle_t attrHandle, const uint8_t* buf, size_t len, bool ack);
+    ssize_t streamValue(hal_ble_attr_handle_t attrHandle, const uint8_t* buf, size_t len, hal_ble_stream_stats_t* stats, BleLock& lock);
     ssize_t getValue(hal_ble_attr_handle_t attrHandle, uint8_t* buf, size_t len);
     int processDataWrittenEventFromThread(ble_evt_t* event);
 
@@ -572,16 +580,25 @@ private:
 
     bool findService(hal_ble_attr_handle_t svcHandle) const;
     BleCharacteristic* findCharacteristic(hal_ble_attr_handle_t attrHandle);
+    int indexCharacteristic(const hal_ble_char_handles_t& charHandles, size_t index);
     int addSubscriber(BleCharacteristic* characteristic, hal_ble_conn_handle_t connHandle, ble_sig_cccd_value_t value);
     void removeSubscriber(BleCharacteristic* characteristic, hal_ble_conn_handle_t connHandle);
+    ssize_t streamToSubscriber(hal_ble_conn_handle_t connHandle, hal_ble_attr_handle_t attrHandle, const uint8_t* buf, size_t len, hal_ble_stream_stats_t* stats, BleLock& lock);
+    int waitStreamSemaphore(BleLock& lock);
+    int waitStreamCompleted(BleLock& lock);
     static void processGattServerEvents(const ble_evt_t* event, void* context);
 
     bool gattsInitialized_;
     volatile bool isHvxing_;
     hal_ble_conn_handle_t currHvxConnHandle_;
     os_semaphore_t hvxSemaphore_;                   /**< Semaphore to wait until the HVX operation completed. */
+    volatile bool isStreaming_;
+    volatile hal_ble_conn_handle_t streamConnHandle_;
+    volatile size_t streamPending_;                 /**< Notifications queued in the SoftDevice but not yet transmitted. */
+    os_semaphore_t streamSemaphore_;                /**< Semaphore to wait until the SoftDevice TX queue has room. */
     Vector<hal_ble_attr_handle_t> services_;        /**< Added services. */
     Vector<BleCharacteristic> characteristics_;     /**< Added characteristic. */
+    Vector<uint8_t> charIndices_;                   /**< Index of characteristic plus one, indexed by attribute handle. */
 };
 
 class BleObject::GattClient {
@@ -2180,6 +2197,35 @@ ssize_t BleObject::ConnectionsManager::getAttMtu(hal_ble_conn_handle_t connHandl
     return connection->info.att_mtu;
 }
 
+int BleObject::ConnectionsManager::requestHighThroughput(hal_ble_conn_handle_t connHandle) {
+    auto connection = fetchConnection(connHandle);
+    CHECK_TRUE(connection, SYSTEM_ERROR_NOT_FOUND);
+    if (connection->isHighThroughputRequested) {
+        return SYSTEM_ERROR_NONE;
+    }
+    // Prefer 2M PHY, the peer may still fall back to 1M PHY if it doesn't support it.
+    ble_gap_phys_t phys = {};
+    phys.tx_phys = BLE_GAP_PHY_2MBPS | BLE_GAP_PHY_1MBPS;
+    phys.rx_phys = BLE_GAP_PHY_2MBPS | BLE_GAP_PHY_1MBPS;
+    int ret = sd_ble_gap_phy_update(connHandle, &phys);
+    if (ret != NRF_SUCCESS) {
+        LOG_DEBUG(TRACE, "sd_ble_gap_phy_update() failed: %u", (unsigned)ret);
+    }
+    // Let the SoftDevice pick the maximum data length allowed by its configuration.
+    ble_gap_data_length_params_t gapDataLenParams = {};
+    gapDataLenParams.max_tx_octets  = BLE_GAP_DATA_LENGTH_AUTO;
+    gapDataLenParams.max_rx_octets  = BLE_GAP_DATA_LENGTH_AUTO;
+    gapDataLenParams.max_tx_time_us = BLE_GAP_DATA_LENGTH_AUTO;
+    gapDataLenParams.max_rx_time_us = BLE_GAP_DATA_LENGTH_AUTO;
+    ret = sd_ble_gap_data_length_update(connHandle, &gapDataLenParams, nullptr);
+    if (ret != NRF_SUCCESS) {
+        LOG_DEBUG(TRACE, "sd_ble_gap_data_length_update() failed: %u", (unsigned)ret);
+    }
+    // Either procedure may be rejected if it has already been initiated by peer, which is fine.
+    connection->isHighThroughputRequested = true;
+    return SYSTEM_ERROR_NONE;
+}
+
 int BleObject::ConnectionsManager::configureAttMtu(hal_ble_conn_handle_t connHandle, size_t effective) {
     auto connection = fetchConnection(connHandle);
     CHECK_TRUE(connection, SYSTEM_ERROR_NOT_FOUND);
@@ -2342,6 +2388,7 @@ int BleObject::ConnectionsManager::processConnectedEventFromThread(const ble_evt
     connection.info.address = toHalAddress(connected.peer_addr);
     connection.info.att_mtu = BLE_DEFAULT_ATT_MTU_SIZE; // Use the default ATT_MTU on connected.
     connection.isMtuExchanged = false;
+    connection.isHighThroughputRequested = false;
     connection.pairState = BLE_PAIRING_STATE_NOT_INITIATED;
     int ret = addConnection(std::move(connection));
     if (ret != SYSTEM_ERROR_NONE) {
@@ -2737,6 +2784,11 @@ int BleObject::GattServer::init() {
         LOG(ERROR, "os_semaphore_create() failed");
         return SYSTEM_ERROR_INTERNAL;
     }
+    if (os_semaphore_create(&streamSemaphore_, 1, 0)) {
+        streamSemaphore_ = nullptr;
+        LOG(ERROR, "os_semaphore_create() failed");
+        return SYSTEM_ERROR_INTERNAL;
+    }
     gattsImpl.instance = this;
     NRF_SDH_BLE_OBSERVER(bleGattServer, 1, processGattServerEvents, &gattsImpl);
     gattsInitialized_ = true;
@@ -2830,6 +2882,11 @@ int BleObject::GattServer::addCharacteristic(const hal_ble_char_init_t* charInit
     characteristic.callback = charInit->callback;
     characteristic.context = charInit->context;
     CHECK_TRUE(characteristics_.append(characteristic), SYSTEM_ERROR_NO_MEMORY);
+    const int r = indexCharacteristic(characteristic.charHandles, characteristics_.size() - 1);
+    if (r != SYSTEM_ERROR_NONE) {
+        characteristics_.removeAt(characteristics_.size() - 1);
+        return r;
+    }
     *charHandles = characteristic.charHandles;
     LOG_DEBUG(TRACE, "Characteristic value handle: %d.", handles.value_handle);
     LOG_DEBUG(TRACE, "Characteristic cccd handle: %d.", handles.cccd_handle);
@@ -2922,6 +2979,136 @@ ssize_t BleObject::GattServer::notifyValue(hal_ble_attr_handle_t attrHandle, con
     return std::min(len, (size_t)BLE_MAX_ATTR_VALUE_PACKET_SIZE);
 }
 
+ssize_t BleObject::GattServer::streamValue(hal_ble_attr_handle_t attrHandle, const uint8_t* buf, size_t len, hal_ble_stream_stats_t* stats, BleLock& lock) {
+    CHECK_TRUE(attrHandle, SYSTEM_ERROR_INVALID_ARGUMENT);
+    CHECK_TRUE(buf, SYSTEM_ERROR_INVALID_ARGUMENT);
+    CHECK_TRUE(len, SYSTEM_ERROR_INVALID_ARGUMENT);
+    // The BLE lock is released while waiting for the SoftDevice, only one stream can be in progress at a time
+    CHECK_TRUE(streamConnHandle_ == BLE_INVALID_CONN_HANDLE, SYSTEM_ERROR_BUSY);
+    BleCharacteristic* characteristic = findCharacteristic(attrHandle);
+    CHECK_TRUE(characteristic, SYSTEM_ERROR_NOT_FOUND);
+    CHECK_TRUE(attrHandle == characteristic->charHandles.value_handle, SYSTEM_ERROR_NOT_FOUND);
+    CHECK_TRUE(characteristic->properties & BLE_SIG_CHAR_PROP_NOTIFY, SYSTEM_ERROR_NOT_SUPPORTED);
+    // The list of subscribers may change while the lock is released
+    hal_ble_conn_handle_t connHandles[BLE_MAX_LINK_COUNT];
+    size_t connCount = 0;
+    for (const auto& subscriber : characteristic->subscribers) {
+        if (subscriber.connHandle != BLE_INVALID_CONN_HANDLE && (subscriber.config & BLE_SIG_CCCD_VAL_NOTIFICATION) &&
+                connCount < BLE_MAX_LINK_COUNT) {
+            connHandles[connCount++] = subscriber.connHandle;
+        }
+    }
+    hal_ble_stream_stats_t streamStats = {};
+    streamStats.version = BLE_API_VERSION;
+    streamStats.size = sizeof(hal_ble_stream_stats_t);
+    const system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+    ssize_t streamed = 0;
+    int error = SYSTEM_ERROR_NONE;
+    for (size_t i = 0; i < connCount; ++i) {
+        BleObject::getInstance().connMgr()->requestHighThroughput(connHandles[i]);
+        ssize_t ret = streamToSubscriber(connHandles[i], attrHandle, buf, len, &streamStats, lock);
+        if (ret < 0) {
+            LOG(ERROR, "Failed to stream data to connection %d: %d", connHandles[i], (int)ret);
+            error = ret;
+            continue;
+        }
+        streamed = std::max(streamed, ret);
+    }
+    streamStats.duration_ms = HAL_Timer_Get_Milli_Seconds() - start;
+    if (streamStats.duration_ms > 0) {
+        streamStats.throughput = (uint64_t)streamStats.bytes * 1000 / streamStats.duration_ms;
+    }
+    LOG_DEBUG(TRACE, "Streamed %u bytes in %u packets, %u ms, %u B/s", (unsigned)streamStats.bytes,
+            (unsigned)streamStats.packets, (unsigned)streamStats.duration_ms, (unsigned)streamStats.throughput);
+    if (stats) {
+        memcpy(stats, &streamStats, std::min((size_t)stats->size, sizeof(hal_ble_stream_stats_t)));
+    }
+    if (streamed == 0 && error < 0) {
+        return error; // Failed to stream the data to any of the subscribers
+    }
+    return streamed;
+}
+
+ssize_t BleObject::GattServer::streamToSubscriber(hal_ble_conn_handle_t connHandle, hal_ble_attr_handle_t attrHandle, const uint8_t* buf, size_t len, hal_ble_stream_stats_t* stats, BleLock& lock) {
+    const ssize_t attMtu = CHECK(BleObject::getInstance().connMgr()->getAttMtu(connHandle));
+    const size_t chunkSize = BLE_ATTR_VALUE_PACKET_SIZE(attMtu);
+    // Discard the signals left over from a previous stream
+    while (!os_semaphore_take(streamSemaphore_, 0, false)) {
+    }
+    streamPending_ = 0;
+    streamConnHandle_ = connHandle;
+    isStreaming_ = true;
+    SCOPE_GUARD({
+        isStreaming_ = false;
+        streamConnHandle_ = BLE_INVALID_CONN_HANDLE;
+    });
+    size_t offset = 0;
+    while (offset < len) {
+        ble_gatts_hvx_params_t hvxParams = {};
+        uint16_t hvxLen = std::min(len - offset, chunkSize);
+        hvxParams.type = BLE_GATT_HVX_NOTIFICATION;
+        hvxParams.handle = attrHandle;
+        hvxParams.offset = 0;
+        hvxParams.p_data = buf + offset;
+        hvxParams.p_len = &hvxLen;
+        // Account for the notification before queuing it, the TX complete event may fire right away.
+        ATOMIC_BLOCK() {
+            ++streamPending_;
+        }
+        int ret = sd_ble_gatts_hvx(connHandle, &hvxParams);
+        if (ret == NRF_ERROR_RESOURCES) {
+            ATOMIC_BLOCK() {
+                --streamPending_;
+            }
+            // The TX queue is full, wait until the SoftDevice has transmitted some of the queued notifications.
+            ++stats->queue_full;
+            if (waitStreamSemaphore(lock)) {
+                LOG(ERROR, "Timed out waiting for the TX queue.");
+                return SYSTEM_ERROR_TIMEOUT;
+            }
+            if (!isStreaming_) {
+                LOG(ERROR, "Disconnected while streaming.");
+                return SYSTEM_ERROR_ABORTED;
+            }
+            continue;
+        }
+        if (ret != NRF_SUCCESS) {
+            ATOMIC_BLOCK() {
+                --streamPending_;
+            }
+            LOG(ERROR, "sd_ble_gatts_hvx() failed: %u", (unsigned)ret);
+            return nrf_system_error(ret);
+        }
+        offset += hvxLen;
+        stats->bytes += hvxLen;
+        ++stats->packets;
+    }
+    CHECK(waitStreamCompleted(lock));
+    return offset;
+}
+
+int BleObject::GattServer::waitStreamSemaphore(BleLock& lock) {
+    // Let other threads use the BLE API while the SoftDevice is transmitting
+    lock.unlock();
+    const int ret = os_semaphore_take(streamSemaphore_, BLE_OPERATION_TIMEOUT_MS, false);
+    lock.lock();
+    return ret;
+}
+
+int BleObject::GattServer::waitStreamCompleted(BleLock& lock) {
+    while (isStreaming_ && streamPending_ > 0) {
+        if (waitStreamSemaphore(lock)) {
+            LOG(ERROR, "Timed out waiting for the notifications to be transmitted.");
+            return SYSTEM_ERROR_TIMEOUT;
+        }
+    }
+    if (streamPending_ > 0) {
+        LOG(ERROR, "Disconnected before all notifications were transmitted.");
+        return SYSTEM_ERROR_ABORTED;
+    }
+    return SYSTEM_ERROR_NONE;
+}
+
 ssize_t BleObject::GattServer::getValue(hal_ble_attr_handle_t attrHandle, uint8_t* buf, size_t len) {
     CHECK_TRUE(attrHandle, SYSTEM_ERROR_INVALID_ARGUMENT);
     CHECK_TRUE(buf, SYSTEM_ERROR_INVALID_ARGUMENT);
@@ -2949,16 +3136,41 @@ bool BleObject::GattServer::findService(hal_ble_attr_handle_t svcHandle) const {
 }
 
 BleObject::GattServer::BleCharacteristic* BleObject::GattServer::findCharacteristic(hal_ble_attr_handle_t attrHandle) {
-    for (auto& characteristic : characteristics_) {
-        if (characteristic.charHandles.value_handle == attrHandle ||
-                characteristic.charHandles.decl_handle == attrHandle ||
-                characteristic.charHandles.user_desc_handle == attrHandle ||
-                characteristic.charHandles.cccd_handle == attrHandle ||
-                characteristic.charHandles.sccd_handle == attrHandle) {
-            return &characteristic;
+    if (attrHandle == BLE_INVALID_ATTR_HANDLE || attrHandle >= charIndices_.size()) {
+        return nullptr;
+    }
+    uint8_t index = charIndices_[attrHandle];
+    if (index == 0) {
+        return nullptr;
+    }
+    return &characteristics_[index - 1];
+}
+
+int BleObject::GattServer::indexCharacteristic(const hal_ble_char_handles_t& charHandles, size_t index) {
+    // Attribute handles are allocated sequentially by the SoftDevice, so the table stays small.
+    const hal_ble_attr_handle_t handles[] = {
+        charHandles.decl_handle,
+        charHandles.value_handle,
+        charHandles.user_desc_handle,
+        charHandles.cccd_handle,
+        charHandles.sccd_handle
+    };
+    // Grow the table first so that no entries are added if there's not enough memory
+    int maxHandle = charIndices_.size() - 1;
+    for (const auto handle : handles) {
+        if (handle != BLE_INVALID_ATTR_HANDLE) {
+            maxHandle = std::max(maxHandle, (int)handle);
         }
     }
-    return nullptr;
+    if (maxHandle >= charIndices_.size()) {
+        CHECK_TRUE(charIndices_.resize(maxHandle + 1), SYSTEM_ERROR_NO_MEMORY);
+    }
+    for (const auto handle : handles) {
+        if (handle != BLE_INVALID_ATTR_HANDLE) {
+            charIndices_[handle] = index + 1;
+        }
+    }
+    return SYSTEM_ERROR_NONE;
 }
 
 int BleObject::GattServer::addSubscriber(BleCharacteristic* characteristic, hal_ble_conn_handle_t connHandle, ble_sig_cccd_value_t value) {
@@ -3039,6 +3251,10 @@ void BleObject::GattServer::processGattServerEvents(const ble_evt_t* event, void
                 gatts->isHvxing_ = false;
                 os_semaphore_give(gatts->hvxSemaphore_, false);
             }
+            if (gatts->isStreaming_ && gatts->streamConnHandle_ == event->evt.gap_evt.conn_handle) {
+                gatts->isStreaming_ = false;
+                os_semaphore_give(gatts->streamSemaphore_, false);
+            }
             break;
         }
         case BLE_GATTS_EVT_SYS_ATTR_MISSING: {
@@ -3070,6 +3286,11 @@ void BleObject::GattServer::processGattServerEvents(const ble_evt_t* event, void
                 gatts->isHvxing_ = false;
                 os_semaphore_give(gatts->hvxSemaphore_, false);
             }
+            if (gatts->isStreaming_ && gatts->streamConnHandle_ == event->evt.gatts_evt.conn_handle) {
+                const uint8_t count = event->evt.gatts_evt.params.hvn_tx_complete.count;
+                gatts->streamPending_ = (gatts->streamPending_ > count) ? (gatts->streamPending_ - count) : 0;
+                os_semaphore_give(gatts->streamSemaphore_, false);
+            }
             break;
         }
         case BLE_GATTS_EVT_HVC: {
@@ -4311,6 +4532,13 @@ ssize_t hal_ble_gatt_server_notify_characteristic_value(hal_ble_attr_handle_t va
     return BleObject::getInstance().gatts()->notifyValue(value_handle, buf, len, false);
 }
 
+ssize_t hal_ble_gatt_server_stream_characteristic_value(hal_ble_attr_handle_t value_handle, const uint8_t* buf, size_t len, hal_ble_stream_stats_t* stats, void* reserved) {
+    BleLock lk;
+    LOG_DEBUG(TRACE, "hal_ble_gatt_server_stream_characteristic_value().");
+    CHECK_TRUE(BleObject::getInstance().initialized(), SYSTEM_ERROR_INVALID_STATE);
+    return BleObject::getInstance().gatts()->streamValue(value_handle, buf, len, stats, lk);
+}
+
 ssize_t hal_ble_gatt_server_indicate_characteristic_value(hal_ble_attr_handle_t value_handle, const uint8_t* buf, size_t len, void* reserved) {
     BleLock lk;
     LOG_DEBUG(TRACE, "hal_ble_gatt_server_indicate_characteristic_value().");
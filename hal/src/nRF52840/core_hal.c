@@ -36,6 +36,7 @@
 #include "interrupts_hal.h"
 #include <nrf_power.h>
 #include "ota_module.h"
+#include "module_validation_cache.h"
 #include "bootloader.h"
 #include <stdlib.h>
 #include <malloc.h>
@@ -57,6 +58,7 @@
 #include <nrf_pwm.h>
 #include "concurrent_hal.h"
 #include "user_hal.h"
+#include "eeprom_hal.h"
 
 #define BACKUP_REGISTER_NUM        10
 static int32_t backup_register[BACKUP_REGISTER_NUM] __attribute__((section(".backup_registers")));
@@ -399,8 +401,8 @@ bool HAL_Core_Validate_User_Module(void)
     if (FLASH_isUserModuleInfoValid(FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION, USER_FIRMWARE_IMAGE_LOCATION))
     {
         //CRC check the user module and set to module_user_part_validated
-        valid = FLASH_VerifyCRC32(FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION,
-                                  FLASH_ModuleLength(FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION))
+        valid = module_validation_cache_verify_crc32(FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION,
+                                                     FLASH_ModuleLength(FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION))
                 && HAL_Verify_User_Dependencies();
     }
     else if(FLASH_isUserModuleInfoValid(FLASH_SERIAL, EXTERNAL_FLASH_FAC_ADDRESS, USER_FIRMWARE_IMAGE_LOCATION))
@@ -480,6 +482,13 @@ void HAL_Core_System_Reset(void) {
 }
 
 void HAL_Core_System_Reset_Ex(int reason, uint32_t data, void *reserved) {
+    if (reason != RESET_REASON_PANIC && !HAL_IsISR()) {
+        // Write the pending EEPROM changes
+        hal_eeprom_flush(true /* force */, NULL);
+        // Let the external flash complete the last erase operation
+        hal_exflash_sync(NULL);
+    }
+
     if (HAL_Feature_Get(FEATURE_RESET_INFO)) {
         // Save reset info to backup registers
         HAL_Core_Write_Backup_Register(BKP_DR_02, reason);
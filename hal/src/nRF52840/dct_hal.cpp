@@ -20,16 +20,50 @@
 #include "scope_guard.h"
 #include "system_error.h"
 #include "service_debug.h"
+#include "module_info.h"
 
 #include "filesystem.h"
 
 #include <algorithm>
+#include <memory>
 #include <mutex>
+#include <cstring>
+
+#if MODULE_FUNCTION != MOD_FUNC_BOOTLOADER
+// Keep a copy of the DCT in RAM
+#define DCD_FILE_CACHE 1
+#else
+#define DCD_FILE_CACHE 0
+#endif // MODULE_FUNCTION != MOD_FUNC_BOOTLOADER
 
 namespace {
 
 using namespace particle::fs;
 
+#if DCD_FILE_CACHE
+
+struct DctField {
+    size_t offset;
+    size_t size;
+};
+
+#define DCT_FIELD(_name) \
+        { offsetof(application_dct_t, _name), sizeof(application_dct_t::_name) }
+
+// Fields that contain secrets and are never cached in RAM. Sorted by offset
+const DctField SECRET_DCT_FIELDS[] = {
+    DCT_FIELD(device_private_key),
+    DCT_FIELD(alt_device_private_key),
+    DCT_FIELD(eap_config),
+    DCT_FIELD(device_secret)
+};
+
+const size_t SECRET_DCT_SIZE = sizeof(application_dct_t::device_private_key) +
+        sizeof(application_dct_t::alt_device_private_key) + sizeof(application_dct_t::eap_config) +
+        sizeof(application_dct_t::device_secret);
+
+#endif // DCD_FILE_CACHE
+
 class DcdFile {
 public:
     DcdFile() {
@@ -41,6 +75,64 @@ public:
     }
 
     ssize_t read(size_t offset, uint8_t* buffer, size_t size) {
+#if DCD_FILE_CACHE
+        const ssize_t cacheOffs = cacheOffset(offset, size);
+        if (cacheOffs >= 0 && loadCache()) {
+            memcpy(buffer, cache_.get() + cacheOffs, size);
+            return size;
+        }
+#endif // DCD_FILE_CACHE
+        return readFile(offset, buffer, size);
+    }
+
+    ssize_t write(size_t offset, const uint8_t* buffer, size_t size) {
+#if DCD_FILE_CACHE
+        const ssize_t cacheOffs = cacheOffset(offset, size);
+        if (cacheOffs >= 0 && loadCache()) {
+            // Only write back the range that has actually changed
+            uint8_t* const data = cache_.get() + cacheOffs;
+            size_t begin = 0;
+            while (begin < size && data[begin] == buffer[begin]) {
+                ++begin;
+            }
+            if (begin == size) {
+                return size;
+            }
+            size_t end = size;
+            while (end > begin && data[end - 1] == buffer[end - 1]) {
+                --end;
+            }
+            // The file is updated atomically when it's closed
+            const ssize_t r = writeFile(offset + begin, buffer + begin, end - begin);
+            if (r != (ssize_t)(end - begin)) {
+                // Reload the file contents on next access
+                cache_.reset();
+                return (r < 0) ? r : SYSTEM_ERROR_IO;
+            }
+            memcpy(data + begin, buffer + begin, end - begin);
+            return size;
+        }
+        // Secret fields are written directly to the file. Reload the cached fields on next access
+        // in case the data overlaps with them
+        cache_.reset();
+#endif // DCD_FILE_CACHE
+        return writeFile(offset, buffer, size);
+    }
+
+    bool clear() {
+#if DCD_FILE_CACHE
+        cache_.reset();
+#endif // DCD_FILE_CACHE
+        return clearFile();
+    }
+
+private:
+#if DCD_FILE_CACHE
+    static const size_t DCT_SIZE = sizeof(application_dct_t);
+    static const size_t CACHE_SIZE = DCT_SIZE - SECRET_DCT_SIZE;
+#endif // DCD_FILE_CACHE
+
+    ssize_t readFile(size_t offset, uint8_t* buffer, size_t size) {
         FsLock lk(fs_);
         open(LFS_O_RDONLY);
         ssize_t r = seek(offset);
@@ -53,7 +145,7 @@ public:
         return r;
     }
 
-    ssize_t write(size_t offset, const uint8_t* buffer, size_t size) {
+    ssize_t writeFile(size_t offset, const uint8_t* buffer, size_t size) {
         FsLock lk(fs_);
 
         open(LFS_O_WRONLY);
@@ -70,12 +162,16 @@ public:
             LOG_DEBUG(ERROR, "Failed to write to DCD: %d", r);
         }
 
-        close();
+        /* The data is committed when the file is closed */
+        if (!close() && r >= 0) {
+            LOG_DEBUG(ERROR, "Failed to commit DCD");
+            r = SYSTEM_ERROR_IO;
+        }
 
         return r;
     }
 
-    bool clear() {
+    bool clearFile() {
         FsLock lk(fs_);
         if (!open(LFS_O_WRONLY)) {
             return false;
@@ -101,8 +197,59 @@ public:
         return true;
     }
 
+#if DCD_FILE_CACHE
+    // Returns the offset of the DCT data in the cache, or -1 if the data is not cached
+    static ssize_t cacheOffset(size_t offset, size_t size) {
+        if (offset >= DCT_SIZE || size > DCT_SIZE - offset) {
+            return -1;
+        }
+        size_t skip = 0;
+        for (const auto& field: SECRET_DCT_FIELDS) {
+            if (offset + size <= field.offset) {
+                break;
+            }
+            if (offset < field.offset + field.size) {
+                return -1;
+            }
+            skip += field.size;
+        }
+        return offset - skip;
+    }
 
-private:
+    // Reads the file into RAM, except for the secret fields, so that the system doesn't need to
+    // open the file every time it reads a DCT field
+    bool loadCache() {
+        if (cache_) {
+            return true;
+        }
+        if (noCacheMemory_) {
+            return false;
+        }
+        std::unique_ptr<uint8_t[]> buf(new(std::nothrow) uint8_t[CACHE_SIZE]);
+        if (!buf) {
+            LOG_DEBUG(WARN, "Not enough memory to cache DCT");
+            noCacheMemory_ = true;
+            return false;
+        }
+        /* Fill with 0xff for compatibility with raw flash DCD, in case the file is smaller */
+        memset(buf.get(), 0xff, CACHE_SIZE);
+        size_t offset = 0;
+        uint8_t* data = buf.get();
+        for (const auto& field: SECRET_DCT_FIELDS) {
+            const size_t n = field.offset - offset;
+            if (readFile(offset, data, n) < 0) {
+                return false;
+            }
+            data += n;
+            offset = field.offset + field.size;
+        }
+        if (readFile(offset, data, DCT_SIZE - offset) < 0) {
+            return false;
+        }
+        cache_ = std::move(buf);
+        return true;
+    }
+#endif // DCD_FILE_CACHE
 
     bool open(int flags) {
         open_ = lfs_file_open(lfs(), &file_, path_, flags) == 0;
@@ -174,6 +321,10 @@ private:
     filesystem_t* fs_;
     lfs_file_t file_;
     bool open_ = false;
+#if DCD_FILE_CACHE
+    std::unique_ptr<uint8_t[]> cache_;
+    bool noCacheMemory_ = false;
+#endif // DCD_FILE_CACHE
     static constexpr const char* path_ = "/sys/dct.bin";
 };
 
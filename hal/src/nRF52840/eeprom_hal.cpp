@@ -19,9 +19,13 @@
 #include "eeprom_hal_impl.h"
 #include "filesystem.h"
 #include "static_recursive_mutex.h"
+#include "eeprom_shadow.h"
+#include "timer_hal.h"
+#include "system_error.h"
 
 #include <algorithm>
 #include <mutex>
+#include <new>
 #include <cstring>
 
 namespace {
@@ -105,6 +109,22 @@ public:
         return r;
     }
 
+    // Methods used by EEPROMShadow
+    int get(size_t offset, void* data, size_t size) {
+        const ssize_t r = read(offset, (uint8_t*)data, size);
+        if (r < 0) {
+            return r;
+        }
+        return ((size_t)r == size) ? 0 : SYSTEM_ERROR_IO;
+    }
+
+    int put(size_t offset, const void* data, size_t size) {
+        const ssize_t r = write(offset, (const uint8_t*)data, size);
+        if (r < 0) {
+            return r;
+        }
+        return ((size_t)r == size) ? 0 : SYSTEM_ERROR_IO;
+    }
 
 private:
 
@@ -163,11 +183,26 @@ private:
     static constexpr const char* path_ = EEPROM_FILE_PATH;
 };
 
+typedef particle::EEPROMShadow<EepromFile, EEPROM_FILE_SIZE, EEPROM_SHADOW_BLOCK_SIZE> EepromShadow;
+
+StaticRecursiveMutex s_mutex;
+EepromShadow* s_shadow = nullptr; // RAM copy of the EEPROM file
+system_tick_t s_dirtyTime = 0; // Time when the shadow got its oldest unflushed change
+
 EepromFile& eeprom() {
     static EepromFile eeprom;
     return eeprom;
 }
 
+// The shadow is allocated on first write so that the devices that don't use the EEPROM don't
+// pay for it. If there's not enough memory, the data is written directly to the file
+EepromShadow* eepromShadow() {
+    if (!s_shadow) {
+        s_shadow = new(std::nothrow) EepromShadow(&eeprom());
+    }
+    return s_shadow;
+}
+
 } // namespace
 
 void HAL_EEPROM_Init(void) {
@@ -195,7 +230,10 @@ void HAL_EEPROM_Get(uint32_t index, void *data, size_t length) {
         return;
     }
 
-    eeprom().read(index, (uint8_t *)data, length);
+    std::lock_guard<StaticRecursiveMutex> lk(s_mutex);
+    if (!s_shadow || s_shadow->get(index, data, length) < 0) {
+        eeprom().read(index, (uint8_t *)data, length);
+    }
 }
 
 void HAL_EEPROM_Put(uint32_t index, const void *data, size_t length) {
@@ -203,10 +241,24 @@ void HAL_EEPROM_Put(uint32_t index, const void *data, size_t length) {
         return;
     }
 
-    eeprom().write(index, (const uint8_t *)data, length);
+    std::lock_guard<StaticRecursiveMutex> lk(s_mutex);
+    const auto shadow = eepromShadow();
+    const bool dirty = shadow && shadow->hasPendingWrites();
+    if (!shadow || shadow->put(index, data, length) < 0) {
+        // The shadow couldn't be allocated or loaded
+        eeprom().write(index, (const uint8_t *)data, length);
+        return;
+    }
+    if (!dirty && shadow->hasPendingWrites()) {
+        s_dirtyTime = HAL_Timer_Get_Milli_Seconds();
+    }
 }
 
 void HAL_EEPROM_Clear() {
+    std::lock_guard<StaticRecursiveMutex> lk(s_mutex);
+    if (s_shadow) {
+        s_shadow->reset();
+    }
     eeprom().recreate();
 }
 
@@ -217,3 +269,21 @@ bool HAL_EEPROM_Has_Pending_Erase() {
 void HAL_EEPROM_Perform_Pending_Erase() {
 
 }
+
+int hal_eeprom_flush(bool force, void* reserved) {
+    std::lock_guard<StaticRecursiveMutex> lk(s_mutex);
+    if (!s_shadow || !s_shadow->hasPendingWrites()) {
+        return 0;
+    }
+    if (!force && HAL_Timer_Get_Milli_Seconds() - s_dirtyTime < EEPROM_FLUSH_DELAY) {
+        return 0;
+    }
+    const int r = s_shadow->flush();
+    if (r < 0) {
+        LOG_DEBUG(ERROR, "Failed to flush EEPROM: %d", r);
+        // Retry after the flush delay
+        s_dirtyTime = HAL_Timer_Get_Milli_Seconds();
+        return r;
+    }
+    return 0;
+}
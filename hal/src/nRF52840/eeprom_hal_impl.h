@@ -22,3 +22,6 @@
 
 #define EEPROM_DIR_PATH             "/sys"
 #define EEPROM_FILE_PATH            "/sys/eeprom.bin"
+
+#define EEPROM_SHADOW_BLOCK_SIZE    64
+#define EEPROM_FLUSH_DELAY          1000 // Milliseconds
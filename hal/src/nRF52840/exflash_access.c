@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "exflash_access.h"
+
+#include <string.h>
+
+void exflash_access_init(exflash_access* a, exflash_access_read_func read, exflash_access_wait_func wait,
+        uint8_t* buf, size_t buf_size, size_t flash_size) {
+    memset(a, 0, sizeof(exflash_access));
+    a->read = read;
+    a->wait = wait;
+    a->buf = buf;
+    a->buf_size = buf_size;
+    a->flash_size = flash_size;
+}
+
+int exflash_access_read(exflash_access* a, uintptr_t addr, uint8_t* data, size_t size) {
+    const int ret = exflash_access_sync(a);
+    if (ret < 0) {
+        return ret;
+    }
+    if (!a->buf_size) {
+        return a->read(addr, data, size);
+    }
+    const bool sequential = (addr == a->last_read_end);
+    a->last_read_end = addr + size;
+    if (a->data_size > 0 && addr >= a->buf_addr && addr + size <= a->buf_addr + a->data_size) {
+        memcpy(data, a->buf + (addr - a->buf_addr), size);
+        return 0;
+    }
+    const uintptr_t start = addr & ~(uintptr_t)3;
+    size_t fill_size = a->buf_size;
+    if (start >= a->flash_size) {
+        fill_size = 0;
+    } else if (a->flash_size - start < fill_size) {
+        fill_size = a->flash_size - start;
+    }
+    if (!sequential || size > a->buf_size / 2 || addr + size > start + fill_size) {
+        // Random access, or the read is large enough already
+        return a->read(addr, data, size);
+    }
+    a->data_size = 0;
+    const int r = a->read(start, a->buf, fill_size);
+    if (r < 0) {
+        return r;
+    }
+    a->buf_addr = start;
+    a->data_size = fill_size;
+    memcpy(data, a->buf + (addr - start), size);
+    return 0;
+}
+
+void exflash_access_invalidate(exflash_access* a, uintptr_t addr, size_t size) {
+    if (a->data_size > 0 && addr < a->buf_addr + a->data_size && a->buf_addr < addr + size) {
+        a->data_size = 0;
+    }
+}
+
+void exflash_access_erase_started(exflash_access* a) {
+    a->erase_pending = true;
+}
+
+int exflash_access_sync(exflash_access* a) {
+    if (a->erase_pending) {
+        a->erase_pending = false;
+        return a->wait();
+    }
+    return 0;
+}
+
+void exflash_access_clear(exflash_access* a) {
+    a->data_size = 0;
+    a->last_read_end = 0;
+}
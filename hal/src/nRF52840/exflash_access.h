@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Reads data directly from the flash.
+ */
+typedef int (*exflash_access_read_func)(uintptr_t addr, uint8_t* data, size_t size);
+
+/**
+ * Waits until the flash completes the ongoing operation.
+ */
+typedef int (*exflash_access_wait_func)(void);
+
+/**
+ * State of the read-ahead buffer and of the pending erase operation of the external flash.
+ *
+ * The functions don't do any locking, the caller needs to hold the flash lock.
+ */
+typedef struct exflash_access {
+    exflash_access_read_func read;
+    exflash_access_wait_func wait;
+    uint8_t* buf; // Read-ahead buffer, needs to be word-aligned
+    size_t buf_size; // Size of the read-ahead buffer (0 disables the read-ahead)
+    size_t flash_size;
+    uintptr_t buf_addr; // Flash address of the buffered data
+    size_t data_size; // Size of the buffered data
+    uintptr_t last_read_end; // End address of the last read, used to detect sequential access
+    bool erase_pending; // Set when the flash may still be busy with the last erase command
+} exflash_access;
+
+/**
+ * Initializes the state.
+ */
+void exflash_access_init(exflash_access* a, exflash_access_read_func read, exflash_access_wait_func wait,
+        uint8_t* buf, size_t buf_size, size_t flash_size);
+
+/**
+ * Reads data, waiting for a pending erase operation to complete first.
+ *
+ * A small read that continues the previous one fills the read-ahead buffer, and the following
+ * reads are served from it.
+ */
+int exflash_access_read(exflash_access* a, uintptr_t addr, uint8_t* data, size_t size);
+
+/**
+ * Drops the buffered data that overlaps with a given range. Must be called before the range is
+ * programmed or erased.
+ */
+void exflash_access_invalidate(exflash_access* a, uintptr_t addr, size_t size);
+
+/**
+ * Marks an erase operation as started. The completion is awaited before the next access, so that
+ * the caller can prepare the data to be written in the meantime.
+ */
+void exflash_access_erase_started(exflash_access* a);
+
+/**
+ * Waits for a pending erase operation to complete.
+ */
+int exflash_access_sync(exflash_access* a);
+
+/**
+ * Drops all buffered data.
+ */
+void exflash_access_clear(exflash_access* a);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
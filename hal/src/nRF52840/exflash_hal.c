@@ -35,6 +35,10 @@
 #include "gpio_hal.h"
 #include "system_error.h"
 #include "nrf_system_error.h"
+#include "module_validation_cache.h"
+#include "flash_mal.h"
+#include "hal_platform.h"
+#include "exflash_access.h"
 
 enum qspi_cmds_t {
     QSPI_STD_CMD_WRSR     = 0x01,
@@ -53,6 +57,33 @@ static const size_t MX25_OTP_SECTOR_SIZE = 4096 / 8; /* 4Kb or 512B */
 
 static hal_exflash_state_t qspi_state = HAL_EXFLASH_STATE_DISABLED;
 
+#if MODULE_FUNCTION != MOD_FUNC_BOOTLOADER
+/* Erases return early and sequential reads go through a read-ahead buffer (see exflash_access.h) */
+#define EXFLASH_ACCESS_TRACKING 1
+#else
+// The bootloader waits for every operation to complete
+#define EXFLASH_ACCESS_TRACKING 0
+#endif // MODULE_FUNCTION != MOD_FUNC_BOOTLOADER
+
+#if EXFLASH_ACCESS_TRACKING
+static int exflash_read(uintptr_t addr, uint8_t* data_buf, size_t data_size);
+static int exflash_qspi_wait_completion();
+
+#if HAL_PLATFORM_EXFLASH_READ_AHEAD_SIZE > 0
+static uint8_t read_ahead_buf[HAL_PLATFORM_EXFLASH_READ_AHEAD_SIZE] __attribute__((aligned(4)));
+#else
+#define read_ahead_buf NULL
+#endif // HAL_PLATFORM_EXFLASH_READ_AHEAD_SIZE > 0
+
+static exflash_access access_state = {
+    .read = exflash_read,
+    .wait = exflash_qspi_wait_completion,
+    .buf = read_ahead_buf,
+    .buf_size = HAL_PLATFORM_EXFLASH_READ_AHEAD_SIZE,
+    .flash_size = EXTERNAL_FLASH_SIZE
+};
+#endif // EXFLASH_ACCESS_TRACKING
+
 // Mitigations for nRF52840 anomaly 215
 // [215] QSPI: Reading QSPI registers after XIP might halt CPU
 // Conditions
@@ -112,6 +143,22 @@ static int exflash_qspi_wait_completion() {
     return nrf_system_error(err);
 }
 
+static int exflash_wait_pending() {
+#if EXFLASH_ACCESS_TRACKING
+    return exflash_access_sync(&access_state);
+#else
+    return 0;
+#endif // EXFLASH_ACCESS_TRACKING
+}
+
+/* Must be called before the flash range is written or erased */
+static void exflash_invalidate(uint8_t flash_dev, uintptr_t addr, size_t size) {
+    module_validation_cache_invalidate(flash_dev, addr, size);
+#if EXFLASH_ACCESS_TRACKING
+    exflash_access_invalidate(&access_state, addr, size);
+#endif // EXFLASH_ACCESS_TRACKING
+}
+
 static int exflash_qspi_cinstr_xfer(nrf_qspi_cinstr_conf_t const* p_config, void const* p_tx_buffer, void* p_rx_buffer) {
     // Certain operations like block erasure, may leave the flash
     // in a weird state where we can't talk to it for substantial periods of time
@@ -224,6 +271,10 @@ hal_exflash_init_done:
 
 int hal_exflash_uninit(void) {
     hal_exflash_lock();
+    exflash_wait_pending();
+#if EXFLASH_ACCESS_TRACKING
+    exflash_access_clear(&access_state);
+#endif
 
     nrfx_qspi_uninit();
     // PATCH: Initialize CS pin, external memory discharge
@@ -242,6 +293,8 @@ int hal_exflash_uninit(void) {
 
 int hal_exflash_write(uintptr_t addr, const uint8_t* data_buf, size_t data_size) {
     hal_exflash_lock();
+    exflash_invalidate(FLASH_SERIAL, addr, data_size);
+    exflash_wait_pending();
     int ret = hal_flash_common_write(addr, data_buf, data_size,
                                      &perform_write, &hal_flash_common_dummy_read);
     exflash_qspi_wait_completion();
@@ -249,9 +302,8 @@ int hal_exflash_write(uintptr_t addr, const uint8_t* data_buf, size_t data_size)
     return ret;
 }
 
-int hal_exflash_read(uintptr_t addr, uint8_t* data_buf, size_t data_size) {
+static int exflash_read(uintptr_t addr, uint8_t* data_buf, size_t data_size) {
     int ret = 0;
-    hal_exflash_lock();
     {
         const uintptr_t src_aligned = ADDR_ALIGN_WORD(addr);
         uint8_t* dst_aligned = (uint8_t*)ADDR_ALIGN_WORD_RIGHT((uintptr_t)data_buf);
@@ -310,10 +362,20 @@ int hal_exflash_read(uintptr_t addr, uint8_t* data_buf, size_t data_size) {
     }
 
 hal_exflash_read_done:
-    hal_exflash_unlock();
     return nrf_system_error(ret);
 }
 
+int hal_exflash_read(uintptr_t addr, uint8_t* data_buf, size_t data_size) {
+    hal_exflash_lock();
+#if EXFLASH_ACCESS_TRACKING
+    int ret = exflash_access_read(&access_state, addr, data_buf, data_size);
+#else
+    int ret = exflash_read(addr, data_buf, data_size);
+#endif
+    hal_exflash_unlock();
+    return ret;
+}
+
 static int erase_common(uintptr_t start_addr, size_t num_blocks, nrf_qspi_erase_len_t len) {
     hal_exflash_lock();
     int err_code = NRF_SUCCESS;
@@ -322,14 +384,21 @@ static int erase_common(uintptr_t start_addr, size_t num_blocks, nrf_qspi_erase_
 
     /* Round down to the nearest block */
     start_addr = ((start_addr / block_length) * block_length);
+    exflash_invalidate(FLASH_SERIAL, start_addr, num_blocks * block_length);
 
     for (size_t i = 0; i < num_blocks; i++) {
+        exflash_wait_pending();
+
         err_code = nrfx_qspi_erase(len, start_addr);
         if (err_code) {
             goto erase_common_done;
         }
 
+#if EXFLASH_ACCESS_TRACKING
+        exflash_access_erase_started(&access_state);
+#else
         exflash_qspi_wait_completion();
+#endif
 
         start_addr += block_length;
     }
@@ -399,6 +468,7 @@ int hal_exflash_read_special(hal_exflash_special_sector_t sp, uintptr_t addr, ui
     }
 
     hal_exflash_lock();
+    exflash_wait_pending();
 
     /* Enter Secure OTP mode */
     int ret = enter_secure_otp();
@@ -407,7 +477,8 @@ int hal_exflash_read_special(hal_exflash_special_sector_t sp, uintptr_t addr, ui
         goto hal_exflash_read_special_done;
     }
 
-    ret = hal_exflash_read(addr, data_buf, data_size);
+    /* Bypass the read-ahead buffer, which only holds the data of the main array */
+    ret = exflash_read(addr, data_buf, data_size);
 
 hal_exflash_read_special_done:
     /* Exit Secure OTP mode */
@@ -428,6 +499,7 @@ int hal_exflash_write_special(hal_exflash_special_sector_t sp, uintptr_t addr, c
     }
 
     hal_exflash_lock();
+    exflash_wait_pending();
 
     /* Enter Secure OTP mode */
     int ret = enter_secure_otp();
@@ -453,6 +525,9 @@ int hal_exflash_special_command(hal_exflash_special_sector_t sp, hal_exflash_com
     int ret = -1;
 
     hal_exflash_lock();
+    if (cmd != HAL_EXFLASH_COMMAND_SUSPEND_PGMERS) {
+        exflash_wait_pending();
+    }
     /* General commands */
     if (sp == HAL_EXFLASH_SPECIAL_SECTOR_NONE) {
         nrf_qspi_cinstr_conf_t cinstr_cfg = {
@@ -527,6 +602,8 @@ int hal_exflash_sleep(bool sleep, void* reserved) {
             hal_exflash_unlock();
             return SYSTEM_ERROR_INVALID_STATE;
         }
+        // Don't abort the last erase operation
+        exflash_wait_pending();
         // Put external flash into Deep Power-down mode
         if (hal_exflash_special_command(HAL_EXFLASH_SPECIAL_SECTOR_NONE, HAL_EXFLASH_COMMAND_SLEEP, NULL, NULL, 0)) {
             // It may fail as the flash chip might be in an ongoing program/erase operation. Suspend it.
@@ -559,3 +636,10 @@ int hal_exflash_sleep(bool sleep, void* reserved) {
     hal_exflash_unlock();
     return SYSTEM_ERROR_NONE;
 }
+
+int hal_exflash_sync(void* reserved) {
+    hal_exflash_lock();
+    const int ret = exflash_wait_pending();
+    hal_exflash_unlock();
+    return ret;
+}
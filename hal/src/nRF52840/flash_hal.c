@@ -22,6 +22,7 @@
 #include "flash_hal.h"
 #include "flash_acquire.h"
 #include "flash_common.h"
+#include "module_validation_cache.h"
 
 #ifdef SOFTDEVICE_PRESENT
 #include "nrf_fstorage_sd.h"
@@ -104,6 +105,8 @@ int hal_flash_write(uintptr_t addr, const uint8_t* data_buf, size_t data_size)
 {
     __flash_acquire();
 
+    module_validation_cache_invalidate(FLASH_INTERNAL, addr, data_size);
+
     int ret = hal_flash_common_write(addr, data_buf, data_size,
                                      &fstorage_perform_write, &hal_flash_common_dummy_read);
 
@@ -128,6 +131,7 @@ int hal_flash_erase_sector(uintptr_t addr, size_t num_sectors)
     }
 
     addr = (addr / INTERNAL_FLASH_PAGE_SIZE) * INTERNAL_FLASH_PAGE_SIZE; // Address must be aligned to a page boundary.
+    module_validation_cache_invalidate(FLASH_INTERNAL, addr, num_sectors * INTERNAL_FLASH_PAGE_SIZE);
     fs_op_state = FS_OP_STATE_BUSY; //should before calling nrf_fstorage_erase
     ret_code = nrf_fstorage_erase(&m_fs, addr, num_sectors, (fs_op_state_t *)&fs_op_state);
     if (ret_code != NRF_SUCCESS) {
@@ -90,8 +90,13 @@
 
 #define HAL_PLATFORM_PACKET_BUFFER_FLOW_CONTROL_THRESHOLD (2)
 
+#define HAL_PLATFORM_PACKET_BUFFER_ADAPTIVE_RESERVE (4)
+
 #define HAL_PLATFORM_COMPRESSED_OTA (1)
 
+// Four littlefs reads
+#define HAL_PLATFORM_EXFLASH_READ_AHEAD_SIZE (1024)
+
 #define HAL_PLATFORM_FILE_MAXIMUM_FD (999)
 
 #define HAL_PLATFORM_SOCKET_IOCTL_NOTIFY (1)
@@ -97,7 +97,7 @@ int inflate_input(inflate_ctx* ctx, const char* data, size_t* size, unsigned fla
             //
             // Note that having the INFLATE_HAS_MORE_INPUT flag set for the last chunk of the compressed
             // data is fine, as the caller might not know the total size of the data in advance
-            if (srcOffs < *size) {
+            if (srcOffs < *size && !(flags & INFLATE_ALLOW_TRAILING_DATA)) {
                 ctx->result = SYSTEM_ERROR_BAD_DATA;
             } else {
                 ctx->result = INFLATE_DONE;
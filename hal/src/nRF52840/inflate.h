@@ -34,7 +34,10 @@ typedef enum inflate_result {
 } inflate_result;
 
 typedef enum inflate_flag {
-    INFLATE_HAS_MORE_INPUT = 0x01
+    INFLATE_HAS_MORE_INPUT = 0x01,
+    // Do not treat the data following the end of the compressed stream as an error. The number of
+    // bytes that belong to the compressed stream is reported via the `size` argument
+    INFLATE_ALLOW_TRAILING_DATA = 0x02
 } inflate_flag;
 
 typedef struct inflate_opts {
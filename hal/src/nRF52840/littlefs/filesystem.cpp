@@ -60,9 +60,28 @@ __attribute__((weak)) int filesystem_unlock(filesystem_t* fs) {
 
 namespace {
 
+#if FILESYSTEM_FILE_CACHE_POOL_SIZE > 0
+
+const size_t FILE_CACHE_SIZE = (FILESYSTEM_READ_SIZE > FILESYSTEM_PROG_SIZE) ? FILESYSTEM_READ_SIZE : FILESYSTEM_PROG_SIZE;
+
+/* Opening a file allocates a cache buffer, which tends to fragment the heap when the system
+ * opens and closes its settings files all the time
+ */
+uint8_t s_file_cache_pool[FILESYSTEM_FILE_CACHE_POOL_SIZE][FILE_CACHE_SIZE] __attribute__((aligned(4)));
+uint32_t s_file_cache_used = 0;
+
+static_assert(FILESYSTEM_FILE_CACHE_POOL_SIZE <= 32, "Too many file caches");
+
+#endif /* FILESYSTEM_FILE_CACHE_POOL_SIZE > 0 */
+
+filesystem_t s_instance = {};
+
 int fs_read(const struct lfs_config* c, lfs_block_t block,
             lfs_off_t off, void* buffer, lfs_size_t size)
 {
+    auto fs = (filesystem_t*)c->context;
+    ++fs->stats.reads;
+    fs->stats.read_bytes += size;
     int r = hal_exflash_read(block * c->block_size + off, (uint8_t*)buffer, size);
     if (r) {
         LOG_DEBUG(ERROR, "fs_read error %d", r);
@@ -73,6 +92,9 @@ int fs_read(const struct lfs_config* c, lfs_block_t block,
 int fs_prog(const struct lfs_config* c, lfs_block_t block,
             lfs_off_t off, const void* buffer, lfs_size_t size)
 {
+    auto fs = (filesystem_t*)c->context;
+    ++fs->stats.progs;
+    fs->stats.prog_bytes += size;
     int r = hal_exflash_write(block * c->block_size + off, (const uint8_t*)buffer, size);
     if (r) {
         LOG_DEBUG(ERROR, "fs_prog error %d", r);
@@ -82,6 +104,8 @@ int fs_prog(const struct lfs_config* c, lfs_block_t block,
 
 int fs_erase(const struct lfs_config* c, lfs_block_t block)
 {
+    auto fs = (filesystem_t*)c->context;
+    ++fs->stats.erases;
     int r = hal_exflash_erase_sector(block * c->block_size, 1);
     if (r) {
         LOG_DEBUG(ERROR, "fs_erase error %d", r);
@@ -232,8 +256,6 @@ void fs_dump(filesystem_t* fs)
 }
 #endif /* DEBUG_BUILD */
 
-filesystem_t s_instance = {};
-
 } /* anonymous */
 
 int filesystem_mount(filesystem_t* fs) {
@@ -257,10 +279,10 @@ int filesystem_mount(filesystem_t* fs) {
     fs->config.block_count = FILESYSTEM_BLOCK_COUNT;
     fs->config.lookahead = FILESYSTEM_LOOKAHEAD;
 
-#ifdef LFS_NO_MALLOC
     fs->config.read_buffer = fs->read_buffer;
     fs->config.prog_buffer = fs->prog_buffer;
     fs->config.lookahead_buffer = fs->lookahead_buffer;
+#ifdef LFS_NO_MALLOC
     fs->config.file_buffer = fs->file_buffer;
 #endif /* LFS_NO_MALLOC */
 
@@ -344,7 +366,50 @@ int filesystem_dump_info(filesystem_t* fs) {
 
 #ifdef DEBUG_BUILD
     fs_dump(fs);
+    LOG_PRINTF(TRACE, "Reads: %lu (%lu bytes), programs: %lu (%lu bytes), erases: %lu\r\n",
+            fs->stats.reads, fs->stats.read_bytes, fs->stats.progs, fs->stats.prog_bytes, fs->stats.erases);
+    LOG_PRINTF(TRACE, "File caches: %lu pooled, %lu from heap\r\n", fs->stats.pool_allocs, fs->stats.heap_allocs);
 #endif /* DEBUG_BUILD */
 
     return 0;
-}
\ No newline at end of file
+}
+
+int filesystem_get_stats(filesystem_t* fs, filesystem_stats_t* stats) {
+    if (!fs || !stats) {
+        return -1;
+    }
+    FsLock lk(fs);
+    *stats = fs->stats;
+    return 0;
+}
+
+#ifndef LFS_NO_MALLOC
+
+void* filesystem_alloc_file_cache(size_t size) {
+#if FILESYSTEM_FILE_CACHE_POOL_SIZE > 0
+    if (size <= FILE_CACHE_SIZE) {
+        for (unsigned i = 0; i < FILESYSTEM_FILE_CACHE_POOL_SIZE; ++i) {
+            if (!(s_file_cache_used & (1u << i))) {
+                s_file_cache_used |= (1u << i);
+                ++s_instance.stats.pool_allocs;
+                return s_file_cache_pool[i];
+            }
+        }
+    }
+#endif /* FILESYSTEM_FILE_CACHE_POOL_SIZE > 0 */
+    ++s_instance.stats.heap_allocs;
+    return malloc(size);
+}
+
+void filesystem_free_file_cache(void* ptr) {
+#if FILESYSTEM_FILE_CACHE_POOL_SIZE > 0
+    const uintptr_t offs = (uintptr_t)ptr - (uintptr_t)s_file_cache_pool;
+    if (offs < sizeof(s_file_cache_pool)) {
+        s_file_cache_used &= ~(1u << (offs / FILE_CACHE_SIZE));
+        return;
+    }
+#endif /* FILESYSTEM_FILE_CACHE_POOL_SIZE > 0 */
+    free(ptr);
+}
+
+#endif /* LFS_NO_MALLOC */
\ No newline at end of file
@@ -29,13 +29,41 @@ extern "C" {
 #include <lfs.h>
 
 /* FIXME */
+#ifndef FILESYSTEM_PROG_SIZE
 #define FILESYSTEM_PROG_SIZE    (256)
+#endif
+#ifndef FILESYSTEM_READ_SIZE
 #define FILESYSTEM_READ_SIZE    (256)
+#endif
 
 #define FILESYSTEM_BLOCK_SIZE   (sFLASH_PAGESIZE)
 /* XXX: Using half of the external flash for now */
 #define FILESYSTEM_BLOCK_COUNT  (sFLASH_PAGECOUNT / 2)
-#define FILESYSTEM_LOOKAHEAD    (128)
+/* Covering the whole filesystem with the lookahead bitmap lets the block allocator traverse
+ * the filesystem only once per FILESYSTEM_BLOCK_COUNT allocations
+ */
+#ifndef FILESYSTEM_LOOKAHEAD
+#define FILESYSTEM_LOOKAHEAD    (FILESYSTEM_BLOCK_COUNT)
+#endif
+
+/* Number of file caches allocated from a static pool rather than from the heap */
+#ifndef FILESYSTEM_FILE_CACHE_POOL_SIZE
+#ifndef LFS_NO_MALLOC
+#define FILESYSTEM_FILE_CACHE_POOL_SIZE (4)
+#else
+#define FILESYSTEM_FILE_CACHE_POOL_SIZE (0)
+#endif /* LFS_NO_MALLOC */
+#endif /* FILESYSTEM_FILE_CACHE_POOL_SIZE */
+
+typedef struct {
+    uint32_t reads;
+    uint32_t read_bytes;
+    uint32_t progs;
+    uint32_t prog_bytes;
+    uint32_t erases;
+    uint32_t pool_allocs; /* File caches allocated from the pool */
+    uint32_t heap_allocs; /* File caches allocated from the heap */
+} filesystem_stats_t;
 
 /* FIXME */
 typedef struct {
@@ -47,10 +75,12 @@ typedef struct {
 
     bool state;
 
-#ifdef LFS_NO_MALLOC
+    filesystem_stats_t stats;
+
     uint8_t read_buffer[FILESYSTEM_READ_SIZE] __attribute__((aligned(4)));
     uint8_t prog_buffer[FILESYSTEM_PROG_SIZE] __attribute__((aligned(4)));
     uint8_t lookahead_buffer[FILESYSTEM_LOOKAHEAD / 8] __attribute__((aligned(4)));
+#ifdef LFS_NO_MALLOC
     uint8_t file_buffer[FILESYSTEM_PROG_SIZE] __attribute__((aligned(4)));
 #endif /* LFS_NO_MALLOC */
 } filesystem_t;
@@ -63,6 +93,16 @@ int filesystem_dump_info(filesystem_t* fs);
 int filesystem_lock(filesystem_t* fs);
 int filesystem_unlock(filesystem_t* fs);
 
+/**
+ * Returns the number of block device operations performed by the filesystem so far. The counters
+ * can be sampled before and after an operation to see its cost.
+ */
+int filesystem_get_stats(filesystem_t* fs, filesystem_stats_t* stats);
+
+/* Used by lfs_malloc() and lfs_free(). Must be called with the filesystem locked */
+void* filesystem_alloc_file_cache(size_t size);
+void filesystem_free_file_cache(void* ptr);
+
 #ifdef __cplusplus
 }
 
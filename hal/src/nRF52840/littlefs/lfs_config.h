@@ -171,10 +171,16 @@ static inline uint32_t lfs_tole32(uint32_t a) {
 // Calculate CRC-32 with polynomial = 0x04c11db7
 void lfs_crc(uint32_t *crc, const void *buffer, size_t size);
 
+#ifndef LFS_NO_MALLOC
+void* filesystem_alloc_file_cache(size_t size);
+void filesystem_free_file_cache(void* ptr);
+#endif
+
 // Allocate memory, only used if buffers are not provided to littlefs
 static inline void *lfs_malloc(size_t size) {
 #ifndef LFS_NO_MALLOC
-    return malloc(size);
+    // The filesystem buffers are provided statically, so this is only used for file caches
+    return filesystem_alloc_file_cache(size);
 #else
     (void)size;
     return NULL;
@@ -184,7 +190,7 @@ static inline void *lfs_malloc(size_t size) {
 // Deallocate memory, only used if buffers are not provided to littlefs
 static inline void lfs_free(void *p) {
 #ifndef LFS_NO_MALLOC
-    free(p);
+    filesystem_free_file_cache(p);
 #else
     (void)p;
 #endif
@@ -44,6 +44,11 @@ struct netif* lwip_hook_ip6_route(const ip6_addr_t* src, const ip6_addr_t* dst);
 
 void lwip_hook_memp_free(memp_t type, unsigned available, unsigned size);
 
+/* Netconn hooks */
+#if LWIP_DNS
+int lwip_hook_netconn_external_resolve(const char* name, ip_addr_t* addr, u8_t addrtype, err_t* err);
+#endif /* LWIP_DNS */
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -455,6 +460,6 @@ void lwip_hook_memp_free(memp_t type, unsigned available, unsigned size);
  * err must also be checked to determine if the hook consumed the query, but
  * the query failed
  */
-// #define LWIP_HOOK_NETCONN_EXTERNAL_RESOLVE(name, addr, addrtype, err)
+#define LWIP_HOOK_NETCONN_EXTERNAL_RESOLVE(name, addr, addrtype, err) lwip_hook_netconn_external_resolve(name, addr, addrtype, err)
 
 #endif /* HAL_LWIP_LWIPHOOKS_H */
@@ -254,7 +254,7 @@
 /**
  * VJ_SUPPORT==1: Support VJ header compression.
  */
-#define VJ_SUPPORT                      0
+#define VJ_SUPPORT                      1
 /* VJ compression is only supported for TCP over IPv4 over PPPoS. */
 #if !PPPOS_SUPPORT || !PPP_IPV4_SUPPORT || !LWIP_TCP
 #undef VJ_SUPPORT
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "module_validation_cache.h"
+
+#include "crc32_util.h"
+
+#include <cstring>
+
+using namespace particle;
+
+namespace {
+
+const uint32_t STORAGE_MAGIC = 0x4d564331; // "MVC1"
+const uint16_t STORAGE_VERSION = 1;
+
+// Size of the CRC that follows the module data
+const uint32_t MODULE_CRC_SIZE = 4;
+
+} // unnamed
+
+ModuleValidationCache::ModuleValidationCache(Storage* storage) :
+        storage_(storage),
+        stats_() {
+}
+
+void ModuleValidationCache::init() {
+    if (storage_->magic != STORAGE_MAGIC || storage_->version != STORAGE_VERSION || storage_->entrySize != sizeof(Entry) ||
+            storage_->checksum != crc32_calc(storage_->entries, sizeof(storage_->entries), 0)) {
+        memset(storage_, 0, sizeof(Storage));
+        storage_->magic = STORAGE_MAGIC;
+        storage_->version = STORAGE_VERSION;
+        storage_->entrySize = sizeof(Entry);
+        updateChecksum();
+    }
+}
+
+bool ModuleValidationCache::find(uint8_t device, uint32_t address, uint32_t length, uint32_t crc) {
+    if (length > 0) {
+        for (const auto& e: storage_->entries) {
+            if (e.length == length && e.address == address && e.device == device && e.crc == crc) {
+                ++stats_.hits;
+                return true;
+            }
+        }
+    }
+    ++stats_.misses;
+    return false;
+}
+
+void ModuleValidationCache::add(uint8_t device, uint32_t address, uint32_t length, uint32_t crc) {
+    if (length == 0) {
+        return;
+    }
+    Entry* entry = nullptr;
+    for (auto& e: storage_->entries) {
+        if (!e.length || (e.address == address && e.device == device)) {
+            entry = &e;
+            break;
+        }
+    }
+    if (!entry) {
+        // Evict the oldest entry
+        memmove(storage_->entries, storage_->entries + 1, sizeof(Entry) * (MAX_ENTRY_COUNT - 1));
+        entry = &storage_->entries[MAX_ENTRY_COUNT - 1];
+    }
+    memset(entry, 0, sizeof(Entry));
+    entry->address = address;
+    entry->length = length;
+    entry->crc = crc;
+    entry->device = device;
+    updateChecksum();
+}
+
+void ModuleValidationCache::invalidate(uint8_t device, uint32_t address, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    bool changed = false;
+    for (auto& e: storage_->entries) {
+        if (e.length && e.device == device && address < e.address + e.length + MODULE_CRC_SIZE &&
+                e.address < address + size) {
+            memset(&e, 0, sizeof(Entry));
+            ++stats_.invalidations;
+            changed = true;
+        }
+    }
+    if (changed) {
+        updateChecksum();
+    }
+}
+
+void ModuleValidationCache::clear() {
+    memset(storage_->entries, 0, sizeof(storage_->entries));
+    updateChecksum();
+}
+
+void ModuleValidationCache::updateChecksum() {
+    storage_->checksum = crc32_calc(storage_->entries, sizeof(storage_->entries), 0);
+}
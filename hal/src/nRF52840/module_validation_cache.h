@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "module_info.h"
+#include "flash_device_hal.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if MODULE_FUNCTION != MOD_FUNC_BOOTLOADER
+
+/**
+ * Verifies the CRC-32 of a module, skipping the computation if the same module has already been
+ * verified and the flash range it occupies hasn't been modified since then.
+ *
+ * @param flash_dev Flash device (`flash_device_t`).
+ * @param addr Start address of the module.
+ * @param length Module length, not including the CRC.
+ * @return `true` if the module is valid.
+ */
+bool module_validation_cache_verify_crc32(uint8_t flash_dev, uint32_t addr, uint32_t length);
+
+/**
+ * Drops the cached results for the modules that overlap with a given flash range. Must be called
+ * when the range is written or erased.
+ */
+void module_validation_cache_invalidate(uint8_t flash_dev, uintptr_t addr, size_t size);
+
+#else
+
+// The bootloader doesn't use the cache
+static inline void module_validation_cache_invalidate(uint8_t flash_dev, uintptr_t addr, size_t size) {
+}
+
+#endif // MODULE_FUNCTION != MOD_FUNC_BOOTLOADER
+
+#ifdef __cplusplus
+} // extern "C"
+
+namespace particle {
+
+/**
+ * Cache of module integrity checks.
+ *
+ * An entry records the location and length of a module that passed the CRC-32 check, along
+ * with the CRC value stored in flash. The storage is meant to be kept in retained memory so that
+ * the results survive warm resets; a new image written by the bootloader has a different CRC
+ * and thus doesn't match a stale entry.
+ */
+class ModuleValidationCache {
+public:
+    static const unsigned MAX_ENTRY_COUNT = 6;
+
+    struct Entry {
+        uint32_t address;
+        uint32_t length; // 0 if the entry is not used
+        uint32_t crc;
+        uint8_t device;
+        uint8_t reserved[3];
+    };
+
+    struct Storage {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t entrySize;
+        Entry entries[MAX_ENTRY_COUNT];
+        uint32_t checksum; // CRC-32 of the entries
+    };
+
+    struct Stats {
+        unsigned hits;
+        unsigned misses;
+        unsigned invalidations;
+    };
+
+    explicit ModuleValidationCache(Storage* storage);
+
+    /**
+     * Validates the contents of the storage. The storage is cleared if it's not valid.
+     */
+    void init();
+
+    /**
+     * Returns `true` if the module with the specified CRC has been verified.
+     */
+    bool find(uint8_t device, uint32_t address, uint32_t length, uint32_t crc);
+    void add(uint8_t device, uint32_t address, uint32_t length, uint32_t crc);
+    /**
+     * Removes the entries for the modules that overlap with a given range, including their CRC.
+     */
+    void invalidate(uint8_t device, uint32_t address, size_t size);
+    void clear();
+
+    const Stats& stats() const;
+
+private:
+    Storage* storage_;
+    Stats stats_;
+
+    void updateChecksum();
+};
+
+inline const ModuleValidationCache::Stats& ModuleValidationCache::stats() const {
+    return stats_;
+}
+
+} // particle
+
+#endif // defined(__cplusplus)
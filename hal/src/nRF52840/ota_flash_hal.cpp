@@ -58,6 +58,10 @@ namespace {
 
 const uint16_t BOOTLOADER_MBR_UPDATE_MIN_VERSION = 1001; // 2.0.0-rc.1
 
+// Decoded copy of the module stored in the OTA section
+uintptr_t s_decodedModuleAddr = 0;
+size_t s_decodedModuleSize = 0;
+
 } // anonymous
 
 static int flash_bootloader(const hal_module_t* mod, uint32_t moduleLength);
@@ -383,6 +387,34 @@ int HAL_OTA_Flash_Read(uintptr_t address, uint8_t* buffer, size_t size)
 #endif
 }
 
+int HAL_OTA_Set_Decoded_Module(uintptr_t address, size_t size, void* reserved)
+{
+    if (address) {
+        const uintptr_t otaAddr = HAL_OTA_FlashAddress();
+        if (address < otaAddr || size < sizeof(module_info_t) + 4 /* CRC-32 */ ||
+                address - otaAddr + size > HAL_OTA_FlashLength()) {
+            return SYSTEM_ERROR_INVALID_ARGUMENT;
+        }
+    } else {
+        size = 0;
+    }
+    s_decodedModuleAddr = address;
+    s_decodedModuleSize = size;
+    return 0;
+}
+
+int HAL_OTA_Read_Module(const hal_module_t* module, uintptr_t offset, uint8_t* buffer, size_t size, void* reserved)
+{
+    const size_t moduleSize = module_length(&module->info) + 4 /* CRC-32 */;
+    if (offset > moduleSize || size > moduleSize - offset) {
+        return SYSTEM_ERROR_OUT_OF_RANGE;
+    }
+    if (module->bounds.location != MODULE_BOUNDS_LOC_INTERNAL_FLASH) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    return hal_flash_read((uintptr_t)module->info.module_start_address + offset, buffer, size);
+}
+
 static int flash_bootloader(const hal_module_t* mod, uint32_t moduleLength)
 {
     bool ok = false;
@@ -481,6 +513,32 @@ int fetchModules(hal_module_t* modules, size_t maxModuleCount, bool userDepsOpti
     return count;
 }
 
+// Replaces a compressed or delta module with its decoded copy if one was registered via
+// HAL_OTA_Set_Decoded_Module(). The original module is used as is if the copy doesn't match it
+void useDecodedModule(hal_module_t* modules, size_t moduleCount, bool userDepsOptional, unsigned flags) {
+    const auto info = &modules[0].info;
+    if (!s_decodedModuleAddr || moduleCount != 1 || !(info->flags & (MODULE_INFO_FLAG_COMPRESSED | MODULE_INFO_FLAG_DELTA))) {
+        return;
+    }
+    module_bounds_t bounds = module_ota;
+    bounds.start_address = s_decodedModuleAddr;
+    bounds.maximum_size = s_decodedModuleSize;
+    hal_module_t module = {};
+    if (!fetch_module(&module, &bounds, userDepsOptional, flags)) {
+        LOG(WARN, "Unable to fetch decoded module");
+        return;
+    }
+    const auto decodedInfo = &module.info;
+    if (module_function(decodedInfo) != module_function(info) || module_index(decodedInfo) != module_index(info) ||
+            module_version(decodedInfo) != module_version(info) || decodedInfo->module_start_address != info->module_start_address ||
+            module_length(decodedInfo) + 4 /* CRC-32 */ != s_decodedModuleSize ||
+            (decodedInfo->flags & (MODULE_INFO_FLAG_COMPRESSED | MODULE_INFO_FLAG_COMBINED | MODULE_INFO_FLAG_DELTA))) {
+        LOG(WARN, "Decoded module doesn't match the received module");
+        return;
+    }
+    memcpy(&modules[0], &module, sizeof(hal_module_t));
+}
+
 int validateModules(const hal_module_t* modules, size_t moduleCount) {
     for (size_t i = 0; i < moduleCount; ++i) {
         const auto module = modules + i;
@@ -501,7 +559,14 @@ int validateModules(const hal_module_t* modules, size_t moduleCount) {
         }
         const auto moduleFunc = module_function(info);
         if (compressed && moduleFunc != MODULE_FUNCTION_USER_PART && moduleFunc != MODULE_FUNCTION_SYSTEM_PART) {
-            SYSTEM_ERROR_MESSAGE("Unsupported compressed module"); // TODO
+            // Other modules can only be updated if they were decompressed while being transferred
+            // (see HAL_OTA_Set_Decoded_Module())
+            SYSTEM_ERROR_MESSAGE("Unsupported compressed module");
+            return SYSTEM_ERROR_OTA_UNSUPPORTED_MODULE;
+        }
+        if (info->flags & MODULE_INFO_FLAG_DELTA) {
+            // Delta modules can only be updated if they were patched while being transferred
+            SYSTEM_ERROR_MESSAGE("Delta module was not patched");
             return SYSTEM_ERROR_OTA_UNSUPPORTED_MODULE;
         }
         if (moduleFunc == MODULE_FUNCTION_NCP_FIRMWARE) {
@@ -554,6 +619,7 @@ int HAL_FLASH_OTA_Validate(bool userDepsOptional, module_validation_flags_t flag
         LOG(WARN, "Got more than %u combined modules", (unsigned)MAX_COMBINED_MODULE_COUNT);
         moduleCount = MAX_COMBINED_MODULE_COUNT;
     }
+    useDecodedModule(modules, moduleCount, userDepsOptional, flags);
     CHECK(validateModules(modules, moduleCount));
     return 0;
 }
@@ -570,6 +636,8 @@ int HAL_FLASH_End(void* reserved)
         LOG(WARN, "Got more than %u combined modules", (unsigned)MAX_COMBINED_MODULE_COUNT);
         moduleCount = MAX_COMBINED_MODULE_COUNT;
     }
+    useDecodedModule(modules, moduleCount, true /* userDepsOptional */,
+            MODULE_VALIDATION_INTEGRITY | MODULE_VALIDATION_DEPENDENCIES_FULL);
     CHECK(validateModules(modules, moduleCount));
     bool restartPending = false;
     for (size_t i = 0; i < moduleCount; ++i) {
@@ -23,10 +23,43 @@
 #include "ota_flash_hal_impl.h"
 #include "platform_radio_stack.h"
 #include "platform_ncp.h"
+#include "module_validation_cache.h"
+#include "flash_hal.h"
+#include "exflash_hal.h"
+#include "hal_irq_flag.h"
+#include "platform_headers.h"
 #include "check.h"
 
+using namespace particle;
+
 namespace {
 
+// Survives warm resets. The contents are validated by ModuleValidationCache::init()
+retained_system ModuleValidationCache::Storage sValidationCacheStorage;
+
+ModuleValidationCache sValidationCache(&sValidationCacheStorage);
+bool sValidationCacheInitialized = false;
+// Incremented on every flash write so that a verification that raced with a write is not cached
+volatile uint32_t sFlashWriteCount = 0;
+
+// Must be called with interrupts disabled
+ModuleValidationCache* validationCache() {
+    if (!sValidationCacheInitialized) {
+        sValidationCache.init();
+        sValidationCacheInitialized = true;
+    }
+    return &sValidationCache;
+}
+
+bool read_module_crc(uint8_t flash_dev, uint32_t addr, uint32_t* crc) {
+    if (flash_dev == FLASH_INTERNAL) {
+        return hal_flash_read(addr, (uint8_t*)crc, sizeof(uint32_t)) == 0;
+    } else if (flash_dev == FLASH_SERIAL) {
+        return hal_exflash_read(addr, (uint8_t*)crc, sizeof(uint32_t)) == 0;
+    }
+    return false;
+}
+
 int get_module_info(const module_bounds_t* bounds, module_info_t* infoOut, uint32_t* offset = nullptr) {
     if (!memcmp(bounds, &module_radio_stack, sizeof(module_radio_stack))) {
         hal_module_t module;
@@ -62,15 +95,45 @@ int get_module_crc_suffix(const module_bounds_t* bounds, const module_info_t* in
 
 bool verify_crc32(const module_bounds_t* bounds, const module_info_t* info) {
     if (bounds->location == MODULE_BOUNDS_LOC_INTERNAL_FLASH) {
-        return FLASH_VerifyCRC32(FLASH_INTERNAL, bounds->start_address, module_length(info));
+        return module_validation_cache_verify_crc32(FLASH_INTERNAL, bounds->start_address, module_length(info));
     } else if (bounds->location == MODULE_BOUNDS_LOC_EXTERNAL_FLASH) {
-        return FLASH_VerifyCRC32(FLASH_SERIAL, bounds->start_address, module_length(info));
+        return module_validation_cache_verify_crc32(FLASH_SERIAL, bounds->start_address, module_length(info));
     }
     return false;
 }
 
 } // namespace
 
+bool module_validation_cache_verify_crc32(uint8_t flash_dev, uint32_t addr, uint32_t length) {
+    uint32_t crc = 0;
+    if (!length || !read_module_crc(flash_dev, addr + length, &crc)) {
+        return false;
+    }
+    int st = HAL_disable_irq();
+    const uint32_t writeCount = sFlashWriteCount;
+    const bool cached = validationCache()->find(flash_dev, addr, length, crc);
+    HAL_enable_irq(st);
+    if (cached) {
+        return true;
+    }
+    if (!FLASH_VerifyCRC32(flash_dev, addr, length)) {
+        return false;
+    }
+    st = HAL_disable_irq();
+    if (writeCount == sFlashWriteCount) {
+        validationCache()->add(flash_dev, addr, length, crc);
+    }
+    HAL_enable_irq(st);
+    return true;
+}
+
+void module_validation_cache_invalidate(uint8_t flash_dev, uintptr_t addr, size_t size) {
+    const int st = HAL_disable_irq();
+    sFlashWriteCount = sFlashWriteCount + 1;
+    validationCache()->invalidate(flash_dev, addr, size);
+    HAL_enable_irq(st);
+}
+
 /**
  * Determines if a given address is in range.
  * @param test      The address to test
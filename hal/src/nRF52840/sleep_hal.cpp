@@ -41,6 +41,7 @@
 #include "ble_hal.h"
 #include "interrupts_hal.h"
 #include "concurrent_hal.h"
+#include "eeprom_hal.h"
 #include "check.h"
 #include "radio_common.h"
 #if HAL_PLATFORM_EXTERNAL_RTC
@@ -1407,6 +1408,9 @@ int hal_sleep_enter(const hal_sleep_config_t* config, hal_wakeup_source_base_t**
     // Check it again just in case.
     CHECK(hal_sleep_validate_config(config, nullptr));
 
+    // The RAM copy of the EEPROM is lost in hibernate mode, and the device may lose power while sleeping
+    hal_eeprom_flush(true /* force */, nullptr);
+
     int ret = SYSTEM_ERROR_NONE;
 
     switch (config->mode) {
@@ -20,6 +20,7 @@
 #include "system_error.h"
 #include "ota_module.h"
 #include "flash_mal.h"
+#include "module_validation_cache.h"
 
 namespace {
 
@@ -36,7 +37,7 @@ bool validUserModuleInfoAtIndex(uint8_t index, module_info_t* info) {
         return false;
     }
 
-    if (!FLASH_VerifyCRC32(FLASH_INTERNAL, bounds->start_address, FLASH_ModuleLength(FLASH_INTERNAL, bounds->start_address))) {
+    if (!module_validation_cache_verify_crc32(FLASH_INTERNAL, bounds->start_address, FLASH_ModuleLength(FLASH_INTERNAL, bounds->start_address))) {
         return false;
     }
 
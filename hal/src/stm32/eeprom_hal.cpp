@@ -77,3 +77,8 @@ void HAL_EEPROM_Perform_Pending_Erase()
 {
     flashEEPROM.performPendingErase();
 }
+
+int hal_eeprom_flush(bool force, void* reserved)
+{
+    return 0;
+}
@@ -35,6 +35,7 @@
 #include "hal_irq_flag.h"
 #include "system_flags_impl.h"
 #include "periph_lock.h"
+#include "crc32_util.h"
 
 /* Private typedef -----------------------------------------------------------*/
 
@@ -980,7 +981,7 @@ uint32_t Compute_CRC32(const uint8_t *pBuffer, uint32_t bufferSize)
     periph_lock();
 
     /* Hardware CRC32 calculation */
-    uint32_t i, j;
+    uint32_t i;
     uint32_t Data;
 
     CRC_ResetDR();
@@ -999,22 +1000,10 @@ uint32_t Compute_CRC32(const uint8_t *pBuffer, uint32_t bufferSize)
     Data = CRC->DR;
     Data = __RBIT(Data);//reverse the bit order of output Data
 
-    i = bufferSize & 3;
+    /* The peripheral only accepts whole words */
+    Data = crc32_calc_update(Data, pBuffer, bufferSize & 3);
 
-    while (i--)
-    {
-        Data ^= (uint32_t)*pBuffer++;
-
-        for (j = 0 ; j < 8 ; j++)
-        {
-            if (Data & 1)
-                Data = (Data >> 1) ^ 0xEDB88320;
-            else
-                Data >>= 1;
-        }
-    }
-
-    Data ^= 0xFFFFFFFF;
+    Data = crc32_calc_final(Data);
 
     periph_unlock();
 
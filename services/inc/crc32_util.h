@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Initial state of a CRC-32 (IEEE 802.3) computation.
+ */
+#define CRC32_CALC_INIT 0xffffffff
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Updates the CRC-32 state with the contents of a buffer.
+ *
+ * The state is neither inverted on entry nor on exit, so that the computation can be split across
+ * multiple calls: start with `CRC32_CALC_INIT`, feed the data and pass the final state to
+ * `crc32_calc_final()`.
+ *
+ * @param state Current state.
+ * @param data Data.
+ * @param size Data size.
+ * @return Updated state.
+ */
+uint32_t crc32_calc_update(uint32_t state, const void* data, size_t size);
+
+/**
+ * Returns the CRC-32 value for a given state.
+ */
+static inline uint32_t crc32_calc_final(uint32_t state) {
+    return state ^ 0xffffffff;
+}
+
+/**
+ * Computes the CRC-32 of a buffer.
+ *
+ * @param data Data.
+ * @param size Data size.
+ * @param crc CRC-32 of the preceding data, or 0.
+ * @return CRC-32 value.
+ */
+static inline uint32_t crc32_calc(const void* data, size_t size, uint32_t crc) {
+    return crc32_calc_final(crc32_calc_update(crc32_calc_final(crc), data, size));
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "varint.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particle {
+
+/**
+ * Streaming applier of binary patches.
+ *
+ * A patch is a sequence of instructions that reconstruct the target data from the base data.
+ * Each instruction starts with an opcode byte followed by one or more varint arguments:
+ *
+ * - `COPY <offset> <length>`: copy `length` bytes of the base data starting at `offset`.
+ * - `ADD <offset> <length> <bytes>`: add `length` bytes that follow the instruction to the base data
+ *   starting at `offset`, modulo 256. This is how code that moved to a different address is
+ *   encoded compactly, as most of the resulting bytes are zero.
+ * - `INSERT <length> <bytes>`: copy `length` bytes that follow the instruction.
+ *
+ * The patch ends when the size of the reconstructed data reaches the target size. The patch can be
+ * passed to the patcher in fragments of arbitrary size, and the patcher only needs a small fixed
+ * amount of RAM regardless of the size of the data.
+ */
+class DeltaPatcher {
+public:
+    enum Opcode {
+        COPY = 0x01,
+        ADD = 0x02,
+        INSERT = 0x03
+    };
+
+    /**
+     * Callback invoked to read the base data.
+     *
+     * @return 0 on success or a negative result code in case of an error.
+     */
+    typedef int (*ReadFn)(size_t offset, char* data, size_t size, void* userData);
+
+    /**
+     * Callback invoked to write the reconstructed data.
+     *
+     * @return 0 on success or a negative result code in case of an error.
+     */
+    typedef int (*WriteFn)(const char* data, size_t size, void* userData);
+
+    DeltaPatcher();
+
+    /**
+     * Initialize the patcher.
+     *
+     * @param baseSize Size of the base data.
+     * @param targetSize Size of the reconstructed data.
+     * @param read Callback for reading the base data.
+     * @param write Callback for writing the reconstructed data.
+     * @param userData User data passed to the callbacks.
+     */
+    void init(size_t baseSize, size_t targetSize, ReadFn read, WriteFn write, void* userData);
+
+    /**
+     * Process a fragment of the patch.
+     *
+     * @param data Patch data.
+     * @param size Data size.
+     * @return Number of bytes processed or a negative result code in case of an error. The returned
+     *         value is only less than `size` if the patch has been fully processed.
+     */
+    int update(const char* data, size_t size);
+
+    /**
+     * Returns `true` if the target data has been fully reconstructed.
+     */
+    bool isDone() const;
+
+    /**
+     * Returns the number of bytes of the target data reconstructed so far.
+     */
+    size_t targetOffset() const;
+
+private:
+    enum State {
+        OPCODE,
+        ARGS,
+        DATA,
+        DONE
+    };
+
+    static const size_t BUFFER_SIZE = 128;
+    static const size_t MAX_ARG_COUNT = 2;
+
+    char buf_[BUFFER_SIZE]; // Buffer for the base data
+    char args_[MAX_ARG_COUNT * maxUnsignedVarintSize<uint32_t>()]; // Encoded instruction arguments
+    ReadFn read_;
+    WriteFn write_;
+    void* userData_;
+    size_t baseSize_;
+    size_t targetSize_;
+    size_t targetOffset_;
+    size_t argsSize_;
+    size_t argCount_; // Number of arguments received so far
+    uint32_t offset_; // Base data offset
+    uint32_t length_; // Number of bytes remaining for the current instruction
+    State state_;
+    uint8_t opcode_;
+
+    int parseArgs();
+    int copy();
+    int add(const char* data, size_t size);
+    int output(const char* data, size_t size);
+};
+
+inline bool DeltaPatcher::isDone() const {
+    return state_ == DONE;
+}
+
+inline size_t DeltaPatcher::targetOffset() const {
+    return targetOffset_;
+}
+
+} // particle
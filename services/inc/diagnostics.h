@@ -48,6 +48,13 @@
 #define DIAG_NAME_NETWORK_CELLULAR_CELL_GLOBAL_IDENTITY_MOBILE_NETWORK_CODE "net:cell:cgi:mnc"
 #define DIAG_NAME_NETWORK_CELLULAR_CELL_GLOBAL_IDENTITY_LOCATION_AREA_CODE "net:cell:cgi:lac"
 #define DIAG_NAME_NETWORK_CELLULAR_CELL_GLOBAL_IDENTITY_CELL_ID "net:cell:cgi:ci"
+#define DIAG_NAME_NETWORK_PPP_HEADER_BYTES_SAVED "net:ppp:hdrsaved"
+#define DIAG_NAME_NETWORK_PPP_VJ_BYTES_SAVED "net:ppp:vjsaved"
+#define DIAG_NAME_NETWORK_MEMP_PBUF_HIGH_WATER_MARK "net:memp:pbuf:max"
+#define DIAG_NAME_NETWORK_MEMP_PBUF_ERRORS "net:memp:pbuf:err"
+#define DIAG_NAME_NETWORK_MEMP_PBUF_STALL_TIME "net:memp:pbuf:stall"
+#define DIAG_NAME_NETWORK_MEMP_TCP_SEG_HIGH_WATER_MARK "net:memp:seg:max"
+#define DIAG_NAME_NETWORK_MEMP_TCP_SEG_ERRORS "net:memp:seg:err"
 #define DIAG_NAME_CLOUD_CONNECTION_STATUS "cloud:stat"
 #define DIAG_NAME_CLOUD_CONNECTION_ERROR_CODE "cloud:err"
 #define DIAG_NAME_CLOUD_DISCONNECTS "cloud:dconn"
@@ -95,6 +102,13 @@ typedef enum diag_id {
     DIAG_ID_NETWORK_CELLULAR_CELL_GLOBAL_IDENTITY_MOBILE_NETWORK_CODE = 41, // net:cell:cgi:mnc
     DIAG_ID_NETWORK_CELLULAR_CELL_GLOBAL_IDENTITY_LOCATION_AREA_CODE = 42, // net:cell:cgi:lac
     DIAG_ID_NETWORK_CELLULAR_CELL_GLOBAL_IDENTITY_CELL_ID = 43, // net:cell:cgi:ci
+    DIAG_ID_NETWORK_PPP_HEADER_BYTES_SAVED = 44, // net:ppp:hdrsaved
+    DIAG_ID_NETWORK_PPP_VJ_BYTES_SAVED = 45, // net:ppp:vjsaved
+    DIAG_ID_NETWORK_MEMP_PBUF_HIGH_WATER_MARK = 46, // net:memp:pbuf:max
+    DIAG_ID_NETWORK_MEMP_PBUF_ERRORS = 47, // net:memp:pbuf:err
+    DIAG_ID_NETWORK_MEMP_PBUF_STALL_TIME = 48, // net:memp:pbuf:stall
+    DIAG_ID_NETWORK_MEMP_TCP_SEG_HIGH_WATER_MARK = 49, // net:memp:seg:max
+    DIAG_ID_NETWORK_MEMP_TCP_SEG_ERRORS = 50, // net:memp:seg:err
     DIAG_ID_CLOUD_CONNECTION_STATUS = 10, // cloud:stat
     DIAG_ID_CLOUD_CONNECTION_ERROR_CODE = 13, // cloud:err
     DIAG_ID_CLOUD_DISCONNECTS = 14, // cloud:dconn
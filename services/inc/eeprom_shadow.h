@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+namespace particle {
+
+/**
+ * RAM shadow of an emulated EEPROM.
+ *
+ * The contents of the EEPROM are loaded into RAM on first access. Reads are served from RAM, and
+ * writes only update the RAM copy and mark the affected blocks as dirty. Writes that don't change
+ * the data don't mark anything. Calling `flush()` writes each contiguous run of dirty blocks to
+ * the underlying storage with a single `put()`, so that repeated writes to the same locations cost
+ * one storage write instead of one per call.
+ *
+ * The storage class needs to provide the following methods, which return 0 on success or a negative
+ * result code in case of an error:
+ *
+ * - `int get(size_t index, void* data, size_t length)`
+ * - `int put(size_t index, const void* data, size_t length)`
+ *
+ * If the data can't be loaded from the storage, `get()` and `put()` fail and the loading is retried
+ * on the next access. If a run of dirty blocks can't be written, it stays dirty and `flush()` fails.
+ *
+ * This class is not thread-safe.
+ */
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN = 32>
+class EEPROMShadow {
+public:
+    typedef StorageT Storage;
+
+    static const size_t CAPACITY = CapacityN;
+    static const size_t BLOCK_SIZE = BlockSizeN;
+    static const size_t BLOCK_COUNT = (CapacityN + BlockSizeN - 1) / BlockSizeN;
+
+    explicit EEPROMShadow(Storage* storage);
+
+    /**
+     * Read data.
+     *
+     * The data outside of the EEPROM range is left unmodified.
+     *
+     * @return 0 on success or a negative result code in case of an error.
+     */
+    int get(size_t index, void* data, size_t length);
+
+    /**
+     * Write data.
+     *
+     * The data outside of the EEPROM range is ignored.
+     *
+     * @return 0 on success or a negative result code in case of an error.
+     */
+    int put(size_t index, const void* data, size_t length);
+
+    /**
+     * Write the dirty blocks to the storage.
+     *
+     * @return 0 on success or a negative result code in case of an error.
+     */
+    int flush();
+
+    /**
+     * Discard the RAM copy of the data, including any unflushed changes.
+     *
+     * This method needs to be called when the storage is modified directly.
+     */
+    void reset();
+
+    /**
+     * Returns `true` if there are changes that haven't been written to the storage yet.
+     */
+    bool hasPendingWrites() const;
+
+private:
+    static const size_t BITS_PER_WORD = sizeof(uint32_t) * 8;
+
+    uint8_t data_[CapacityN];
+    uint32_t dirty_[(BLOCK_COUNT + BITS_PER_WORD - 1) / BITS_PER_WORD]; // Bitmap of dirty blocks
+    Storage* storage_;
+    size_t dirtyCount_; // Number of dirty blocks
+    bool loaded_;
+
+    int load();
+    bool isDirty(size_t block) const;
+    void setDirty(size_t block, bool dirty);
+    static size_t clampLength(size_t index, size_t length);
+};
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline EEPROMShadow<StorageT, CapacityN, BlockSizeN>::EEPROMShadow(Storage* storage) :
+        storage_(storage) {
+    reset();
+}
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline int EEPROMShadow<StorageT, CapacityN, BlockSizeN>::get(size_t index, void* data, size_t length) {
+    length = clampLength(index, length);
+    if (!length) {
+        return 0;
+    }
+    const int r = load();
+    if (r < 0) {
+        return r;
+    }
+    memcpy(data, data_ + index, length);
+    return 0;
+}
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline int EEPROMShadow<StorageT, CapacityN, BlockSizeN>::put(size_t index, const void* data, size_t length) {
+    length = clampLength(index, length);
+    if (!length) {
+        return 0;
+    }
+    const int r = load();
+    if (r < 0) {
+        return r;
+    }
+    auto src = (const uint8_t*)data;
+    const size_t end = index + length;
+    while (index < end) {
+        const size_t block = index / BlockSizeN;
+        const size_t n = std::min((block + 1) * BlockSizeN, end) - index;
+        if (memcmp(data_ + index, src, n) != 0) {
+            memcpy(data_ + index, src, n);
+            setDirty(block, true);
+        }
+        index += n;
+        src += n;
+    }
+    return 0;
+}
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline int EEPROMShadow<StorageT, CapacityN, BlockSizeN>::flush() {
+    size_t block = 0;
+    while (dirtyCount_ > 0 && block < BLOCK_COUNT) {
+        if (!isDirty(block)) {
+            ++block;
+            continue;
+        }
+        const size_t first = block;
+        do {
+            setDirty(block++, false);
+        } while (block < BLOCK_COUNT && isDirty(block));
+        const size_t index = first * BlockSizeN;
+        const size_t length = std::min(block * BlockSizeN, CapacityN) - index;
+        const int r = storage_->put(index, data_ + index, length);
+        if (r < 0) {
+            // Keep the blocks dirty so that they're written on the next flush
+            for (size_t b = first; b < block; ++b) {
+                setDirty(b, true);
+            }
+            return r;
+        }
+    }
+    return 0;
+}
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline void EEPROMShadow<StorageT, CapacityN, BlockSizeN>::reset() {
+    memset(dirty_, 0, sizeof(dirty_));
+    dirtyCount_ = 0;
+    loaded_ = false;
+}
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline bool EEPROMShadow<StorageT, CapacityN, BlockSizeN>::hasPendingWrites() const {
+    return dirtyCount_ > 0;
+}
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline int EEPROMShadow<StorageT, CapacityN, BlockSizeN>::load() {
+    if (!loaded_) {
+        const int r = storage_->get(0, data_, CapacityN);
+        if (r < 0) {
+            return r;
+        }
+        loaded_ = true;
+    }
+    return 0;
+}
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline bool EEPROMShadow<StorageT, CapacityN, BlockSizeN>::isDirty(size_t block) const {
+    return dirty_[block / BITS_PER_WORD] & ((uint32_t)1 << (block % BITS_PER_WORD));
+}
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline void EEPROMShadow<StorageT, CapacityN, BlockSizeN>::setDirty(size_t block, bool dirty) {
+    const uint32_t mask = (uint32_t)1 << (block % BITS_PER_WORD);
+    uint32_t& word = dirty_[block / BITS_PER_WORD];
+    if (dirty && !(word & mask)) {
+        word |= mask;
+        ++dirtyCount_;
+    } else if (!dirty && (word & mask)) {
+        word &= ~mask;
+        --dirtyCount_;
+    }
+}
+
+template<typename StorageT, size_t CapacityN, size_t BlockSizeN>
+inline size_t EEPROMShadow<StorageT, CapacityN, BlockSizeN>::clampLength(size_t index, size_t length) {
+    if (index >= CapacityN) {
+        return 0;
+    }
+    return std::min(length, CapacityN - index);
+}
+
+} // particle
@@ -21,6 +21,7 @@
 #include "check.h"
 
 #include "mbedtls/md.h"
+#include "mbedtls/sha256.h"
 
 #include <cstring>
 
@@ -30,6 +31,10 @@ class Sha256 {
 public:
     static const size_t HASH_SIZE = 32;
     static const size_t BLOCK_SIZE = 64;
+    // Size of the saved state. The state is a copy of the platform's mbedtls_sha256_context, so its
+    // layout depends on the SHA-256 implementation (e.g. CC310 on nRF52840) and it can only be
+    // restored on the same platform
+    static const size_t STATE_SIZE = sizeof(mbedtls_sha256_context);
 
     Sha256();
     ~Sha256();
@@ -45,6 +50,25 @@ public:
 
     int copyFrom(const Sha256& src);
 
+    /**
+     * Save the intermediate state of the computation.
+     *
+     * The state can be restored via `restoreState()`, possibly by a different instance of this class
+     * or after a reset of the device.
+     *
+     * @param buf Output buffer. The buffer should be at least `STATE_SIZE` bytes long.
+     */
+    int saveState(char* buf) const;
+    /**
+     * Restore the intermediate state of the computation.
+     *
+     * @param buf State data saved via `saveState()`.
+     * @return 0 on success, or `SYSTEM_ERROR_BAD_DATA` if the state is known to be invalid. Note
+     *         that a corrupted state is not always detected, so the result of the computation needs
+     *         to be checked against a known hash.
+     */
+    int restoreState(const char* buf);
+
 private:
     mbedtls_md_context_t ctx_;
 };
@@ -118,6 +142,33 @@ inline int Sha256::copyFrom(const Sha256& src) {
     return 0;
 }
 
+inline int Sha256::saveState(char* buf) const {
+    if (!ctx_.md_ctx) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    memcpy(buf, ctx_.md_ctx, STATE_SIZE);
+    return 0;
+}
+
+inline int Sha256::restoreState(const char* buf) {
+    if (!ctx_.md_ctx) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    // Hardware-accelerated implementations may need to initialize the destination context so the
+    // state is restored via mbedtls_sha256_clone() rather than copied directly
+    mbedtls_sha256_context ctx;
+    memcpy(&ctx, buf, STATE_SIZE);
+#ifdef MBEDTLS_SHA256_ALT
+    // The CC310 implementation (nRF52840) silently skips the copy if it can't initialize a hardware
+    // context for the saved hash mode
+    if (ctx.mode != CRYS_HASH_SHA256_mode) {
+        return SYSTEM_ERROR_BAD_DATA;
+    }
+#endif
+    mbedtls_sha256_clone((mbedtls_sha256_context*)ctx_.md_ctx, &ctx);
+    return 0;
+}
+
 inline HmacSha256::HmacSha256() :
         ctx_() {
 }
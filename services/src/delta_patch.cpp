@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "delta_patch.h"
+
+#include "check.h"
+
+#include <algorithm>
+
+namespace particle {
+
+DeltaPatcher::DeltaPatcher() {
+    init(0, 0, nullptr, nullptr, nullptr);
+}
+
+void DeltaPatcher::init(size_t baseSize, size_t targetSize, ReadFn read, WriteFn write, void* userData) {
+    read_ = read;
+    write_ = write;
+    userData_ = userData;
+    baseSize_ = baseSize;
+    targetSize_ = targetSize;
+    targetOffset_ = 0;
+    argsSize_ = 0;
+    argCount_ = 0;
+    offset_ = 0;
+    length_ = 0;
+    state_ = (targetSize > 0) ? OPCODE : DONE;
+    opcode_ = 0;
+}
+
+int DeltaPatcher::update(const char* data, size_t size) {
+    size_t offs = 0;
+    while (offs < size && state_ != DONE) {
+        switch (state_) {
+        case OPCODE: {
+            opcode_ = data[offs++];
+            if (opcode_ != COPY && opcode_ != ADD && opcode_ != INSERT) {
+                return SYSTEM_ERROR_BAD_DATA;
+            }
+            argsSize_ = 0;
+            argCount_ = 0;
+            state_ = ARGS;
+            break;
+        }
+        case ARGS: {
+            if (argsSize_ == sizeof(args_)) {
+                return SYSTEM_ERROR_BAD_DATA;
+            }
+            const char b = data[offs++];
+            args_[argsSize_++] = b;
+            if (!(b & 0x80)) {
+                ++argCount_;
+                if (argCount_ == ((opcode_ == INSERT) ? 1 : 2)) {
+                    CHECK(parseArgs());
+                }
+            }
+            break;
+        }
+        case DATA: {
+            const size_t n = std::min<size_t>(length_, size - offs);
+            if (opcode_ == ADD) {
+                CHECK(add(data + offs, n));
+            } else { // INSERT
+                CHECK(output(data + offs, n));
+            }
+            length_ -= n;
+            offs += n;
+            if (!length_) {
+                state_ = (targetOffset_ == targetSize_) ? DONE : OPCODE;
+            }
+            break;
+        }
+        default:
+            return SYSTEM_ERROR_INTERNAL;
+        }
+    }
+    return offs;
+}
+
+int DeltaPatcher::parseArgs() {
+    const char* p = args_;
+    const char* const end = args_ + argsSize_;
+    offset_ = 0;
+    if (opcode_ != INSERT) {
+        p += CHECK(decodeUnsignedVarint(p, end - p, &offset_));
+    }
+    CHECK(decodeUnsignedVarint(p, end - p, &length_));
+    if (!length_ || length_ > targetSize_ - targetOffset_) {
+        return SYSTEM_ERROR_BAD_DATA;
+    }
+    if (opcode_ != INSERT && (offset_ > baseSize_ || length_ > baseSize_ - offset_)) {
+        return SYSTEM_ERROR_BAD_DATA;
+    }
+    if (opcode_ == COPY) {
+        CHECK(copy());
+        state_ = (targetOffset_ == targetSize_) ? DONE : OPCODE;
+    } else {
+        state_ = DATA;
+    }
+    return 0;
+}
+
+int DeltaPatcher::copy() {
+    while (length_ > 0) {
+        const size_t n = std::min<size_t>(length_, sizeof(buf_));
+        CHECK(read_(offset_, buf_, n, userData_));
+        CHECK(output(buf_, n));
+        offset_ += n;
+        length_ -= n;
+    }
+    return 0;
+}
+
+int DeltaPatcher::add(const char* data, size_t size) {
+    while (size > 0) {
+        const size_t n = std::min(size, sizeof(buf_));
+        CHECK(read_(offset_, buf_, n, userData_));
+        for (size_t i = 0; i < n; ++i) {
+            buf_[i] = (uint8_t)buf_[i] + (uint8_t)data[i];
+        }
+        CHECK(output(buf_, n));
+        offset_ += n;
+        data += n;
+        size -= n;
+    }
+    return 0;
+}
+
+int DeltaPatcher::output(const char* data, size_t size) {
+    CHECK(write_(data, size, userData_));
+    targetOffset_ += size;
+    return 0;
+}
+
+} // particle
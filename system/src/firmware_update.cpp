@@ -37,9 +37,15 @@ LOG_SOURCE_CATEGORY("system.ota");
 #include "sha256.h"
 #endif // HAL_PLATFORM_RESUMABLE_OTA
 
+#if HAL_PLATFORM_COMPRESSED_OTA
+#include "inflate.h"
+#include "delta_patch.h"
+#endif // HAL_PLATFORM_COMPRESSED_OTA
+
 #include "spark_wiring_system.h"
 #include "spark_wiring_rgb.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdarg>
 
@@ -70,12 +76,35 @@ static_assert(OTA_FLASH_READ_BLOCK_SIZE >= Sha256::HASH_SIZE, "OTA_FLASH_READ_BL
 struct PersistentTransferState {
     char fileHash[Sha256::HASH_SIZE]; // SHA-256 of the update binary
     char partialHash[Sha256::HASH_SIZE]; // SHA-256 of the partially transferred data
+    char hashState[Sha256::STATE_SIZE]; // Intermediate state of the SHA-256 computation
     uint32_t fileSize; // Size of the update binary
     uint32_t partialSize; // Size of the partially transferred data
 } /* __attribute__((packed)) */;
 
 #endif // HAL_PLATFORM_RESUMABLE_OTA
 
+#if HAL_PLATFORM_COMPRESSED_OTA
+
+// The decoded data is written to the OTA section in blocks of this size
+const size_t DECODE_BUFFER_SIZE = 512;
+
+// Size of the data read from the OTA section when decoding the data that couldn't be decoded as
+// it was received
+const size_t DECODE_READ_BLOCK_SIZE = 256;
+
+// Maximum amount of the received data that is decoded per call to FirmwareUpdate::process()
+const size_t DECODE_MAX_CATCH_UP_SIZE = 4096;
+
+// The decoded module is stored in the OTA section after the received one. Its location is
+// aligned at the erase block boundary
+const size_t OTA_FLASH_ERASE_BLOCK_SIZE = 4096;
+
+inline size_t alignToEraseBlock(size_t size) {
+    return (size + OTA_FLASH_ERASE_BLOCK_SIZE - 1) / OTA_FLASH_ERASE_BLOCK_SIZE * OTA_FLASH_ERASE_BLOCK_SIZE;
+}
+
+#endif // HAL_PLATFORM_COMPRESSED_OTA
+
 } // namespace
 
 namespace detail {
@@ -102,6 +131,231 @@ struct TransferState {
 
 #endif // HAL_PLATFORM_RESUMABLE_OTA
 
+#if HAL_PLATFORM_COMPRESSED_OTA
+
+struct DecodeState {
+    char header[sizeof(module_info_t) + std::max(sizeof(compressed_module_header), sizeof(delta_module_header))]; // Module headers
+    char buf[DECODE_BUFFER_SIZE]; // Output buffer
+    inflate_ctx* inflate; // Decompressor instance
+    std::unique_ptr<DeltaPatcher> patcher; // Patcher instance
+    hal_module_t baseModule; // Installed module the patch is applied to
+    uintptr_t destAddr; // Address of the decoded module in the OTA section
+    size_t destSize; // Size of the decoded module
+    size_t destOffset; // Number of bytes of the decoded module written to flash
+    size_t erasedSize; // Number of bytes erased at the destination address
+    size_t bufSize; // Number of bytes in the output buffer
+    size_t headerSize; // Number of bytes of the module headers received
+    size_t expectedHeaderSize; // Size of the module headers
+    size_t skipSize; // Number of header bytes that still need to be skipped
+    size_t fileSize; // Size of the update binary
+    size_t fileOffset; // Offset of the next byte of the update binary to process
+    size_t availSize; // Size of the contiguous data received at the beginning of the OTA section
+    bool done; // Whether the module has been decoded
+
+    explicit DecodeState(size_t fileSize) :
+            inflate(nullptr),
+            baseModule(),
+            destAddr(0),
+            destSize(0),
+            destOffset(0),
+            erasedSize(0),
+            bufSize(0),
+            headerSize(0),
+            expectedHeaderSize(sizeof(module_info_t)),
+            skipSize(0),
+            fileSize(fileSize),
+            fileOffset(0),
+            availSize(0),
+            done(false) {
+    }
+
+    ~DecodeState() {
+        inflate_destroy(inflate);
+    }
+
+    // Collects the module headers. Returns 1 if all headers have been received
+    int readHeader(const char** data, size_t* size) {
+        while (headerSize < expectedHeaderSize && *size > 0) {
+            const size_t n = std::min(expectedHeaderSize - headerSize, *size);
+            memcpy(header + headerSize, *data, n);
+            headerSize += n;
+            *data += n;
+            *size -= n;
+            if (headerSize == sizeof(module_info_t)) {
+                module_info_t info = {};
+                memcpy(&info, header, sizeof(info));
+                const auto flags = info.flags & (MODULE_INFO_FLAG_COMPRESSED | MODULE_INFO_FLAG_DELTA | MODULE_INFO_FLAG_COMBINED);
+                if (flags == MODULE_INFO_FLAG_COMPRESSED) {
+                    expectedHeaderSize += sizeof(compressed_module_header);
+                } else if (flags == MODULE_INFO_FLAG_DELTA) {
+                    expectedHeaderSize += sizeof(delta_module_header);
+                } else {
+                    // Compressed patches and combined modules are not supported
+                    return SYSTEM_ERROR_NOT_SUPPORTED;
+                }
+            }
+        }
+        if (headerSize < expectedHeaderSize) {
+            return 0;
+        }
+        module_info_t info = {};
+        memcpy(&info, header, sizeof(info));
+        if (info.flags & MODULE_INFO_FLAG_COMPRESSED) {
+            CHECK(initInflate());
+        } else {
+            CHECK(initPatcher(info));
+        }
+        return 1;
+    }
+
+    int initInflate() {
+        compressed_module_header compHeader = {};
+        memcpy(&compHeader, header + sizeof(module_info_t), sizeof(compHeader));
+        if (compHeader.method != 0 /* Raw Deflate */ || compHeader.size < sizeof(compHeader) || !compHeader.original_size) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+        CHECK(initDest(compHeader.original_size));
+        inflate_opts opts = {};
+        opts.window_bits = compHeader.window_bits;
+        CHECK(inflate_create(&inflate, &opts, output, this));
+        skipSize = compHeader.size - sizeof(compHeader);
+        return 0;
+    }
+
+    int initPatcher(const module_info_t& info) {
+        delta_module_header deltaHeader = {};
+        memcpy(&deltaHeader, header + sizeof(module_info_t), sizeof(deltaHeader));
+        if (deltaHeader.method != 0 || deltaHeader.size < sizeof(deltaHeader) || !deltaHeader.original_size) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+        // Find the module the patch was made against
+        hal_system_info_t sysInfo = {};
+        sysInfo.size = sizeof(sysInfo);
+        HAL_System_Info(&sysInfo, true /* construct */, nullptr);
+        SCOPE_GUARD({
+            HAL_System_Info(&sysInfo, false, nullptr);
+        });
+        const hal_module_t* base = nullptr;
+        for (size_t i = 0; i < sysInfo.module_count; ++i) {
+            const auto& m = sysInfo.modules[i];
+            if (m.bounds.store == MODULE_STORE_MAIN && module_function(&m.info) == module_function(&info) &&
+                    module_index(&m.info) == module_index(&info) &&
+                    !((m.validity_checked & ~m.validity_result) & MODULE_VALIDATION_INTEGRITY) &&
+                    module_length(&m.info) + 4 /* CRC-32 */ == deltaHeader.base_size &&
+                    memcmp(m.suffix.sha, deltaHeader.base_hash, sizeof(deltaHeader.base_hash)) == 0) {
+                base = &m;
+                break;
+            }
+        }
+        if (!base) {
+            LOG(ERROR, "Base module not found");
+            return SYSTEM_ERROR_NOT_FOUND;
+        }
+        memcpy(&baseModule, base, sizeof(baseModule));
+        CHECK(initDest(deltaHeader.original_size));
+        patcher.reset(new(std::nothrow) DeltaPatcher());
+        if (!patcher) {
+            return SYSTEM_ERROR_NO_MEMORY;
+        }
+        patcher->init(deltaHeader.base_size, deltaHeader.original_size, readBase, writeTarget, this);
+        skipSize = deltaHeader.size - sizeof(deltaHeader);
+        return 0;
+    }
+
+    int initDest(size_t size) {
+        const size_t destOffs = alignToEraseBlock(fileSize);
+        if (destOffs + alignToEraseBlock(size) > HAL_OTA_FlashLength()) {
+            return SYSTEM_ERROR_TOO_LARGE;
+        }
+        destAddr = HAL_OTA_FlashAddress() + destOffs;
+        destSize = size;
+        return 0;
+    }
+
+    // Passes the module data to the decoder. Returns 1 if the module has been decoded
+    int decode(const char* data, size_t size) {
+        int r = 0;
+        if (inflate) {
+            // The compressed data is followed by the module suffix and CRC
+            while (size > 0 && r != INFLATE_DONE) {
+                size_t n = size;
+                r = CHECK(inflate_input(inflate, data, &n, INFLATE_HAS_MORE_INPUT | INFLATE_ALLOW_TRAILING_DATA));
+                data += n;
+                size -= n;
+            }
+            if (r != INFLATE_DONE) {
+                return 0;
+            }
+        } else if (patcher) {
+            CHECK(patcher->update(data, size));
+            if (!patcher->isDone()) {
+                return 0;
+            }
+        } else {
+            return SYSTEM_ERROR_INVALID_STATE;
+        }
+        CHECK(flush());
+        if (destOffset != destSize) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+        inflate_destroy(inflate);
+        inflate = nullptr;
+        patcher.reset();
+        done = true;
+        return 1;
+    }
+
+    int flush() {
+        if (!bufSize) {
+            return 0;
+        }
+        if (destOffset + bufSize > destSize) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+        while (erasedSize < destOffset + bufSize) {
+            CHECK_TRUE(HAL_FLASH_Begin(destAddr + erasedSize, OTA_FLASH_ERASE_BLOCK_SIZE, nullptr), SYSTEM_ERROR_FLASH_IO);
+            erasedSize += OTA_FLASH_ERASE_BLOCK_SIZE;
+        }
+        CHECK_TRUE(HAL_FLASH_Update((const uint8_t*)buf, destAddr + destOffset, bufSize, nullptr) == 0, SYSTEM_ERROR_FLASH_IO);
+        destOffset += bufSize;
+        bufSize = 0;
+        // Start erasing the next block in advance. The flash driver doesn't wait for the erasure to
+        // complete, so it proceeds while the next chunk of the update is being received
+        if (erasedSize - destOffset < OTA_FLASH_ERASE_BLOCK_SIZE && erasedSize < alignToEraseBlock(destSize)) {
+            CHECK_TRUE(HAL_FLASH_Begin(destAddr + erasedSize, OTA_FLASH_ERASE_BLOCK_SIZE, nullptr), SYSTEM_ERROR_FLASH_IO);
+            erasedSize += OTA_FLASH_ERASE_BLOCK_SIZE;
+        }
+        return 0;
+    }
+
+    static int output(const char* data, size_t size, void* userData) {
+        const auto self = (DecodeState*)userData;
+        size_t offs = 0;
+        while (offs < size) {
+            const size_t n = std::min(size - offs, sizeof(self->buf) - self->bufSize);
+            memcpy(self->buf + self->bufSize, data + offs, n);
+            self->bufSize += n;
+            offs += n;
+            if (self->bufSize == sizeof(self->buf)) {
+                CHECK(self->flush());
+            }
+        }
+        return size;
+    }
+
+    static int readBase(size_t offset, char* data, size_t size, void* userData) {
+        const auto self = (DecodeState*)userData;
+        return HAL_OTA_Read_Module(&self->baseModule, offset, (uint8_t*)data, size, nullptr);
+    }
+
+    static int writeTarget(const char* data, size_t size, void* userData) {
+        CHECK(output(data, size, userData));
+        return 0;
+    }
+};
+
+#endif // HAL_PLATFORM_COMPRESSED_OTA
+
 } // namespace detail
 
 FirmwareUpdate::FirmwareUpdate() :
@@ -160,6 +414,14 @@ int FirmwareUpdate::startUpdate(size_t fileSize, const char* fileHash, size_t* p
             return SYSTEM_ERROR_FLASH_IO;
         }
         system_set_flag(SYSTEM_FLAG_OTA_UPDATE_PENDING, 0, nullptr);
+#if HAL_PLATFORM_COMPRESSED_OTA
+        clearDecodeState();
+        // The data received before the transfer was interrupted is decoded in process()
+        const int r = initDecodeState(fileSize, fileOffset);
+        if (r < 0) {
+            decodeFailed(r);
+        }
+#endif // HAL_PLATFORM_COMPRESSED_OTA
         // TODO: Use the LED service for the update indication
         ledOverridden_ = LED_RGB_IsOverRidden();
         if (!ledOverridden_) {
@@ -204,6 +466,16 @@ int FirmwareUpdate::finishUpdate(FirmwareUpdateFlags flags) {
             if (r < 0 || discardData) {
                 clearTransferState();
             }
+#endif
+#if HAL_PLATFORM_COMPRESSED_OTA
+            if (r >= 0 && decodeState_) {
+                // Decode the data that was received out of order or hasn't been processed yet
+                decodeState_->availSize = decodeState_->fileSize;
+                const int ret = decodeReceivedData(decodeState_->fileSize);
+                if (ret < 0) {
+                    decodeFailed(ret);
+                }
+            }
 #endif
             if (r >= 0) {
                 // TODO: Cache the validation result so that it's not performed twice
@@ -251,6 +523,14 @@ int FirmwareUpdate::saveChunk(const char* chunkData, size_t chunkSize, size_t ch
             clearTransferState();
         }
     }
+#endif
+#if HAL_PLATFORM_COMPRESSED_OTA
+    if (decodeState_) {
+        r = updateDecodeState(chunkData, chunkSize, chunkOffset, partialSize);
+        if (r < 0) {
+            decodeFailed(r);
+        }
+    }
 #endif
     if (!ledOverridden_) {
         LED_Toggle(PARTICLE_LED_RGB);
@@ -282,6 +562,14 @@ void FirmwareUpdate::process() {
         }
     }
 #endif
+#if HAL_PLATFORM_COMPRESSED_OTA
+    if (decodeState_) {
+        const int r = decodeReceivedData(DECODE_MAX_CATCH_UP_SIZE);
+        if (r < 0) {
+            decodeFailed(r);
+        }
+    }
+#endif
 }
 
 FirmwareUpdate* FirmwareUpdate::instance() {
@@ -304,21 +592,37 @@ int FirmwareUpdate::initTransferState(size_t fileSize, const char* fileHash) {
     if (r == sizeof(PersistentTransferState)) {
         if (persist->fileSize == fileSize && persist->partialSize <= fileSize &&
                 memcmp(persist->fileHash, fileHash, Sha256::HASH_SIZE) == 0) {
-            // Compute the hash of the partially transferred data stored in the OTA section
-            CHECK(state->partialHash.start());
+            // Restore the SHA-256 context saved when the transfer was interrupted. The data stored in
+            // the OTA section is only rehashed if the saved context is not valid
             char buf[OTA_FLASH_READ_BLOCK_SIZE] = {};
-            uintptr_t addr = HAL_OTA_FlashAddress();
-            const uintptr_t endAddr = addr + persist->partialSize;
-            while (addr < endAddr) {
-                const size_t n = std::min(endAddr - addr, sizeof(buf));
-                CHECK(HAL_OTA_Flash_Read(addr, (uint8_t*)buf, n));
-                CHECK(state->partialHash.update(buf, n));
-                addr += n;
+            if (persist->partialSize > 0) {
+                // Any error here means that the saved context can't be used
+                CHECK(state->partialHash.start());
+                if (state->partialHash.restoreState(persist->hashState) == 0 &&
+                        state->tempHash.copyFrom(state->partialHash) == 0 &&
+                        state->tempHash.finish(buf) == 0 &&
+                        memcmp(persist->partialHash, buf, Sha256::HASH_SIZE) == 0) {
+                    resumeTransfer = true;
+                } else {
+                    LOG(WARN, "Saved SHA-256 context is not valid");
+                }
             }
-            CHECK(state->tempHash.copyFrom(state->partialHash));
-            CHECK(state->tempHash.finish(buf));
-            if (memcmp(persist->partialHash, buf, Sha256::HASH_SIZE) == 0) {
-                resumeTransfer = true;
+            if (!resumeTransfer) {
+                // Compute the hash of the partially transferred data stored in the OTA section
+                CHECK(state->partialHash.start());
+                uintptr_t addr = HAL_OTA_FlashAddress();
+                const uintptr_t endAddr = addr + persist->partialSize;
+                while (addr < endAddr) {
+                    const size_t n = std::min(endAddr - addr, sizeof(buf));
+                    CHECK(HAL_OTA_Flash_Read(addr, (uint8_t*)buf, n));
+                    CHECK(state->partialHash.update(buf, n));
+                    addr += n;
+                }
+                CHECK(state->tempHash.copyFrom(state->partialHash));
+                CHECK(state->tempHash.finish(buf));
+                if (memcmp(persist->partialHash, buf, Sha256::HASH_SIZE) == 0) {
+                    resumeTransfer = true;
+                }
             }
         }
     } else if (r < 0 && r != SYSTEM_ERROR_NOT_FOUND && r != SYSTEM_ERROR_BAD_DATA) {
@@ -328,6 +632,7 @@ int FirmwareUpdate::initTransferState(size_t fileSize, const char* fileHash) {
         state->file.clear();
         memcpy(persist->fileHash, fileHash, Sha256::HASH_SIZE);
         memset(persist->partialHash, 0, Sha256::HASH_SIZE);
+        memset(persist->hashState, 0, Sha256::STATE_SIZE);
         persist->fileSize = fileSize;
         persist->partialSize = 0;
         CHECK(state->partialHash.start()); // Reset SHA-256 context
@@ -373,6 +678,9 @@ int FirmwareUpdate::updateTransferState(const char* chunkData, size_t chunkSize,
     if (persist->partialSize > partialSizeBefore) {
         CHECK(state->tempHash.copyFrom(state->partialHash));
         CHECK(state->tempHash.finish(persist->partialHash));
+        // Save the SHA-256 context so that the data received so far doesn't need to be rehashed
+        // if the transfer is resumed after a reset
+        CHECK(state->partialHash.saveState(persist->hashState));
         CHECK(state->file.save(persist, sizeof(PersistentTransferState)));
         // Avoid syncing the file on the very first chunk received
         if (partialSizeBefore == state->startOffset) {
@@ -417,12 +725,104 @@ void FirmwareUpdate::clearTransferState() {
 
 #endif // HAL_PLATFORM_RESUMABLE_OTA
 
+#if HAL_PLATFORM_COMPRESSED_OTA
+
+int FirmwareUpdate::initDecodeState(size_t fileSize, size_t partialSize) {
+    std::unique_ptr<detail::DecodeState> state(new(std::nothrow) detail::DecodeState(fileSize));
+    if (!state) {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    state->availSize = partialSize;
+    decodeState_ = std::move(state);
+    return 0;
+}
+
+int FirmwareUpdate::updateDecodeState(const char* chunkData, size_t chunkSize, size_t chunkOffset, size_t partialSize) {
+    const auto state = decodeState_.get();
+    if (!state) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    if (partialSize > state->availSize) {
+        state->availSize = std::min(partialSize, state->fileSize);
+    }
+    if (chunkOffset <= state->availSize && chunkOffset + chunkSize > state->availSize) {
+        state->availSize = std::min(chunkOffset + chunkSize, state->fileSize);
+    }
+    if (state->done || chunkOffset > state->fileOffset || chunkOffset + chunkSize <= state->fileOffset) {
+        // A chunk that was received out of order is decoded from flash once the preceding data
+        // has been received
+        return 0;
+    }
+    const size_t skip = state->fileOffset - chunkOffset;
+    return decodeData(chunkData + skip, chunkSize - skip);
+}
+
+int FirmwareUpdate::decodeReceivedData(size_t maxSize) {
+    const auto state = decodeState_.get();
+    if (!state) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
+    char buf[DECODE_READ_BLOCK_SIZE] = {};
+    size_t size = 0;
+    while (!state->done && state->fileOffset < state->availSize && size < maxSize) {
+        const size_t n = std::min(state->availSize - state->fileOffset, sizeof(buf));
+        CHECK(HAL_OTA_Flash_Read(HAL_OTA_FlashAddress() + state->fileOffset, (uint8_t*)buf, n));
+        CHECK(decodeData(buf, n));
+        size += n;
+    }
+    return 0;
+}
+
+int FirmwareUpdate::decodeData(const char* data, size_t size) {
+    const auto state = decodeState_.get();
+    state->fileOffset += size;
+    if (!state->inflate && !state->patcher) {
+        const int r = CHECK(state->readHeader(&data, &size));
+        if (!r) {
+            return 0;
+        }
+    }
+    if (state->skipSize > 0) {
+        const size_t n = std::min(state->skipSize, size);
+        state->skipSize -= n;
+        data += n;
+        size -= n;
+    }
+    if (size > 0 && CHECK(state->decode(data, size))) {
+        CHECK(HAL_OTA_Set_Decoded_Module(state->destAddr, state->destSize, nullptr));
+        LOG(TRACE, "Decoded module size: %u", (unsigned)state->destSize);
+    }
+    return 0;
+}
+
+void FirmwareUpdate::decodeFailed(int error) {
+    // Not a critical error for compressed modules, they will be decompressed when applied
+    if (error != SYSTEM_ERROR_NOT_SUPPORTED) {
+        LOG(ERROR, "Failed to decode firmware data: %d", error);
+    }
+    clearDecodeState();
+}
+
+void FirmwareUpdate::clearDecodeState() {
+    decodeState_.reset();
+    HAL_OTA_Set_Decoded_Module(0 /* address */, 0 /* size */, nullptr /* reserved */);
+}
+
+#endif // HAL_PLATFORM_COMPRESSED_OTA
+
 void FirmwareUpdate::endUpdate(bool ok) {
     if (!updating_) {
         return;
     }
 #if HAL_PLATFORM_RESUMABLE_OTA
     transferState_.reset();
+#endif
+#if HAL_PLATFORM_COMPRESSED_OTA
+    if (ok) {
+        decodeState_.reset();
+    } else {
+        clearDecodeState();
+    }
 #endif
     if (!ledOverridden_) {
         RGB.control(false);
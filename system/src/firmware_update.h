@@ -34,6 +34,10 @@ namespace detail {
 struct TransferState;
 #endif
 
+#if HAL_PLATFORM_COMPRESSED_OTA
+struct DecodeState;
+#endif
+
 } // namespace detail
 
 /**
@@ -101,6 +105,17 @@ private:
     void clearTransferState();
 #endif
 
+#if HAL_PLATFORM_COMPRESSED_OTA
+    std::unique_ptr<detail::DecodeState> decodeState_; // Decoding state for compressed and delta modules
+
+    int initDecodeState(size_t fileSize, size_t partialSize);
+    int updateDecodeState(const char* chunkData, size_t chunkSize, size_t chunkOffset, size_t partialSize);
+    int decodeReceivedData(size_t maxSize);
+    int decodeData(const char* data, size_t size);
+    void decodeFailed(int error);
+    void clearDecodeState();
+#endif
+
     FirmwareUpdate();
 
     void endUpdate(bool ok);
@@ -27,6 +27,11 @@
 #include "spark_wiring_ticks.h"
 #include "system_network_diagnostics.h"
 
+#if HAL_PLATFORM_IFAPI
+#include "ifapi.h"
+#include "system_network.h"
+#endif
+
 #if Wiring_WiFi
 #include "spark_wiring_wifi.h"
 #include "system_network_wifi.h"
@@ -358,7 +363,103 @@ public:
         return result;
     }
 } g_networkCellularCellGlobalIdentityCellIdDiagnosticData;
+
+#if HAL_PLATFORM_IFAPI
+int getPppStats(if_req_ppp_stats& stats)
+{
+    if_t iface = nullptr;
+    CHECK_TRUE(if_get_by_index(NETWORK_INTERFACE_CELLULAR, &iface) == 0, SYSTEM_ERROR_NOT_FOUND);
+    CHECK_TRUE(if_request(iface, IF_REQ_PPP_STATS, &stats, sizeof(stats), nullptr) == 0,
+               SYSTEM_ERROR_NOT_SUPPORTED);
+    return SYSTEM_ERROR_NONE;
+}
+
+class NetworkPppHeaderBytesSavedDiagnosticData : public AbstractIntegerDiagnosticData
+{
+public:
+    NetworkPppHeaderBytesSavedDiagnosticData()
+        : AbstractIntegerDiagnosticData(DIAG_ID_NETWORK_PPP_HEADER_BYTES_SAVED,
+                                        DIAG_NAME_NETWORK_PPP_HEADER_BYTES_SAVED)
+    {
+    }
+
+    virtual int get(IntType& val)
+    {
+        if_req_ppp_stats stats = {};
+        CHECK(getPppStats(stats));
+        val = static_cast<IntType>(stats.tx_hdr_saved);
+
+        return SYSTEM_ERROR_NONE;
+    }
+} g_networkPppHeaderBytesSavedDiagnosticData;
+
+class NetworkPppVjBytesSavedDiagnosticData : public AbstractIntegerDiagnosticData
+{
+public:
+    NetworkPppVjBytesSavedDiagnosticData()
+        : AbstractIntegerDiagnosticData(DIAG_ID_NETWORK_PPP_VJ_BYTES_SAVED,
+                                        DIAG_NAME_NETWORK_PPP_VJ_BYTES_SAVED)
+    {
+    }
+
+    virtual int get(IntType& val)
+    {
+        if_req_ppp_stats stats = {};
+        CHECK(getPppStats(stats));
+        val = static_cast<IntType>(stats.tx_vj_saved);
+
+        return SYSTEM_ERROR_NONE;
+    }
+} g_networkPppVjBytesSavedDiagnosticData;
+#endif // HAL_PLATFORM_IFAPI
 #endif // HAL_PLATFORM_CELLULAR
+
+#if HAL_PLATFORM_IFAPI
+class NetworkMempDiagnosticData : public AbstractIntegerDiagnosticData
+{
+public:
+    typedef uint32_t (*Getter)(const if_req_memp_stats&);
+
+    NetworkMempDiagnosticData(DiagnosticDataId id, const char* name, if_memp_pool_t pool, Getter getter)
+        : AbstractIntegerDiagnosticData(id, name),
+          pool_(pool),
+          getter_(getter)
+    {
+    }
+
+    virtual int get(IntType& val)
+    {
+        if_req_memp_stats stats = {};
+        stats.pool = pool_;
+        // The pools are shared by all interfaces
+        CHECK_TRUE(if_request(nullptr, IF_REQ_MEMP_STATS, &stats, sizeof(stats), nullptr) == 0,
+                   SYSTEM_ERROR_NOT_SUPPORTED);
+        val = static_cast<IntType>(getter_(stats));
+
+        return SYSTEM_ERROR_NONE;
+    }
+
+private:
+    if_memp_pool_t pool_;
+    Getter getter_;
+};
+
+NetworkMempDiagnosticData g_networkMempPbufHighWaterMarkDiagData(
+    DIAG_ID_NETWORK_MEMP_PBUF_HIGH_WATER_MARK, DIAG_NAME_NETWORK_MEMP_PBUF_HIGH_WATER_MARK,
+    IF_MEMP_POOL_PBUF, [](const if_req_memp_stats& s) -> uint32_t { return s.max; });
+NetworkMempDiagnosticData g_networkMempPbufErrorsDiagData(
+    DIAG_ID_NETWORK_MEMP_PBUF_ERRORS, DIAG_NAME_NETWORK_MEMP_PBUF_ERRORS,
+    IF_MEMP_POOL_PBUF, [](const if_req_memp_stats& s) -> uint32_t { return s.err; });
+NetworkMempDiagnosticData g_networkMempPbufStallTimeDiagData(
+    DIAG_ID_NETWORK_MEMP_PBUF_STALL_TIME, DIAG_NAME_NETWORK_MEMP_PBUF_STALL_TIME,
+    IF_MEMP_POOL_PBUF, [](const if_req_memp_stats& s) -> uint32_t { return s.stall_time; });
+NetworkMempDiagnosticData g_networkMempTcpSegHighWaterMarkDiagData(
+    DIAG_ID_NETWORK_MEMP_TCP_SEG_HIGH_WATER_MARK, DIAG_NAME_NETWORK_MEMP_TCP_SEG_HIGH_WATER_MARK,
+    IF_MEMP_POOL_TCP_SEG, [](const if_req_memp_stats& s) -> uint32_t { return s.max; });
+NetworkMempDiagnosticData g_networkMempTcpSegErrorsDiagData(
+    DIAG_ID_NETWORK_MEMP_TCP_SEG_ERRORS, DIAG_NAME_NETWORK_MEMP_TCP_SEG_ERRORS,
+    IF_MEMP_POOL_TCP_SEG, [](const if_req_memp_stats& s) -> uint32_t { return s.err; });
+#endif // HAL_PLATFORM_IFAPI
 } // namespace
 
 #endif // Wiring_Network
@@ -41,6 +41,7 @@
 #include "wlan_hal.h"
 #include "delay_hal.h"
 #include "timer_hal.h"
+#include "eeprom_hal.h"
 #include "rgbled.h"
 #include "service_debug.h"
 #include "cellular_hal.h"
@@ -494,6 +495,8 @@ void Spark_Idle_Events(bool force_events/*=false*/)
     {
         system_pending_shutdown(RESET_REASON_USER);
     }
+    // Write the EEPROM changes that have been pending for long enough
+    hal_eeprom_flush(false /* force */, nullptr);
 #if HAL_PLATFORM_BLE
     // TODO: Process BLE channel events in a separate thread
     system::SystemControl::instance()->run();
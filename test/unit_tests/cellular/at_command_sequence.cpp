@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/virtual_modem.h"
+
+#include "ncp/at_parser/at_parser.h"
+#include "ncp/at_parser/at_response.h"
+#include "ncp/cellular/at_command_sequence.h"
+
+#include "timer_hal.h"
+
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include "catch2/catch.hpp"
+
+namespace {
+
+using namespace particle;
+using namespace particle::test;
+
+using Cmds = std::vector<std::string>;
+
+const AtSequenceStep INIT_STEPS[] = {
+    { "AT+COPS=3,2", nullptr, nullptr, AtSequenceStep::OPTIONAL | AtSequenceStep::BATCH, 0 },
+    { "AT+CGEREP=1,0", nullptr, nullptr, AtSequenceStep::BATCH, 0 },
+    { "AT+UPSV=0", nullptr, nullptr, AtSequenceStep::BATCH, 0 },
+    { "AT+CPSMS=0", "AT+CPSMS?", "+CPSMS:0", AtSequenceStep::PERSISTENT, 0 },
+    { "AT+URAT=7", "AT+URAT?", "+URAT: 7", AtSequenceStep::PERSISTENT, 0 },
+    { "AT+QCFG=\"cmux/urcport\",1", nullptr, nullptr, AtSequenceStep::OPTIONAL | AtSequenceStep::BATCH, 0 },
+    { "AT+CGPIAF=1,1,1,1", nullptr, nullptr, AtSequenceStep::BATCH | AtSequenceStep::PERSISTENT, 0 }
+};
+
+const size_t INIT_STEP_COUNT = sizeof(INIT_STEPS) / sizeof(INIT_STEPS[0]);
+
+void addInitScript(VirtualModem& modem, unsigned delay = 0) {
+    modem.on("AT+COPS=3,2", "OK", delay)
+        .on("AT+CGEREP=1,0", "OK", delay)
+        .on("AT+UPSV=0", "OK", delay)
+        .on("AT+CPSMS?", "+CPSMS:1,,,\"00010011\",\"00000011\"\r\nOK", delay)
+        .on("AT+CPSMS=0", "OK", delay)
+        .on("AT+URAT?", "+URAT: 7\r\nOK", delay)
+        .on("AT+URAT=7", "OK", delay)
+        .on("AT+QCFG=\"cmux/urcport\",1", "OK", delay)
+        .on("AT+CGPIAF=1,1,1,1", "OK", delay);
+}
+
+void initParser(AtParser& parser, VirtualModem& modem) {
+    REQUIRE(parser.init(AtParserConfig().stream(&modem).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+}
+
+} // unnamed
+
+TEST_CASE("AtCommandSequence") {
+    VirtualModem modem;
+    AtParser parser;
+    initParser(parser, modem);
+
+    SECTION("concatenates adjacent batchable commands") {
+        addInitScript(modem);
+        AtCommandSequence seq(&parser, INIT_STEPS, INIT_STEP_COUNT);
+        CHECK(seq.run() == AtResponse::OK);
+        CHECK(modem.commands() == Cmds({ "AT+COPS=3,2;+CGEREP=1,0;+UPSV=0", "AT+CPSMS?", "AT+CPSMS=0", "AT+URAT?",
+                "AT+QCFG=\"cmux/urcport\",1;+CGPIAF=1,1,1,1" }));
+        CHECK(seq.commandsSent() == 5);
+        CHECK(seq.stepsSkipped() == 1); // AT+URAT=7
+        CHECK(seq.stats(0).batched);
+        CHECK(seq.stats(2).batched);
+        CHECK_FALSE(seq.stats(3).batched);
+        CHECK(seq.stats(4).skipped);
+        // Persistent steps are recorded as applied
+        CHECK(seq.appliedMask() == ((1u << 3) | (1u << 4) | (1u << 6)));
+    }
+
+    SECTION("rechecks persistent steps that are known to be applied if they have a query") {
+        addInitScript(modem);
+        AtCommandSequence seq(&parser, INIT_STEPS, INIT_STEP_COUNT);
+        seq.appliedMask((1u << 3) | (1u << 4) | (1u << 6));
+        CHECK(seq.run() == AtResponse::OK);
+        // The settings that can be queried are checked anyway: PSM has been enabled by other means
+        CHECK(modem.commands() == Cmds({ "AT+COPS=3,2;+CGEREP=1,0;+UPSV=0", "AT+CPSMS?", "AT+CPSMS=0", "AT+URAT?",
+                "AT+QCFG=\"cmux/urcport\",1" }));
+        CHECK(seq.stepsSkipped() == 2); // AT+URAT=7, AT+CGPIAF=1,1,1,1
+    }
+
+    SECTION("retries the commands of a failed batch one by one") {
+        modem.on("AT+COPS=3,2", "ERROR", 0, 1);
+        addInitScript(modem);
+        AtCommandSequence seq(&parser, INIT_STEPS, 3);
+        CHECK(seq.run() == AtResponse::OK); // AT+COPS=3,2 is optional
+        CHECK(modem.commands() == Cmds({ "AT+COPS=3,2;+CGEREP=1,0;+UPSV=0", "AT+COPS=3,2", "AT+CGEREP=1,0", "AT+UPSV=0" }));
+        CHECK_FALSE(seq.stats(1).batched);
+    }
+
+    SECTION("stops at the first mandatory command that fails") {
+        modem.on("AT+COPS=3,2", "OK").on("AT+UPSV=0", "OK").on("AT+CGEREP=1,0", "+CME ERROR: 3");
+        AtCommandSequence seq(&parser, INIT_STEPS, INIT_STEP_COUNT);
+        CHECK(seq.run() == AtResponse::CME_ERROR);
+        CHECK(modem.commands() == Cmds({ "AT+COPS=3,2;+CGEREP=1,0;+UPSV=0", "AT+COPS=3,2", "AT+CGEREP=1,0" }));
+    }
+}
+
+TEST_CASE("AtCommandSequence benchmark", "[.][benchmark]") {
+    const unsigned delay = 20; // Modem response time
+    std::ostringstream s;
+    uint32_t applied = 0;
+    for (const char* name: { "sequential", "cold", "warm" }) {
+        VirtualModem modem;
+        addInitScript(modem, delay);
+        AtParser parser;
+        initParser(parser, modem);
+        const auto t = HAL_Timer_Get_Milli_Seconds();
+        if (std::string(name) == "sequential") {
+            // Every command is sent on its own and waits for OK
+            for (size_t i = 0; i < INIT_STEP_COUNT; ++i) {
+                if (INIT_STEPS[i].query) {
+                    auto resp = parser.sendCommand("%s", INIT_STEPS[i].query);
+                    REQUIRE(resp.readResult() == AtResponse::OK);
+                }
+                REQUIRE(parser.execCommand("%s", INIT_STEPS[i].cmd) == AtResponse::OK);
+            }
+        } else {
+            AtCommandSequence seq(&parser, INIT_STEPS, INIT_STEP_COUNT);
+            seq.appliedMask(applied);
+            REQUIRE(seq.run() == AtResponse::OK);
+            applied = seq.appliedMask();
+        }
+        s << name << ": " << (HAL_Timer_Get_Milli_Seconds() - t) << " ms, " << modem.commands().size() << " command lines\n";
+    }
+    WARN(s.str());
+}
@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ncp/at_parser/at_parser.h"
+#include "ncp/at_parser/at_command.h"
+#include "ncp/at_parser/at_response.h"
+
+#include "stream.h"
+#include "c_string.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+#include "catch2/catch.hpp"
+
+namespace {
+
+using namespace particle;
+
+// In-memory stream that replays a recorded modem transcript: each time the DTE sends the
+// expected command line, the recorded response is made available for reading
+class TranscriptStream: public Stream {
+public:
+    explicit TranscriptStream(size_t maxReadSize = 0) :
+            maxReadSize_(maxReadSize),
+            readCount_(0) {
+    }
+
+    TranscriptStream& expect(std::string cmd, std::string resp) {
+        steps_.push_back({ std::move(cmd), std::move(resp) });
+        return *this;
+    }
+
+    TranscriptStream& urc(const std::string& data) {
+        in_ += data;
+        return *this;
+    }
+
+    int read(char* data, size_t size) override {
+        size_t n = std::min(size, in_.size());
+        if (maxReadSize_ > 0) {
+            n = std::min(n, maxReadSize_);
+        }
+        if (data) {
+            memcpy(data, in_.data(), n);
+        }
+        in_.erase(0, n);
+        ++readCount_;
+        return n;
+    }
+
+    int peek(char* data, size_t size) override {
+        const size_t n = std::min(size, in_.size());
+        memcpy(data, in_.data(), n);
+        return n;
+    }
+
+    int skip(size_t size) override {
+        return read(nullptr, size);
+    }
+
+    int availForRead() override {
+        return in_.size();
+    }
+
+    int write(const char* data, size_t size) override {
+        out_.append(data, size);
+        // Commands are terminated with CRLF
+        size_t pos = 0;
+        while ((pos = out_.find("\r\n")) != std::string::npos) {
+            const std::string cmd = out_.substr(0, pos);
+            out_.erase(0, pos + 2);
+            if (!steps_.empty() && steps_.front().cmd == cmd) {
+                in_ += cmd + "\r\n" + steps_.front().resp; // Echo and response
+                steps_.pop_front();
+            }
+        }
+        return size;
+    }
+
+    int flush() override {
+        return 0;
+    }
+
+    int availForWrite() override {
+        return 1024;
+    }
+
+    int waitEvent(unsigned flags, unsigned timeout) override {
+        if ((flags & Stream::READABLE) && !in_.empty()) {
+            return Stream::READABLE;
+        }
+        if (flags & Stream::WRITABLE) {
+            return Stream::WRITABLE;
+        }
+        return SYSTEM_ERROR_TIMEOUT;
+    }
+
+    size_t readCount() const {
+        return readCount_;
+    }
+
+    bool done() const {
+        return steps_.empty();
+    }
+
+private:
+    struct Step {
+        std::string cmd;
+        std::string resp;
+    };
+
+    std::deque<Step> steps_;
+    std::string in_;
+    std::string out_;
+    size_t maxReadSize_;
+    size_t readCount_;
+};
+
+struct UrcCounter {
+    std::string prefix;
+    std::string line;
+    int count = 0;
+};
+
+int countUrc(AtResponseReader* reader, const char* prefix, void* data) {
+    const auto c = static_cast<UrcCounter*>(data);
+    c->prefix = prefix;
+    char buf[64] = {};
+    const int n = reader->readLine(buf, sizeof(buf));
+    if (n >= 0) {
+        c->line = buf;
+    }
+    ++c->count;
+    return 0;
+}
+
+// Abridged transcript of a SARA-R410 initialization sequence
+const char* const COPS_RESPONSE = "+COPS: (2,\"AT&T\",\"AT&T\",\"310410\",7),(1,\"T-Mobile\",\"T-Mobile\",\"310260\",7),"
+        "(1,\"Verizon Wireless\",\"Verizon\",\"311480\",7),(3,\"Sprint\",\"Sprint\",\"310120\",7),,(0,1,2,3,4),(0,1,2)\r\n";
+
+void addInitTranscript(TranscriptStream& strm) {
+    strm.expect("AT", "OK\r\n")
+        .expect("AT+CMEE=2", "OK\r\n")
+        .expect("AT+CGMI", "u-blox\r\nOK\r\n")
+        .expect("AT+CGMM", "SARA-R410M-02B\r\nOK\r\n")
+        .expect("AT+CCID", "+CCID: 89014103271226997000\r\nOK\r\n")
+        .expect("AT+CGDCONT?", "+CGDCONT: 1,\"IP\",\"10569.mcs\",\"10.170.32.100\",0,0,0,0\r\n"
+                "+CGDCONT: 2,\"IPV4V6\",\"ims\",\"\",0,0,0,0\r\nOK\r\n")
+        .expect("AT+COPS=?", std::string(COPS_RESPONSE) + "\r\nOK\r\n")
+        .expect("AT+CEREG?", "+CEREG: 2,5,\"2C2D\",\"A2E4D0B\",7\r\nOK\r\n");
+}
+
+} // unnamed
+
+TEST_CASE("AtParser") {
+    SECTION("dispatches URCs to the handler with the longest matching prefix") {
+        TranscriptStream strm(7);
+        AtParser parser;
+        REQUIRE(parser.init(AtParserConfig().stream(&strm).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+        UrcCounter creg, cereg, plus, uusord;
+        REQUIRE(parser.addUrcHandler("+CREG", countUrc, &creg) == 0);
+        REQUIRE(parser.addUrcHandler("+CEREG", countUrc, &cereg) == 0);
+        REQUIRE(parser.addUrcHandler("+C", countUrc, &plus) == 0);
+        REQUIRE(parser.addUrcHandler("+UUSORD", countUrc, &uusord) == 0);
+        strm.urc("+CEREG: 5\r\n+CREG: 1\r\n+CGEV: ME PDN ACT 1\r\n+UUSORD: 0,32\r\n+UNKNOWN: 1\r\n+CREG: 2\r\n");
+        while (parser.processUrc(0) > 0) {
+        }
+        CHECK(cereg.count == 1);
+        CHECK(cereg.line == "+CEREG: 5");
+        CHECK(creg.count == 2);
+        CHECK(creg.line == "+CREG: 2");
+        CHECK(plus.count == 1);
+        CHECK(plus.line == "+CGEV: ME PDN ACT 1");
+        CHECK(uusord.count == 1);
+        CHECK(uusord.prefix == "+UUSORD");
+    }
+
+    SECTION("stops dispatching URCs to a removed handler") {
+        TranscriptStream strm;
+        AtParser parser;
+        REQUIRE(parser.init(AtParserConfig().stream(&strm).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+        UrcCounter creg, cereg;
+        REQUIRE(parser.addUrcHandler("+CREG", countUrc, &creg) == 0);
+        REQUIRE(parser.addUrcHandler("+CEREG", countUrc, &cereg) == 0);
+        parser.removeUrcHandler("+CREG");
+        strm.urc("+CREG: 1\r\n+CEREG: 1\r\n");
+        while (parser.processUrc(0) > 0) {
+        }
+        CHECK(creg.count == 0);
+        CHECK(cereg.count == 1);
+    }
+
+    SECTION("rejects an input buffer that is too small") {
+        TranscriptStream strm;
+        AtParser parser;
+        CHECK(parser.init(AtParserConfig().stream(&strm).inputBufferSize(8)) == SYSTEM_ERROR_INVALID_ARGUMENT);
+    }
+
+    SECTION("reads long response lines in chunks") {
+        TranscriptStream strm(16);
+        AtParser parser;
+        REQUIRE(parser.init(AtParserConfig().stream(&strm).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+        strm.expect("AT+COPS=?", std::string(COPS_RESPONSE) + "\r\nOK\r\n");
+        auto resp = parser.sendCommand("AT+COPS=?");
+        REQUIRE(resp.hasNextLine());
+        std::string line;
+        char buf[10];
+        int n = 0;
+        while ((n = resp.read(buf, sizeof(buf))) > 0) {
+            line.append(buf, n);
+        }
+        CHECK(n == 0);
+        CHECK(line + "\r\n" == COPS_RESPONSE);
+        CHECK(resp.read(buf, sizeof(buf)) == 0);
+        CHECK(resp.readResult() == AtResponse::OK);
+    }
+
+    SECTION("replays a recorded initialization transcript") {
+        for (size_t bufSize: { (size_t)AtParserConfig::DEFAULT_INPUT_BUFFER_SIZE, (size_t)256 }) {
+            TranscriptStream strm;
+            addInitTranscript(strm);
+            AtParser parser;
+            REQUIRE(parser.init(AtParserConfig().stream(&strm).commandTerminator(AtCommandTerminator::CRLF).inputBufferSize(bufSize)) == 0);
+            CHECK(parser.execCommand("AT") == AtResponse::OK);
+            CHECK(parser.execCommand("AT+CMEE=2") == AtResponse::OK);
+            auto resp = parser.sendCommand("AT+CGMI");
+            CHECK(std::string(resp.readLine()) == "u-blox");
+            CHECK(resp.readResult() == AtResponse::OK);
+            resp = parser.sendCommand("AT+CGMM");
+            CHECK(std::string(resp.readLine()) == "SARA-R410M-02B");
+            CHECK(resp.readResult() == AtResponse::OK);
+            resp = parser.sendCommand("AT+CCID");
+            char iccid[32] = {};
+            CHECK(resp.scanf("+CCID: %31s", iccid) == 1);
+            CHECK(strcmp(iccid, "89014103271226997000") == 0);
+            CHECK(resp.readResult() == AtResponse::OK);
+            resp = parser.sendCommand("AT+CGDCONT?");
+            int lines = 0;
+            while (resp.hasNextLine()) {
+                CHECK(std::string(resp.readLine()).find("+CGDCONT: ") == 0);
+                ++lines;
+            }
+            CHECK(lines == 2);
+            CHECK(resp.readResult() == AtResponse::OK);
+            resp = parser.sendCommand("AT+COPS=?");
+            CHECK(std::string(resp.readLine()) + "\r\n" == COPS_RESPONSE);
+            CHECK(resp.readResult() == AtResponse::OK);
+            resp = parser.sendCommand("AT+CEREG?");
+            int n = 0, stat = 0;
+            CHECK(resp.scanf("+CEREG: %d,%d", &n, &stat) == 2);
+            CHECK(stat == 5);
+            CHECK(resp.readResult() == AtResponse::OK);
+            CHECK(strm.done());
+        }
+    }
+}
+
+TEST_CASE("AtParser benchmark", "[.][benchmark]") {
+    const unsigned ITERATIONS = 2000;
+    const char* const URCS[] = { "+CREG", "+CGREG", "+CEREG", "+UUSORD", "+UUSORF", "+UUSOCL", "+UUPSDD",
+            "+UUPSDA", "+UUSOLI", "+CIEV", "+UUSIMSTAT", "+UUFWINSTALL", "+QIURC", "+QIND", "+CMTI", "+CGEV" };
+    for (size_t bufSize: { (size_t)AtParserConfig::DEFAULT_INPUT_BUFFER_SIZE, (size_t)256, (size_t)1024 }) {
+        size_t reads = 0;
+        const auto t1 = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < ITERATIONS; ++i) {
+            TranscriptStream strm;
+            addInitTranscript(strm);
+            strm.urc("+CEREG: 2\r\n+UUSORD: 0,64\r\n+CIEV: 2,3\r\n+CGEV: ME PDN ACT 1\r\n");
+            AtParser parser;
+            parser.init(AtParserConfig().stream(&strm).commandTerminator(AtCommandTerminator::CRLF).inputBufferSize(bufSize));
+            UrcCounter c;
+            for (const auto prefix: URCS) {
+                parser.addUrcHandler(prefix, countUrc, &c);
+            }
+            while (parser.processUrc(0) > 0) {
+            }
+            for (const auto cmd: { "AT", "AT+CMEE=2", "AT+CGMI", "AT+CGMM", "AT+CCID", "AT+CGDCONT?", "AT+COPS=?", "AT+CEREG?" }) {
+                auto resp = parser.sendCommand("%s", cmd);
+                while (resp.hasNextLine()) {
+                    resp.readLine();
+                }
+                resp.readResult();
+            }
+            reads += strm.readCount();
+        }
+        const auto t2 = std::chrono::steady_clock::now();
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+        WARN("Input buffer: " << bufSize << " bytes, " << (double)us / ITERATIONS << " us per transcript, "
+                << (double)reads / ITERATIONS << " stream reads per transcript");
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/virtual_modem.h"
+
+#include "ncp/at_parser/at_parser.h"
+#include "ncp/at_parser/at_response.h"
+#include "ncp/cellular/cellular_ncp_common.h"
+
+#include <string>
+#include <limits>
+
+#include "catch2/catch.hpp"
+
+namespace {
+
+using namespace particle;
+using namespace particle::test;
+
+using LacType = decltype(CellularGlobalIdentity::location_area_code);
+using CidType = decltype(CellularGlobalIdentity::cell_id);
+
+const CellularNcpTraits R4_TRAITS = { 1, "IP", true, true, 1000 };
+const CellularNcpTraits BG96_TRAITS = { 1, "IP", false, false, 1000 };
+
+} // unnamed
+
+TEST_CASE("CellularNcpCommon") {
+    VirtualModem modem;
+    AtParser parser;
+    REQUIRE(parser.init(AtParserConfig().stream(&modem).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+    CellularGlobalIdentity cgi = {};
+    cgi.location_area_code = std::numeric_limits<LacType>::max();
+    cgi.cell_id = std::numeric_limits<CidType>::max();
+    int parserError = 0;
+    CellularNcpCommon common(&parser, &cgi, &parserError);
+    common.traits(&R4_TRAITS);
+
+    SECTION("processRegLine() handles URCs and query responses") {
+        CellularRegistrationStatus eps;
+        CellularRegUpdate update = {};
+        CHECK(common.processRegLine(CellularRegType::CEREG, "+CEREG: 2", CellularAccessTechnology::NONE, &eps, &update) == 0);
+        CHECK(eps.status() == CellularRegistrationStatus::SEARCHING);
+        CHECK(update.urc);
+        CHECK(update.changed);
+        CHECK_FALSE(update.registered);
+        CHECK(common.processRegLine(CellularRegType::CEREG, "+CEREG: 2,5,\"2C2D\",\"A2E4D0B\",7",
+                CellularAccessTechnology::NONE, &eps, &update) == 0);
+        CHECK(eps.status() == CellularRegistrationStatus::ROAMING);
+        CHECK_FALSE(update.urc);
+        CHECK(update.registered);
+        CHECK(cgi.location_area_code == 0x2c2d);
+        CHECK(cgi.cell_id == 0xa2e4d0b);
+        // Location of a 2G/3G cell is not reported via +CEREG
+        CHECK(common.processRegLine(CellularRegType::CEREG, "+CEREG: 5,\"1111\",\"2222\",0",
+                CellularAccessTechnology::NONE, &eps, &update) == 0);
+        CHECK_FALSE(update.changed);
+        CHECK(cgi.location_area_code == 0x2c2d);
+        CHECK(common.processRegLine(CellularRegType::CGREG, "+CGREG: 5,\"1111\",\"2222\"",
+                CellularAccessTechnology::UTRAN, &eps, &update) == 0);
+        CHECK(cgi.location_area_code == 0x1111);
+        // +CREG only sets the location if it's unset
+        CHECK(common.processRegLine(CellularRegType::CREG, "+CREG: 1,\"3333\",\"4444\"",
+                CellularAccessTechnology::UTRAN, &eps, &update) == 0);
+        CHECK(cgi.location_area_code == 0x1111);
+        CHECK(common.processRegLine(CellularRegType::CREG, "+CREG:", CellularAccessTechnology::NONE, &eps,
+                &update) == SYSTEM_ERROR_AT_RESPONSE_UNEXPECTED);
+    }
+
+    SECTION("queryOperator() parses the MCC, MNC and access technology") {
+        modem.on("AT+COPS=3,2", "OK").on("AT+COPS?", "+COPS: 0,2,\"310410\",7\r\nOK");
+        CellularSignalQuality qual;
+        CHECK(common.queryOperator(&qual) == 0);
+        CHECK(cgi.mobile_country_code == 310);
+        CHECK(cgi.mobile_network_code == 410);
+        CHECK_FALSE(cgi.cgi_flags & CGI_FLAG_TWO_DIGIT_MNC);
+        CHECK(qual.accessTechnology() == CellularAccessTechnology::LTE_CAT_M1);
+        common.traits(&BG96_TRAITS);
+        CHECK(common.queryOperator(&qual) == 0);
+        CHECK(qual.accessTechnology() == CellularAccessTechnology::LTE);
+    }
+
+    SECTION("queryOperator() fails if the modem rejects the command") {
+        CHECK(common.queryOperator() == SYSTEM_ERROR_AT_NOT_OK);
+        // This is not a parser error
+        CHECK(parserError == 0);
+    }
+
+    SECTION("configurePdpContext() adds the CHAP prefix if needed") {
+        modem.on("AT+CGDCONT=*", "OK");
+        CHECK(common.configurePdpContext("apn", true) == AtResponse::OK);
+        common.traits(&BG96_TRAITS);
+        CHECK(common.configurePdpContext("apn", true) == AtResponse::OK);
+        CHECK(common.configurePdpContext(nullptr, false) == AtResponse::OK);
+        CHECK(modem.commands() == std::vector<std::string>({ "AT+CGDCONT=1,\"IP\",\"CHAP:apn\"",
+                "AT+CGDCONT=1,\"IP\",\"apn\"", "AT+CGDCONT=1,\"IP\",\"\"" }));
+    }
+
+    SECTION("dial() waits for CONNECT") {
+        modem.on("ATD*99***1#", "CONNECT", 0, 1).on("ATD*99***1#", "NO CARRIER", 0, 1).on("ATD*99***1#", "BUSY");
+        CHECK(common.dial(&parser) == 0);
+        CHECK(common.dial(&parser) == SYSTEM_ERROR_NOT_ALLOWED);
+    }
+}
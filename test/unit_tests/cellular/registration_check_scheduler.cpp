@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ncp/cellular/registration_check_scheduler.h"
+
+#include "catch2/catch.hpp"
+
+using namespace particle;
+
+TEST_CASE("RegistrationCheckScheduler") {
+    RegistrationCheckScheduler s(15000, 60000);
+    s.reset(1000);
+
+    SECTION("polls at the minimum interval if no URCs are received and the state changes") {
+        CHECK_FALSE(s.checkDue(15999));
+        CHECK(s.checkDue(16000));
+        s.checked(true /* changed */, 16000);
+        CHECK(s.interval() == 15000);
+        CHECK(s.checkDue(31000));
+        CHECK(s.checksSent() == 1);
+        CHECK(s.checksAvoided() == 0);
+    }
+
+    SECTION("backs off while the state doesn't change") {
+        system_tick_t t = 1000;
+        for (system_tick_t interval: { 30000, 60000, 60000 }) {
+            t += s.interval();
+            REQUIRE(s.checkDue(t));
+            s.checked(false, t);
+            CHECK(s.interval() == interval);
+        }
+        // Polls that would have been sent at the minimum interval are counted as avoided
+        CHECK_FALSE(s.checkDue(t + 15000));
+        CHECK_FALSE(s.checkDue(t + 30000));
+        CHECK_FALSE(s.checkDue(t + 45000));
+        CHECK(s.checkDue(t + 60000));
+        CHECK(s.checksAvoided() == 3);
+        // A state change reported via URC resets the interval
+        s.urcReceived(true, t + 60000);
+        CHECK(s.interval() == 15000);
+        CHECK(s.urcCount() == 1);
+    }
+
+    SECTION("defers polls while URCs are received") {
+        for (system_tick_t t = 11000; t <= 61000; t += 10000) {
+            CHECK_FALSE(s.checkDue(t));
+            s.urcReceived(false, t);
+        }
+        CHECK(s.checksSent() == 0);
+        CHECK(s.checksAvoided() == 3);
+        CHECK(s.checkDue(76000));
+    }
+}
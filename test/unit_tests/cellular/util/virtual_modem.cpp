@@ -0,0 +1,483 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "virtual_modem.h"
+
+#include "system_error.h"
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+
+namespace particle {
+
+namespace test {
+
+namespace {
+
+const uint8_t CMUX_FLAG = 0xf9;
+const uint8_t CMUX_EA = 0x01;
+const uint8_t CMUX_CR = 0x02;
+const uint8_t CMUX_PF = 0x10;
+
+uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// TS 27.010, 5.2.1.6: CRC-8 with the reversed polynomial x^8 + x^2 + x + 1
+uint8_t cmuxFcs(const uint8_t* data, size_t size) {
+    uint8_t crc = 0xff;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; ++j) {
+            crc = (crc & 0x01) ? ((crc >> 1) ^ 0xe0) : (crc >> 1);
+        }
+    }
+    return 0xff - crc;
+}
+
+bool isLineEnd(char c) {
+    return c == '\r' || c == '\n';
+}
+
+bool endsWith(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // unnamed
+
+std::string encodeCmuxFrame(uint8_t dlci, uint8_t type, const std::string& data) {
+    std::string hdr;
+    hdr += (char)((dlci << 2) | CMUX_CR | CMUX_EA);
+    hdr += (char)(type | CMUX_PF);
+    if (data.size() < 128) {
+        hdr += (char)((data.size() << 1) | CMUX_EA);
+    } else {
+        hdr += (char)((data.size() & 0x7f) << 1);
+        hdr += (char)(data.size() >> 7);
+    }
+    std::string frame;
+    frame += (char)CMUX_FLAG;
+    frame += hdr;
+    frame += data;
+    frame += (char)cmuxFcs((const uint8_t*)hdr.data(), hdr.size());
+    frame += (char)CMUX_FLAG;
+    return frame;
+}
+
+bool decodeCmuxFrame(std::string* buf, CmuxFrame* frame) {
+    for (;;) {
+        // Skip everything up to the first byte following the opening flag
+        size_t pos = 0;
+        while (pos < buf->size() && (uint8_t)(*buf)[pos] != CMUX_FLAG) {
+            ++pos;
+        }
+        if (pos == buf->size()) {
+            buf->clear();
+            return false;
+        }
+        while (pos < buf->size() && (uint8_t)(*buf)[pos] == CMUX_FLAG) {
+            ++pos;
+        }
+        if (pos >= buf->size()) {
+            return false;
+        }
+        buf->erase(0, pos - 1); // Keep the opening flag
+        const auto p = (const uint8_t*)buf->data();
+        if (buf->size() < 5) {
+            return false;
+        }
+        size_t hdrSize = 3;
+        size_t dataSize = p[3] >> 1;
+        if (!(p[3] & CMUX_EA)) {
+            if (buf->size() < 6) {
+                return false;
+            }
+            dataSize |= (size_t)p[4] << 7;
+            ++hdrSize;
+        }
+        const size_t frameSize = 1 + hdrSize + dataSize + 2;
+        if (buf->size() < frameSize) {
+            return false;
+        }
+        const bool valid = cmuxFcs(p + 1, hdrSize) == p[1 + hdrSize + dataSize] && p[frameSize - 1] == CMUX_FLAG;
+        if (valid) {
+            frame->dlci = p[1] >> 2;
+            frame->type = p[2] & ~CMUX_PF;
+            frame->data = buf->substr(1 + hdrSize, dataSize);
+        }
+        // The closing flag may be shared with the next frame
+        buf->erase(0, frameSize - 1);
+        if (valid) {
+            return true;
+        }
+    }
+}
+
+VirtualModem::VirtualModem() :
+        lastOutTime_(0),
+        readCount_(0),
+        echo_(true),
+        muxer_(false) {
+}
+
+VirtualModem& VirtualModem::on(std::string cmd, std::string resp, unsigned delay, unsigned count) {
+    if (!resp.empty() && !endsWith(resp, "\r\n")) {
+        resp += "\r\n";
+    }
+    rules_.push_back({ std::move(cmd), std::move(resp), delay, count });
+    return *this;
+}
+
+VirtualModem& VirtualModem::urc(const std::string& data, unsigned delay, uint8_t dlci) {
+    send(dlci, endsWith(data, "\r\n") ? data : data + "\r\n", delay);
+    return *this;
+}
+
+int VirtualModem::read(char* data, size_t size) {
+    update();
+    const size_t n = std::min(size, in_.size());
+    if (data) {
+        memcpy(data, in_.data(), n);
+    }
+    in_.erase(0, n);
+    ++readCount_;
+    return n;
+}
+
+int VirtualModem::peek(char* data, size_t size) {
+    update();
+    const size_t n = std::min(size, in_.size());
+    memcpy(data, in_.data(), n);
+    return n;
+}
+
+int VirtualModem::skip(size_t size) {
+    return read(nullptr, size);
+}
+
+int VirtualModem::availForRead() {
+    update();
+    return in_.size();
+}
+
+int VirtualModem::write(const char* data, size_t size) {
+    if (!muxer_) {
+        processData(0, std::string(data, size));
+        return size;
+    }
+    frameBuf_.append(data, size);
+    CmuxFrame frame;
+    while (decodeCmuxFrame(&frameBuf_, &frame)) {
+        processFrame(frame);
+    }
+    return size;
+}
+
+int VirtualModem::flush() {
+    return 0;
+}
+
+int VirtualModem::availForWrite() {
+    return 1024;
+}
+
+int VirtualModem::waitEvent(unsigned flags, unsigned timeout) {
+    if (flags & Stream::WRITABLE) {
+        return Stream::WRITABLE;
+    }
+    if (!(flags & Stream::READABLE)) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    const auto deadline = now() + timeout;
+    for (;;) {
+        update();
+        if (!in_.empty()) {
+            return Stream::READABLE;
+        }
+        const auto t = now();
+        if (out_.empty() || t >= deadline) {
+            return SYSTEM_ERROR_TIMEOUT;
+        }
+        // Sleep until the next scheduled response
+        const auto next = std::min(out_.front().time, deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(next - t));
+    }
+}
+
+void VirtualModem::processData(uint8_t dlci, const std::string& data) {
+    auto& buf = lineBufs_[dlci];
+    for (char c: data) {
+        if (!isLineEnd(c)) {
+            buf += c;
+        } else if (!buf.empty()) {
+            const std::string cmd = std::move(buf);
+            buf.clear();
+            processCommand(dlci, cmd);
+        }
+    }
+}
+
+void VirtualModem::processFrame(const CmuxFrame& frame) {
+    switch (frame.type) {
+    case CmuxFrame::SABM: {
+        lineBufs_[frame.dlci].clear();
+        sendFrame(frame.dlci, CmuxFrame::UA);
+        break;
+    }
+    case CmuxFrame::DISC: {
+        sendFrame(frame.dlci, CmuxFrame::UA);
+        if (frame.dlci == 0) {
+            // Closing the control channel terminates the multiplexer
+            muxer_ = false;
+        }
+        break;
+    }
+    case CmuxFrame::UIH: {
+        if (frame.dlci != 0) { // Control channel messages are ignored
+            processData(frame.dlci, frame.data);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void VirtualModem::processCommand(uint8_t dlci, const std::string& cmd) {
+    cmds_.push_back(cmd);
+    std::string resp = echo_ ? cmd + "\r\n" : std::string();
+    unsigned delay = 0;
+    // Split a concatenated command line (e.g. "AT+COPS=3,2;+CGEREP=1,0") unless there's a rule for it
+    std::vector<std::string> subCmds;
+    bool exactRule = false;
+    for (const auto& rule: rules_) {
+        if (rule.cmd == cmd) {
+            exactRule = true;
+            break;
+        }
+    }
+    if (!exactRule && cmd.compare(0, 2, "AT") == 0) {
+        size_t pos = 2;
+        bool quoted = false;
+        for (size_t i = 2; i <= cmd.size(); ++i) {
+            if (i == cmd.size() || (cmd[i] == ';' && !quoted)) {
+                subCmds.push_back("AT" + cmd.substr(pos, i - pos));
+                pos = i + 1;
+            } else if (cmd[i] == '"') {
+                quoted = !quoted;
+            }
+        }
+    } else {
+        subCmds.push_back(cmd);
+    }
+    for (size_t i = 0; i < subCmds.size(); ++i) {
+        unsigned d = 0;
+        std::string r = respond(subCmds[i], &d);
+        delay += d;
+        // Only the last command of a concatenated line produces the final result code
+        if (endsWith(r, "OK\r\n") && i != subCmds.size() - 1) {
+            r.erase(r.size() - 4);
+            resp += r;
+        } else {
+            resp += r;
+            break;
+        }
+    }
+    const bool startMuxer = !muxer_ && cmd.compare(0, 8, "AT+CMUX=") == 0 && endsWith(resp, "OK\r\n");
+    send(dlci, std::move(resp), delay);
+    if (startMuxer) {
+        muxer_ = true;
+    }
+}
+
+std::string VirtualModem::respond(const std::string& cmd, unsigned* delay) {
+    std::string resp;
+    auto rule = rules_.begin();
+    for (; rule != rules_.end(); ++rule) {
+        const bool match = (!rule->cmd.empty() && rule->cmd.back() == '*') ?
+                cmd.compare(0, rule->cmd.size() - 1, rule->cmd, 0, rule->cmd.size() - 1) == 0 : cmd == rule->cmd;
+        if (match) {
+            break;
+        }
+    }
+    if (rule != rules_.end()) {
+        resp = rule->resp;
+        *delay = rule->delay;
+        if (rule->count > 0 && --rule->count == 0) {
+            rules_.erase(rule);
+        }
+    } else if (cmd == "ATE0" || cmd == "ATE1" || cmd.compare(0, 7, "AT+CMUX") == 0) {
+        resp = "OK\r\n";
+    } else {
+        resp = "ERROR\r\n";
+    }
+    if (cmd == "ATE0" || cmd == "ATE1") {
+        echo_ = (cmd == "ATE1");
+    }
+    return resp;
+}
+
+void VirtualModem::send(uint8_t dlci, std::string data, unsigned delay) {
+    if (data.empty()) {
+        return;
+    }
+    if (!muxer_) {
+        // Responses are delivered in the order they were scheduled
+        lastOutTime_ = std::max(now() + delay, lastOutTime_);
+        out_.push_back({ std::move(data), lastOutTime_ });
+        return;
+    }
+    sendFrame(dlci, CmuxFrame::UIH, data, delay);
+}
+
+void VirtualModem::sendFrame(uint8_t dlci, uint8_t type, const std::string& data, unsigned delay) {
+    lastOutTime_ = std::max(now() + delay, lastOutTime_);
+    out_.push_back({ encodeCmuxFrame(dlci, type, data), lastOutTime_ });
+}
+
+void VirtualModem::update() {
+    const auto t = now();
+    while (!out_.empty() && out_.front().time <= t) {
+        in_ += out_.front().data;
+        out_.pop_front();
+    }
+}
+
+class CmuxClient::ChannelStream: public Stream {
+public:
+    ChannelStream(CmuxClient* client, uint8_t dlci) :
+            client_(client),
+            dlci_(dlci) {
+    }
+
+    int read(char* data, size_t size) override {
+        client_->update();
+        auto& buf = client_->data_[dlci_];
+        const size_t n = std::min(size, buf.size());
+        if (data) {
+            memcpy(data, buf.data(), n);
+        }
+        buf.erase(0, n);
+        return n;
+    }
+
+    int peek(char* data, size_t size) override {
+        client_->update();
+        const auto& buf = client_->data_[dlci_];
+        const size_t n = std::min(size, buf.size());
+        memcpy(data, buf.data(), n);
+        return n;
+    }
+
+    int skip(size_t size) override {
+        return read(nullptr, size);
+    }
+
+    int availForRead() override {
+        client_->update();
+        return client_->data_[dlci_].size();
+    }
+
+    int write(const char* data, size_t size) override {
+        const auto frame = encodeCmuxFrame(dlci_, CmuxFrame::UIH, std::string(data, size));
+        return (client_->modem_->write(frame.data(), frame.size()) < 0) ? SYSTEM_ERROR_IO : (int)size;
+    }
+
+    int flush() override {
+        return 0;
+    }
+
+    int availForWrite() override {
+        return client_->modem_->availForWrite();
+    }
+
+    int waitEvent(unsigned flags, unsigned timeout) override {
+        if (flags & Stream::WRITABLE) {
+            return Stream::WRITABLE;
+        }
+        const auto deadline = now() + timeout;
+        for (;;) {
+            if (availForRead() > 0) {
+                return Stream::READABLE;
+            }
+            const auto t = now();
+            if (t >= deadline) {
+                return SYSTEM_ERROR_TIMEOUT;
+            }
+            const int r = client_->modem_->waitEvent(Stream::READABLE, deadline - t);
+            if (r < 0) {
+                return r;
+            }
+        }
+    }
+
+private:
+    CmuxClient* client_;
+    uint8_t dlci_;
+};
+
+CmuxClient::CmuxClient(VirtualModem* modem) :
+        modem_(modem) {
+}
+
+CmuxClient::~CmuxClient() {
+}
+
+Stream* CmuxClient::openChannel(uint8_t dlci, unsigned timeout) {
+    ua_[dlci] = false;
+    const auto frame = encodeCmuxFrame(dlci, CmuxFrame::SABM);
+    modem_->write(frame.data(), frame.size());
+    const auto deadline = now() + timeout;
+    for (;;) {
+        update();
+        if (ua_[dlci]) {
+            break;
+        }
+        const auto t = now();
+        if (t >= deadline || modem_->waitEvent(Stream::READABLE, deadline - t) < 0) {
+            return nullptr;
+        }
+    }
+    auto& strm = channels_[dlci];
+    if (!strm) {
+        strm.reset(new ChannelStream(this, dlci));
+    }
+    return strm.get();
+}
+
+void CmuxClient::update() {
+    char buf[128];
+    int n = 0;
+    while ((n = modem_->read(buf, sizeof(buf))) > 0) {
+        buf_.append(buf, n);
+    }
+    CmuxFrame frame;
+    while (decodeCmuxFrame(&buf_, &frame)) {
+        if (frame.type == CmuxFrame::UA) {
+            ua_[frame.dlci] = true;
+        } else if (frame.type == CmuxFrame::UIH) {
+            data_[frame.dlci] += frame.data;
+        }
+    }
+}
+
+} // namespace test
+
+} // namespace particle
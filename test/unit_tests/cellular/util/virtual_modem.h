@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "stream.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <cstdint>
+
+namespace particle {
+
+namespace test {
+
+// 3GPP TS 27.010 basic option frame
+struct CmuxFrame {
+    enum Type {
+        SABM = 0x2f,
+        UA = 0x63,
+        DM = 0x0f,
+        DISC = 0x43,
+        UIH = 0xef
+    };
+
+    uint8_t dlci;
+    uint8_t type;
+    std::string data;
+};
+
+// Encodes a CMUX frame
+std::string encodeCmuxFrame(uint8_t dlci, uint8_t type, const std::string& data = std::string());
+// Decodes a CMUX frame at the beginning of the buffer. The frame is removed from the buffer
+bool decodeCmuxFrame(std::string* buf, CmuxFrame* frame);
+
+// Scriptable modem simulator. The class implements the DTE side of the modem's serial interface
+class VirtualModem: public Stream {
+public:
+    VirtualModem();
+
+    // Sets a response for a command. If the command ends with '*', it's matched as a prefix.
+    // Rules are matched in the order they were added. A rule with a non-zero count is only
+    // used that many times. Concatenated commands ("AT+A;+B") are matched one by one unless
+    // there's a rule for the entire command line
+    VirtualModem& on(std::string cmd, std::string resp, unsigned delay = 0, unsigned count = 0);
+    // Sends an unsolicited result code
+    VirtualModem& urc(const std::string& data, unsigned delay = 0, uint8_t dlci = 0);
+    // Enables or disables command echo (ATE1/ATE0)
+    VirtualModem& echo(bool enabled);
+
+    // Returns all commands received by the modem
+    const std::vector<std::string>& commands() const;
+    // Returns true if the modem is in the multiplexed mode (AT+CMUX)
+    bool isMuxerRunning() const;
+    // Returns the number of times the DTE read from the modem
+    size_t readCount() const;
+
+    // Reimplemented from Stream
+    int read(char* data, size_t size) override;
+    int peek(char* data, size_t size) override;
+    int skip(size_t size) override;
+    int availForRead() override;
+    int write(const char* data, size_t size) override;
+    int flush() override;
+    int availForWrite() override;
+    int waitEvent(unsigned flags, unsigned timeout) override;
+
+private:
+    struct Rule {
+        std::string cmd;
+        std::string resp;
+        unsigned delay;
+        unsigned count;
+    };
+
+    struct Output {
+        std::string data;
+        uint64_t time;
+    };
+
+    std::vector<Rule> rules_;
+    std::vector<std::string> cmds_;
+    std::deque<Output> out_;
+    std::string in_; // Data available for reading
+    std::string frameBuf_;
+    std::map<uint8_t, std::string> lineBufs_; // Per-channel command buffers
+    uint64_t lastOutTime_;
+    size_t readCount_;
+    bool echo_;
+    bool muxer_;
+
+    void processData(uint8_t dlci, const std::string& data);
+    void processFrame(const CmuxFrame& frame);
+    void processCommand(uint8_t dlci, const std::string& cmd);
+    std::string respond(const std::string& cmd, unsigned* delay);
+    void send(uint8_t dlci, std::string data, unsigned delay = 0);
+    void sendFrame(uint8_t dlci, uint8_t type, const std::string& data = std::string(), unsigned delay = 0);
+    void update();
+};
+
+// Minimal DTE side of the CMUX protocol for talking to a virtual modem
+class CmuxClient {
+public:
+    explicit CmuxClient(VirtualModem* modem);
+    ~CmuxClient();
+
+    // Opens a channel and returns a stream for it
+    Stream* openChannel(uint8_t dlci, unsigned timeout = 1000);
+
+private:
+    class ChannelStream;
+
+    VirtualModem* modem_;
+    std::map<uint8_t, std::unique_ptr<ChannelStream>> channels_;
+    std::map<uint8_t, std::string> data_;
+    std::map<uint8_t, bool> ua_;
+    std::string buf_;
+
+    void update();
+};
+
+inline VirtualModem& VirtualModem::echo(bool enabled) {
+    echo_ = enabled;
+    return *this;
+}
+
+inline const std::vector<std::string>& VirtualModem::commands() const {
+    return cmds_;
+}
+
+inline bool VirtualModem::isMuxerRunning() const {
+    return muxer_;
+}
+
+inline size_t VirtualModem::readCount() const {
+    return readCount_;
+}
+
+} // namespace test
+
+} // namespace particle
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/virtual_modem.h"
+
+#include "ncp/at_parser/at_parser.h"
+#include "ncp/at_parser/at_response.h"
+#include "ncp/cellular/ncp_phase_timer.h"
+#include "ncp/cellular/cellular_ncp_common.h"
+
+#include <string>
+#include <sstream>
+
+#include "catch2/catch.hpp"
+
+namespace {
+
+using namespace particle;
+using namespace particle::test;
+
+// Response delays of a scripted SARA R410 modem
+struct SaraDelays {
+    unsigned cfun;
+    unsigned cops;
+    unsigned dial;
+};
+
+void addSaraR410Script(VirtualModem& modem, const SaraDelays& d) {
+    modem.on("AT", "OK")
+        .on("AT+CGMR", "L0.0.00.00.05.08 [Apr 17 2019 19:34:02]\r\nOK")
+        .on("AT+CCID", "+CCID: 89014103271226997000\r\nOK")
+        .on("AT+IFC=2,2", "OK")
+        .on("AT+UMNOPROF?", "+UMNOPROF: 2\r\nOK")
+        .on("AT+COPS=3,2", "OK")
+        .on("AT+CGEREP=1,0", "OK")
+        .on("AT+URAT?", "+URAT: 7\r\nOK")
+        .on("AT+CPSMS?", "+CPSMS:0\r\nOK")
+        .on("AT+CEDRXS?", "+CEDRXS:\r\nOK")
+        .on("AT+CMUX=*", "OK")
+        .on("AT+CFUN=1,0", "OK", d.cfun)
+        .on("AT+CGDCONT=*", "OK")
+        .on("AT+CEREG=2", "OK")
+        .on("AT+COPS?", "+COPS: 2\r\nOK")
+        .on("AT+COPS=0,2", "OK", d.cops)
+        .on("AT+CEREG?", "+CEREG: 2,2\r\nOK", 0, 1) // Searching
+        .on("AT+CEREG?", "+CEREG: 2,5,\"2C2D\",\"A2E4D0B\",7\r\nOK")
+        .on("ATD*99***1#", "CONNECT", d.dial);
+}
+
+// Replays a hand-written copy of the AT commands that SaraNcpClient sends to an R410 modem when connecting.
+// SaraNcpClient itself can't be built on the host, so this exercises the virtual modem, the AT parser and
+// NcpPhaseTimer but not the client: the sequence has to be kept in sync with the client manually and the
+// timings say nothing about the client's own connect phases
+void replaySaraR410Commands(VirtualModem& modem, NcpPhaseTimer& timer) {
+    AtParser parser;
+    REQUIRE(parser.init(AtParserConfig().stream(&modem).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+    {
+        const NcpPhaseTimer::Scope phase(&timer, NcpPhase::INIT_READY);
+        CHECK(parser.execCommand("AT+CGMR") == AtResponse::OK);
+        CHECK(parser.execCommand("AT+CCID") == AtResponse::OK);
+        CHECK(parser.execCommand("AT+IFC=2,2") == AtResponse::OK);
+        CHECK(parser.execCommand("AT") == AtResponse::OK);
+        {
+            const NcpPhaseTimer::Scope phase(&timer, NcpPhase::SELECT_NETWORK_PROF);
+            CHECK(parser.execCommand("AT+UMNOPROF?") == AtResponse::OK);
+        }
+        CHECK(parser.execCommand("AT+COPS=3,2") == AtResponse::OK);
+        CHECK(parser.execCommand("AT+CGEREP=1,0") == AtResponse::OK);
+        CHECK(parser.execCommand("AT+URAT?") == AtResponse::OK);
+        CHECK(parser.execCommand("AT+CPSMS?") == AtResponse::OK);
+        CHECK(parser.execCommand("AT+CEDRXS?") == AtResponse::OK);
+        CHECK(parser.execCommand("AT+CMUX=0,0,,1509,,,,,") == AtResponse::OK);
+    }
+    REQUIRE(modem.isMuxerRunning());
+    CmuxClient mux(&modem);
+    const auto atStrm = mux.openChannel(1);
+    REQUIRE(atStrm);
+    const auto dataStrm = mux.openChannel(2);
+    REQUIRE(dataStrm);
+    AtParser atParser;
+    REQUIRE(atParser.init(AtParserConfig().stream(atStrm).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+    const CellularNcpTraits traits = { 1, "IP", true, true, 1000 };
+    CellularGlobalIdentity cgi = {};
+    CellularNcpCommon common(&atParser, &cgi, nullptr);
+    common.traits(&traits);
+    {
+        const NcpPhaseTimer::Scope phase(&timer, NcpPhase::REGISTER_NET);
+        CHECK(atParser.execCommand("AT+CFUN=1,0") == AtResponse::OK);
+        CHECK(common.configurePdpContext("apn", false) == AtResponse::OK);
+        CHECK(atParser.execCommand("AT+CEREG=2") == AtResponse::OK);
+        CHECK(atParser.execCommand("AT+COPS?") == AtResponse::OK);
+        CHECK(atParser.execCommand("AT+COPS=0,2") == AtResponse::OK);
+        CHECK(atParser.execCommand("AT+CEREG?") == AtResponse::OK);
+    }
+    // Registration status is polled until the modem is registered
+    int stat = 0;
+    while (stat != 5) {
+        auto resp = atParser.sendCommand("AT+CEREG?");
+        int n = 0;
+        REQUIRE(resp.scanf("+CEREG: %d,%d", &n, &stat) == 2);
+        REQUIRE(resp.readResult() == AtResponse::OK);
+    }
+    AtParser dataParser;
+    REQUIRE(dataParser.init(AtParserConfig().stream(dataStrm).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+    {
+        const NcpPhaseTimer::Scope phase(&timer, NcpPhase::ENTER_DATA_MODE);
+        CHECK(dataParser.execCommand("AT") == AtResponse::OK);
+        CHECK(common.dial(&dataParser) == 0);
+    }
+}
+
+} // unnamed
+
+TEST_CASE("encodeCmuxFrame()/decodeCmuxFrame()") {
+    SECTION("round-trips short and long frames") {
+        std::string buf = encodeCmuxFrame(1, CmuxFrame::UIH, "AT\r\n") + encodeCmuxFrame(2, CmuxFrame::UIH, std::string(300, 'x')) +
+                encodeCmuxFrame(3, CmuxFrame::SABM);
+        CmuxFrame f;
+        REQUIRE(decodeCmuxFrame(&buf, &f));
+        CHECK(f.dlci == 1);
+        CHECK(f.type == CmuxFrame::UIH);
+        CHECK(f.data == "AT\r\n");
+        REQUIRE(decodeCmuxFrame(&buf, &f));
+        CHECK(f.dlci == 2);
+        CHECK(f.data == std::string(300, 'x'));
+        REQUIRE(decodeCmuxFrame(&buf, &f));
+        CHECK(f.dlci == 3);
+        CHECK(f.type == CmuxFrame::SABM);
+        CHECK(f.data.empty());
+        CHECK_FALSE(decodeCmuxFrame(&buf, &f));
+    }
+
+    SECTION("skips frames with an invalid FCS") {
+        std::string bad = encodeCmuxFrame(1, CmuxFrame::UIH, "abc");
+        bad[bad.size() - 2] ^= 0x55;
+        std::string buf = bad + encodeCmuxFrame(2, CmuxFrame::UIH, "def");
+        CmuxFrame f;
+        REQUIRE(decodeCmuxFrame(&buf, &f));
+        CHECK(f.dlci == 2);
+        CHECK(f.data == "def");
+    }
+
+    SECTION("waits for an incomplete frame") {
+        const std::string frame = encodeCmuxFrame(1, CmuxFrame::UIH, "OK\r\n");
+        std::string buf = frame.substr(0, 5);
+        CmuxFrame f;
+        CHECK_FALSE(decodeCmuxFrame(&buf, &f));
+        buf += frame.substr(5);
+        REQUIRE(decodeCmuxFrame(&buf, &f));
+        CHECK(f.data == "OK\r\n");
+    }
+}
+
+TEST_CASE("VirtualModem") {
+    VirtualModem modem;
+    AtParser parser;
+    REQUIRE(parser.init(AtParserConfig().stream(&modem).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+
+    SECTION("replies to scripted commands after the configured delay") {
+        modem.on("AT+CFUN=1,0", "OK", 30);
+        NcpPhaseTimer timer;
+        {
+            const NcpPhaseTimer::Scope phase(&timer, NcpPhase::REGISTER_NET);
+            CHECK(parser.execCommand("AT+CFUN=1,0") == AtResponse::OK);
+        }
+        CHECK(timer.stats(NcpPhase::REGISTER_NET).count == 1);
+        CHECK(timer.stats(NcpPhase::REGISTER_NET).last >= 30);
+        CHECK(parser.execCommand("AT+UNKNOWN") == AtResponse::ERROR);
+        CHECK(modem.commands() == std::vector<std::string>({ "AT+CFUN=1,0", "AT+UNKNOWN" }));
+    }
+
+    SECTION("uses a rule with a limited count before the following ones") {
+        modem.on("AT+CEREG?", "+CEREG: 2,2\r\nOK", 0, 2);
+        modem.on("AT+CEREG?", "+CEREG: 2,5\r\nOK");
+        for (int expected: { 2, 2, 5, 5 }) {
+            auto resp = parser.sendCommand("AT+CEREG?");
+            int n = 0, stat = 0;
+            CHECK(resp.scanf("+CEREG: %d,%d", &n, &stat) == 2);
+            CHECK(stat == expected);
+            CHECK(resp.readResult() == AtResponse::OK);
+        }
+    }
+
+    SECTION("delivers URCs") {
+        modem.on("ATE0", "OK");
+        CHECK(parser.execCommand("ATE0") == AtResponse::OK);
+        modem.urc("+CEREG: 5", 10);
+        int count = 0;
+        REQUIRE(parser.addUrcHandler("+CEREG", [](AtResponseReader* reader, const char* prefix, void* data) {
+            ++*(int*)data;
+            return 0;
+        }, &count) == 0);
+        while (count == 0) {
+            REQUIRE(parser.processUrc(100) >= 0);
+        }
+        CHECK(count == 1);
+    }
+
+    SECTION("multiplexes AT channels after AT+CMUX") {
+        modem.on("AT+CSQ", "+CSQ: 20,99\r\nOK");
+        CHECK(parser.execCommand("AT+CMUX=0,0,,1509,,,,,") == AtResponse::OK);
+        REQUIRE(modem.isMuxerRunning());
+        CmuxClient mux(&modem);
+        const auto ch1 = mux.openChannel(1);
+        const auto ch2 = mux.openChannel(2);
+        REQUIRE(ch1);
+        REQUIRE(ch2);
+        AtParser p1, p2;
+        REQUIRE(p1.init(AtParserConfig().stream(ch1).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+        REQUIRE(p2.init(AtParserConfig().stream(ch2).commandTerminator(AtCommandTerminator::CRLF)) == 0);
+        auto resp = p2.sendCommand("AT+CSQ");
+        int rssi = 0, qual = 0;
+        CHECK(resp.scanf("+CSQ: %d,%d", &rssi, &qual) == 2);
+        CHECK(rssi == 20);
+        CHECK(resp.readResult() == AtResponse::OK);
+        CHECK(p1.execCommand("AT+CSQ") == AtResponse::OK);
+        CHECK(ch1->availForRead() == 0);
+        CHECK(ch2->availForRead() == 0);
+    }
+}
+
+TEST_CASE("NcpPhaseTimer") {
+    SECTION("reports the duration of each phase of a replayed AT command sequence") {
+        VirtualModem modem;
+        addSaraR410Script(modem, { 20, 40, 30 });
+        NcpPhaseTimer timer;
+        replaySaraR410Commands(modem, timer);
+        CHECK(timer.stats(NcpPhase::INIT_READY).count == 1);
+        CHECK(timer.stats(NcpPhase::SELECT_NETWORK_PROF).count == 1);
+        CHECK(timer.stats(NcpPhase::REGISTER_NET).last >= 60);
+        CHECK(timer.stats(NcpPhase::ENTER_DATA_MODE).last >= 30);
+        CHECK(timer.stats(NcpPhase::INIT_READY).last < timer.stats(NcpPhase::REGISTER_NET).last);
+        timer.reset();
+        CHECK(timer.stats(NcpPhase::REGISTER_NET).count == 0);
+    }
+}
+
+// Measures the virtual modem and AT parser overhead for a replayed command sequence, see replaySaraR410Commands()
+TEST_CASE("Replayed SARA R410 AT command sequence benchmark", "[.][benchmark]") {
+    const int runs = 5;
+    NcpPhaseTimer timer;
+    for (int i = 0; i < runs; ++i) {
+        VirtualModem modem;
+        addSaraR410Script(modem, { 20, 100, 50 });
+        replaySaraR410Commands(modem, timer);
+    }
+    std::ostringstream s;
+    for (size_t i = 0; i < NCP_PHASE_COUNT; ++i) {
+        const auto phase = (NcpPhase)i;
+        const auto& st = timer.stats(phase);
+        s << NcpPhaseTimer::phaseName(phase) << ": avg " << st.total / st.count << " ms, max " << st.max << " ms\n";
+    }
+    WARN(s.str());
+}
@@ -613,6 +613,137 @@ TEST_CASE("FirmwareUpdate") {
         m = w.receiveMessage();
         CHECK(m.option(OtaCoapOption::CHUNK_INDEX).toUInt() == 2);
     }
+    SECTION("shifts the receiver window past a whole word of the chunk bitmap") {
+        w.sendStart(40 * 512 /* fileSize */, std::string() /* fileHash */, 512 /* chunkSize */, false /* discardData */);
+        w.skipMessages(2); // Skip the ACK and response
+        for (unsigned i = 2; i <= 34; ++i) {
+            w.sendChunk(i /* index */, genString(512) /* data */);
+            w.skipMessages(1);
+        }
+        w.sendChunk(1 /* index */, genString(512) /* data */);
+        auto m = w.receiveMessage();
+        CHECK(m.option(OtaCoapOption::CHUNK_INDEX).toUInt() == 34);
+        CHECK(!m.hasPayload()); // No gaps
+    }
+    SECTION("repeats the acknowledgement if the transfer stalls") {
+        w.sendStart(2048 /* fileSize */, std::string() /* fileHash */, 512 /* chunkSize */, false /* discardData */);
+        w.skipMessages(2); // Skip the ACK and response
+        // Chunk 1
+        w.sendChunk(1 /* index */, genString(512) /* data */);
+        CHECK(!w.hasMessages()); // ACK delayed
+        // Chunk 3
+        w.sendChunk(3 /* index */, genString(512) /* data */);
+        w.skipMessages(1);
+        // Chunks 2 and 4 are lost
+        w.addMillis(OTA_CHUNK_ACK_REPEAT_DELAY - 1);
+        w.processTimeouts();
+        CHECK(!w.hasMessages());
+        w.addMillis(1);
+        w.processTimeouts();
+        auto m = w.receiveMessage();
+        CHECK(m.option(CoapOption::URI_PATH).toString() == "A");
+        CHECK(m.option(OtaCoapOption::CHUNK_INDEX).toUInt() == 1);
+        CHECK(parseChunkAckPayload(m) == std::vector<unsigned>{ 3 });
+        CHECK(w.stats().repeatedChunkAcks == 1);
+        // The delay doubles with every repeated acknowledgement
+        w.addMillis(OTA_CHUNK_ACK_REPEAT_DELAY);
+        w.processTimeouts();
+        CHECK(!w.hasMessages());
+        w.addMillis(OTA_CHUNK_ACK_REPEAT_DELAY);
+        w.processTimeouts();
+        m = w.receiveMessage();
+        CHECK(m.option(OtaCoapOption::CHUNK_INDEX).toUInt() == 1);
+        CHECK(w.stats().repeatedChunkAcks == 2);
+        // Chunk 2
+        w.sendChunk(2 /* index */, genString(512) /* data */);
+        m = w.receiveMessage();
+        CHECK(m.option(OtaCoapOption::CHUNK_INDEX).toUInt() == 3);
+        // The delay is reset when a chunk is received
+        w.addMillis(OTA_CHUNK_ACK_REPEAT_DELAY);
+        w.processTimeouts();
+        m = w.receiveMessage();
+        CHECK(m.option(OtaCoapOption::CHUNK_INDEX).toUInt() == 3);
+        CHECK(w.stats().repeatedChunkAcks == 3);
+        // Chunk 4
+        w.sendChunk(4 /* index */, genString(512) /* data */);
+        w.skipMessages(1);
+        // No acknowledgements are repeated once all chunks are received
+        w.addMillis(OTA_CHUNK_ACK_REPEAT_DELAY * 10);
+        w.processTimeouts();
+        CHECK(!w.hasMessages());
+    }
+    SECTION("completes a transfer with many chunks in flight over a lossy channel") {
+        const size_t chunkSize = 512;
+        const size_t fileSize = 200 * chunkSize - 100;
+        const unsigned chunkCount = (fileSize + chunkSize - 1) / chunkSize;
+        const double lossRate = GENERATE(0.0, 0.1, 0.3);
+        const system_tick_t roundTripTime = 500;
+        const auto fileData = genString(fileSize);
+        std::string recvData(fileSize, '\0');
+        auto cb = w.callbacksMock();
+        When(Method(cb, saveFirmwareChunk)).AlwaysDo([&](const char* chunkData, size_t chunkSize, size_t chunkOffset,
+                size_t partialSize) {
+            REQUIRE(chunkOffset + chunkSize <= fileSize);
+            recvData.replace(chunkOffset, chunkSize, chunkData, chunkSize);
+            return 0;
+        });
+        std::bernoulli_distribution lost(lossRate);
+        w.sendStart(fileSize, std::string() /* fileHash */, chunkSize, false /* discardData */);
+        w.skipMessages(1); // Skip the ACK
+        const unsigned windowSize = w.receiveMessage().option(OtaCoapOption::WINDOW_SIZE).toUInt();
+        REQUIRE(windowSize >= 32);
+        // Simulated server implementing selective repeat: within the receiver window, every chunk
+        // that hasn't been acknowledged yet is (re)sent once per round trip
+        unsigned ackIndex = 0; // Cumulatively acknowledged chunks
+        std::vector<bool> acked(chunkCount + 1);
+        unsigned rounds = 0;
+        unsigned sentChunks = 0;
+        auto receiveAcks = [&]() {
+            while (w.hasMessages()) {
+                const auto m = w.receiveMessage();
+                REQUIRE(m.option(CoapOption::URI_PATH).toString() == "A");
+                if (lost(randomGen())) {
+                    continue;
+                }
+                const unsigned index = m.option(OtaCoapOption::CHUNK_INDEX).toUInt();
+                for (unsigned i = ackIndex + 1; i <= index; ++i) {
+                    acked.at(i) = true;
+                }
+                ackIndex = std::max(ackIndex, index);
+                if (m.hasPayload()) {
+                    for (auto i: parseChunkAckPayload(m)) {
+                        acked.at(i) = true;
+                    }
+                }
+            }
+        };
+        while (ackIndex < chunkCount) {
+            REQUIRE(++rounds < 100);
+            for (unsigned i = ackIndex + 1; i <= std::min(ackIndex + windowSize, chunkCount); ++i) {
+                if (acked.at(i)) {
+                    continue;
+                }
+                ++sentChunks;
+                if (!lost(randomGen())) {
+                    const size_t offs = (i - 1) * chunkSize;
+                    REQUIRE(w.sendChunk(i, fileData.substr(offs, chunkSize)) == ProtocolError::NO_ERROR);
+                }
+            }
+            receiveAcks();
+            w.addMillis(roundTripTime);
+            w.processTimeouts();
+            receiveAcks();
+        }
+        CHECK(recvData == fileData);
+        CHECK(w.isRunning());
+        // A stop-and-wait transfer would need at least one round trip per chunk
+        CHECK(rounds < chunkCount / 10);
+        CHECK(w.stats().receivedChunks <= sentChunks);
+        w.sendFinish(false /* cancelUpdate */, false /* discardData */);
+        w.skipMessages(1); // Skip the ACK
+        auto m = w.receiveMessage();
+        CHECK(m.code() == CoapCode::CHANGED);
+    }
     SECTION("replies to the server with an error response if an UpdateChunk request cannot be processed") {
         SECTION("no update is in progress") {
             int r = w.sendChunk(1 /* index */, genString(512) /* data */);
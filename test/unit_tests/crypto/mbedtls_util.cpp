@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mbedtls_util.h"
+#include "system_error.h"
+
+// crypto/src/mbedtls_util.cpp depends on the HAL, so only the functions used by the tests are
+// defined here
+int mbedtls_to_system_error(int error) {
+    return (error == 0) ? SYSTEM_ERROR_NONE : SYSTEM_ERROR_CRYPTO;
+}
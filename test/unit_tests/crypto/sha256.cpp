@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sha256.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+namespace {
+
+using namespace particle;
+
+// NOTE: These tests use the software SHA-256 implementation. The saved state is a copy of the
+// platform's mbedtls_sha256_context, which has a different layout with the CC310 implementation
+
+// Data that doesn't end on a block boundary so that the saved state contains buffered input
+const std::string DATA = std::string(1000, 'a') + "The quick brown fox jumps over the lazy dog";
+const size_t PARTIAL_SIZE = 777;
+
+std::string hash(const std::string& data) {
+    Sha256 sha;
+    REQUIRE(sha.init() == 0);
+    REQUIRE(sha.start() == 0);
+    REQUIRE(sha.update(data.data(), data.size()) == 0);
+    std::string h(Sha256::HASH_SIZE, '\0');
+    REQUIRE(sha.finish(&h[0]) == 0);
+    return h;
+}
+
+// Restores the state into a fresh instance and returns the hash of the data processed so far, as
+// done when an interrupted OTA transfer is resumed
+std::string restoredHash(const std::string& state) {
+    Sha256 sha;
+    REQUIRE(sha.init() == 0);
+    REQUIRE(sha.start() == 0);
+    REQUIRE(sha.restoreState(state.data()) == 0);
+    std::string h(Sha256::HASH_SIZE, '\0');
+    REQUIRE(sha.finish(&h[0]) == 0);
+    return h;
+}
+
+} // namespace
+
+TEST_CASE("Sha256") {
+    Sha256 sha;
+    REQUIRE(sha.init() == 0);
+    REQUIRE(sha.start() == 0);
+    REQUIRE(sha.update(DATA.data(), PARTIAL_SIZE) == 0);
+    std::string state(Sha256::STATE_SIZE, '\0');
+    REQUIRE(sha.saveState(&state[0]) == 0);
+    const auto partialHash = hash(DATA.substr(0, PARTIAL_SIZE));
+
+    SECTION("restored state produces the same hash as a one-shot computation") {
+        Sha256 sha2;
+        REQUIRE(sha2.init() == 0);
+        REQUIRE(sha2.start() == 0);
+        REQUIRE(sha2.restoreState(state.data()) == 0);
+        REQUIRE(sha2.update(DATA.data() + PARTIAL_SIZE, DATA.size() - PARTIAL_SIZE) == 0);
+        std::string h(Sha256::HASH_SIZE, '\0');
+        REQUIRE(sha2.finish(&h[0]) == 0);
+        CHECK(h == hash(DATA));
+        CHECK(restoredHash(state) == partialHash);
+    }
+
+    SECTION("zeroed state doesn't match the hash of the partial data") {
+        // A transfer state saved without a valid context has its hash state zeroed
+        const std::string zeroed(Sha256::STATE_SIZE, '\0');
+        CHECK(restoredHash(zeroed) != partialHash);
+        // Rehashing the data is the fallback
+        CHECK(hash(DATA.substr(0, PARTIAL_SIZE)) == partialHash);
+    }
+
+    SECTION("corrupted state doesn't match the hash of the partial data") {
+        auto corrupted = state;
+        for (auto& c: corrupted) {
+            c ^= 0x5a;
+        }
+        CHECK(restoredHash(corrupted) != partialHash);
+    }
+
+    SECTION("can't save or restore the state of an uninitialized instance") {
+        Sha256 sha2;
+        CHECK(sha2.saveState(&state[0]) < 0);
+        CHECK(sha2.restoreState(state.data()) < 0);
+    }
+}
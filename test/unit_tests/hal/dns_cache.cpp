@@ -0,0 +1,162 @@
+#include "dns_cache.h"
+
+#include <string>
+#include <cstring>
+
+#include "catch2/catch.hpp"
+
+namespace {
+
+using namespace particle::net;
+
+const uint32_t NOW = 1600000000;
+
+std::string u16(uint16_t v) {
+    return std::string{ (char)(v >> 8), (char)(v & 0xff) };
+}
+
+std::string u32(uint32_t v) {
+    return u16(v >> 16) + u16(v & 0xffff);
+}
+
+std::string encodeName(const std::string& name) {
+    std::string s;
+    size_t pos = 0;
+    for (;;) {
+        const auto dot = name.find('.', pos);
+        const auto label = name.substr(pos, dot == std::string::npos ? std::string::npos : dot - pos);
+        s += (char)label.size();
+        s += label;
+        if (dot == std::string::npos) {
+            break;
+        }
+        pos = dot + 1;
+    }
+    return s + std::string(1, '\0');
+}
+
+std::string header(uint16_t flags, uint16_t anCount) {
+    return u16(0x1234) + u16(flags) + u16(1) + u16(anCount) + u16(0) + u16(0);
+}
+
+// Resource record that refers to the question name
+std::string record(uint16_t type, uint32_t ttl, const std::string& data) {
+    return std::string("\xc0\x0c", 2) + u16(type) + u16(1) + u32(ttl) + u16(data.size()) + data;
+}
+
+DnsCache::Query query(const std::string& name, DnsCache::EntryType type = DnsCache::ENTRY_IPV4, uint16_t id = 0x1234) {
+    DnsCache::Query q = {};
+    strcpy(q.name, name.c_str());
+    q.id = id;
+    q.type = type;
+    return q;
+}
+
+bool process(DnsCache& cache, const std::string& msg, const DnsCache::Query& q, uint32_t now = NOW) {
+    return cache.processResponse((const uint8_t*)msg.data(), msg.size(), q, now);
+}
+
+} // unnamed
+
+TEST_CASE("DnsCache") {
+    DnsCache::Storage storage;
+    memset(&storage, 0xaa, sizeof(storage));
+    DnsCache cache(&storage);
+    cache.init();
+
+    const std::string name = "device.spark.io";
+    const std::string question = encodeName(name) + u16(1) + u16(1);
+    const std::string question6 = encodeName(name) + u16(28) + u16(1);
+
+    SECTION("drops uninitialized storage") {
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_IPV4, NOW) == DnsCache::LOOKUP_MISS);
+        CHECK(cache.stats().misses == 1);
+    }
+
+    SECTION("caches A records with the smallest TTL of the answer") {
+        const auto msg = header(0x8180, 2) + question + record(5, 600, encodeName("cname.example.com")) +
+                record(1, 3600, std::string("\x0a\x00\x00\x01", 4));
+        CHECK(process(cache, msg, query(name)));
+        uint32_t addr = 0;
+        CHECK(cache.lookup("DEVICE.spark.io", DnsCache::ENTRY_IPV4, NOW + 100, &addr) == DnsCache::LOOKUP_HIT);
+        CHECK(memcmp(&addr, "\x0a\x00\x00\x01", 4) == 0);
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_IPV4, NOW + 600) == DnsCache::LOOKUP_MISS);
+    }
+
+    SECTION("survives reinitialization") {
+        cache.update(name.c_str(), DnsCache::ENTRY_IPV4, 0x01020304, 3600, NOW);
+        DnsCache cache2(&storage);
+        cache2.init();
+        uint32_t addr = 0;
+        CHECK(cache2.lookup(name.c_str(), DnsCache::ENTRY_IPV4, NOW + 1, &addr) == DnsCache::LOOKUP_HIT);
+        CHECK(addr == 0x01020304);
+    }
+
+    SECTION("requests a refresh before an entry expires") {
+        cache.update(name.c_str(), DnsCache::ENTRY_IPV4, 0x01020304, 800, NOW);
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_IPV4, NOW + 600) == DnsCache::LOOKUP_HIT);
+        // 1/8 of the TTL is left
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_IPV4, NOW + 700) == DnsCache::LOOKUP_HIT_REFRESH);
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_IPV4, NOW + 705) == DnsCache::LOOKUP_HIT);
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_IPV4, NOW + 710) == DnsCache::LOOKUP_HIT_REFRESH);
+        CHECK(cache.stats().refreshes == 2);
+        // Response to the refresh query
+        CHECK(process(cache, header(0x8180, 1) + question + record(1, 800, u32(0x0a000002)), query(name), NOW + 711));
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_IPV4, NOW + 1000) == DnsCache::LOOKUP_HIT);
+    }
+
+    SECTION("remembers names without IPv6 addresses") {
+        CHECK(process(cache, header(0x8180, 0) + question6, query(name, DnsCache::ENTRY_NO_IPV6)));
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_NO_IPV6, NOW + 1) == DnsCache::LOOKUP_HIT);
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_NO_IPV6, NOW + DnsCache::NEGATIVE_TTL) == DnsCache::LOOKUP_MISS);
+        CHECK(process(cache, header(0x8180, 0) + question6, query(name, DnsCache::ENTRY_NO_IPV6)));
+        CHECK_FALSE(process(cache, header(0x8180, 1) + question6 + record(28, 60, std::string(16, '\x01')), query(name, DnsCache::ENTRY_NO_IPV6)));
+        CHECK(cache.lookup(name.c_str(), DnsCache::ENTRY_NO_IPV6, NOW + 1) == DnsCache::LOOKUP_MISS);
+    }
+
+    SECTION("ignores queries, errors and malformed responses") {
+        const auto answer = record(1, 60, u32(0x0a000001));
+        CHECK_FALSE(process(cache, header(0x0100, 1) + question + answer, query(name)));
+        // NXDOMAIN
+        CHECK_FALSE(process(cache, header(0x8183, 0) + question, query(name)));
+        // Truncated
+        CHECK_FALSE(process(cache, header(0x8380, 1) + question + answer, query(name)));
+        const auto msg = header(0x8180, 1) + question + answer;
+        CHECK_FALSE(process(cache, msg.substr(0, msg.size() - 1), query(name)));
+        // Compression pointer loop
+        CHECK_FALSE(process(cache, header(0x8180, 1) + std::string("\xc0\x0c", 2) + u16(1) + u16(1) + answer, query(name)));
+        CHECK(cache.stats().updates == 0);
+    }
+
+    SECTION("ignores responses that don't match the query") {
+        const auto msg = header(0x8180, 1) + question + record(1, 60, u32(0x0a000001));
+        CHECK_FALSE(process(cache, msg, query(name, DnsCache::ENTRY_IPV4, 0x4321)));
+        CHECK_FALSE(process(cache, msg, query("other.spark.io")));
+        CHECK_FALSE(process(cache, msg, query(name, DnsCache::ENTRY_NO_IPV6)));
+        CHECK_FALSE(process(cache, header(0x8180, 0) + question6, query(name)));
+        CHECK(cache.stats().updates == 0);
+        CHECK(process(cache, msg, query("Device.Spark.IO")));
+    }
+
+    SECTION("evicts the entry that expires first") {
+        for (unsigned i = 0; i < DnsCache::MAX_ENTRY_COUNT; ++i) {
+            const auto n = "host" + std::to_string(i);
+            cache.update(n.c_str(), DnsCache::ENTRY_IPV4, i, 1000 - i, NOW);
+        }
+        cache.update("other", DnsCache::ENTRY_IPV4, 0, 1000, NOW);
+        const auto last = "host" + std::to_string(DnsCache::MAX_ENTRY_COUNT - 1);
+        CHECK(cache.lookup(last.c_str(), DnsCache::ENTRY_IPV4, NOW + 1) == DnsCache::LOOKUP_MISS);
+        CHECK(cache.lookup("host0", DnsCache::ENTRY_IPV4, NOW + 1) == DnsCache::LOOKUP_HIT);
+        CHECK(cache.lookup("other", DnsCache::ENTRY_IPV4, NOW + 1) == DnsCache::LOOKUP_HIT);
+    }
+
+    SECTION("formats queries") {
+        uint8_t buf[64] = {};
+        size_t n = DnsCache::formatQuery(query(name), buf, sizeof(buf));
+        CHECK(std::string((const char*)buf, n) == u16(0x1234) + u16(0x0100) + u16(1) + u16(0) + u16(0) + u16(0) + question);
+        n = DnsCache::formatQuery(query(name, DnsCache::ENTRY_NO_IPV6), buf, sizeof(buf));
+        CHECK(std::string((const char*)buf, n) == u16(0x1234) + u16(0x0100) + u16(1) + u16(0) + u16(0) + u16(0) + question6);
+        CHECK(DnsCache::formatQuery(query("a..b"), buf, sizeof(buf)) == 0);
+        CHECK(DnsCache::formatQuery(query(name), buf, 20) == 0);
+    }
+}
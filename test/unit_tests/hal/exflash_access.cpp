@@ -0,0 +1,166 @@
+#include "exflash_access.h"
+
+#include <vector>
+#include <cstring>
+
+#include "catch2/catch.hpp"
+
+namespace {
+
+const size_t FLASH_SIZE = 64 * 1024;
+const size_t BUF_SIZE = 1024;
+const size_t READ_SIZE = 128;
+
+// Simulated flash. The memory is accessed via global state since the access functions are plain
+// function pointers
+struct Flash {
+    std::vector<uint8_t> mem;
+    unsigned reads;
+    unsigned waits;
+    bool busy;
+};
+
+Flash g_flash;
+
+int readFlash(uintptr_t addr, uint8_t* data, size_t size) {
+    REQUIRE_FALSE(g_flash.busy); // The flash can't be read while it's erasing
+    REQUIRE(addr + size <= g_flash.mem.size());
+    memcpy(data, g_flash.mem.data() + addr, size);
+    ++g_flash.reads;
+    return 0;
+}
+
+int waitFlash() {
+    g_flash.busy = false;
+    ++g_flash.waits;
+    return 0;
+}
+
+void program(exflash_access* a, uintptr_t addr, const std::vector<uint8_t>& data) {
+    // Same order of calls as in hal_exflash_write()
+    exflash_access_invalidate(a, addr, data.size());
+    REQUIRE(exflash_access_sync(a) == 0);
+    REQUIRE_FALSE(g_flash.busy);
+    memcpy(g_flash.mem.data() + addr, data.data(), data.size());
+}
+
+void erase(exflash_access* a, uintptr_t addr, size_t size) {
+    // Same order of calls as in erase_common()
+    exflash_access_invalidate(a, addr, size);
+    REQUIRE(exflash_access_sync(a) == 0);
+    memset(g_flash.mem.data() + addr, 0xff, size);
+    g_flash.busy = true;
+    exflash_access_erase_started(a);
+}
+
+std::vector<uint8_t> read(exflash_access* a, uintptr_t addr, size_t size) {
+    std::vector<uint8_t> data(size);
+    REQUIRE(exflash_access_read(a, addr, data.data(), size) == 0);
+    return data;
+}
+
+std::vector<uint8_t> mem(uintptr_t addr, size_t size) {
+    return std::vector<uint8_t>(g_flash.mem.begin() + addr, g_flash.mem.begin() + addr + size);
+}
+
+} // unnamed
+
+TEST_CASE("exflash_access") {
+    g_flash = Flash();
+    g_flash.mem.resize(FLASH_SIZE);
+    for (size_t i = 0; i < FLASH_SIZE; ++i) {
+        g_flash.mem[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    alignas(4) uint8_t buf[BUF_SIZE];
+    exflash_access a;
+    exflash_access_init(&a, readFlash, waitFlash, buf, sizeof(buf), FLASH_SIZE);
+
+    SECTION("serves sequential reads from the read-ahead buffer") {
+        CHECK(read(&a, 0x1000, READ_SIZE) == mem(0x1000, READ_SIZE)); // Not known to be sequential yet
+        CHECK(g_flash.reads == 1);
+        for (size_t offs = READ_SIZE; offs < BUF_SIZE; offs += READ_SIZE) {
+            CHECK(read(&a, 0x1000 + offs, READ_SIZE) == mem(0x1000 + offs, READ_SIZE));
+        }
+        CHECK(g_flash.reads == 2);
+    }
+
+    SECTION("reads random and large chunks directly") {
+        read(&a, 0x1000, READ_SIZE);
+        read(&a, 0x1000 + READ_SIZE, READ_SIZE);
+        CHECK(g_flash.reads == 2);
+        CHECK(read(&a, 0x4000, READ_SIZE) == mem(0x4000, READ_SIZE));
+        CHECK(g_flash.reads == 3);
+        CHECK(read(&a, 0x4000 + READ_SIZE, BUF_SIZE) == mem(0x4000 + READ_SIZE, BUF_SIZE));
+        CHECK(g_flash.reads == 4);
+    }
+
+    SECTION("doesn't read past the end of the flash") {
+        const uintptr_t addr = FLASH_SIZE - READ_SIZE * 2;
+        read(&a, addr, READ_SIZE);
+        CHECK(read(&a, addr + READ_SIZE, READ_SIZE) == mem(addr + READ_SIZE, READ_SIZE));
+    }
+
+    SECTION("drops the buffered data that overlaps with a programmed range") {
+        read(&a, 0x1000, READ_SIZE);
+        read(&a, 0x1000 + READ_SIZE, READ_SIZE);
+        program(&a, 0x1000 + BUF_SIZE - 4, std::vector<uint8_t>(8, 0x5a));
+        CHECK(read(&a, 0x1000 + BUF_SIZE - READ_SIZE, READ_SIZE) == mem(0x1000 + BUF_SIZE - READ_SIZE, READ_SIZE));
+        CHECK(mem(0x1000 + BUF_SIZE - 1, 1)[0] == 0x5a);
+    }
+
+    SECTION("keeps the buffered data if a programmed range doesn't overlap with it") {
+        read(&a, 0x1000, READ_SIZE);
+        read(&a, 0x1000 + READ_SIZE, READ_SIZE);
+        // The buffer is filled starting from the second read
+        program(&a, 0x1000 + READ_SIZE + BUF_SIZE, std::vector<uint8_t>(8, 0x5a));
+        const auto reads = g_flash.reads;
+        CHECK(read(&a, 0x1000 + READ_SIZE * 2, READ_SIZE) == mem(0x1000 + READ_SIZE * 2, READ_SIZE));
+        CHECK(g_flash.reads == reads);
+    }
+
+    SECTION("drops the buffered data that overlaps with an erased range") {
+        read(&a, 0x1000, READ_SIZE);
+        read(&a, 0x1000 + READ_SIZE, READ_SIZE);
+        erase(&a, 0x1000, 4096);
+        CHECK(read(&a, 0x1000 + READ_SIZE * 2, READ_SIZE) == std::vector<uint8_t>(READ_SIZE, 0xff));
+    }
+
+    SECTION("waits for a pending erase before the next access") {
+        erase(&a, 0x2000, 4096);
+        CHECK(g_flash.busy);
+        CHECK(g_flash.waits == 0);
+        read(&a, 0x2000, READ_SIZE);
+        CHECK(g_flash.waits == 1);
+        erase(&a, 0x3000, 4096);
+        program(&a, 0x3000, std::vector<uint8_t>(8, 0x5a));
+        CHECK(g_flash.waits == 2);
+        erase(&a, 0x4000, 4096);
+        erase(&a, 0x5000, 4096);
+        CHECK(g_flash.waits == 3);
+    }
+
+    SECTION("sync completes a pending erase before the device is reset") {
+        erase(&a, 0x2000, 4096);
+        CHECK(exflash_access_sync(&a) == 0);
+        CHECK_FALSE(g_flash.busy);
+        CHECK(g_flash.waits == 1);
+        CHECK(exflash_access_sync(&a) == 0); // Nothing to wait for
+        CHECK(g_flash.waits == 1);
+    }
+
+    SECTION("clear drops the buffered data") {
+        read(&a, 0x1000, READ_SIZE);
+        read(&a, 0x1000 + READ_SIZE, READ_SIZE);
+        exflash_access_clear(&a);
+        g_flash.mem[0x1000 + READ_SIZE * 2] ^= 0xff;
+        CHECK(read(&a, 0x1000 + READ_SIZE * 2, READ_SIZE) == mem(0x1000 + READ_SIZE * 2, READ_SIZE));
+    }
+
+    SECTION("reads directly if the read-ahead is disabled") {
+        exflash_access_init(&a, readFlash, waitFlash, nullptr, 0, FLASH_SIZE);
+        read(&a, 0x1000, READ_SIZE);
+        read(&a, 0x1000 + READ_SIZE, READ_SIZE);
+        read(&a, 0x1000 + READ_SIZE * 2, READ_SIZE);
+        CHECK(g_flash.reads == 3);
+    }
+}
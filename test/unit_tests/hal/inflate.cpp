@@ -22,7 +22,8 @@ class Options {
 public:
     Options() :
             windowBits_(DEFAULT_WINDOW_BITS),
-            hasMoreInput_(false) {
+            hasMoreInput_(false),
+            allowTrailingData_(false) {
     }
 
     Options& hasMoreInput(bool hasMore = true) {
@@ -43,9 +44,19 @@ public:
         return windowBits_;
     }
 
+    Options& allowTrailingData(bool allow = true) {
+        allowTrailingData_ = allow;
+        return *this;
+    }
+
+    bool allowTrailingData() const {
+        return allowTrailingData_;
+    }
+
 private:
     unsigned windowBits_;
     bool hasMoreInput_;
+    bool allowTrailingData_;
 };
 
 class Output {
@@ -93,7 +104,14 @@ public:
 
     int input(const char* data, size_t* size, const Options& opts = Options()) {
         REQUIRE(ctx_ != nullptr);
-        return inflate_input(ctx_, data, size, opts.hasMoreInput() ? INFLATE_HAS_MORE_INPUT : 0);
+        unsigned flags = 0;
+        if (opts.hasMoreInput()) {
+            flags |= INFLATE_HAS_MORE_INPUT;
+        }
+        if (opts.allowTrailingData()) {
+            flags |= INFLATE_ALLOW_TRAILING_DATA;
+        }
+        return inflate_input(ctx_, data, size, flags);
     }
 
     int input(const char* data, size_t size, const Options& opts = Options()) {
@@ -406,6 +424,30 @@ TEST_CASE("inflate_input()") {
         CHECK(infl.output() == decomp);
     }
 
+    SECTION("fails if the compressed stream is followed by more data") {
+        auto decomp = genCompressibleData();
+        auto comp = deflate(decomp) + "trailing data";
+        int r = infl.input(comp.data(), comp.size(), Options().hasMoreInput());
+        CHECK(r == SYSTEM_ERROR_BAD_DATA);
+    }
+
+    SECTION("stops at the end of the compressed stream if INFLATE_ALLOW_TRAILING_DATA is set") {
+        auto decomp = genCompressibleData();
+        auto comp = deflate(decomp);
+        const auto compSize = comp.size();
+        comp += "trailing data";
+        int r = 0;
+        size_t offs = 0;
+        do {
+            size_t size = std::min<size_t>(128, comp.size() - offs);
+            r = infl.input(comp.data() + offs, &size, Options().hasMoreInput().allowTrailingData());
+            offs += size;
+        } while (r == INFLATE_NEEDS_MORE_INPUT);
+        CHECK(r == INFLATE_DONE);
+        CHECK(offs == compSize);
+        CHECK(infl.output() == decomp);
+    }
+
     SECTION("works as expected with a smaller window size") {
         auto decomp = genCompressibleData();
         auto comp = deflate(decomp, Options().windowBits(10));
@@ -0,0 +1,60 @@
+#include "memp_monitor.h"
+
+#include "catch2/catch.hpp"
+
+using namespace particle::net;
+
+TEST_CASE("PoolMonitor") {
+    PoolMonitor mon(2);
+
+    SECTION("measures stall time") {
+        mon.stallBegin(1000);
+        // Repeated notifications don't restart the stall
+        mon.stallBegin(1010);
+        CHECK(mon.isStalled());
+        mon.stallEnd(1050, 0);
+        mon.stallEnd(1100, 0);
+        mon.stallBegin(2000);
+        mon.stallEnd(2020, 0);
+        CHECK_FALSE(mon.isStalled());
+        CHECK(mon.stats().stalls == 2);
+        CHECK(mon.stats().stallTime == 70);
+        CHECK(mon.stats().maxStallTime == 50);
+    }
+
+    SECTION("grows the reserve when allocations fail") {
+        CHECK(mon.reserve(2) == 2);
+        mon.stallBegin(0);
+        mon.stallEnd(10, 3);
+        CHECK(mon.reserve(2) == 3);
+        mon.stallBegin(20);
+        mon.stallEnd(30, 4);
+        mon.stallBegin(40);
+        mon.stallEnd(50, 5);
+        // Limited by the maximum
+        CHECK(mon.reserve(2) == 4);
+        mon.setMaxExtraReserve(1);
+        CHECK(mon.reserve(2) == 3);
+    }
+
+    SECTION("shrinks the reserve after stalls without failures") {
+        mon.stallBegin(0);
+        mon.stallEnd(10, 1);
+        CHECK(mon.stats().extraReserve == 1);
+        for (unsigned i = 0; i < PoolMonitor::SHRINK_AFTER_CLEAN_STALLS - 1; ++i) {
+            mon.stallBegin(100 + i * 10);
+            mon.stallEnd(105 + i * 10, 1);
+        }
+        CHECK(mon.stats().extraReserve == 1);
+        mon.stallBegin(1000);
+        mon.stallEnd(1005, 1);
+        CHECK(mon.stats().extraReserve == 0);
+    }
+
+    SECTION("doesn't adapt when disabled") {
+        PoolMonitor fixed;
+        fixed.stallBegin(0);
+        fixed.stallEnd(10, 1);
+        CHECK(fixed.reserve(2) == 2);
+    }
+}
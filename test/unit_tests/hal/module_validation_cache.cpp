@@ -0,0 +1,80 @@
+#include "module_validation_cache.h"
+
+#include <cstring>
+
+#include "catch2/catch.hpp"
+
+namespace {
+
+using namespace particle;
+
+const uint32_t ADDR = 0x30000;
+const uint32_t LENGTH = 0x1000;
+const uint32_t CRC = 0x12345678;
+
+} // unnamed
+
+TEST_CASE("ModuleValidationCache") {
+    ModuleValidationCache::Storage storage;
+    memset(&storage, 0xaa, sizeof(storage));
+    ModuleValidationCache cache(&storage);
+    cache.init();
+
+    SECTION("drops uninitialized storage") {
+        CHECK_FALSE(cache.find(FLASH_INTERNAL, 0xaaaaaaaa, 0xaaaaaaaa, 0xaaaaaaaa));
+        CHECK(cache.stats().misses == 1);
+    }
+
+    SECTION("matches the module location, length and CRC") {
+        cache.add(FLASH_INTERNAL, ADDR, LENGTH, CRC);
+        CHECK(cache.find(FLASH_INTERNAL, ADDR, LENGTH, CRC));
+        CHECK_FALSE(cache.find(FLASH_SERIAL, ADDR, LENGTH, CRC));
+        CHECK_FALSE(cache.find(FLASH_INTERNAL, ADDR, LENGTH + 4, CRC));
+        CHECK_FALSE(cache.find(FLASH_INTERNAL, ADDR, LENGTH, CRC + 1));
+        CHECK(cache.stats().hits == 1);
+        CHECK(cache.stats().misses == 3);
+    }
+
+    SECTION("survives reinitialization unless the storage is corrupted") {
+        cache.add(FLASH_INTERNAL, ADDR, LENGTH, CRC);
+        ModuleValidationCache cache2(&storage);
+        cache2.init();
+        CHECK(cache2.find(FLASH_INTERNAL, ADDR, LENGTH, CRC));
+        storage.entries[0].length = LENGTH + 4;
+        ModuleValidationCache cache3(&storage);
+        cache3.init();
+        CHECK_FALSE(cache3.find(FLASH_INTERNAL, ADDR, LENGTH + 4, CRC));
+    }
+
+    SECTION("invalidates modules that overlap with a written range") {
+        cache.add(FLASH_INTERNAL, ADDR, LENGTH, CRC);
+        cache.add(FLASH_SERIAL, ADDR, LENGTH, CRC);
+        cache.invalidate(FLASH_INTERNAL, ADDR - 0x100, 0x100);
+        cache.invalidate(FLASH_INTERNAL, ADDR + LENGTH + 4, 0x100);
+        CHECK(cache.find(FLASH_INTERNAL, ADDR, LENGTH, CRC));
+        // The CRC is part of the module
+        cache.invalidate(FLASH_INTERNAL, ADDR + LENGTH + 3, 1);
+        CHECK_FALSE(cache.find(FLASH_INTERNAL, ADDR, LENGTH, CRC));
+        CHECK(cache.find(FLASH_SERIAL, ADDR, LENGTH, CRC));
+        cache.invalidate(FLASH_SERIAL, 0, 0x100000);
+        CHECK_FALSE(cache.find(FLASH_SERIAL, ADDR, LENGTH, CRC));
+        CHECK(cache.stats().invalidations == 2);
+    }
+
+    SECTION("replaces the entry for the same location") {
+        cache.add(FLASH_INTERNAL, ADDR, LENGTH, CRC);
+        cache.add(FLASH_INTERNAL, ADDR, LENGTH * 2, CRC + 1);
+        CHECK_FALSE(cache.find(FLASH_INTERNAL, ADDR, LENGTH, CRC));
+        CHECK(cache.find(FLASH_INTERNAL, ADDR, LENGTH * 2, CRC + 1));
+    }
+
+    SECTION("evicts the oldest entry") {
+        for (unsigned i = 0; i <= ModuleValidationCache::MAX_ENTRY_COUNT; ++i) {
+            cache.add(FLASH_INTERNAL, ADDR + i * LENGTH, LENGTH, CRC);
+        }
+        CHECK_FALSE(cache.find(FLASH_INTERNAL, ADDR, LENGTH, CRC));
+        for (unsigned i = 1; i <= ModuleValidationCache::MAX_ENTRY_COUNT; ++i) {
+            CHECK(cache.find(FLASH_INTERNAL, ADDR + i * LENGTH, LENGTH, CRC));
+        }
+    }
+}
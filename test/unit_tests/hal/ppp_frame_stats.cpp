@@ -0,0 +1,78 @@
+#include "ppp_frame_stats.h"
+
+#include <string>
+
+#include "catch2/catch.hpp"
+
+namespace {
+
+using namespace particle::net::ppp;
+
+// Encodes a frame the way PPPoS does (with a dummy FCS), all control characters are escaped
+std::string encodeFrame(const std::string& data) {
+    std::string frame = data + std::string("\x12\x34", 2);
+    std::string s(1, '\x7e');
+    for (char c: frame) {
+        if (c == '\x7e' || c == '\x7d' || (uint8_t)c < 0x20) {
+            s += '\x7d';
+            s += (char)(c ^ 0x20);
+        } else {
+            s += c;
+        }
+    }
+    return s;
+}
+
+void process(FrameStats& stats, const std::string& data) {
+    stats.process((const uint8_t*)data.data(), data.size());
+}
+
+} // unnamed
+
+TEST_CASE("FrameStats") {
+    FrameStats stats;
+
+    SECTION("doesn't count uncompressed frames as savings") {
+        // LCP Echo-Request
+        process(stats, encodeFrame(std::string("\xff\x03\xc0\x21\x09\x01\x00\x08\x00\x00\x00\x00", 12)) + "\x7e");
+        CHECK(stats.counters().frames == 1);
+        CHECK(stats.counters().hdrSaved == 0);
+        CHECK(stats.counters().vjSaved == 0);
+    }
+
+    SECTION("counts address/control and protocol field compression") {
+        const auto ip = std::string("\x21\x45\x00\x00\x14", 5);
+        // The closing flag of the first frame opens the second one
+        process(stats, encodeFrame(ip) + encodeFrame(std::string("\x00", 1) + ip) + "\x7e");
+        CHECK(stats.counters().frames == 2);
+        CHECK(stats.counters().hdrSaved == 3 + 2);
+    }
+
+    SECTION("counts VJ header compression") {
+        // NEW_C | NEW_A, connection number, TCP checksum, 1-byte ACK delta
+        process(stats, encodeFrame(std::string("\x2d\x44\x03\xab\xcd\x05\x01\x02", 8)) + "\x7e");
+        // SPECIAL_D, TCP checksum
+        process(stats, encodeFrame(std::string("\x2d\x0f\xab\xcd\x01\x02", 6)) + "\x7e");
+        // NEW_S with a 3-byte delta
+        process(stats, encodeFrame(std::string("\x2d\x08\xab\xcd\x00\x12\x34\x01", 8)) + "\x7e");
+        CHECK(stats.counters().frames == 3);
+        CHECK(stats.counters().vjFrames == 3);
+        CHECK(stats.counters().hdrSaved == 9);
+        CHECK(stats.counters().vjSaved == (40 - 5) + (40 - 3) + (40 - 6));
+    }
+
+    SECTION("reassembles frames split across writes") {
+        const auto data = encodeFrame(std::string("\x2d\x44\x03\x11\x13\x05\x01\x02", 8)) + "\x7e";
+        for (char c: data) {
+            process(stats, std::string(1, c));
+        }
+        CHECK(stats.counters().frames == 1);
+        CHECK(stats.counters().bytes == data.size());
+        CHECK(stats.counters().vjSaved == 40 - 5);
+    }
+
+    SECTION("ignores truncated VJ headers") {
+        CHECK(FrameStats::vjHeaderSize((const uint8_t*)"\x08\xab\xcd\x00\x12", 5) == 0);
+        CHECK(FrameStats::vjHeaderSize((const uint8_t*)"\x24\xab\xcd\x01\x02", 5) == 5);
+    }
+}
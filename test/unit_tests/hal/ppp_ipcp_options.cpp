@@ -0,0 +1,82 @@
+#include "ppp_ipcp_options.h"
+
+#include <cstring>
+
+#include "catch2/catch.hpp"
+
+namespace {
+
+using namespace particle::net::ppp;
+using namespace particle::net::ppp::ipcp;
+
+const uint8_t VJ_OPTION[] = { CONFIGURATION_OPTION_IP_COMPRESSION_PROTOCOL, 6, 0x00, 0x2d, 15, 1 };
+
+// Our Configure-Request as sent to the peer and echoed back in its Configure-Ack
+void ackLocalRequest(IpCompressionProtocolConfigurationOption& opt) {
+    uint8_t buf[16] = {};
+    const int n = opt.sendConfigureReq(buf, sizeof(buf));
+    REQUIRE(n == (int)sizeof(VJ_OPTION));
+    REQUIRE(opt.recvConfigureAck(buf, n) == n);
+}
+
+} // unnamed
+
+TEST_CASE("IpCompressionProtocolConfigurationOption") {
+    IpCompressionProtocolConfigurationOption opt;
+    opt.reset();
+    uint8_t buf[16] = {};
+
+    SECTION("negotiates receiving only if the peer acknowledged our request but didn't ask for VJ") {
+        ackLocalRequest(opt);
+        CHECK(opt.stateLocal == CONFIGURATION_OPTION_STATE_ACK);
+        CHECK(opt.isReceiveNegotiated());
+        CHECK_FALSE(opt.isSendNegotiated());
+    }
+
+    SECTION("negotiates sending only if the peer asked for VJ but rejected our request") {
+        memcpy(buf, VJ_OPTION, sizeof(VJ_OPTION));
+        CHECK(opt.recvConfigureReq(buf, sizeof(VJ_OPTION)) == (int)sizeof(VJ_OPTION));
+        CHECK(opt.statePeer == CONFIGURATION_OPTION_STATE_ACK);
+        uint8_t rej[16] = {};
+        const int n = opt.sendConfigureReq(rej, sizeof(rej));
+        CHECK(opt.recvConfigureRej(rej, n) == n);
+        CHECK(opt.isSendNegotiated());
+        CHECK_FALSE(opt.isReceiveNegotiated());
+        CHECK(opt.peerMaxSlotId == 15);
+        CHECK(opt.peerCompSlotId == 1);
+    }
+
+    SECTION("negotiates both directions") {
+        memcpy(buf, VJ_OPTION, sizeof(VJ_OPTION));
+        CHECK(opt.recvConfigureReq(buf, sizeof(VJ_OPTION)) == (int)sizeof(VJ_OPTION));
+        ackLocalRequest(opt);
+        CHECK(opt.isSendNegotiated());
+        CHECK(opt.isReceiveNegotiated());
+    }
+
+    SECTION("adopts the slot parameters from a Configure-Nak") {
+        const uint8_t nak[] = { CONFIGURATION_OPTION_IP_COMPRESSION_PROTOCOL, 6, 0x00, 0x2d, 7, 0 };
+        memcpy(buf, nak, sizeof(nak));
+        CHECK(opt.recvConfigureNak(buf, sizeof(nak)) == (int)sizeof(nak));
+        CHECK_FALSE(opt.isReceiveNegotiated());
+        CHECK(opt.localMaxSlotId == 7);
+        CHECK(opt.localCompSlotId == 0);
+        ackLocalRequest(opt);
+        CHECK(opt.isReceiveNegotiated());
+    }
+
+    SECTION("rejects other compression protocols") {
+        const uint8_t other[] = { CONFIGURATION_OPTION_IP_COMPRESSION_PROTOCOL, 4, 0x00, 0x61 };
+        memcpy(buf, other, sizeof(other));
+        CHECK(opt.recvConfigureReq(buf, sizeof(other)) == (int)sizeof(other));
+        CHECK(opt.statePeer == CONFIGURATION_OPTION_STATE_REJ);
+        CHECK_FALSE(opt.isSendNegotiated());
+    }
+
+    SECTION("negotiates nothing after a reset") {
+        ackLocalRequest(opt);
+        opt.reset();
+        CHECK_FALSE(opt.isReceiveNegotiated());
+        CHECK_FALSE(opt.isSendNegotiated());
+    }
+}
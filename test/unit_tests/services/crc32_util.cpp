@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "crc32_util.h"
+
+#include "util/random.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+// Bitwise reference implementation
+uint32_t crc32Ref(const std::string& data, uint32_t crc = 0) {
+    crc = ~crc;
+    for (unsigned char b: data) {
+        crc ^= b;
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+TEST_CASE("crc32_calc()") {
+    SECTION("computes the standard CRC-32") {
+        CHECK(crc32_calc("123456789", 9, 0) == 0xcbf43926);
+        CHECK(crc32_calc(nullptr, 0, 0) == 0);
+        CHECK(crc32_calc("", 0, 0x12345678) == 0x12345678);
+    }
+
+    SECTION("matches the reference implementation for any size and alignment") {
+        const auto data = particle::test::randString(256 + 8);
+        for (size_t offs = 0; offs < 8; ++offs) {
+            for (size_t size = 0; size <= 256; ++size) {
+                const auto s = data.substr(offs, size);
+                CHECK(crc32_calc(data.data() + offs, size, 0) == crc32Ref(s));
+            }
+        }
+    }
+
+    SECTION("can be computed incrementally") {
+        const auto data = particle::test::randString(1000);
+        const uint32_t crc = crc32Ref(data);
+        for (size_t n = 0; n <= data.size(); n += 37) {
+            uint32_t c = crc32_calc(data.data(), n, 0);
+            c = crc32_calc(data.data() + n, data.size() - n, c);
+            CHECK(c == crc);
+            uint32_t state = CRC32_CALC_INIT;
+            state = crc32_calc_update(state, data.data(), n);
+            state = crc32_calc_update(state, data.data() + n, data.size() - n);
+            CHECK(crc32_calc_final(state) == crc);
+        }
+    }
+}
+
+TEST_CASE("crc32_calc_update() benchmark", "[.][benchmark]") {
+    const size_t size = 64 * 1024;
+    const unsigned count = 2000;
+    const auto data = particle::test::randString(size);
+    uint32_t state = CRC32_CALC_INIT;
+    const auto start = std::chrono::steady_clock::now();
+    const auto startCycles = cycles();
+    for (unsigned i = 0; i < count; ++i) {
+        state = crc32_calc_update(state, data.data(), data.size());
+    }
+    const auto endCycles = cycles();
+    const std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    const double bytes = (double)size * count;
+    std::cout << "crc32_calc_update(): " << (unsigned long)(bytes / d.count() / (1024 * 1024)) << " MB/s";
+    if (endCycles > startCycles) {
+        std::cout << ", " << bytes / (endCycles - startCycles) << " bytes/cycle";
+    }
+    std::cout << std::endl;
+    CHECK(state != 0);
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "delta_patch.h"
+#include "flash_storage.h"
+
+#include "util/random.h"
+
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+using namespace particle;
+
+const unsigned FLASH_BASE = 0x100000;
+const unsigned FLASH_SECTOR_SIZE = 4096;
+const unsigned FLASH_SECTOR_COUNT = 64;
+
+// The base image is stored in the lower half of the flash, the patched image is written to the upper half
+const unsigned BASE_ADDRESS = FLASH_BASE;
+const unsigned TARGET_ADDRESS = FLASH_BASE + FLASH_SECTOR_SIZE * FLASH_SECTOR_COUNT / 2;
+const size_t MAX_IMAGE_SIZE = FLASH_SECTOR_SIZE * FLASH_SECTOR_COUNT / 2;
+
+typedef RAMFlashStorage<FLASH_BASE, FLASH_SECTOR_COUNT, FLASH_SECTOR_SIZE> Flash;
+
+template<typename T>
+T randomNumber(T min, T max) {
+    std::uniform_int_distribution<T> dist(min, max);
+    return dist(test::randGen());
+}
+
+class PatchBuilder {
+public:
+    PatchBuilder& copy(size_t offset, size_t length) {
+        patch_ += (char)DeltaPatcher::COPY;
+        appendVarint(offset);
+        appendVarint(length);
+        return *this;
+    }
+
+    PatchBuilder& add(size_t offset, const std::string& data) {
+        patch_ += (char)DeltaPatcher::ADD;
+        appendVarint(offset);
+        appendVarint(data.size());
+        patch_ += data;
+        return *this;
+    }
+
+    PatchBuilder& insert(const std::string& data) {
+        patch_ += (char)DeltaPatcher::INSERT;
+        appendVarint(data.size());
+        patch_ += data;
+        return *this;
+    }
+
+    const std::string& data() const {
+        return patch_;
+    }
+
+private:
+    std::string patch_;
+
+    void appendVarint(size_t val) {
+        char buf[maxUnsignedVarintSize<uint32_t>()];
+        const int n = encodeUnsignedVarint(buf, sizeof(buf), (uint32_t)val);
+        patch_.append(buf, n);
+    }
+};
+
+// A simple greedy diff. Matching blocks are encoded as COPY, modified bytes that replace the same
+// number of bytes in the base image as ADD, and everything else as INSERT
+std::string makePatch(const std::string& base, const std::string& target) {
+    const size_t BLOCK_SIZE = 16;
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i + BLOCK_SIZE <= base.size(); ++i) {
+        index.emplace(base.substr(i, BLOCK_SIZE), i);
+    }
+    PatchBuilder patch;
+    size_t baseOffs = 0; // End of the last copied block in the base image
+    size_t literalStart = 0;
+    size_t i = 0;
+    auto flushLiteral = [&](size_t end, size_t nextBaseOffs) {
+        if (literalStart == end) {
+            return;
+        }
+        const auto literal = target.substr(literalStart, end - literalStart);
+        if (nextBaseOffs - baseOffs == literal.size()) {
+            std::string diff;
+            for (size_t j = 0; j < literal.size(); ++j) {
+                diff += (char)((uint8_t)literal[j] - (uint8_t)base[baseOffs + j]);
+            }
+            patch.add(baseOffs, diff);
+        } else {
+            patch.insert(literal);
+        }
+    };
+    while (i < target.size()) {
+        const auto it = (i + BLOCK_SIZE <= target.size()) ? index.find(target.substr(i, BLOCK_SIZE)) : index.end();
+        if (it == index.end()) {
+            ++i;
+            continue;
+        }
+        size_t srcOffs = it->second;
+        size_t len = BLOCK_SIZE;
+        while (i + len < target.size() && srcOffs + len < base.size() && target[i + len] == base[srcOffs + len]) {
+            ++len;
+        }
+        flushLiteral(i, srcOffs);
+        patch.copy(srcOffs, len);
+        i += len;
+        baseOffs = srcOffs + len;
+        literalStart = i;
+    }
+    flushLiteral(target.size(), std::string::npos /* Never an ADD at the end */);
+    return patch.data();
+}
+
+std::string mutate(std::string data, unsigned count) {
+    for (unsigned i = 0; i < count; ++i) {
+        const size_t offs = randomNumber<size_t>(0, data.size() - 1);
+        switch (randomNumber(0, 3)) {
+        case 0: // Replace a few bytes
+            data.replace(offs, 4, test::randString(4));
+            break;
+        case 1: // Insert some bytes
+            data.insert(offs, test::randString(randomNumber(1, 100)));
+            break;
+        case 2: // Remove some bytes
+            data.erase(offs, randomNumber(1, 100));
+            break;
+        default: { // Relocate an address
+            if (offs + 4 <= data.size()) {
+                uint32_t addr = 0;
+                memcpy(&addr, data.data() + offs, 4);
+                addr += 0x100;
+                memcpy(&data[offs], &addr, 4);
+            }
+            break;
+        }
+        }
+    }
+    return data.substr(0, MAX_IMAGE_SIZE);
+}
+
+class PatchTest {
+public:
+    PatchTest() :
+            flash_(new Flash()),
+            targetSize_(0) {
+        for (unsigned i = 0; i < FLASH_SECTOR_COUNT; ++i) {
+            flash_->eraseSector(FLASH_BASE + i * FLASH_SECTOR_SIZE);
+        }
+    }
+
+    PatchTest& base(const std::string& data) {
+        REQUIRE(data.size() <= MAX_IMAGE_SIZE);
+        REQUIRE(flash_->write(BASE_ADDRESS, data.data(), data.size()) == 0);
+        base_ = data;
+        return *this;
+    }
+
+    int apply(const std::string& patch, size_t targetSize, size_t maxFragmentSize = 0) {
+        targetSize_ = targetSize;
+        patcher_.init(base_.size(), targetSize, readBase, writeTarget, this);
+        size_t offs = 0;
+        while (offs < patch.size() && !patcher_.isDone()) {
+            size_t n = patch.size() - offs;
+            if (maxFragmentSize) {
+                n = std::min(n, randomNumber<size_t>(1, maxFragmentSize));
+            }
+            const int r = patcher_.update(patch.data() + offs, n);
+            if (r < 0) {
+                return r;
+            }
+            offs += r;
+        }
+        return offs;
+    }
+
+    std::string target() const {
+        return std::string((const char*)flash_->dataAt(TARGET_ADDRESS), patcher_.targetOffset());
+    }
+
+    const DeltaPatcher& patcher() const {
+        return patcher_;
+    }
+
+private:
+    std::unique_ptr<Flash> flash_;
+    DeltaPatcher patcher_;
+    std::string base_;
+    size_t targetSize_;
+
+    static int readBase(size_t offset, char* data, size_t size, void* userData) {
+        const auto self = (PatchTest*)userData;
+        REQUIRE(offset + size <= self->base_.size());
+        return self->flash_->read(BASE_ADDRESS + offset, data, size);
+    }
+
+    static int writeTarget(const char* data, size_t size, void* userData) {
+        const auto self = (PatchTest*)userData;
+        REQUIRE(self->patcher_.targetOffset() + size <= self->targetSize_);
+        return self->flash_->write(TARGET_ADDRESS + self->patcher_.targetOffset(), data, size);
+    }
+};
+
+} // namespace
+
+TEST_CASE("DeltaPatcher") {
+    PatchTest test;
+
+    SECTION("applies each kind of instruction") {
+        const std::string base = "0123456789abcdef";
+        test.base(base);
+        const std::string diff = { 1, 1, 1, 0 };
+        const auto patch = PatchBuilder().copy(10, 6).insert("xyz").add(0, diff).copy(0, 2).data();
+        CHECK(test.apply(patch, 15) == (int)patch.size());
+        CHECK(test.patcher().isDone());
+        CHECK(test.target() == "abcdefxyz1233" "01");
+    }
+
+    SECTION("reconstructs a modified image") {
+        const auto base = test::randString(50000);
+        const auto target = mutate(base, 20);
+        const auto patch = makePatch(base, target);
+        test.base(base);
+        CHECK(test.apply(patch, target.size()) == (int)patch.size());
+        CHECK(test.patcher().isDone());
+        CHECK(test.target() == target);
+        // Sanity check for the diff
+        CHECK(patch.size() < target.size() / 10);
+    }
+
+    SECTION("can process the patch in fragments of arbitrary size") {
+        for (unsigned i = 0; i < 50; ++i) {
+            const auto base = test::randString(randomNumber(1000, 20000));
+            const auto target = mutate(base, randomNumber(1, 50));
+            const auto patch = makePatch(base, target);
+            test.base(base);
+            REQUIRE(test.apply(patch, target.size(), randomNumber(1, 300)) == (int)patch.size());
+            REQUIRE(test.target() == target);
+            PatchTest t; // Clean flash
+            std::swap(test, t);
+        }
+    }
+
+    SECTION("stops at the end of the patch") {
+        test.base("0123456789");
+        const auto patch = PatchBuilder().copy(0, 10).data();
+        CHECK(test.apply(patch + "trailing data", 10) == (int)patch.size());
+        CHECK(test.target() == "0123456789");
+    }
+
+    SECTION("fails if an instruction refers to data outside of the base image") {
+        test.base("0123456789");
+        CHECK(test.apply(PatchBuilder().copy(5, 6).data(), 6) == SYSTEM_ERROR_BAD_DATA);
+        CHECK(test.apply(PatchBuilder().add(11, "x").data(), 1) == SYSTEM_ERROR_BAD_DATA);
+    }
+
+    SECTION("fails if the reconstructed data would exceed the target size") {
+        test.base("0123456789");
+        CHECK(test.apply(PatchBuilder().copy(0, 10).data(), 9) == SYSTEM_ERROR_BAD_DATA);
+        CHECK(test.apply(PatchBuilder().insert("abc").data(), 2) == SYSTEM_ERROR_BAD_DATA);
+    }
+
+    SECTION("fails on an unknown opcode") {
+        test.base("0123456789");
+        CHECK(test.apply(std::string("\x7f\x00\x01", 3), 1) == SYSTEM_ERROR_BAD_DATA);
+    }
+
+    SECTION("uses a bounded amount of RAM") {
+        CHECK(sizeof(DeltaPatcher) <= 256);
+    }
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "eeprom_shadow.h"
+#include "eeprom_emulation.h"
+#include "flash_storage.h"
+
+#include "util/random.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace {
+
+using namespace particle;
+
+const uintptr_t FLASH_BASE = 0xC000;
+const size_t FLASH_PAGE_SIZE = 0x4000;
+
+typedef RAMFlashStorage<FLASH_BASE, 2, FLASH_PAGE_SIZE> Flash;
+typedef EEPROMEmulation<Flash, FLASH_BASE, FLASH_PAGE_SIZE, FLASH_BASE + FLASH_PAGE_SIZE, FLASH_PAGE_SIZE> Eeprom;
+
+const size_t EEPROM_SIZE = Eeprom::capacity();
+const size_t BLOCK_SIZE = 32;
+const size_t LAST_BLOCK_SIZE = (EEPROM_SIZE - 1) % BLOCK_SIZE + 1;
+
+// Counts the accesses to the emulated EEPROM
+class Storage {
+public:
+    unsigned gets = 0;
+    unsigned puts = 0;
+    unsigned bytesPut = 0;
+    bool failGets = false;
+    bool failPuts = false;
+
+    Storage() :
+            eeprom_(new Eeprom()) {
+        eeprom_->init();
+    }
+
+    int get(size_t index, void* data, size_t length) {
+        ++gets;
+        if (failGets) {
+            return -1;
+        }
+        eeprom_->get(index, data, length);
+        return 0;
+    }
+
+    int put(size_t index, const void* data, size_t length) {
+        ++puts;
+        if (failPuts) {
+            return -1;
+        }
+        eeprom_->put(index, data, length);
+        bytesPut += length;
+        return 0;
+    }
+
+    std::string read(size_t index, size_t length) {
+        std::string s(length, '\0');
+        eeprom_->get(index, &s[0], length);
+        return s;
+    }
+
+    // Re-reads the records from flash
+    void reload() {
+        eeprom_->init();
+    }
+
+    Eeprom& eeprom() {
+        return *eeprom_;
+    }
+
+private:
+    std::unique_ptr<Eeprom> eeprom_;
+};
+
+typedef EEPROMShadow<Storage, EEPROM_SIZE, BLOCK_SIZE> Shadow;
+
+std::string get(Shadow& shadow, size_t index, size_t length) {
+    std::string s(length, '\0');
+    shadow.get(index, &s[0], length);
+    return s;
+}
+
+void put(Shadow& shadow, size_t index, const std::string& data) {
+    shadow.put(index, data.data(), data.size());
+}
+
+} // namespace
+
+TEST_CASE("EEPROMShadow") {
+    Storage storage;
+    storage.eeprom().put(10, "abc", 3);
+    Shadow shadow(&storage);
+
+    SECTION("loads the data from the storage on first access") {
+        CHECK(storage.gets == 0);
+        CHECK(get(shadow, 10, 3) == "abc");
+        CHECK(get(shadow, 0, 1) == "\xff");
+        CHECK(storage.gets == 1);
+    }
+
+    SECTION("doesn't write to the storage until flushed") {
+        put(shadow, 20, "xyz");
+        put(shadow, 21, "Y");
+        CHECK(get(shadow, 20, 3) == "xYz");
+        CHECK(shadow.hasPendingWrites());
+        CHECK(storage.puts == 0);
+        CHECK(storage.read(20, 3) == "\xff\xff\xff");
+        shadow.flush();
+        CHECK_FALSE(shadow.hasPendingWrites());
+        CHECK(storage.puts == 1);
+        CHECK(storage.read(20, 3) == "xYz");
+        storage.reload();
+        CHECK(storage.read(20, 3) == "xYz");
+    }
+
+    SECTION("writes each run of dirty blocks with a single storage write") {
+        put(shadow, 0, "a");
+        put(shadow, BLOCK_SIZE * 2 - 1, "bc"); // Spans two blocks
+        put(shadow, BLOCK_SIZE * 4, "d");
+        put(shadow, EEPROM_SIZE - 1, "e");
+        shadow.flush();
+        CHECK(storage.puts == 3);
+        CHECK(storage.bytesPut == BLOCK_SIZE * 4 + LAST_BLOCK_SIZE);
+        CHECK(storage.read(0, 1) == "a");
+        CHECK(storage.read(BLOCK_SIZE * 2 - 1, 2) == "bc");
+        CHECK(storage.read(BLOCK_SIZE * 4, 1) == "d");
+        CHECK(storage.read(EEPROM_SIZE - 1, 1) == "e");
+        CHECK(storage.read(10, 3) == "abc");
+        shadow.flush();
+        CHECK(storage.puts == 3);
+    }
+
+    SECTION("ignores writes that don't change the data") {
+        put(shadow, 10, "abc");
+        CHECK_FALSE(shadow.hasPendingWrites());
+        put(shadow, 10, "abd");
+        put(shadow, 10, "abc");
+        shadow.flush();
+        CHECK(storage.puts == 1);
+        CHECK(storage.read(10, 3) == "abc");
+    }
+
+    SECTION("ignores data outside of the EEPROM range") {
+        put(shadow, EEPROM_SIZE - 2, "1234");
+        put(shadow, EEPROM_SIZE, "5");
+        CHECK(get(shadow, EEPROM_SIZE - 2, 4) == std::string("12\0\0", 4));
+        shadow.flush();
+        CHECK(storage.bytesPut == LAST_BLOCK_SIZE);
+        CHECK(storage.read(EEPROM_SIZE - 2, 2) == "12");
+    }
+
+    SECTION("keeps the blocks dirty if they can't be written") {
+        put(shadow, 20, "xyz");
+        put(shadow, BLOCK_SIZE * 4, "d");
+        storage.failPuts = true;
+        CHECK(shadow.flush() < 0);
+        CHECK(shadow.hasPendingWrites());
+        CHECK(storage.read(20, 3) == "\xff\xff\xff");
+        storage.failPuts = false;
+        CHECK(shadow.flush() == 0);
+        CHECK_FALSE(shadow.hasPendingWrites());
+        CHECK(storage.read(20, 3) == "xyz");
+        CHECK(storage.read(BLOCK_SIZE * 4, 1) == "d");
+    }
+
+    SECTION("retries loading the data if it can't be read") {
+        storage.failGets = true;
+        std::string s = "123";
+        CHECK(shadow.get(10, &s[0], s.size()) < 0);
+        CHECK(s == "123");
+        CHECK(shadow.put(20, "xyz", 3) < 0);
+        CHECK_FALSE(shadow.hasPendingWrites());
+        storage.failGets = false;
+        CHECK(get(shadow, 10, 3) == "abc");
+        CHECK(storage.gets == 3);
+    }
+
+    SECTION("discards the unflushed changes when reset") {
+        put(shadow, 10, "xyz");
+        shadow.reset();
+        CHECK_FALSE(shadow.hasPendingWrites());
+        storage.eeprom().put(13, "d", 1);
+        CHECK(get(shadow, 10, 4) == "abcd");
+        CHECK(storage.gets == 2);
+        shadow.flush();
+        CHECK(storage.puts == 0);
+    }
+
+    SECTION("matches the storage after random writes") {
+        std::string expected = storage.read(0, EEPROM_SIZE);
+        for (unsigned i = 0; i < 500; ++i) {
+            const size_t index = std::uniform_int_distribution<size_t>(0, EEPROM_SIZE - 1)(test::randGen());
+            const size_t length = std::uniform_int_distribution<size_t>(1, std::min<size_t>(16, EEPROM_SIZE - index))(test::randGen());
+            const auto data = test::randString(length);
+            put(shadow, index, data);
+            expected.replace(index, length, data);
+            if (i % 50 == 0) {
+                shadow.flush();
+            }
+        }
+        REQUIRE(get(shadow, 0, EEPROM_SIZE) == expected);
+        shadow.flush();
+        storage.reload();
+        CHECK(storage.read(0, EEPROM_SIZE) == expected);
+    }
+}
+
+TEST_CASE("EEPROMShadow benchmark", "[.][benchmark]") {
+    // Simulates an application that updates a few counters in a tight loop
+    const unsigned count = 20000;
+    const unsigned flushInterval = 1000; // Number of writes between flushes
+    const size_t counterCount = 8;
+    const auto run = [=](const char* name, Storage* storage, Shadow* shadow) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < count; ++i) {
+            const size_t index = (i % counterCount) * 16;
+            if (shadow) {
+                shadow->put(index, &i, sizeof(i));
+                if ((i + 1) % flushInterval == 0) {
+                    shadow->flush();
+                }
+            } else {
+                storage->put(index, &i, sizeof(i));
+            }
+        }
+        if (shadow) {
+            shadow->flush();
+        }
+        const std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << (unsigned long)(count / d.count()) << " puts/s, " << storage->puts <<
+                " storage writes, " << storage->bytesPut << " bytes" << std::endl;
+        uint32_t last = 0;
+        storage->get((count - 1) % counterCount * 16, &last, sizeof(last));
+        CHECK(last == count - 1);
+    };
+    {
+        Storage storage;
+        run("EEPROMEmulation", &storage, nullptr);
+    }
+    {
+        Storage storage;
+        std::unique_ptr<Shadow> shadow(new Shadow(&storage));
+        run("EEPROMShadow", &storage, shadow.get());
+    }
+}
@@ -0,0 +1,132 @@
+#include "spark_wiring_json.h"
+
+#include "catch2/catch.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace {
+
+using namespace spark;
+
+class PrintBuffer: public Print {
+public:
+    PrintBuffer() :
+            size_(0) {
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+        const size_t n = std::min(size, sizeof(buf_) - size_);
+        memcpy(buf_ + size_, data, n);
+        size_ += n;
+        return n;
+    }
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    std::string data() const {
+        return std::string(buf_, size_);
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+
+private:
+    char buf_[1024];
+    size_t size_;
+};
+
+// Builds a document similar to the device vitals and other telemetry events
+void writeEvent(JSONWriter& w, unsigned seq) {
+    w.beginObject();
+    w.name("seq").value(seq);
+    w.name("time").value(1600000000ul + seq);
+    w.name("device").beginObject();
+    w.name("uptime").value(seq * 10);
+    w.name("mem_free").value(81234);
+    w.name("batt").value(87.4f, 1);
+    w.name("temp").value(-12.3456);
+    w.endObject();
+    w.name("net").beginObject();
+    w.name("rssi").value(-71);
+    w.name("qual").value(0.625);
+    w.name("cell").value("310-410-3a2f-b0c1");
+    w.endObject();
+    w.name("msg").value("sensor \"A\" ok\n");
+    w.endObject();
+}
+
+const char* const EXPECTED_EVENT = "{\"seq\":1,\"time\":1600000001,\"device\":{\"uptime\":10,\"mem_free\":81234,"
+        "\"batt\":87.4,\"temp\":-12.3456},\"net\":{\"rssi\":-71,\"qual\":0.625,\"cell\":\"310-410-3a2f-b0c1\"},"
+        "\"msg\":\"sensor \\\"A\\\" ok\\n\"}";
+
+template<typename F>
+double eventsPerSecond(unsigned count, F fn) {
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < count; ++i) {
+        fn(i);
+    }
+    const std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return count / d.count();
+}
+
+} // namespace
+
+TEST_CASE("JSONWriter") {
+    SECTION("buffer and stream writers produce the same output") {
+        char buf[1024];
+        JSONBufferWriter bw(buf, sizeof(buf));
+        writeEvent(bw, 1);
+        PrintBuffer p;
+        JSONStreamWriter sw(p);
+        writeEvent(sw, 1);
+        CHECK(std::string(buf, bw.dataSize()) == EXPECTED_EVENT);
+        CHECK(p.data() == EXPECTED_EVENT);
+    }
+
+    SECTION("buffer writer reports the full size when the buffer is too small") {
+        char buf[16] = {};
+        JSONBufferWriter w(buf, sizeof(buf));
+        writeEvent(w, 1);
+        CHECK(w.dataSize() == strlen(EXPECTED_EVENT));
+        CHECK(std::string(buf, sizeof(buf)) == std::string(EXPECTED_EVENT, sizeof(buf)));
+        JSONBufferWriter w2(nullptr, 0);
+        writeEvent(w2, 1);
+        CHECK(w2.dataSize() == strlen(EXPECTED_EVENT));
+    }
+    SECTION("writes non-ASCII characters as is") {
+        const std::string str = "Temp\xc3\xa9rature 25\xc2\xb0" "C \xe2\x82\xac \xf0\x9f\x98\x80\t";
+        char buf[64];
+        JSONBufferWriter w(buf, sizeof(buf));
+        w.value(str.data(), str.size());
+        REQUIRE(w.dataSize() <= sizeof(buf));
+        const std::string json(buf, w.dataSize());
+        CHECK(json == "\"" + str.substr(0, str.size() - 1) + "\\t\"");
+        const auto v = JSONValue::parseCopy(json.data(), json.size());
+        REQUIRE(v.isString());
+        CHECK(std::string(v.toString().data(), v.toString().size()) == str);
+    }
+}
+
+TEST_CASE("JSONWriter benchmark", "[.][benchmark]") {
+    const unsigned count = 200000;
+    char buf[1024];
+    const double bufRate = eventsPerSecond(count, [&](unsigned i) {
+        JSONBufferWriter w(buf, sizeof(buf));
+        writeEvent(w, i);
+    });
+    PrintBuffer p;
+    const double strmRate = eventsPerSecond(count, [&](unsigned i) {
+        p.clear();
+        JSONStreamWriter w(p);
+        writeEvent(w, i);
+    });
+    std::cout << "JSONBufferWriter: " << (unsigned long)bufRate << " events/s" << std::endl;
+    std::cout << "JSONStreamWriter: " << (unsigned long)strmRate << " events/s" << std::endl;
+    CHECK(bufRate > 0);
+    CHECK(strmRate > 0);
+}
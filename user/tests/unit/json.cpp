@@ -10,6 +10,8 @@
 #include <string>
 #include <cstdlib>
 #include <cfloat> // for constants
+#include <climits>
+#include <cmath>
 
 namespace {
 
@@ -1116,4 +1118,39 @@ TEST_CASE("JSONBufferWriter") {
         CHECK(w.dataSize() == 25); // Size of the actual JSON data
         CHECK(buf.isPaddingValid());
     }
+
+    SECTION("numbers are formatted the same way as printf()") {
+        char buf[512];
+        char expected[512];
+        const auto checkValue = [&](double val, int precision) {
+            JSONBufferWriter w(buf, sizeof(buf));
+            if (precision < 0) {
+                w.value(val);
+                snprintf(expected, sizeof(expected), "%g", val);
+            } else {
+                w.value(val, precision);
+                snprintf(expected, sizeof(expected), "%.*lf", precision, val);
+            }
+            REQUIRE(w.dataSize() < sizeof(buf));
+            buf[w.dataSize()] = '\0';
+            CHECK(std::string(buf) == std::string(expected));
+        };
+        const double values[] = { 0.0, -0.0, 1.0, 0.5, 0.125, 0.375, 1.005, 2.675, 9.9999996, 99999.95, 999999.4,
+                999999.5, 0.0001, 0.00009999996, 123456.789, 1e15, 1e-20, DBL_MAX, DBL_MIN };
+        for (double val: values) {
+            for (int precision = -1; precision <= 12; ++precision) {
+                checkValue(val, precision);
+                checkValue(-val, precision);
+            }
+        }
+        for (int i = 0; i < 10000; ++i) {
+            const double val = (std::rand() - RAND_MAX / 2) / std::pow(10.0, std::rand() % 12);
+            checkValue(val, std::rand() % 12 - 1);
+        }
+        JSONBufferWriter w(buf, sizeof(buf));
+        w.beginArray().value(LONG_MIN).value(LONG_MAX).value(ULONG_MAX).value(INT_MIN).value(UINT_MAX).endArray();
+        buf[w.dataSize()] = '\0';
+        snprintf(expected, sizeof(expected), "[%ld,%ld,%lu,%d,%u]", LONG_MIN, LONG_MAX, ULONG_MAX, INT_MIN, UINT_MAX);
+        CHECK(std::string(buf) == std::string(expected));
+    }
 }
@@ -2,6 +2,9 @@
 #include "catch.hpp"
 #include "spark_wiring_print.h"
 
+#include <cstdio>
+#include <string>
+
 
 class BufferPrint : public Print
 {
@@ -56,3 +59,62 @@ SCENARIO("Print.printf() with a a > 20 char string", "[print]")
     print.printf("abcdabcdabcdabcd %d xyzxyzxyzxyzxyzxyzxyzxyz", 100);
     REQUIRE(String("abcdabcdabcdabcd 100 xyzxyzxyzxyzxyzxyzxyzxyz") == print.result());
 }
+
+SCENARIO("Print.printf() with a long string is written in chunks", "[print]")
+{
+    class ChunkPrint : public Print
+    {
+    public:
+        std::string value;
+        size_t writes = 0;
+
+        size_t write(uint8_t c) override
+        {
+            return write(&c, 1);
+        }
+
+        size_t write(const uint8_t* data, size_t size) override
+        {
+            value.append((const char*)data, size);
+            ++writes;
+            return size;
+        }
+    };
+
+    ChunkPrint print;
+    const std::string s(1000, 'x');
+    const size_t n = print.printlnf("%d %s %d", 1, s.c_str(), 2);
+    REQUIRE(print.value == "1 " + s + " 2\r\n");
+    REQUIRE(n == print.value.size());
+    REQUIRE(print.writes <= 3);
+}
+
+SCENARIO("Print.printf() produces the same output as vsnprintf()", "[print]")
+{
+    char expected[256];
+    const auto check = [&](const char* fmt, auto... args) {
+        BufferPrint print;
+        const size_t n = print.printf(fmt, args...);
+        snprintf(expected, sizeof(expected), fmt, args...);
+        CHECK(std::string(print.result().c_str()) == std::string(expected));
+        CHECK(n == strlen(expected));
+    };
+    check("%%");
+    check("a%5sb%-5sc%.2s|", "xy", "xy", "xyz");
+    check("%*s|%-*s|%.*s|", 4, "a", 4, "b", 1, "cd");
+    check("%*s|", -4, "a");
+    check("%s", (const char*)nullptr);
+    check("%d %i %u %x %X %o", -123, 456, 789u, 0xabcu, 0xdefu, 8u);
+    check("%+05d|% d|%-6d|%#x|%#o", 42, 42, 42, 255u, 8u);
+    check("%hhd %hd %ld %lld %zu %jd", 300, 70000, -1L, -1LL, (size_t)12345, (intmax_t)-9);
+    check("%lu %llu %llx", 123456789UL, 18446744073709551615ULL, 0x123456789abcdefULL);
+    check("%f %.2f %10.3f %-10.1f| %e %g %G", 3.14159, 2.675, -1.5, 0.25, 12345.678, 0.0001, 1e20);
+    check("%*.*f", 12, 4, 3.14159);
+    check("%f", 1e100);
+    check("%c%c%5c", 'a', 'b', 'c');
+    check("%p", (void*)0x1234);
+    int count = 0;
+    BufferPrint print;
+    print.printf("abc%n def", &count);
+    CHECK(count == 3);
+}
@@ -197,6 +197,7 @@ struct BlePairingEvent {
 
 typedef hal_ble_conn_handle_t BleConnectionHandle;
 typedef hal_ble_attr_handle_t BleAttributeHandle;
+typedef hal_ble_stream_stats_t BleStreamStats;
 
 typedef void (*BleOnDataReceivedCallback)(const uint8_t* data, size_t len, const BlePeerDevice& peer, void* context);
 typedef void (*BleOnScanResultCallback)(const BleScanResult* result, void* context);
@@ -598,6 +599,9 @@ public:
         return setValue(reinterpret_cast<const uint8_t*>(&val), sizeof(T), type);
     }
 
+    // Valid for local characteristic only. Streams data of arbitrary length to subscribers using back-to-back notifications.
+    ssize_t streamValue(const uint8_t* buf, size_t len, BleStreamStats* stats = nullptr);
+
     // Valid for peer characteristic only. Manually enable the characteristic notification or indication.
     int subscribe(bool enable) const;
 
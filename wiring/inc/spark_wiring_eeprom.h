@@ -118,6 +118,11 @@ struct EEPtr{
     This object represents the entire EEPROM space.
     It wraps the functionality of EEPtr and EERef into a basic interface.
     This class is also 100% backwards compatible with earlier Arduino core releases.
+
+    On some platforms, writes are buffered in RAM and written to the underlying storage
+    by the system a short time after the first unwritten change, before the device
+    resets and before it enters sleep mode. Changes that haven't been written yet are
+    lost if the device loses power. Call flush() to write them immediately.
 ***/
 
 struct EEPROMClass{
@@ -166,6 +171,13 @@ struct EEPROMClass{
     {
         HAL_EEPROM_Perform_Pending_Erase();
     }
+
+    // Writes the buffered changes to the underlying storage. Returns 0 on success or a
+    // negative result code in case of an error
+    int flush()
+    {
+        return hal_eeprom_flush(true /* force */, nullptr /* reserved */);
+    }
 };
 
 #define EEPROM __fetch_global_EEPROM()
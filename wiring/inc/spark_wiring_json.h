@@ -23,6 +23,7 @@
 
 #include "jsmn.h"
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
 
@@ -185,9 +186,15 @@ public:
     JSONWriter& nullValue();
 
 protected:
+    // Constructs a writer that appends data to a memory buffer directly, bypassing virtual calls
+    JSONWriter(char *buf, size_t size);
+
     virtual void write(const char *data, size_t size) = 0;
     virtual void printf(const char *fmt, ...);
 
+    char *buf_;
+    size_t bufSize_, n_;
+
 private:
     enum State {
         BEGIN, // Beginning of a document or a compound value
@@ -196,10 +203,13 @@ private:
     };
 
     State state_;
+    bool direct_;
 
     void writeSeparator();
     void writeEscaped(const char *data, size_t size);
-    void write(char c);
+    void writeUnsigned(unsigned long val, bool neg);
+    void append(const char *data, size_t size);
+    void append(char c);
 };
 
 class JSONStreamWriter: public JSONWriter {
@@ -227,10 +237,6 @@ public:
 protected:
     virtual void write(const char *data, size_t size) override;
     virtual void printf(const char *fmt, ...) override;
-
-private:
-    char *buf_;
-    size_t bufSize_, n_;
 };
 
 bool operator==(const char *str1, const JSONString &str2);
@@ -372,7 +378,19 @@ inline size_t spark::JSONObjectIterator::count() const {
 
 // spark::JSONWriter
 inline spark::JSONWriter::JSONWriter() :
-        state_(BEGIN) {
+        buf_(nullptr),
+        bufSize_(0),
+        n_(0),
+        state_(BEGIN),
+        direct_(false) {
+}
+
+inline spark::JSONWriter::JSONWriter(char *buf, size_t size) :
+        buf_(buf),
+        bufSize_(size),
+        n_(0),
+        state_(BEGIN),
+        direct_(true) {
 }
 
 inline spark::JSONWriter& spark::JSONWriter::name(const char *name) {
@@ -391,8 +409,26 @@ inline spark::JSONWriter& spark::JSONWriter::value(const String &val) {
     return value(val.c_str(), val.length());
 }
 
-inline void spark::JSONWriter::write(char c) {
-    write(&c, 1);
+inline void spark::JSONWriter::append(const char *data, size_t size) {
+    if (direct_) {
+        if (n_ < bufSize_) {
+            memcpy(buf_ + n_, data, std::min(size, bufSize_ - n_));
+        }
+        n_ += size;
+    } else {
+        write(data, size);
+    }
+}
+
+inline void spark::JSONWriter::append(char c) {
+    if (direct_) {
+        if (n_ < bufSize_) {
+            buf_[n_] = c;
+        }
+        ++n_;
+    } else {
+        write(&c, 1);
+    }
 }
 
 // spark::JSONStreamWriter
@@ -410,9 +446,7 @@ inline void spark::JSONStreamWriter::write(const char *data, size_t size) {
 
 // spark::JSONBufferWriter
 inline spark::JSONBufferWriter::JSONBufferWriter(char *buf, size_t size) :
-        buf_(buf),
-        bufSize_(size),
-        n_(0) {
+        JSONWriter(buf, size) {
 }
 
 inline char* spark::JSONBufferWriter::buffer() const {
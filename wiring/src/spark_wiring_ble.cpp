@@ -1101,6 +1101,7 @@ public:
             : connectedCallback_(nullptr),
               disconnectedCallback_(nullptr),
               pairingEventCallback_(nullptr) {
+        indexPeers();
     }
 
     ~BleLocalDeviceImpl() = default;
@@ -1113,10 +1114,28 @@ public:
         return characteristics_;
     }
 
-    Vector<BlePeerDevice>& peers() {
+    const Vector<BlePeerDevice>& peers() const {
         return peers_;
     }
 
+    bool addPeer(const BlePeerDevice& peer) {
+        if (!peers_.append(peer)) {
+            return false;
+        }
+        indexPeers();
+        return true;
+    }
+
+    void removePeer(const BlePeerDevice& peer) {
+        peers_.removeOne(peer);
+        indexPeers();
+    }
+
+    void clearPeers() {
+        peers_.clear();
+        indexPeers();
+    }
+
     void onConnectedCallback(BleOnConnectedCallback callback, void* context) {
         connectedCallback_ = callback ? std::bind(callback, _1, context) : (BleOnConnectedStdFunction)nullptr;
     }
@@ -1142,6 +1161,14 @@ public:
     }
 
     BlePeerDevice* findPeerDevice(BleConnectionHandle connHandle) {
+        // Connection handles are assigned by the SoftDevice in range [0, BLE_MAX_LINK_COUNT)
+        if (connHandle < BLE_MAX_LINK_COUNT) {
+            int index = peerIndices_[connHandle];
+            if (index >= 0 && peers_[index].impl()->connHandle() == connHandle) {
+                return &peers_[index];
+            }
+            return nullptr;
+        }
         for (auto& peer : peers_) {
             if (peer.impl()->connHandle() == connHandle) {
                 return &peer;
@@ -1164,7 +1191,7 @@ public:
                 BlePeerDevice peer;
                 peer.impl()->connHandle() = event->conn_handle;
                 peer.impl()->address() = event->params.connected.info->address;
-                if (!impl->peers_.append(peer)) {
+                if (!impl->addPeer(peer)) {
                     LOG(ERROR, "Failed to append peer Central device.");
                     // FIXME: It will acquire the BLE HAL lock. If there is a thread currently invoking a
                     // BLOCKING BLE HAL API, which means that that API has acquired the BLE HAL lock and relying
@@ -1187,7 +1214,7 @@ public:
                         impl->disconnectedCallback_(*peer);
                     }
                     LOG(TRACE, "Disconnected by remote device.");
-                    impl->peers_.removeOne(*peer);
+                    impl->removePeer(*peer);
                 }
                 break;
             }
@@ -1228,9 +1255,22 @@ public:
     }
 
 private:
+    void indexPeers() {
+        for (auto& index : peerIndices_) {
+            index = -1;
+        }
+        for (int i = 0; i < peers_.size(); i++) {
+            BleConnectionHandle connHandle = peers_[i].impl()->connHandle();
+            if (connHandle < BLE_MAX_LINK_COUNT) {
+                peerIndices_[connHandle] = i;
+            }
+        }
+    }
+
     Vector<BleService> services_;
     Vector<BleCharacteristic> characteristics_;
     Vector<BlePeerDevice> peers_;
+    int8_t peerIndices_[BLE_MAX_LINK_COUNT];     /**< Index of peer in peers_, indexed by connection handle. */
     BleOnConnectedStdFunction connectedCallback_;
     BleOnDisconnectedStdFunction disconnectedCallback_;
     BleOnPairingEventStdFunction pairingEventCallback_;
@@ -1392,6 +1432,20 @@ ssize_t BleCharacteristic::setValue(const uint8_t* buf, size_t len, BleTxRxType
     return SYSTEM_ERROR_INVALID_STATE;
 }
 
+ssize_t BleCharacteristic::streamValue(const uint8_t* buf, size_t len, BleStreamStats* stats) {
+    if (buf == nullptr || len == 0) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    CHECK_TRUE(impl()->isLocal(), SYSTEM_ERROR_NOT_SUPPORTED);
+    CHECK_TRUE(impl()->properties().isSet(BleCharacteristicProperty::NOTIFY), SYSTEM_ERROR_NOT_SUPPORTED);
+    if (stats) {
+        *stats = {};
+        stats->version = BLE_API_VERSION;
+        stats->size = sizeof(BleStreamStats);
+    }
+    return hal_ble_gatt_server_stream_characteristic_value(impl()->attrHandles().value_handle, buf, len, stats, nullptr);
+}
+
 ssize_t BleCharacteristic::setValue(const String& str, BleTxRxType type) {
     return setValue(reinterpret_cast<const uint8_t*>(str.c_str()), str.length(), type);
 }
@@ -1835,7 +1889,7 @@ int BlePeerDevice::connect(const BleAddress& addr, const BleConnectionParams* pa
     bind(addr);
     {
         WiringBleLock lk;
-        if (!BleLocalDevice::getInstance().impl()->peers().append(*this)) {
+        if (!BleLocalDevice::getInstance().impl()->addPeer(*this)) {
             LOG(ERROR, "Cannot add new peer device.");
             lk.unlock();
             hal_ble_gap_disconnect(impl()->connHandle(), nullptr);
@@ -1894,7 +1948,7 @@ int BlePeerDevice::disconnect() const {
     CHECK(hal_ble_gap_disconnect(impl()->connHandle(), nullptr));
     {
         WiringBleLock lk;
-        BleLocalDevice::getInstance().impl()->peers().removeOne(*this);
+        BleLocalDevice::getInstance().impl()->removePeer(*this);
         /*
         * Only the connection handle is invalid. The service and characteristics being
         * discovered previously can be re-used next time once connected if needed.
@@ -1989,7 +2043,7 @@ int BleLocalDevice::end() const {
     disconnectAll(); // BLE HAL will guard that the Peripheral connection is remained if device is in the Listening mode.
     {
         WiringBleLock lk;
-        impl()->peers().clear();
+        impl()->clearPeers();
     }
     stopAdvertising(); // BLE HAL will guard that device keeps broadcasting if device is in the Listening mode.
     stopScanning();
@@ -2005,7 +2059,7 @@ int BleLocalDevice::off() const {
     CHECK(hal_ble_stack_deinit(nullptr));
     {
         WiringBleLock lk;
-        impl()->peers().clear();
+        impl()->clearPeers();
     }
     return SYSTEM_ERROR_NONE;
 }
@@ -2234,6 +2288,262 @@ bool BleLocalDevice::advertising() const {
     return hal_ble_gap_is_advertising(nullptr);
 }
 
+/*
+ * Scan filter compiled into a form that can be evaluated against the raw advertising data
+ * of a scan report, without decoding it into a BleScanResult.
+ */
+class BleScanFilterMatcher {
+public:
+    BleScanFilterMatcher()
+            : addrMask_(0),
+              uuid16Mask_(0),
+              nameLenMask_(0),
+              minRssi_(BLE_RSSI_INVALID),
+              maxRssi_(BLE_RSSI_INVALID),
+              customData_(nullptr),
+              customDataLen_(0) {
+    }
+
+    ~BleScanFilterMatcher() = default;
+
+    void compile(const BleScanFilter& filter) {
+        addresses_.clear();
+        addrMask_ = 0;
+        for (const auto& address : filter.addresses()) {
+            const hal_ble_addr_t addr = address.halAddress();
+            addresses_.append(addr);
+            addrMask_ |= hashBit(addressHash(addr));
+        }
+        uuids16_.clear();
+        uuids128_.clear();
+        uuid16Mask_ = 0;
+        for (const auto& uuid : filter.serviceUUIDs()) {
+            if (uuid.type() == BleUuidType::SHORT) {
+                uuids16_.append(uuid.shorted());
+                uuid16Mask_ |= hashBit(uuid.shorted());
+            } else {
+                uuids128_.append(uuid);
+            }
+        }
+        names_ = filter.deviceNames();
+        nameLenMask_ = 0;
+        for (const auto& name : names_) {
+            nameLenMask_ |= hashBit(name.length());
+        }
+        appearances_ = filter.appearances();
+        minRssi_ = filter.minRssi();
+        maxRssi_ = filter.maxRssi();
+        customData_ = filter.customData(&customDataLen_);
+    }
+
+    /*
+     * This is executed from the HAL scan callback, so it must not allocate memory.
+     */
+    bool match(const hal_ble_scan_result_evt_t* event) const {
+        return matchRssi(event->rssi) &&
+                matchAddress(event->peer_addr) &&
+                matchDeviceName(event) &&
+                matchServiceUuid(event) &&
+                matchAppearance(event) &&
+                matchCustomData(event);
+    }
+
+private:
+    static uint64_t hashBit(unsigned hash) {
+        return (uint64_t)1 << (hash & 0x3f);
+    }
+
+    static unsigned addressHash(const hal_ble_addr_t& addr) {
+        unsigned h = addr.addr_type;
+        for (size_t i = 0; i < BLE_SIG_ADDR_LEN; i++) {
+            h = (h * 31) ^ addr.addr[i];
+        }
+        return h;
+    }
+
+    // Returns the data of the first AD structure of the given type, the same way as BleAdvertisingData::get()
+    static const uint8_t* findAdStructure(const uint8_t* buf, size_t len, BleAdvertisingDataType type, size_t* dataLen) {
+        for (size_t i = 0; (i + 3) <= len; i += buf[i] + 1) {
+            if (buf[i + 1] == static_cast<uint8_t>(type)) {
+                // The length field doesn't include itself but includes the type field
+                if ((i + buf[i] + 1) > len || buf[i] < 2) {
+                    return nullptr;
+                }
+                *dataLen = buf[i] - 1;
+                return buf + i + 2;
+            }
+        }
+        return nullptr;
+    }
+
+    static const uint8_t* findDeviceName(const uint8_t* buf, size_t len, size_t* nameLen) {
+        const uint8_t* name = findAdStructure(buf, len, BleAdvertisingDataType::SHORT_LOCAL_NAME, nameLen);
+        if (!name) {
+            name = findAdStructure(buf, len, BleAdvertisingDataType::COMPLETE_LOCAL_NAME, nameLen);
+        }
+        return name;
+    }
+
+    static ble_sig_appearance_t findAppearance(const uint8_t* buf, size_t len) {
+        size_t dataLen = 0;
+        const uint8_t* data = findAdStructure(buf, len, BleAdvertisingDataType::APPEARANCE, &dataLen);
+        if (!data || dataLen < 2) {
+            return BLE_SIG_APPEARANCE_UNKNOWN;
+        }
+        return (ble_sig_appearance_t)((uint16_t)data[1] << 8 | data[0]);
+    }
+
+    bool matchRssi(int8_t rssi) const {
+        if (minRssi_ != BLE_RSSI_INVALID && rssi < minRssi_) {
+            LOG_DEBUG(TRACE, "Exceed min. RSSI");
+            return false;
+        }
+        if (maxRssi_ != BLE_RSSI_INVALID && rssi > maxRssi_) {
+            LOG_DEBUG(TRACE, "Exceed max. RSSI.");
+            return false;
+        }
+        return true;
+    }
+
+    bool matchAddress(const hal_ble_addr_t& addr) const {
+        if (addresses_.isEmpty()) {
+            return true;
+        }
+        if (addrMask_ & hashBit(addressHash(addr))) {
+            for (const auto& address : addresses_) {
+                if (address.addr_type == addr.addr_type && !memcmp(address.addr, addr.addr, BLE_SIG_ADDR_LEN)) {
+                    return true;
+                }
+            }
+        }
+        LOG_DEBUG(TRACE, "Address mismatched.");
+        return false;
+    }
+
+    bool matchName(const uint8_t* name, size_t len) const {
+        if (!name || !(nameLenMask_ & hashBit(len))) {
+            return false;
+        }
+        for (const auto& filterName : names_) {
+            if (filterName.length() == len && !memcmp(filterName.c_str(), name, len)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool matchDeviceName(const hal_ble_scan_result_evt_t* event) const {
+        if (names_.isEmpty()) {
+            return true;
+        }
+        size_t len = 0;
+        const uint8_t* name = findDeviceName(event->sr_data, event->sr_data_len, &len);
+        if (matchName(name, len)) {
+            return true;
+        }
+        name = findDeviceName(event->adv_data, event->adv_data_len, &len);
+        if (matchName(name, len)) {
+            return true;
+        }
+        LOG_DEBUG(TRACE, "Device name mismatched.");
+        return false;
+    }
+
+    bool matchUuids(const uint8_t* buf, size_t len) const {
+        // Walk the AD structures once and check every 16-bit and 128-bit service UUID found
+        for (size_t i = 0; (i + 3) <= len; i += buf[i] + 1) {
+            const size_t adsLen = buf[i] + 1;
+            if (i + adsLen > len) {
+                break;
+            }
+            const uint8_t type = buf[i + 1];
+            const uint8_t* data = buf + i + 2;
+            const size_t dataLen = adsLen - 2;
+            if (type == BLE_SIG_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE || type == BLE_SIG_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE) {
+                if (uuids16_.isEmpty()) {
+                    continue;
+                }
+                for (size_t j = 0; j + BLE_SIG_UUID_16BIT_LEN <= dataLen; j += BLE_SIG_UUID_16BIT_LEN) {
+                    const uint16_t uuid = (uint16_t)data[j] | ((uint16_t)data[j + 1] << 8);
+                    if (!(uuid16Mask_ & hashBit(uuid))) {
+                        continue;
+                    }
+                    for (const auto& filterUuid : uuids16_) {
+                        if (filterUuid == uuid) {
+                            return true;
+                        }
+                    }
+                }
+            } else if (type == BLE_SIG_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE || type == BLE_SIG_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE) {
+                for (size_t j = 0; j + BLE_SIG_UUID_128BIT_LEN <= dataLen; j += BLE_SIG_UUID_128BIT_LEN) {
+                    for (const auto& filterUuid : uuids128_) {
+                        if (!memcmp(filterUuid.rawBytes(), data + j, BLE_SIG_UUID_128BIT_LEN)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    bool matchServiceUuid(const hal_ble_scan_result_evt_t* event) const {
+        if (uuids16_.isEmpty() && uuids128_.isEmpty()) {
+            return true;
+        }
+        if (matchUuids(event->sr_data, event->sr_data_len) || matchUuids(event->adv_data, event->adv_data_len)) {
+            return true;
+        }
+        LOG_DEBUG(TRACE, "Service UUID mismatched.");
+        return false;
+    }
+
+    bool matchAppearance(const hal_ble_scan_result_evt_t* event) const {
+        if (appearances_.isEmpty()) {
+            return true;
+        }
+        const ble_sig_appearance_t srAppearance = findAppearance(event->sr_data, event->sr_data_len);
+        const ble_sig_appearance_t advAppearance = findAppearance(event->adv_data, event->adv_data_len);
+        for (const auto& appearance : appearances_) {
+            if (appearance == srAppearance || appearance == advAppearance) {
+                return true;
+            }
+        }
+        LOG_DEBUG(TRACE, "Appearance mismatched.");
+        return false;
+    }
+
+    bool matchCustomData(const hal_ble_scan_result_evt_t* event) const {
+        if (!customData_ || customDataLen_ == 0) {
+            return true;
+        }
+        size_t len = 0;
+        const uint8_t* data = findAdStructure(event->sr_data, event->sr_data_len, BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, &len);
+        if (data && len == customDataLen_ && !memcmp(data, customData_, len)) {
+            return true;
+        }
+        data = findAdStructure(event->adv_data, event->adv_data_len, BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, &len);
+        if (data && len == customDataLen_ && !memcmp(data, customData_, len)) {
+            return true;
+        }
+        LOG_DEBUG(TRACE, "Custom data mismatched.");
+        return false;
+    }
+
+    Vector<hal_ble_addr_t> addresses_;
+    Vector<uint16_t> uuids16_;
+    Vector<BleUuid> uuids128_;
+    Vector<String> names_;
+    Vector<ble_sig_appearance_t> appearances_;
+    uint64_t addrMask_; // Bitmap of address hashes
+    uint64_t uuid16Mask_; // Bitmap of 16-bit UUID hashes
+    uint64_t nameLenMask_; // Bitmap of device name lengths
+    int8_t minRssi_;
+    int8_t maxRssi_;
+    const uint8_t* customData_;
+    size_t customDataLen_;
+};
+
 class BleScanDelegator {
 public:
     BleScanDelegator()
@@ -2285,7 +2595,7 @@ public:
     }
 
     BleScanDelegator& setScanFilter(const BleScanFilter& filter) {
-        filter_ = filter;
+        filter_.compile(filter);
         return *this;
     }
 
@@ -2298,20 +2608,15 @@ private:
      */
     static void onScanResultCallback(const hal_ble_scan_result_evt_t* event, void* context) {
         BleScanDelegator* delegator = static_cast<BleScanDelegator*>(context);
+        // Drop the report before constructing any objects if it doesn't match the filter
+        if (!delegator->filter_.match(event)) {
+            return;
+        }
         BleScanResult result = {};
         result.address(event->peer_addr).rssi(event->rssi)
               .scanResponse(event->sr_data, event->sr_data_len)
               .advertisingData(event->adv_data, event->adv_data_len);
 
-        if (!delegator->filterByRssi(result) ||
-              !delegator->filterByAddress(result) ||
-              !delegator->filterByDeviceName(result) ||
-              !delegator->filterByServiceUUID(result) ||
-              !delegator->filterByAppearance(result) ||
-              !delegator->filterByCustomData(result)) {
-            return;
-        }
-
         if (delegator->scanResultCallback_) {
             delegator->foundCount_++;
             delegator->scanResultCallback_(&result);
@@ -2335,152 +2640,13 @@ private:
         delegator->resultsVector_.append(result);
     }
 
-    bool filterByRssi(const BleScanResult& result) {
-        int8_t filterRssi = filter_.minRssi();
-        if (filterRssi != BLE_RSSI_INVALID && result.rssi() < filterRssi) {
-            LOG_DEBUG(TRACE, "Exceed min. RSSI");
-            return false;
-        }
-        filterRssi = filter_.maxRssi();
-        if (filterRssi != BLE_RSSI_INVALID && result.rssi() > filterRssi) {
-            LOG_DEBUG(TRACE, "Exceed max. RSSI.");
-            return false;
-        }
-        return true;
-    }
-
-    bool filterByAddress(const BleScanResult& result) {
-        auto filerAddresses = filter_.addresses();
-        if (filerAddresses.size() > 0) {
-            for (const auto& address : filerAddresses) {
-                if (address == result.address()) {
-                    return true;
-                }
-            }
-            LOG_DEBUG(TRACE, "Address mismatched.");
-            return false;
-        }
-        return true;
-    }
-
-    bool filterByDeviceName(const BleScanResult& result) {
-        auto filterDeviceNames = filter_.deviceNames();
-        if (filterDeviceNames.size() > 0) {
-            String srName = result.scanResponse().deviceName();
-            String advName = result.advertisingData().deviceName();
-            if (srName.length() == 0 && advName.length() == 0) {
-                LOG_DEBUG(TRACE, "Device name mismatched.");
-                return false;
-            }
-            for (const auto& name : filterDeviceNames) {
-                if (name == srName || name == advName) {
-                    return true;
-                }
-            }
-            LOG_DEBUG(TRACE, "Device name mismatched.");
-            return false;
-        }
-        return true;
-    }
-
-    bool filterByServiceUUID(const BleScanResult& result) {
-        auto filterServiceUuids = filter_.serviceUUIDs();
-        if (filterServiceUuids.size() > 0) {
-            const Vector<BleUuid>& srUuids = result.scanResponse().serviceUUID();
-            const Vector<BleUuid>& advUuids = result.advertisingData().serviceUUID();
-            if (srUuids.size() <= 0 && advUuids.size() <= 0) {
-                LOG_DEBUG(TRACE, "Service UUID mismatched.");
-                return false;
-            }
-            for (const auto& uuid : filterServiceUuids) {
-                for (const auto& found : srUuids) {
-                    if (uuid == found) {
-                        return true;
-                    }
-                }
-                for (const auto& found : advUuids) {
-                    if (uuid == found) {
-                        return true;
-                    }
-                }
-            }
-            LOG_DEBUG(TRACE, "Service UUID mismatched.");
-            return false;
-        }
-        return true;
-    }
-
-    bool filterByAppearance(const BleScanResult& result) {
-        auto filterAppearances = filter_.appearances();
-        if (filterAppearances.size() > 0) {
-            ble_sig_appearance_t srAppearance = result.scanResponse().appearance();
-            ble_sig_appearance_t advAppearance = result.advertisingData().appearance();
-            for (const auto& appearance : filterAppearances) {
-                if (appearance == srAppearance || appearance == advAppearance) {
-                    return true;
-                }
-            }
-            LOG_DEBUG(TRACE, "Appearance mismatched.");
-            return false;
-        }
-        return true;
-    }
-
-    bool filterByCustomData(const BleScanResult& result) {
-        size_t filterCustomDatalen;
-        const uint8_t* filterCustomData = filter_.customData(&filterCustomDatalen);
-        if (filterCustomData != nullptr && filterCustomDatalen > 0) {
-            size_t srLen = result.scanResponse().get(BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, nullptr, sizeof(size_t));
-            size_t advLen = result.advertisingData().get(BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, nullptr, sizeof(size_t));
-            if (srLen != filterCustomDatalen && advLen != filterCustomDatalen) {
-                LOG_DEBUG(TRACE, "Custom data mismatched.");
-                return false;
-            }
-            if (srLen == filterCustomDatalen) {
-                uint8_t* buf = (uint8_t*)malloc(srLen);
-                SCOPE_GUARD({
-                    if (buf) {
-                        free(buf);
-                    }
-                });
-                if (!buf) {
-                    LOG(ERROR, "Failed to allocate memory!");
-                    return false;
-                }
-                result.scanResponse().get(BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, buf, srLen);
-                if (!memcmp(buf, filterCustomData, srLen)) {
-                    return true;
-                }
-            }
-            if (advLen == filterCustomDatalen) {
-                uint8_t* buf = (uint8_t*)malloc(advLen);
-                SCOPE_GUARD({
-                    if (buf) {
-                        free(buf);
-                    }
-                });
-                if (!buf) {
-                    LOG(ERROR, "Failed to allocate memory!");
-                    return false;
-                }
-                result.advertisingData().get(BleAdvertisingDataType::MANUFACTURER_SPECIFIC_DATA, buf, advLen);
-                if (!memcmp(buf, filterCustomData, advLen)) {
-                    return true;
-                }
-            }
-            LOG_DEBUG(TRACE, "Custom data mismatched.");
-            return false;
-        }
-        return true;
-    }
-
     Vector<BleScanResult> resultsVector_;
     BleScanResult* resultsPtr_;
     size_t targetCount_;
     size_t foundCount_;
     std::function<void(const BleScanResult*)> scanResultCallback_;
     BleOnScanResultStdFunction scanResultCallbackRef_;
-    BleScanFilter filter_;
+    BleScanFilterMatcher filter_;
 };
 
 int BleLocalDevice::setScanTimeout(uint16_t timeout) const {
@@ -2685,7 +2851,7 @@ int BleLocalDevice::disconnect() const {
             lk.unlock(); // To allow HAL BLE thread to invoke wiring callback
             CHECK(hal_ble_gap_disconnect(p.impl()->connHandle(), nullptr));
             lk.lock();
-            impl()->peers().removeOne(p);
+            impl()->removePeer(p);
             return SYSTEM_ERROR_NONE;
         }
     }
@@ -23,9 +23,132 @@
 #include <cstdlib>
 #include <cstdarg>
 #include <cctype>
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
 
 namespace {
 
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+const unsigned MAX_UINT64_DIGITS = 20;
+
+// Maximum precision and magnitude of a floating point value that can be formatted without vsnprintf()
+const int MAX_FAST_DOUBLE_PRECISION = 9;
+const double MAX_FAST_DOUBLE_SCALED = 1e15;
+const size_t FAST_DOUBLE_BUF_SIZE = 32;
+
+const uint64_t POW10[] = { 1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+        1000000000ull, 10000000000ull };
+
+// Returns true if a character doesn't need to be escaped. Bytes of multibyte UTF-8 sequences
+// are written as is
+inline bool isPlainChar(char c) {
+    return (unsigned char)c >= 0x20 && c != 0x7f && c != '"' && c != '\\';
+}
+
+// Writes a decimal representation of an unsigned value to the buffer ending at `end`.
+// Returns a pointer to the first character
+char* formatDecimal(uint64_t val, char *end) {
+    do {
+        *--end = '0' + val % 10;
+        val /= 10;
+    } while (val);
+    return end;
+}
+
+// Rounds |val| * 10^precision to the nearest integer. Returns false if the value is out of range
+// or too close to a rounding boundary for the result to be guaranteed to match vsnprintf()
+bool roundScaled(double val, int precision, uint64_t *result) {
+    if (!std::isfinite(val) || precision < 0 || precision > MAX_FAST_DOUBLE_PRECISION) {
+        return false;
+    }
+    const double scaled = std::fabs(val) * (double)POW10[precision];
+    if (scaled >= MAX_FAST_DOUBLE_SCALED) {
+        return false;
+    }
+    const double intPart = std::floor(scaled);
+    const double frac = scaled - intPart;
+    // The product above can be off by a few ULPs, so ties and near-ties are left to vsnprintf()
+    const double err = (scaled + 1.0) * DBL_EPSILON * 4;
+    if (std::fabs(frac - 0.5) <= err) {
+        return false;
+    }
+    *result = (uint64_t)intPart + (frac > 0.5 ? 1 : 0);
+    return true;
+}
+
+// Formats a value rounded to `precision` digits of the fractional part, the same way as "%.*f"
+size_t formatDigits(uint64_t scaled, int precision, bool neg, char *buf) {
+    char tmp[FAST_DOUBLE_BUF_SIZE];
+    char* const end = tmp + sizeof(tmp);
+    char* p = end;
+    if (precision > 0) {
+        p = formatDecimal(scaled % POW10[precision] + POW10[precision], p); // Keep leading zeros
+        *p = '.'; // Replace the extra leading digit
+        scaled /= POW10[precision];
+    }
+    p = formatDecimal(scaled, p);
+    if (neg) {
+        *--p = '-';
+    }
+    const size_t n = end - p;
+    memcpy(buf, p, n);
+    return n;
+}
+
+// Formats a value in fixed-point notation. Returns 0 if the value should be formatted via vsnprintf() instead
+size_t formatFixed(double val, int precision, char *buf) {
+    uint64_t scaled = 0;
+    if (!roundScaled(val, precision, &scaled)) {
+        return 0;
+    }
+    return formatDigits(scaled, precision, std::signbit(val), buf);
+}
+
+// Formats a value the same way as "%g". Returns 0 if the value should be formatted via vsnprintf() instead
+size_t formatGeneral(double val, char *buf) {
+    const double absVal = std::fabs(val);
+    if (!std::isfinite(val) || (absVal != 0.0 && absVal < 1e-4) || absVal >= 1e6) {
+        return 0; // Exponential notation may be needed
+    }
+    // Decimal exponent of the value
+    int exp = 0;
+    if (absVal != 0.0) {
+        exp = -4;
+        while (exp < 5 && absVal >= (double)POW10[exp + 5] / 1e4) {
+            ++exp;
+        }
+    }
+    // 6 significant digits
+    int precision = 5 - exp;
+    uint64_t scaled = 0;
+    if (!roundScaled(val, precision, &scaled)) {
+        return 0;
+    }
+    if (scaled >= POW10[6]) {
+        // The value got rounded up to the next power of 10
+        if (exp == 5) {
+            return 0;
+        }
+        --precision;
+        if (!roundScaled(val, precision, &scaled)) {
+            return 0;
+        }
+    }
+    size_t n = formatDigits(scaled, precision, std::signbit(val), buf);
+    if (precision > 0) {
+        // Remove trailing zeros and the decimal point
+        while (buf[n - 1] == '0') {
+            --n;
+        }
+        if (buf[n - 1] == '.') {
+            --n;
+        }
+    }
+    return n;
+}
+
 // Skips token and all its children tokens if any
 const jsmntok_t* skipToken(const jsmntok_t *t) {
     size_t n = 1;
@@ -407,26 +530,26 @@ bool spark::JSONArrayIterator::next() {
 // spark::JSONWriter
 spark::JSONWriter& spark::JSONWriter::beginArray() {
     writeSeparator();
-    write('[');
+    append('[');
     state_ = BEGIN;
     return *this;
 }
 
 spark::JSONWriter& spark::JSONWriter::endArray() {
-    write(']');
+    append(']');
     state_ = NEXT;
     return *this;
 }
 
 spark::JSONWriter& spark::JSONWriter::beginObject() {
     writeSeparator();
-    write('{');
+    append('{');
     state_ = BEGIN;
     return *this;
 }
 
 spark::JSONWriter& spark::JSONWriter::endObject() {
-    write('}');
+    append('}');
     state_ = NEXT;
     return *this;
 }
@@ -441,52 +564,62 @@ spark::JSONWriter& spark::JSONWriter::name(const char *name, size_t size) {
 spark::JSONWriter& spark::JSONWriter::value(bool val) {
     writeSeparator();
     if (val) {
-        write("true", 4);
+        append("true", 4);
     } else {
-        write("false", 5);
+        append("false", 5);
     }
     state_ = NEXT;
     return *this;
 }
 
 spark::JSONWriter& spark::JSONWriter::value(int val) {
-    writeSeparator();
-    printf("%d", val);
-    state_ = NEXT;
-    return *this;
+    return value((long)val);
 }
 
 spark::JSONWriter& spark::JSONWriter::value(unsigned val) {
-    writeSeparator();
-    printf("%u", val);
-    state_ = NEXT;
-    return *this;
+    return value((unsigned long)val);
 }
 
 spark::JSONWriter& spark::JSONWriter::value(long val) {
     writeSeparator();
-    printf("%ld", val);
+    if (val < 0) {
+        writeUnsigned((unsigned long)-(val + 1) + 1, true);
+    } else {
+        writeUnsigned(val, false);
+    }
     state_ = NEXT;
     return *this;
 }
 
 spark::JSONWriter& spark::JSONWriter::value(unsigned long val) {
     writeSeparator();
-    printf("%lu", val);
+    writeUnsigned(val, false);
     state_ = NEXT;
     return *this;
 }
 
 spark::JSONWriter& spark::JSONWriter::value(double val, int precision) {
     writeSeparator();
-    printf("%.*lf", precision, val);
+    char buf[FAST_DOUBLE_BUF_SIZE];
+    const size_t n = formatFixed(val, precision, buf);
+    if (n) {
+        append(buf, n);
+    } else {
+        printf("%.*lf", precision, val);
+    }
     state_ = NEXT;
     return *this;
 }
 
 spark::JSONWriter& spark::JSONWriter::value(double val) {
     writeSeparator();
-    printf("%g", val);
+    char buf[FAST_DOUBLE_BUF_SIZE];
+    const size_t n = formatGeneral(val, buf);
+    if (n) {
+        append(buf, n);
+    } else {
+        printf("%g", val);
+    }
     state_ = NEXT;
     return *this;
 }
@@ -500,7 +633,7 @@ spark::JSONWriter& spark::JSONWriter::value(const char *val, size_t size) {
 
 spark::JSONWriter& spark::JSONWriter::nullValue() {
     writeSeparator();
-    write("null", 4);
+    append("null", 4);
     state_ = NEXT;
     return *this;
 }
@@ -517,20 +650,20 @@ void spark::JSONWriter::printf(const char *fmt, ...) {
         n = vsnprintf(buf, sizeof(buf), fmt, args);
         va_end(args);
         if (n > 0) {
-            write(buf, n);
+            append(buf, n);
         }
     } else if (n > 0) {
-        write(buf, n);
+        append(buf, n);
     }
 }
 
 void spark::JSONWriter::writeSeparator() {
     switch (state_) {
     case NEXT:
-        write(',');
+        append(',');
         break;
     case VALUE:
-        write(':');
+        append(':');
         break;
     default:
         break;
@@ -538,47 +671,65 @@ void spark::JSONWriter::writeSeparator() {
 }
 
 void spark::JSONWriter::writeEscaped(const char *str, size_t size) {
-    write('"');
+    append('"');
     const char* const end = str + size;
     const char *s = str;
     while (s != end) {
         const char c = *s;
-        if (c == '"' || c == '\\' || !std::isprint((unsigned char)c)) {
-            write(str, s - str); // Write preceeding characters
-            write('\\');
+        if (!isPlainChar(c)) {
+            if (s != str) {
+                append(str, s - str); // Write preceeding characters
+            }
+            char esc[6] = { '\\', c };
+            size_t escSize = 2;
             switch (c) {
             case '"':
             case '\\':
-                write(c);
                 break;
             case 0x08: // Backspace
-                write('b');
+                esc[1] = 'b';
                 break;
             case 0x09: // Tab
-                write('t');
+                esc[1] = 't';
                 break;
             case 0x0a: // Line feed
-                write('n');
+                esc[1] = 'n';
                 break;
             case 0x0c: // Form feed
-                write('f');
+                esc[1] = 'f';
                 break;
             case 0x0d: // Carriage return
-                write('r');
+                esc[1] = 'r';
                 break;
             default:
                 // All other control characters are written in hex, e.g. "\u001f"
-                printf("u%04x", (unsigned)c);
+                esc[1] = 'u';
+                esc[2] = '0';
+                esc[3] = '0';
+                esc[4] = HEX_DIGITS[((unsigned char)c >> 4) & 0x0f];
+                esc[5] = HEX_DIGITS[(unsigned char)c & 0x0f];
+                escSize = 6;
                 break;
             }
+            append(esc, escSize);
             str = s + 1;
         }
         ++s;
     }
     if (s != str) {
-        write(str, s - str); // Write remaining characters
+        append(str, s - str); // Write remaining characters
+    }
+    append('"');
+}
+
+void spark::JSONWriter::writeUnsigned(unsigned long val, bool neg) {
+    char buf[MAX_UINT64_DIGITS + 1];
+    char* const end = buf + sizeof(buf);
+    char* p = formatDecimal(val, end);
+    if (neg) {
+        *--p = '-';
     }
-    write('"');
+    append(p, end - p);
 }
 
 // spark::JSONBufferWriter
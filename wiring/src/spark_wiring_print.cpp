@@ -27,10 +27,343 @@
 #include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+#include <algorithm>
 #include "spark_wiring_print.h"
 #include "spark_wiring_string.h"
 #include "spark_wiring_stream.h"
 
+namespace {
+
+// Size of the buffer used to pass formatted output of Print::vprintf() to the stream in chunks
+const size_t PRINTF_BUFFER_SIZE = 64;
+
+// Maximum size of a single conversion specification, e.g. "%-08.3lf"
+const size_t PRINTF_MAX_SPEC_SIZE = 32;
+
+enum class ArgLength {
+    NONE,
+    HH, // hh
+    H, // h
+    L, // l
+    LL, // ll
+    J, // j
+    Z, // z
+    T, // t
+    LD // L
+};
+
+// Formats printf() output into a small buffer and writes it to the stream in chunks
+class PrintfWriter {
+public:
+    explicit PrintfWriter(Print* p)
+            : p_(p),
+              size_(0),
+              count_(0),
+              total_(0) {
+    }
+
+    void write(const char* data, size_t size) {
+        total_ += size;
+        if (size_ + size > sizeof(buf_)) {
+            flush();
+            if (size >= sizeof(buf_)) {
+                count_ += p_->write((const uint8_t*)data, size);
+                return;
+            }
+        }
+        memcpy(buf_ + size_, data, size);
+        size_ += size;
+    }
+
+    void fill(char c, size_t count) {
+        while (count > 0) {
+            if (size_ == sizeof(buf_)) {
+                flush();
+            }
+            const size_t n = std::min(count, sizeof(buf_) - size_);
+            memset(buf_ + size_, c, n);
+            size_ += n;
+            total_ += n;
+            count -= n;
+        }
+    }
+
+    template<typename... ArgsT>
+    void format(const char* spec, ArgsT... args) {
+        char buf[PRINTF_BUFFER_SIZE];
+        const int n = snprintf(buf, sizeof(buf), spec, args...);
+        if (n <= 0) {
+            return;
+        }
+        if ((size_t)n < sizeof(buf)) {
+            write(buf, n);
+        } else {
+            // Output of a single conversion doesn't fit the buffer, e.g. "%f" with a very large value
+            char bigger[n + 1];
+            snprintf(bigger, sizeof(bigger), spec, args...);
+            write(bigger, n);
+        }
+    }
+
+    void flush() {
+        if (size_ > 0) {
+            count_ += p_->write((const uint8_t*)buf_, size_);
+            size_ = 0;
+        }
+    }
+
+    // Number of bytes written to the stream
+    size_t count() const {
+        return count_;
+    }
+
+    // Number of characters formatted so far, including buffered ones
+    size_t total() const {
+        return total_;
+    }
+
+private:
+    Print* p_;
+    char buf_[PRINTF_BUFFER_SIZE];
+    size_t size_;
+    size_t count_;
+    size_t total_;
+};
+
+template<typename T>
+void formatValue(PrintfWriter* w, const char* spec, bool widthArg, int width, bool precArg, int prec, T val) {
+    if (widthArg && precArg) {
+        w->format(spec, width, prec, val);
+    } else if (widthArg) {
+        w->format(spec, width, val);
+    } else if (precArg) {
+        w->format(spec, prec, val);
+    } else {
+        w->format(spec, val);
+    }
+}
+
+template<typename T>
+void storeCount(PrintfWriter* w, va_list* ap) {
+    T* const p = va_arg(*ap, T*);
+    if (p) {
+        *p = (T)w->total();
+    }
+}
+
+const char* parseNumber(const char* p, int* val) {
+    *val = 0;
+    while (*p >= '0' && *p <= '9') {
+        *val = *val * 10 + (*p - '0');
+        ++p;
+    }
+    return p;
+}
+
+// Formats a single conversion specification and returns a pointer to the next character of the format string.
+// Strings are written to the stream as is, other conversions are formatted one by one via snprintf()
+const char* formatArg(PrintfWriter* w, const char* fmt, va_list* ap) {
+    const char* p = fmt + 1; // Skip '%'
+    bool left = false;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' || *p == '\'') {
+        if (*p == '-') {
+            left = true;
+        }
+        ++p;
+    }
+    int width = 0;
+    bool widthArg = false;
+    if (*p == '*') {
+        width = va_arg(*ap, int);
+        widthArg = true;
+        ++p;
+    } else {
+        p = parseNumber(p, &width);
+    }
+    int prec = -1;
+    bool precArg = false;
+    if (*p == '.') {
+        ++p;
+        if (*p == '*') {
+            prec = va_arg(*ap, int);
+            precArg = true;
+            ++p;
+        } else {
+            p = parseNumber(p, &prec);
+        }
+    }
+    ArgLength len = ArgLength::NONE;
+    switch (*p) {
+    case 'h':
+        len = (*++p == 'h') ? (++p, ArgLength::HH) : ArgLength::H;
+        break;
+    case 'l':
+        len = (*++p == 'l') ? (++p, ArgLength::LL) : ArgLength::L;
+        break;
+    case 'j':
+        len = ArgLength::J;
+        ++p;
+        break;
+    case 'z':
+        len = ArgLength::Z;
+        ++p;
+        break;
+    case 't':
+        len = ArgLength::T;
+        ++p;
+        break;
+    case 'L':
+        len = ArgLength::LD;
+        ++p;
+        break;
+    default:
+        break;
+    }
+    const char conv = *p;
+    if (!conv) {
+        w->write(fmt, p - fmt); // Incomplete specification
+        return p;
+    }
+    ++p;
+    const size_t specSize = p - fmt;
+    if (conv == '%') {
+        w->write("%", 1);
+        return p;
+    }
+    if (conv == 's' && len == ArgLength::NONE) {
+        const char* str = va_arg(*ap, const char*);
+        if (!str) {
+            str = "(null)";
+        }
+        const size_t n = (prec >= 0) ? strnlen(str, prec) : strlen(str);
+        if (width < 0) {
+            left = true;
+            width = -width;
+        }
+        const size_t pad = ((size_t)width > n) ? width - n : 0;
+        if (!left) {
+            w->fill(' ', pad);
+        }
+        w->write(str, n);
+        if (left) {
+            w->fill(' ', pad);
+        }
+        return p;
+    }
+    if (specSize >= PRINTF_MAX_SPEC_SIZE) {
+        w->write(fmt, specSize); // Not a valid specification
+        return p;
+    }
+    char spec[PRINTF_MAX_SPEC_SIZE];
+    memcpy(spec, fmt, specSize);
+    spec[specSize] = '\0';
+    switch (conv) {
+    case 'd':
+    case 'i':
+        switch (len) {
+        case ArgLength::L:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, long));
+            break;
+        case ArgLength::LL:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, long long));
+            break;
+        case ArgLength::J:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, intmax_t));
+            break;
+        case ArgLength::Z:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, ssize_t));
+            break;
+        case ArgLength::T:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, ptrdiff_t));
+            break;
+        default:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, int));
+            break;
+        }
+        break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        switch (len) {
+        case ArgLength::L:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, unsigned long));
+            break;
+        case ArgLength::LL:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, unsigned long long));
+            break;
+        case ArgLength::J:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, uintmax_t));
+            break;
+        case ArgLength::Z:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, size_t));
+            break;
+        case ArgLength::T:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, ptrdiff_t));
+            break;
+        default:
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, unsigned));
+            break;
+        }
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        if (len == ArgLength::LD) {
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, long double));
+        } else {
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, double));
+        }
+        break;
+    case 'c':
+        if (len == ArgLength::L) {
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, wint_t));
+        } else {
+            formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, int));
+        }
+        break;
+    case 's': // Wide string
+        formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, const wchar_t*));
+        break;
+    case 'p':
+        formatValue(w, spec, widthArg, width, precArg, prec, va_arg(*ap, void*));
+        break;
+    case 'n':
+        switch (len) {
+        case ArgLength::HH:
+            storeCount<signed char>(w, ap);
+            break;
+        case ArgLength::H:
+            storeCount<short>(w, ap);
+            break;
+        case ArgLength::L:
+            storeCount<long>(w, ap);
+            break;
+        case ArgLength::LL:
+            storeCount<long long>(w, ap);
+            break;
+        default:
+            storeCount<int>(w, ap);
+            break;
+        }
+        break;
+    default:
+        w->write(fmt, specSize); // Unknown conversion
+        break;
+    }
+    return p;
+}
+
+} // namespace
+
 // Public Methods //////////////////////////////////////////////////////////////
 
 /* default implementation: may be overridden */
@@ -213,26 +546,26 @@ size_t Print::printFloat(double number, uint8_t digits)
 
 size_t Print::vprintf(bool newline, const char* format, va_list args)
 {
-    const int bufsize = 20;
-    char test[bufsize];
-    va_list args2;
-    va_copy(args2, args);
-    size_t n = vsnprintf(test, bufsize, format, args);
-
-    if (n<bufsize)
-    {
-        n = print(test);
-    }
-    else
-    {
-        char bigger[n+1];
-        n = vsnprintf(bigger, n+1, format, args2);
-        n = print(bigger);
-    }
-    if (newline)
-        n += println();
-
-    va_end(args2);
-    return n;
+    PrintfWriter w(this);
+    va_list ap;
+    va_copy(ap, args);
+    const char* p = format;
+    for (;;) {
+        const char* const spec = strchr(p, '%');
+        if (!spec) {
+            w.write(p, strlen(p));
+            break;
+        }
+        if (spec != p) {
+            w.write(p, spec - p);
+        }
+        p = formatArg(&w, spec, &ap);
+    }
+    va_end(ap);
+    if (newline) {
+        w.write("\r\n", 2);
+    }
+    w.flush();
+    return w.count();
 }
 